@@ -29,12 +29,16 @@ static size_t accumulator_width = 0;									///< The width (2^accumulator_width
 static bool parameter_ascii_query_parser = false;					///< When true use the ASCII pre-casefolded query parser
 static bool parameter_help = false;										///< Print the usage information
 static bool parameter_index_v2 = false;								///< The index is a JASS version 2 index
+static size_t parameter_checksum_threads = 0;						///< Number of threads to use to verify the index checksums (0 = don't verify)
+static size_t parameter_postings_cache_mb = 0;						///< Size (in MB) of the cache of segments read from disk on demand (0 = load the postings into memory)
+static std::string parameter_shards;									///< Comma seperated list of directories, each holding one shard of a document-partitioned index
 std::string parameter_accumulator_manager = "2d_heap";	///< Which accumulator manager to use
 
 static std::string parameters_errors;									///< Any errors as a result of command line parsing
 static auto parameters = std::make_tuple								///< The  command line parameter block
 	(
 	JASS::commandline::parameter("-?",   "--help",         "                      Print this help.", parameter_help),
+	JASS::commandline::parameter("-D",   "--direct",       "<megabytes>           Read segments from disk on demand (direct I/O) with a cache of this size [default = -D0 (load the postings)]", parameter_postings_cache_mb),
 	JASS::commandline::parameter("-h",   "--help",         "                      Print this help.", parameter_help),
 	JASS::commandline::parameter("-2",   "--v2_index",     "                      The index is a JASS v2 index", parameter_index_v2),
 	JASS::commandline::parameter("-I2",  "--v2_index",     "                      The index is a JASS v2 index", parameter_index_v2),
@@ -44,7 +48,9 @@ static auto parameters = std::make_tuple								///< The  command line parameter
 	JASS::commandline::parameter("-q",   "--queryfile",    "<filename>            Name of file containing a list of queries (1 per line, each line prefixed with query-id)", parameter_queryfilename),
 	JASS::commandline::parameter("-r",   "--rho",          "<integer_percent>     Percent of the collection size to use as max number of postings to process [default = -r100] (overrides -R)", rho),
 	JASS::commandline::parameter("-R",   "--RHO",          "<integer_max>         Max number of postings to process [default is all]", maximum_number_of_postings_to_process),
+	JASS::commandline::parameter("-S",   "--shards",       "<dir,dir,...>         Search a document-partitioned index, one shard in each directory [default = the current directory]", parameter_shards),
 	JASS::commandline::parameter("-t",   "--threads",      "<threadcount>         Number of threads to use (one query per thread) [default = -t1]", parameter_threads),
+	JASS::commandline::parameter("-V",   "--verify",       "<threadcount>         Verify the index checksums on load using this many threads [default = -V0 (don't verify)]", parameter_checksum_threads),
 	JASS::commandline::parameter("-w",   "--width",        "<2^w>                 The width of the 2D accumulator array (2^w is used)", accumulator_width)
 	);
 
@@ -109,6 +115,31 @@ void load_queries(std::vector<JASS_anytime_query> &query_list, const std::string
 	delete input;
 	}
 
+/*
+	SPLIT_SHARD_LIST()
+	------------------
+*/
+std::vector<std::string> split_shard_list(const std::string &list)
+	{
+	std::vector<std::string> directories;
+	size_t start = 0;
+
+	/*
+		The list is a comma seperated list of directory names
+	*/
+	while (start <= list.size())
+		{
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+		if (end != start)
+			directories.push_back(list.substr(start, end - start));
+		start = end + 1;
+		}
+
+	return directories;
+	}
+
 /*
 	USAGE()
 	-------
@@ -173,9 +204,20 @@ static int main_event(int argc, const char *argv[])
 	/*
 		Read the index into memory
 	*/
-	if (engine.load_index(parameter_index_v2 ? 2 : 1, "", true) != JASS_ERROR_OK)
+	engine.set_checksum_verification(parameter_checksum_threads);
+	engine.set_postings_on_demand(parameter_postings_cache_mb * 1024 * 1024);
+	JASS_ERROR loaded;
+	if (parameter_shards.size() == 0)
+		loaded = engine.load_index(parameter_index_v2 ? 2 : 1, "", true);
+	else
+		loaded = engine.load_sharded_index(parameter_index_v2 ? 2 : 1, split_shard_list(parameter_shards), true);
+
+	if (loaded != JASS_ERROR_OK)
 		{
-		std::cout << "Cannot load the index\n";
+		if (loaded == JASS_ERROR_BAD_CHECKSUM)
+			std::cout << "Cannot load the index, it failed checksum verification\n";
+		else
+			std::cout << "Cannot load the index\n";
 		return 0;
 		}
 	stats.number_of_documents = engine.get_document_count();
@@ -248,16 +290,26 @@ static int main_event(int argc, const char *argv[])
 	*/
 	std::ostringstream TREC_file;
 	std::ostringstream stats_file;
+	size_t segments_failed = 0;
+	size_t incomplete_queries = 0;
 	stats_file << "<JASSv2stats>\n";
 	for (size_t which = 0; which < parameter_threads ; which++)
 		for (const auto &[query_id, result] : output[which])
 			{
-			stats_file << "<id>" << result.query_id << "</id><query>" << result.query << "</query><postings>" << result.postings_processed << "</postings><time_ns>" << result.search_time_in_ns << "</time_ns>\n";
+			stats_file << "<id>" << result.query_id << "</id><query>" << result.query << "</query><postings>" << result.postings_processed << "</postings><time_ns>" << result.search_time_in_ns << "</time_ns>";
+			if (result.segments_failed != 0)
+				stats_file << "<segments_failed>" << result.segments_failed << "</segments_failed>";
+			stats_file << "\n";
 			stats.sum_of_CPU_time_in_ns += result.search_time_in_ns;
 			TREC_file << result.results_list;
+			segments_failed += result.segments_failed;
+			incomplete_queries += result.segments_failed != 0;
 			}
 	stats_file << "</JASSv2stats>\n";
 
+	if (segments_failed != 0)
+		std::cout << "WARNING: " << segments_failed << " segments could not be read from disk, so the results of " << incomplete_queries << " queries are incomplete\n";
+
 	JASS::file::write_entire_file("ranking.txt", TREC_file.str());
 	JASS::file::write_entire_file("JASSv2Stats.txt", stats_file.str());
 
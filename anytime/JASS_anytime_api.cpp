@@ -4,17 +4,26 @@
 	Copyright (c) 2021 Andrew Trotman
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+
 #include "timer.h"
+#include "asserts.h"
 #include "threads.h"
 #include "query_heap.h"
 #include "run_export.h"
 #include "top_k_limit.h"
 #include "query_simple.h"
 #include "parser_query.h"
+#include "merge_jass_v2.h"
+#include "unittest_data.h"
 #include "JASS_anytime_api.h"
 #include "JASS_anytime_query.h"
 #include "JASS_anytime_stats.h"
+#include "serialise_jass_v2.h"
 #include "deserialised_jass_v2.h"
+#include "index_manager_sequential.h"
 #include "JASS_anytime_thread_result.h"
 #include "JASS_anytime_accumulator_manager.h"
 
@@ -33,7 +42,6 @@ void JASS_anytime_api::anytime_bootstrap(JASS_anytime_api *thiss, JASS_anytime_t
 */
 JASS_anytime_api::JASS_anytime_api()
 	{
-	index = nullptr;
 	postings_to_process = (std::numeric_limits<size_t>::max)();
 	relative_postings_to_process = 1;
 	top_k = 10;
@@ -41,6 +49,12 @@ JASS_anytime_api::JASS_anytime_api()
 	accumulator_width = 0;
 	stats.threads = 1;
 	accumulator_manager = "2d_heap";
+	checksum_threads = 0;
+	postings_cache_size = 0;
+	postings_io_threads = 8;
+	merger_fan_in = 4;
+	merger_pending = false;
+	merger_stopping = false;
 	}
 
 /*
@@ -49,39 +63,278 @@ JASS_anytime_api::JASS_anytime_api()
 */
 JASS_anytime_api::~JASS_anytime_api()
 	{
-	delete index;
+	stop_segment_merger();
+	}
+
+/*
+	JASS_ANYTIME_API::SHARD_WORKER::SHARD_WORKER()
+	----------------------------------------------
+*/
+JASS_anytime_api::shard_worker::shard_worker(shard_search &search, const shard &index) :
+	search(search),
+	index(index),
+	busy(false),
+	stopping(false),
+	scale_rsv_scores(false),
+	largest_possible_rsv_with_overflow(0),
+	query_terms_count(0)
+	{
+	worker.reset(new JASS::thread(run, this));
+	}
+
+/*
+	JASS_ANYTIME_API::SHARD_WORKER::~SHARD_WORKER()
+	-----------------------------------------------
+*/
+JASS_anytime_api::shard_worker::~shard_worker()
+	{
+	{
+	std::lock_guard<std::mutex> lock(mutex);
+	stopping = true;
+	}
+	wake.notify_all();
+	worker->join();
+	}
+
+/*
+	JASS_ANYTIME_API::SHARD_WORKER::RUN()
+	-------------------------------------
+*/
+void JASS_anytime_api::shard_worker::run(shard_worker *thiss)
+	{
+	std::unique_lock<std::mutex> lock(thiss->mutex);
+	while (true)
+		{
+		thiss->wake.wait(lock, [thiss]{ return thiss->busy || thiss->stopping; });
+		if (!thiss->busy)
+			return;
+
+		/*
+			Search the shard without holding the lock then tell wait() it is done
+		*/
+		lock.unlock();
+		search_shard(thiss->search, thiss->index, thiss->scale_rsv_scores, thiss->largest_possible_rsv_with_overflow, thiss->query_terms_count);
+		lock.lock();
+		thiss->busy = false;
+		thiss->wake.notify_all();
+		}
+	}
+
+/*
+	JASS_ANYTIME_API::SHARD_WORKER::START()
+	---------------------------------------
+*/
+void JASS_anytime_api::shard_worker::start(bool scale_rsv_scores, uint32_t largest_possible_rsv_with_overflow, size_t query_terms_count)
+	{
+	{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->scale_rsv_scores = scale_rsv_scores;
+	this->largest_possible_rsv_with_overflow = largest_possible_rsv_with_overflow;
+	this->query_terms_count = query_terms_count;
+	busy = true;
+	}
+	wake.notify_all();
+	}
+
+/*
+	JASS_ANYTIME_API::SHARD_WORKER::WAIT()
+	--------------------------------------
+*/
+void JASS_anytime_api::shard_worker::wait(void)
+	{
+	std::unique_lock<std::mutex> lock(mutex);
+	wake.wait(lock, [this]{ return !busy; });
 	}
 
 /*
 	JASS_ANYTIME_API::GET_THREAD_LOCAL_DATA()
 	-----------------------------------------
 */
-JASS_anytime_api::thread_data &JASS_anytime_api::get_thread_local_data(size_t thread_number)
+JASS_anytime_api::thread_data &JASS_anytime_api::get_thread_local_data(loaded_index &index, size_t thread_number)
 	{
-	auto &initial = thread_local_data[thread_number];
+	std::lock_guard<std::mutex> lock(index.thread_local_data_mutex);
+	auto &initial = index.thread_local_data[thread_number];
 
 	/*
 		If this is the first time we've seen this thread number then initialise the object before returning it.
 	*/
-	if (initial.segment_order == nullptr)
+	if (initial.shard.size() == 0)
 		{
-		std::string codex_name;
-		int32_t d_ness;
+		initial.shard.resize(index.shards.size());
+		for (size_t which = 0; which < index.shards.size(); which++)
+			{
+			std::string codex_name;
+			int32_t d_ness;
+			auto &shard = *index.shards[which]->index;
+			auto &search = initial.shard[which];
+
+			/*
+				Allocate the Score-at-a-Time table
+			*/
+			search.segment_order = std::unique_ptr<JASS::deserialised_jass_v1::segment_header[]>{new JASS::deserialised_jass_v1::segment_header[MAX_TERMS_PER_QUERY * MAX_QUANTUM]};
+
+			/*
+				Allocate a JASS query object
+			*/
+			search.codex.reset(shard.codex(codex_name, d_ness));
+			search.jass_query.reset(JASS_anytime_accumulator_manager::get_by_name(accumulator_manager, *search.codex));
+			search.jass_query->init(shard.primary_keys(), shard.document_count(), (JASS::query::DOCID_TYPE)top_k, accumulator_width);
+			}
+		initial.largest_term_impact.reserve(MAX_TERMS_PER_QUERY);
 
 		/*
-			Allocate the Score-at-a-Time table
+			Start a worker to search each shard other than the first (which the search thread searches itself)
 		*/
-		initial.segment_order = std::unique_ptr<JASS::deserialised_jass_v1::segment_header[]>{new JASS::deserialised_jass_v1::segment_header[MAX_TERMS_PER_QUERY * MAX_QUANTUM]};
+		for (size_t which = 1; which < index.shards.size(); which++)
+			initial.workers.push_back(std::unique_ptr<shard_worker>(new shard_worker(initial.shard[which], *index.shards[which])));
+		}
+
+	return initial;
+	}
+
+/*
+	JASS_ANYTIME_API::READ_SHARD()
+	------------------------------
+*/
+JASS_ERROR JASS_anytime_api::read_shard(std::shared_ptr<shard> &into, size_t index_version, const std::string &directory, bool verbose)
+	{
+	if (index_version != 1 && index_version != 2)
+		return JASS_ERROR_BAD_INDEX_VERSION;
+
+	try
+		{
+		auto loaded = std::make_shared<shard>();
+		if (index_version == 1)
+			loaded->index.reset(new JASS::deserialised_jass_v1(verbose));
+		else
+			{
+			auto *v2_index = new JASS::deserialised_jass_v2(verbose);
+			v2_index->set_front_coded_vocabulary(true);
+			loaded->index.reset(v2_index);
+			}
+
+		loaded->index->set_postings_resident(postings_cache_size == 0);
+		if (loaded->index->read_index(directory) == 0)
+			return JASS_ERROR_FAIL;
+
+		if (checksum_threads != 0 && !loaded->index->verify_checksums(directory, checksum_threads))
+			return JASS_ERROR_BAD_CHECKSUM;
+
+		if (loaded->index->document_count() > JASS::query::MAX_DOCUMENTS)
+			return JASS_ERROR_TOO_MANY_DOCUMENTS;
+
+		if (postings_cache_size != 0)
+			{
+			loaded->cache = std::make_unique<JASS::segment_cache>(postings_cache_size, postings_io_threads);
+			if (!loaded->cache->open((std::filesystem::path(directory) / JASS::deserialised_jass_v1::POSTINGS_FILENAME).string()))
+				return JASS_ERROR_FAIL;
+			}
+
+		into = loaded;
+		return JASS_ERROR_OK;
+		}
+	catch (...)
+		{
+		return JASS_ERROR_FAIL;
+		}
+	}
+
+/*
+	JASS_ANYTIME_API::MAKE_INDEX()
+	------------------------------
+*/
+JASS_ERROR JASS_anytime_api::make_index(std::shared_ptr<loaded_index> &into, size_t index_version, const std::vector<std::shared_ptr<shard>> &shards, const std::vector<std::string> &directories)
+	{
+	try
+		{
+		auto index = std::make_shared<loaded_index>();
+		index->index_version = index_version;
+		index->directories = directories;
+		index->shards = shards;
 
 		/*
-			Allocate a JASS query object
+			Number the documents of each shard after those in the shards before it
 		*/
-		JASS::compress_integer &codex = *index->codex(codex_name, d_ness);
-		initial.jass_query = JASS_anytime_accumulator_manager::get_by_name(accumulator_manager, codex);
-		initial.jass_query->init(index->primary_keys(), index->document_count(), (JASS::query::DOCID_TYPE)top_k, accumulator_width);
+		for (const auto &shard : shards)
+			{
+			index->first_document.push_back(index->documents);
+			index->documents += shard->index->document_count();
+			}
+
+		/*
+			Set up the accumulators array (and other thread-local data). First the Score-at-a-Time table
+		*/
+		get_thread_local_data(*index, 0);
+
+		into = index;
+		return JASS_ERROR_OK;
 		}
+	catch (...)
+		{
+		return JASS_ERROR_FAIL;
+		}
+	}
 
-	return initial;
+/*
+	JASS_ANYTIME_API::READ_INDEX()
+	------------------------------
+*/
+JASS_ERROR JASS_anytime_api::read_index(std::shared_ptr<loaded_index> &into, size_t index_version, const std::vector<std::string> &directories, bool verbose)
+	{
+	if (directories.size() == 0)
+		return JASS_ERROR_NO_SHARDS;
+
+	std::vector<std::shared_ptr<shard>> shards;
+	for (const auto &directory : directories)
+		{
+		std::shared_ptr<shard> loaded;
+		JASS_ERROR error = read_shard(loaded, index_version, directory, verbose);
+		if (error != JASS_ERROR_OK)
+			return error;
+		shards.push_back(loaded);
+		}
+
+	return make_index(into, index_version, shards, directories);
+	}
+
+/*
+	JASS_ANYTIME_API::WARM_INDEX()
+	------------------------------
+*/
+void JASS_anytime_api::warm_index(loaded_index &index, const std::vector<std::shared_ptr<shard>> &cold)
+	{
+	/*
+		Touch each page of the postings so that the first queries don't take the page faults (unless the postings are read on demand)
+	*/
+	static constexpr size_t PAGE_SIZE = 4096;
+	uint8_t checksum = 0;
+	for (const auto &shard : cold)
+		{
+		if (shard->cache != nullptr)
+			continue;
+
+		const uint8_t *postings = shard->index->postings();
+		size_t postings_size = shard->index->postings_size();
+		for (size_t byte = 0; byte < postings_size; byte += PAGE_SIZE)
+			checksum ^= postings[byte];
+		}
+	volatile uint8_t result = checksum;			// don't let the compiler optimise away the loop
+	(void)result;
+
+	/*
+		Allocate the accumulators (etc.) for each thread that is searching the current index
+	*/
+	std::vector<size_t> thread_numbers;
+	auto current = get_index();
+	if (current != nullptr)
+		{
+		std::lock_guard<std::mutex> lock(current->thread_local_data_mutex);
+		for (const auto &[thread_number, data] : current->thread_local_data)
+			thread_numbers.push_back(thread_number);
+		}
+
+	for (const auto thread_number : thread_numbers)
+		get_thread_local_data(index, thread_number);
 	}
 
 /*
@@ -89,50 +342,312 @@ JASS_anytime_api::thread_data &JASS_anytime_api::get_thread_local_data(size_t th
 	------------------------------
 */
 JASS_ERROR JASS_anytime_api::load_index(size_t index_version, const std::string &directory, bool verbose)
+	{
+	return load_sharded_index(index_version, std::vector<std::string>{directory}, verbose);
+	}
+
+/*
+	JASS_ANYTIME_API::LOAD_SHARDED_INDEX()
+	--------------------------------------
+*/
+JASS_ERROR JASS_anytime_api::load_sharded_index(size_t index_version, const std::vector<std::string> &directories, bool verbose)
 	{
 	/*
 		Can't load an index if one has already been loaded
 	*/
-	if (index != nullptr)
+	if (get_index() != nullptr)
 		return JASS_ERROR_INDEX_ALREADY_LOADED;
 
+	std::shared_ptr<loaded_index> index;
+	JASS_ERROR error = read_index(index, index_version, directories, verbose);
+	if (error == JASS_ERROR_OK)
+		std::atomic_store(&current_index, index);
+
+	return error;
+	}
+
+/*
+	JASS_ANYTIME_API::REPLACE_INDEX()
+	---------------------------------
+*/
+JASS_ERROR JASS_anytime_api::replace_index(size_t index_version, const std::string &directory, bool verbose)
+	{
+	return replace_sharded_index(index_version, std::vector<std::string>{directory}, verbose);
+	}
+
+/*
+	JASS_ANYTIME_API::REPLACE_SHARDED_INDEX()
+	-----------------------------------------
+*/
+JASS_ERROR JASS_anytime_api::replace_sharded_index(size_t index_version, const std::vector<std::string> &directories, bool verbose)
+	{
+	/*
+		Hold off the segment merger, else it might swap in shards of the index we are replacing
+	*/
+	std::lock_guard<std::mutex> lock(segments_mutex);
+
+	return swap_in_index(index_version, directories, verbose);
+	}
+
+/*
+	JASS_ANYTIME_API::SWAP_IN_INDEX()
+	---------------------------------
+*/
+JASS_ERROR JASS_anytime_api::swap_in_index(size_t index_version, const std::vector<std::string> &directories, bool verbose)
+	{
 	/*
-		Load the index
+		Load and warm the new index while searching continues on the current index
 	*/
-	try
+	std::shared_ptr<loaded_index> index;
+	JASS_ERROR error = read_index(index, index_version, directories, verbose);
+	if (error != JASS_ERROR_OK)
+		return error;
+
+	warm_index(*index, index->shards);
+
+	/*
+		Swap it in.  Searches already using the old index hold a reference to it so it gets deleted when the last of them finishes
+	*/
+	std::atomic_store(&current_index, index);
+
+	return JASS_ERROR_OK;
+	}
+
+/*
+	JASS_ANYTIME_API::SWAP_IN_SHARDS()
+	----------------------------------
+*/
+JASS_ERROR JASS_anytime_api::swap_in_shards(size_t index_version, const std::vector<std::shared_ptr<shard>> &shards, const std::vector<std::string> &directories, const std::shared_ptr<shard> &added)
+	{
+	std::shared_ptr<loaded_index> index;
+	JASS_ERROR error = make_index(index, index_version, shards, directories);
+	if (error != JASS_ERROR_OK)
+		return error;
+
+	warm_index(*index, std::vector<std::shared_ptr<shard>>{added});
+
+	/*
+		Swap it in.  The old index and the new one share all the other shards, which are deleted when the last index using them is
+	*/
+	std::atomic_store(&current_index, index);
+
+	return JASS_ERROR_OK;
+	}
+
+/*
+	JASS_ANYTIME_API::ADD_SEGMENT()
+	-------------------------------
+*/
+JASS_ERROR JASS_anytime_api::add_segment(const std::string &directory, bool verbose)
+	{
+	JASS_ERROR error;
+
 		{
-		switch (index_version)
+		std::lock_guard<std::mutex> lock(segments_mutex);
+		auto current = get_index();
+		if (current == nullptr)
+			error = swap_in_index(2, std::vector<std::string>{directory}, verbose);
+		else
 			{
-			case 1:
-				index = new JASS::deserialised_jass_v1(verbose);
-				break;
-			case 2:
-				index = new JASS::deserialised_jass_v2(verbose);
-				break;
-			default:
-				return JASS_ERROR_BAD_INDEX_VERSION;
+			/*
+				Only the new segment is read from disk, the others are shared with the current index
+			*/
+			std::shared_ptr<shard> segment;
+			error = read_shard(segment, current->index_version, directory, verbose);
+			if (error == JASS_ERROR_OK)
+				{
+				auto shards = current->shards;
+				shards.push_back(segment);
+				auto directories = current->directories;
+				directories.push_back(directory);
+				error = swap_in_shards(current->index_version, shards, directories, segment);
+				}
 			}
+		}
+
+	if (error == JASS_ERROR_OK)
+		{
+			{
+			std::lock_guard<std::mutex> lock(merger_mutex);
+			merger_pending = true;
+			}
+		merger_wake.notify_one();
+		}
 
-		index->read_index(directory);
+	return error;
+	}
+
+/*
+	JASS_ANYTIME_API::MERGE_SEGMENTS()
+	----------------------------------
+*/
+bool JASS_anytime_api::merge_segments(void)
+	{
+	/*
+		Find the smallest run of merger_fan_in adjacent segments of a similar size.  Its the smallest segments that get merged first.
+	*/
+	auto current = get_index();
+	if (current == nullptr || current->index_version != 2)
+		return false;
+
+	size_t best_tier = (std::numeric_limits<size_t>::max)();
+	size_t best_start = 0;
+	size_t run_start = 0;
+	size_t run_tier = (std::numeric_limits<size_t>::max)();
+	for (size_t which = 0; which < current->shards.size(); which++)
+		{
+		size_t tier = 0;
+		for (size_t documents = current->shards[which]->index->document_count(); documents >= merger_fan_in; documents /= merger_fan_in)
+			tier++;
 
-		if (index->document_count() > JASS::query::MAX_DOCUMENTS)
+		if (tier != run_tier)
 			{
-			delete index;
-			index = nullptr;
-			return JASS_ERROR_TOO_MANY_DOCUMENTS;
+			run_tier = tier;
+			run_start = which;
 			}
+		if (which - run_start + 1 >= merger_fan_in && tier < best_tier)
+			{
+			best_tier = tier;
+			best_start = which + 1 - merger_fan_in;
+			}
+		}
 
-		/*
-			Set up the accumulators array (and other thread-local data). First the Score-at-a-Time table
-		*/
-		get_thread_local_data(0);
+	if (best_tier == (std::numeric_limits<size_t>::max)())
+		return false;
 
-		return JASS_ERROR_OK;
+	std::vector<std::string> sources(current->directories.begin() + best_start, current->directories.begin() + best_start + merger_fan_in);
+	current = nullptr;			// don't keep the old index in memory while merging
+
+	/*
+		Merge them into a new segment (searching continues on the current index while this happens)
+	*/
+	std::string destination;
+	for (size_t instance = merger_created.size(); destination.empty() || std::filesystem::exists(destination); instance++)
+		destination = (std::filesystem::path(merger_directory) / ("segment_" + std::to_string(instance))).string();
+
+	std::error_code error;
+	std::filesystem::create_directories(destination, error);
+	if (error || JASS::merge_jass_v2::merge(destination, sources) == 0)
+		{
+		std::filesystem::remove_all(destination, error);
+		return false;
 		}
-	catch (...)
+
+	/*
+		Swap the new segment in for the ones it was made from.  Segments are only ever removed by the merger, but the index might have been
+		replaced (with replace_sharded_index()) while we were merging in which case the merged segment is no longer wanted.
+	*/
+	std::lock_guard<std::mutex> lock(segments_mutex);
+	current = get_index();
+	auto found = std::search(current->directories.begin(), current->directories.end(), sources.begin(), sources.end());
+	if (found == current->directories.end())
+		{
+		std::filesystem::remove_all(destination, error);
+		return false;
+		}
+
+	/*
+		Only the merged segment is read from disk, the segments either side of it are shared with the current index
+	*/
+	std::shared_ptr<shard> merged;
+	if (read_shard(merged, current->index_version, destination, false) != JASS_ERROR_OK)
 		{
+		std::filesystem::remove_all(destination, error);
+		return false;
+		}
+
+	size_t first = found - current->directories.begin();
+	std::vector<std::string> directories(current->directories.begin(), found);
+	directories.push_back(destination);
+	directories.insert(directories.end(), found + sources.size(), current->directories.end());
+	std::vector<std::shared_ptr<shard>> shards(current->shards.begin(), current->shards.begin() + first);
+	shards.push_back(merged);
+	shards.insert(shards.end(), current->shards.begin() + first + sources.size(), current->shards.end());
+	if (swap_in_shards(current->index_version, shards, directories, merged) != JASS_ERROR_OK)
+		{
+		std::filesystem::remove_all(destination, error);
+		return false;
+		}
+
+	/*
+		The merged segments are no longer searched by new queries, so delete those the merger made (queries still using them have them in memory, or open)
+	*/
+	for (const auto &source : sources)
+		{
+		auto created = std::find(merger_created.begin(), merger_created.end(), source);
+		if (created != merger_created.end())
+			{
+			std::filesystem::remove_all(source, error);
+			merger_created.erase(created);
+			}
+		}
+	merger_created.push_back(destination);
+
+	return true;
+	}
+
+/*
+	JASS_ANYTIME_API::SEGMENT_MERGER()
+	----------------------------------
+*/
+void JASS_anytime_api::segment_merger(JASS_anytime_api *thiss)
+	{
+	std::unique_lock<std::mutex> lock(thiss->merger_mutex);
+	while (!thiss->merger_stopping)
+		{
+		thiss->merger_pending = false;
+		lock.unlock();
+		bool merged = thiss->merge_segments();
+		lock.lock();
+
+		if (!merged)
+			thiss->merger_wake.wait(lock, [thiss](){ return thiss->merger_stopping || thiss->merger_pending; });
+		}
+	}
+
+/*
+	JASS_ANYTIME_API::START_SEGMENT_MERGER()
+	----------------------------------------
+*/
+JASS_ERROR JASS_anytime_api::start_segment_merger(const std::string &directory, size_t fan_in)
+	{
+	if (merger != nullptr)
+		return JASS_ERROR_MERGER_RUNNING;
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
 		return JASS_ERROR_FAIL;
+
+	merger_directory = directory;
+	merger_fan_in = fan_in < 2 ? 2 : fan_in;
+	merger_stopping = false;
+	merger_pending = true;
+	merger = std::make_unique<JASS::thread>(segment_merger, this);
+
+	return JASS_ERROR_OK;
+	}
+
+/*
+	JASS_ANYTIME_API::STOP_SEGMENT_MERGER()
+	---------------------------------------
+*/
+void JASS_anytime_api::stop_segment_merger(void)
+	{
+	if (merger == nullptr)
+		return;
+
+	/*
+		Tell the merger to stop (under the lock so that it can't miss the wake-up) then wait for it
+	*/
+		{
+		std::lock_guard<std::mutex> lock(merger_mutex);
+		merger_stopping = true;
 		}
+	merger_wake.notify_one();
+
+	merger->join();
+	merger = nullptr;
 	}
 
 /*
@@ -141,10 +656,11 @@ JASS_ERROR JASS_anytime_api::load_index(size_t index_version, const std::string
 */
 JASS_ERROR JASS_anytime_api::set_postings_to_process_proportion(double percent)
 	{
+	auto index = get_index();
 	if (index == nullptr)
 		return JASS_ERROR_NO_INDEX;
 
-	postings_to_process = (JASS::query::DOCID_TYPE)((double)index->document_count() * percent / 100.0);
+	postings_to_process = (JASS::query::DOCID_TYPE)((double)index->documents * percent / 100.0);
 
 	return JASS_ERROR_OK;
 	}
@@ -186,7 +702,7 @@ uint32_t JASS_anytime_api::get_postings_to_process(void)
 */
 JASS_ERROR JASS_anytime_api::set_top_k(size_t k)
 	{
-	if (index != nullptr)
+	if (get_index() != nullptr)
 		return JASS_ERROR_INDEX_ALREADY_LOADED;
 
 	if (k > JASS::query::MAX_TOP_K)
@@ -203,10 +719,11 @@ JASS_ERROR JASS_anytime_api::set_top_k(size_t k)
 */
 JASS::query::DOCID_TYPE JASS_anytime_api::get_document_count(void)
 	{
+	auto index = get_index();
 	if (index == nullptr)
 		return 0;				// no index has been loaded
 
-	return index->document_count();
+	return (JASS::query::DOCID_TYPE)index->documents;
 	}
 
 /*
@@ -233,10 +750,11 @@ JASS::query::DOCID_TYPE JASS_anytime_api::get_max_top_k(void)
 */
 JASS_ERROR JASS_anytime_api::get_encoding_scheme(std::string &codex_name, int32_t &d_ness)
 	{
+	auto index = get_index();
 	if (index == nullptr)
 		return JASS_ERROR_NO_INDEX;
 
-	index->codex(codex_name, d_ness);
+	std::unique_ptr<JASS::compress_integer> codex(index->shards[0]->index->codex(codex_name, d_ness));
 
 	return JASS_ERROR_OK;
 	}
@@ -297,7 +815,7 @@ JASS_ERROR JASS_anytime_api::use_query_parser(void)
 */
 JASS_ERROR JASS_anytime_api::set_accumulator_width(size_t width)
 	{
-	if (index != nullptr)
+	if (get_index() != nullptr)
 		return JASS_ERROR_INDEX_ALREADY_LOADED;
 
 	if (width > 32)
@@ -313,7 +831,7 @@ JASS_ERROR JASS_anytime_api::set_accumulator_width(size_t width)
 */
 JASS_anytime_result JASS_anytime_api::search(const std::string &query)
 	{
-	if (index == nullptr)
+	if (get_index() == nullptr)
 		return JASS_anytime_result();
 		
 	JASS_anytime_thread_result output;
@@ -331,7 +849,7 @@ JASS_anytime_result JASS_anytime_api::search(const std::string &query)
 */
 std::vector<JASS_anytime_thread_result> JASS_anytime_api::threaded_search(std::vector<std::string> &query_list, size_t thread_count)
 	{
-	if (index == nullptr)
+	if (get_index() == nullptr)
 		return std::vector<JASS_anytime_thread_result>();
 
 	std::vector<JASS_anytime_query> queries;
@@ -352,7 +870,7 @@ std::vector<JASS_anytime_thread_result> JASS_anytime_api::threaded_search(std::v
 */
 JASS_ERROR JASS_anytime_api::search(std::vector<JASS_anytime_thread_result> &output, std::vector<JASS_anytime_query> &query_list, size_t thread_count)
 	{
-	if (index == nullptr)
+	if (get_index() == nullptr)
 		return JASS_ERROR_NO_INDEX;
 
 	/*
@@ -384,13 +902,114 @@ JASS_ERROR JASS_anytime_api::search(std::vector<JASS_anytime_thread_result> &out
 	return JASS_ERROR_OK;
 	}
 
+/*
+	JASS_ANYTIME_API::MERGED_RESULTS::MERGE()
+	-----------------------------------------
+*/
+void JASS_anytime_api::merged_results::merge(const std::vector<size_t> &first_document, std::vector<shard_search> &searches, size_t top_k)
+	{
+	results.clear();
+
+	/*
+		Gather the top-k from each shard, converting the document ids into global document ids
+	*/
+	for (size_t which = 0; which < searches.size(); which++)
+		for (auto *document = searches[which].jass_query->get_first(); document != nullptr; document = searches[which].jass_query->get_next())
+			results.push_back(JASS::query::docid_rsv_pair{document->document_id + first_document[which], document->primary_key, document->rsv});
+
+	/*
+		Keep the top-k in the same order a single index would have them in (highest rsv first, ties broken on the highest document id)
+	*/
+	auto end = results.begin() + JASS::maths::minimum(top_k, results.size());
+	std::partial_sort
+		(
+		results.begin(),
+		end,
+		results.end(),
+		[](const JASS::query::docid_rsv_pair &lhs, const JASS::query::docid_rsv_pair &rhs)
+			{
+			return lhs.rsv > rhs.rsv || (lhs.rsv == rhs.rsv && lhs.document_id > rhs.document_id);
+			}
+		);
+	results.erase(end, results.end());
+	}
+
+/*
+	JASS_ANYTIME_API::SEARCH_SHARD()
+	--------------------------------
+*/
+void JASS_anytime_api::search_shard(shard_search &search, const shard &index, bool scale_rsv_scores, uint32_t largest_possible_rsv_with_overflow, size_t query_terms_count)
+	{
+	const uint8_t *postings = index.index->postings();
+
+	/*
+		Process the segments
+	*/
+	search.postings_processed = 0;
+	search.segments_failed = 0;
+	size_t segment_number = 0;
+	size_t postings_failed = 0;
+	for (auto *header = search.segment_order.get(); header < search.segment_order_end; header++)
+		{
+		if (scale_rsv_scores)
+			header->impact = (JASS::query::ACCUMULATOR_TYPE)((double)header->impact / (double)largest_possible_rsv_with_overflow * ((double)JASS::query::MAX_RSV - query_terms_count) + 1);
+
+//std::cout << "Process Segment->(" << header->impact << ":" << header->segment_frequency << ")\n";
+		/*
+			The anytime algorithms basically boils down to this... have we processed enough postings yet?  If so then stop
+			The definition of "enough" is that processing the next segment will exceed postings_to_process so we wil be over
+			the "time limit" so we must not do it.
+		*/
+		if (search.postings_processed + header->segment_frequency > search.postings_to_process)
+			break;
+		search.postings_processed += header->segment_frequency;
+
+		/*
+			Process the postings
+		*/
+		JASS::query::ACCUMULATOR_TYPE impact = header->impact;
+		if (index.cache == nullptr)
+			search.jass_query->decode_and_process(impact, header->segment_frequency, postings + header->offset, header->end - header->offset);
+		else
+			{
+			/*
+				The segment was requested from disk when the query was parsed, so wait for it to arrive.  If it can't be read then the
+				results are incomplete, which is reported to the caller (in JASS_anytime_result::segments_failed).  A failed segment
+				still counts against the budget because anytime() only requested the segments that fit in it, so there are no more.
+			*/
+			const uint8_t *segment = search.segments[segment_number++]->wait();
+			if (segment != nullptr)
+				search.jass_query->decode_and_process(impact, header->segment_frequency, segment, header->end - header->offset);
+			else
+				{
+				postings_failed += header->segment_frequency;
+				search.segments_failed++;
+				}
+			}
+		}
+	search.postings_processed -= postings_failed;
+
+	/*
+		Let the cache evict the segments once they are no longer needed
+	*/
+	search.segments.clear();
+
+	/*
+		Finally we have the results list in the heap, now sort it.
+	*/
+	search.jass_query->sort();
+	}
+
 /*
 	JASS_ANYTIME_API::ANYTIME()
 	---------------------------
 */
 void JASS_anytime_api::anytime(JASS_anytime_thread_result &output, std::vector<JASS_anytime_query> &query_list, size_t thread_number)
 	{
-	thread_data &local = get_thread_local_data(thread_number);
+	/*
+		Allocate the thread local data (if necessary) before the timer starts
+	*/
+	get_thread_local_data(*get_index(), thread_number);
 
 	/*
 		Start the timer
@@ -426,73 +1045,96 @@ void JASS_anytime_api::anytime(JASS_anytime_thread_result &output, std::vector<J
 
 //std::cout << "QUERY:" << query_id << "\n";
 		/*
-			Process the query
+			Get the index (which might have been replaced since the last query).  Holding index stops it being deleted until this query is done
 		*/
-		local.jass_query->parse(query, which_query_parser);
+		std::shared_ptr<loaded_index> index = get_index();
+		const std::vector<std::shared_ptr<shard>> &shards = index->shards;
+		thread_data &local = get_thread_local_data(*index, thread_number);
 
 		/*
-			Parse the query and extract the list of impact segments
+			Parse the query and extract the list of impact segments from each shard.  The largest possible rsv is computed from the largest impact
+			of each term in any shard so that every shard rescales (on accumulator overflow) in the same way.  This only makes the rsvs from different
+			shards comparable if the shards were quantized against the same collection statistics (JASS_index -Sr, see load_sharded_index()).
 		*/
-		JASS::deserialised_jass_v1::segment_header *current_segment = local.segment_order.get();
 		uint32_t largest_possible_rsv = (std::numeric_limits<decltype(largest_possible_rsv)>::min)();
 		uint32_t largest_possible_rsv_with_overflow;
 		uint32_t smallest_possible_rsv = (std::numeric_limits<decltype(smallest_possible_rsv)>::max)();
-		size_t query_terms_count = local.jass_query->terms().size();
-		uint64_t total_postings_for_query = 0;
-//std::cout << "\n";
-		for (const auto &term : local.jass_query->terms())
+		size_t query_terms_count = 0;
+		for (size_t which = 0; which < shards.size(); which++)
 			{
-//std::cout << "TERM:" << term << " ";
+			const JASS::deserialised_jass_v1 &shard_index = *shards[which]->index;
+			shard_search &search = local.shard[which];
 
 			/*
-				Get the metadata for this term (and if this term isn't in the vocab them move on to the next term)
+				Process the query
 			*/
-			JASS::deserialised_jass_v1::metadata metadata;
-			if (!index->postings_details(metadata, term))
-				continue;
+			search.jass_query->parse(query, which_query_parser);
+			query_terms_count = search.jass_query->terms().size();
+			if (which == 0)
+				local.largest_term_impact.assign(query_terms_count, 0);
+
+			search.segment_order_end = search.segment_order.get();
+			search.total_postings_for_query = 0;
+			size_t term_number = 0;
+//std::cout << "\n";
+			for (const auto &term : search.jass_query->terms())
+				{
+//std::cout << "TERM:" << term << " ";
+				uint32_t &largest_term_impact = local.largest_term_impact[term_number++];
+
+				/*
+					Get the metadata for this term (and if this term isn't in the vocab them move on to the next term)
+				*/
+				JASS::deserialised_jass_v1::metadata metadata;
+				if (!shard_index.postings_details(metadata, term))
+					continue;
+
+				/*
+					Add the segments to the list to process
+				*/
+				uint32_t term_smallest_impact;
+				uint32_t term_largest_impact;
+				JASS::query::DOCID_TYPE document_frequency;
+				search.segment_order_end += shard_index.get_segment_list(search.segment_order_end, metadata, term.frequency(), term_smallest_impact, term_largest_impact, document_frequency);
+				search.total_postings_for_query += document_frequency;
+
+				/*
+					Compute the largest and smallest possible rsv values
+				*/
+				largest_term_impact = JASS::maths::maximum(largest_term_impact, term_largest_impact);
+				smallest_possible_rsv = JASS::maths::minimum(smallest_possible_rsv, (decltype(smallest_possible_rsv))term_smallest_impact);
+				}
 
 			/*
-				Add the segments to the list to process
+				Sort the segments from highest impact to lowest impact
 			*/
-			uint32_t term_smallest_impact;
-			uint32_t term_largest_impact;
-			JASS::query::DOCID_TYPE document_frequency;
-			current_segment += index->get_segment_list(current_segment, metadata, term.frequency(), term_smallest_impact, term_largest_impact, document_frequency);
-			total_postings_for_query += document_frequency;
+			std::sort
+				(
+				search.segment_order.get(),
+				search.segment_order_end,
+				[](JASS::deserialised_jass_v1::segment_header &lhs, JASS::deserialised_jass_v1::segment_header &rhs)
+					{
+
+					/*
+						sort from highest to lowest impact, but break ties by placing the lowest quantum-frequency first and the highest quantum-frequency last
+					*/
+					if (lhs.impact < rhs.impact)
+						return false;
+					else if (lhs.impact > rhs.impact)
+						return true;
+					else			// impact scores are the same, so tie break on the length of the segment
+						return lhs.segment_frequency < rhs.segment_frequency;
+					}
+				);
 
 			/*
-				Compute the largest and smallest possible rsv values
+				0 terminate the list of segments by setting the impact score to zero
 			*/
-			largest_possible_rsv += term_largest_impact;
-			smallest_possible_rsv = JASS::maths::minimum(smallest_possible_rsv, (decltype(smallest_possible_rsv))term_smallest_impact);
+			search.segment_order_end->impact = 0;
 			}
 
-		/*
-			Sort the segments from highest impact to lowest impact
-		*/
-		std::sort
-			(
-			local.segment_order.get(),
-			current_segment,
-			[postings = index->postings()](JASS::deserialised_jass_v1::segment_header &lhs, JASS::deserialised_jass_v1::segment_header &rhs)
-				{
-
-				/*
-					sort from highest to lowest impact, but break ties by placing the lowest quantum-frequency first and the highest quantum-frequency last
-				*/
-				if (lhs.impact < rhs.impact)
-					return false;
-				else if (lhs.impact > rhs.impact)
-					return true;
-				else			// impact scores are the same, so tie break on the length of the segment
-					return lhs.segment_frequency < rhs.segment_frequency;
-				}
-			);
-
-		/*
-			0 terminate the list of segments by setting the impact score to zero
-		*/
-		current_segment->impact = 0;
+		for (const auto impact : local.largest_term_impact)
+			largest_possible_rsv += impact;
 
 		/*
 			Work out the dynamic impact score scaling factor (if necessary)
@@ -510,47 +1152,64 @@ void JASS_anytime_api::anytime(JASS_anytime_thread_result &output, std::vector<J
 			*/
 			smallest_possible_rsv = smallest_possible_rsv == 0 ? 1 : smallest_possible_rsv;
 			}
-
-		local.jass_query->rewind(smallest_possible_rsv, 1, largest_possible_rsv);
 //std::cout << "MAXRSV:" << largest_possible_rsv << " MINRSV:" << smallest_possible_rsv << "\n";
 
 		/*
-			Check to see if we've got a rho stopping condition relative to the number of postings in this query.
-		*/
-		if (relative_postings_to_process != 1)
-			postings_to_process = total_postings_for_query * relative_postings_to_process;
-
-		/*
-			Process the segments
+			Work out how many postings each shard may process.  A rho stopping condition relative to the number of postings in this query is
+			applied to each shard's postings, otherwise the postings budget is shared between the shards in proportion to their size.
 		*/
-		size_t postings_processed = 0;
-		for (auto *header = local.segment_order.get(); header < current_segment; header++)
+		for (size_t which = 0; which < shards.size(); which++)
 			{
-			if (scale_rsv_scores)
-				header->impact = (JASS::query::ACCUMULATOR_TYPE)((double)header->impact / (double)largest_possible_rsv_with_overflow * ((double)JASS::query::MAX_RSV - query_terms_count) + 1);
+			shard_search &search = local.shard[which];
 
-//std::cout << "Process Segment->(" << header->impact << ":" << header->segment_frequency << ")\n";
-			/*
-				The anytime algorithms basically boils down to this... have we processed enough postings yet?  If so then stop
-				The definition of "enough" is that processing the next segment will exceed postings_to_process so we wil be over
-				the "time limit" so we must not do it.
-			*/
-			if (postings_processed + header->segment_frequency > postings_to_process)
-				break;
-			postings_processed += header->segment_frequency;
+			search.jass_query->rewind(smallest_possible_rsv, 1, largest_possible_rsv);
+
+			if (relative_postings_to_process != 1)
+				search.postings_to_process = search.total_postings_for_query * relative_postings_to_process;
+			else if (shards.size() == 1 || postings_to_process == (std::numeric_limits<size_t>::max)())
+				search.postings_to_process = postings_to_process;
+			else
+				search.postings_to_process = (size_t)((double)postings_to_process * shards[which]->index->document_count() / index->documents);
 
 			/*
-				Process the postings
+				If the postings are read on demand then request all the segments this shard will process now, so that the reads are in flight at once
 			*/
-			JASS::query::ACCUMULATOR_TYPE impact = header->impact;
-			local.jass_query->decode_and_process(impact, header->segment_frequency, index->postings() + header->offset, header->end - header->offset);
+			if (shards[which]->cache != nullptr)
+				{
+				size_t postings_requested = 0;
+				for (auto *header = search.segment_order.get(); header < search.segment_order_end; header++)
+					{
+					if (postings_requested + header->segment_frequency > search.postings_to_process)
+						break;
+					postings_requested += header->segment_frequency;
+					search.segments.push_back(shards[which]->cache->fetch(header->offset, header->end));
+					}
+				}
 			}
 
 		/*
-			Finally we have the results list in the heap, now sort it.
+			Search the shards, one worker per shard (this thread searches the first shard)
 		*/
-		local.jass_query->sort();
-		
+		for (auto &worker : local.workers)
+			worker->start(scale_rsv_scores, largest_possible_rsv_with_overflow, query_terms_count);
+
+		search_shard(local.shard[0], *shards[0], scale_rsv_scores, largest_possible_rsv_with_overflow, query_terms_count);
+
+		size_t postings_processed = local.shard[0].postings_processed;
+		size_t segments_failed = local.shard[0].segments_failed;
+		for (size_t which = 1; which < shards.size(); which++)
+			{
+			local.workers[which - 1]->wait();
+			postings_processed += local.shard[which].postings_processed;
+			segments_failed += local.shard[which].segments_failed;
+			}
+
+		/*
+			Merge the results lists of the shards
+		*/
+		if (shards.size() > 1)
+			local.results.merge(index->first_document, local.shard, top_k);
+
 		/*
 			stop the timer
 		*/
@@ -560,11 +1219,15 @@ void JASS_anytime_api::anytime(JASS_anytime_thread_result &output, std::vector<J
 			Serialise the results list (don't time this)
 		*/
 		std::ostringstream results_list;
-		JASS::run_export(JASS::run_export::TREC, results_list, query_id.c_str(), *local.jass_query, "JASSv2", true);
+		if (shards.size() == 1)
+			JASS::run_export(JASS::run_export::TREC, results_list, query_id.c_str(), *local.shard[0].jass_query, "JASSv2", true);
+		else
+			JASS::run_export(JASS::run_export::TREC, results_list, query_id.c_str(), local.results, "JASSv2", true);
+
 		/*
 			Store the results (and the time it took)
 		*/
-		output.push_back(query_id, query, results_list.str(), postings_processed, time_taken);
+		output.push_back(query_id, query, results_list.str(), postings_processed, time_taken, segments_failed);
 
 		/*
 			Re-start the timer
@@ -578,3 +1241,55 @@ void JASS_anytime_api::anytime(JASS_anytime_thread_result &output, std::vector<J
 		}
 	}
 
+/*
+	JASS_ANYTIME_API::UNITTEST()
+	----------------------------
+*/
+void JASS_anytime_api::unittest(void)
+	{
+	std::string directory = (std::filesystem::temp_directory_path() / "JASS_anytime_api.unittest").string();
+	std::filesystem::create_directories(directory);
+
+	/*
+		Index the ten document collection and load it with the postings read on demand
+	*/
+	{
+	JASS::index_manager_sequential index;
+	JASS::index_manager_sequential::unittest_build_index(index, JASS::unittest_data::ten_documents);
+	JASS::serialise_jass_v2 serialiser(index.get_highest_document_id(), JASS::serialise_jass_v1::jass_v1_codex::elias_gamma_simd_vb, 1, directory);
+	index.iterate(serialiser);
+	serialiser.finish();
+	}
+
+	{
+	JASS_anytime_api api;
+	api.set_postings_on_demand(JASS::segment_cache::ALIGNMENT * 16, 1);
+	JASS_assert(api.load_index(2, directory) == JASS_ERROR_OK);
+
+	auto index = api.get_index();
+	const shard &loaded = *index->shards[0];
+	shard_search &search = api.get_thread_local_data(*index, 0).shard[0];
+
+	/*
+		Two segments of 6 postings each with a budget of 10, so only the first is requested from disk.  The first can't be read
+		(it is past the end of the postings file) but it must still count against the budget, else the second would be processed
+		even though it was never requested.
+	*/
+	uint64_t past_end = std::filesystem::file_size(std::filesystem::path(directory) / JASS::deserialised_jass_v1::POSTINGS_FILENAME) + JASS::segment_cache::ALIGNMENT;
+	search.segment_order[0] = JASS::deserialised_jass_v1::segment_header{2, past_end, past_end + 10, 6};
+	search.segment_order[1] = JASS::deserialised_jass_v1::segment_header{1, 0, 10, 6};
+	search.segment_order_end = search.segment_order.get() + 2;
+	search.postings_to_process = 10;
+	search.segments.push_back(loaded.cache->fetch(search.segment_order[0].offset, search.segment_order[0].end));
+	search.jass_query->rewind();
+
+	search_shard(search, loaded, false, 0, 1);
+	JASS_assert(search.segments_failed == 1);
+	JASS_assert(search.postings_processed == 0);
+	JASS_assert(search.segments.size() == 0);
+	}
+
+	std::filesystem::remove_all(directory);
+
+	puts("JASS_anytime_api::PASSED");
+	}
@@ -12,9 +12,18 @@
 */
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <condition_variable>
+
 #include "query.h"
+#include "threads.h"
 #include "top_k_limit.h"
 #include "parser_query.h"
+#include "segment_cache.h"
 #include "JASS_anytime_query.h"
 #include "JASS_anytime_stats.h"
 #include "deserialised_jass_v2.h"
@@ -37,6 +46,9 @@ enum JASS_ERROR
 	JASS_ERROR_TOO_MANY_DOCUMENTS,		///< This index cannot be loaded by this instance of the APIs because it contains more documents than the system-wide maximum
 	JASS_ERROR_TOO_LARGE,					///< top-k is larger than the system-wide maximum top-k value (or the accumulator width is too large)
 	JASS_ERROR_INDEX_ALREADY_LOADED,		///< Attempt to load an index when an index has alrady been loaded
+	JASS_ERROR_NO_SHARDS,					///< Attempt to load a sharded index without naming any shards
+	JASS_ERROR_BAD_CHECKSUM,				///< The index failed checksum verification (it is corrupt or has no checksums)
+	JASS_ERROR_MERGER_RUNNING,				///< Attempt to start the segment merger when it is already running
 };
 
 /*
@@ -54,6 +66,159 @@ class JASS_anytime_api
 		static constexpr size_t MAX_TERMS_PER_QUERY = 1024;	///< The maximum number of terms in a query
 
 	private:
+		/*
+			@class shard
+			@brief One document-partitioned part of the index, searched as if it were an index on its own.
+			@details A shard is never changed once loaded, so add_segment() and the segment merger share the unchanged shards between the
+			current index and the one that replaces it (rather than reading them from disk again).
+		*/
+		class shard
+			{
+			public:
+				std::unique_ptr<JASS::deserialised_jass_v1> index;		///< The index of this shard
+				std::unique_ptr<JASS::segment_cache> cache;					///< The segments read from disk on demand (nullptr if the postings are in memory)
+			};
+
+		/*
+			@class shard_search
+			@brief The state of the search of one shard by one thread
+		*/
+		class shard_search
+			{
+			public:
+				std::unique_ptr<JASS::deserialised_jass_v1::segment_header[]> segment_order;		///< The Score-at-a-Time table
+				JASS::deserialised_jass_v1::segment_header *segment_order_end;							///< The end of the segments for the current query
+				std::unique_ptr<JASS::compress_integer> codex;												///< The decompressor for this shard's postings (must outlive jass_query)
+				std::unique_ptr<JASS::query> jass_query;														///< The query object (accumulators, etc.) for this shard
+				uint64_t total_postings_for_query;																///< The number of postings this shard has for the current query
+				size_t postings_to_process;																		///< The number of postings this shard may process for the current query
+				size_t postings_processed;																			///< The number of postings this shard did process for the current query
+				size_t segments_failed;																				///< The number of segments of the current query that could not be read from disk
+				std::vector<std::shared_ptr<JASS::segment_cache::segment>> segments;					///< The segments being read from disk for the current query (if the postings are read on demand)
+			};
+
+		/*
+			@class shard_worker
+			@brief A thread that searches one shard for each query of one search thread.
+			@details The workers are started once (when the thread local data is allocated) and live as long as the loaded_index, so
+			a query on a sharded index does not pay for creating and joining a thread per shard.
+		*/
+		class shard_worker
+			{
+			private:
+				shard_search &search;											///< The search of the shard this worker searches
+				const shard &index;												///< The shard this worker searches
+				std::mutex mutex;													///< Protects busy and stopping
+				std::condition_variable wake;									///< Signalled when busy or stopping changes
+				bool busy;															///< Set by start() and cleared when the search of the shard is done
+				bool stopping;														///< Set when the worker thread should exit
+				bool scale_rsv_scores;											///< Parameter to search_shard() for the current query
+				uint32_t largest_possible_rsv_with_overflow;				///< Parameter to search_shard() for the current query
+				size_t query_terms_count;										///< Parameter to search_shard() for the current query
+				std::unique_ptr<JASS::thread> worker;						///< The worker thread (started last, once everything else is initialised)
+
+			private:
+				/*
+					JASS_ANYTIME_API::SHARD_WORKER::RUN()
+					-------------------------------------
+				*/
+				/*!
+					@brief The worker thread, wait for start() and call search_shard() until stopped
+					@param thiss [in] Pointer to the worker
+				*/
+				static void run(shard_worker *thiss);
+
+			public:
+				/*
+					JASS_ANYTIME_API::SHARD_WORKER::SHARD_WORKER()
+					----------------------------------------------
+				*/
+				/*!
+					@brief Constructor, start the worker thread
+					@param search [in] The search of the shard, which must outlive this object
+					@param index [in] The shard, which must outlive this object
+				*/
+				shard_worker(shard_search &search, const shard &index);
+
+				/*
+					JASS_ANYTIME_API::SHARD_WORKER::~SHARD_WORKER()
+					-----------------------------------------------
+				*/
+				/*!
+					@brief Destructor, stop the worker thread and wait for it to exit
+				*/
+				~shard_worker();
+
+				/*
+					JASS_ANYTIME_API::SHARD_WORKER::START()
+					---------------------------------------
+				*/
+				/*!
+					@brief Start searching the shard for the current query (see search_shard() for the parameters), call wait() for it to finish
+				*/
+				void start(bool scale_rsv_scores, uint32_t largest_possible_rsv_with_overflow, size_t query_terms_count);
+
+				/*
+					JASS_ANYTIME_API::SHARD_WORKER::WAIT()
+					--------------------------------------
+				*/
+				/*!
+					@brief Block until the search started by start() has finished
+				*/
+				void wait(void);
+			};
+
+		/*
+			@class merged_results
+			@brief The results lists of all the shards merged into one top-k results list that can be passed to JASS::run_export.
+		*/
+		class merged_results
+			{
+			private:
+				std::vector<JASS::query::docid_rsv_pair> results;	///< The merged results list (using global document ids)
+				size_t next_result;											///< The index of the result get_next() will return
+
+			public:
+				/*
+					JASS_ANYTIME_API::MERGED_RESULTS::MERGE()
+					-----------------------------------------
+				*/
+				/*!
+					@brief Merge the (sorted) results list of each shard into a single top-k results list
+					@param first_document [in] The global document id of each shard's document 0
+					@param searches [in] The searches of the shards
+					@param top_k [in] The number of results to keep
+				*/
+				void merge(const std::vector<size_t> &first_document, std::vector<shard_search> &searches, size_t top_k);
+
+				/*
+					JASS_ANYTIME_API::MERGED_RESULTS::GET_FIRST()
+					---------------------------------------------
+				*/
+				/*!
+					@brief Return the top result
+					@return The first (i.e. top) result in the results list, or NULL if the list is empty
+				*/
+				JASS::query::docid_rsv_pair *get_first(void)
+					{
+					next_result = 0;
+					return get_next();
+					}
+
+				/*
+					JASS_ANYTIME_API::MERGED_RESULTS::GET_NEXT()
+					--------------------------------------------
+				*/
+				/*!
+					@brief After calling get_first(), return the next result
+					@return The next result in the results list, or NULL if at end of list
+				*/
+				JASS::query::docid_rsv_pair *get_next(void)
+					{
+					return next_result < results.size() ? &results[next_result++] : nullptr;
+					}
+			};
+
 		/*
 			@class thread_data
 			@brief thread local data - one of these is needed per thread
@@ -61,20 +226,66 @@ class JASS_anytime_api
 		class thread_data
 			{
 			public:
-				std::unique_ptr<JASS::deserialised_jass_v1::segment_header[]> segment_order;
-				JASS::query *jass_query;
+				std::vector<shard_search> shard;						///< The search of each shard
+				std::vector<uint32_t> largest_term_impact;		///< The largest impact of each query term in any shard
+				merged_results results;									///< The results of the shards merged into one list
+				std::vector<std::unique_ptr<shard_worker>> workers;	///< The workers that search shards 1 to n-1 (shard 0 is searched by the search thread), destroyed before shard
+			};
+
+		/*
+			@class loaded_index
+			@brief An index (all of its shards) along with the thread local data needed to search it.
+			@details Searches hold a std::shared_ptr to the loaded_index they are searching, so when the index is replaced the
+			old index is not deleted until the last search using it has finished.
+		*/
+		class loaded_index
+			{
+			public:
+				std::vector<std::shared_ptr<shard>> shards;				///< The index (more than one shard if the collection is document-partitioned)
+				std::vector<size_t> first_document;							///< The global document id of each shard's document 0 (the number of documents in the shards before it)
+				size_t documents;													///< The number of documents in all the shards
+				size_t index_version;											///< The version of the index (all shards are the same version)
+				std::vector<std::string> directories;						///< The directory of each shard
+				std::mutex thread_local_data_mutex;							///< Serialises access to thread_local_data (each thread_data is only ever used by one thread)
+				std::map<size_t, thread_data> thread_local_data;		///< Data needed by each thread (the accumulators array, etc)
+
+			public:
+				/*
+					JASS_ANYTIME_API::LOADED_INDEX::LOADED_INDEX()
+					----------------------------------------------
+				*/
+				/*!
+					@brief Constructor
+				*/
+				loaded_index() :
+					documents(0),
+					index_version(0)
+					{
+					/* Nothing */
+					}
 			};
 
 	private:
-		JASS::deserialised_jass_v1 *index;							///< The index
+		std::shared_ptr<loaded_index> current_index;			///< The index being searched (nullptr if none has been loaded), only accessed with std::atomic_load() and std::atomic_store()
 		size_t postings_to_process;									///< The maximunm number of postings to process
 		double relative_postings_to_process;						///< If not 1 then then this is the proportion of this query's postings that should be processed
 		size_t top_k;														///< The number of documents we want in the results list
 		JASS::parser_query::parser_type which_query_parser;	///< Use the simple ASCII parser or the regular query parser
 		size_t accumulator_width;										///< Width of the accumulator array
 		JASS_anytime_stats stats;										///< Stats for this "session"
-		std::map<size_t, thread_data> thread_local_data;		///< Data needed by each thread (the accumulators array, etc)
 		std::string accumulator_manager;								///< The name of the accumulator manager
+		size_t checksum_threads;										///< The number of threads to use to verify the index checksums on load (0 = don't verify)
+		size_t postings_cache_size;									///< The size (in bytes) of the cache of segments read on demand (0 = load the postings into memory)
+		size_t postings_io_threads;									///< The number of reads from disk in flight at once (per shard) when the postings are read on demand
+		std::mutex segments_mutex;										///< Serialises changes to the list of segments (replace_sharded_index(), add_segment(), and the segment merger)
+		std::string merger_directory;									///< The segment merger writes the segments it creates into this directory
+		size_t merger_fan_in;											///< The segment merger merges this many segments of a similar size into one
+		std::vector<std::string> merger_created;					///< The segments created by the segment merger (and so deleted by it once they are merged)
+		std::unique_ptr<JASS::thread> merger;						///< The segment merger thread (nullptr if it is not running)
+		std::mutex merger_mutex;										///< Protects merger_pending and merger_stopping
+		std::condition_variable merger_wake;						///< Signalled when there might be segments to merge (or on stop)
+		bool merger_pending;												///< Set when segments have been added since the merger last looked
+		bool merger_stopping;											///< Set when the merger thread should exit
 
 	private:
 		/*
@@ -123,10 +334,139 @@ class JASS_anytime_api
 		*/
 		/*!
 			@brief Return the expensive-to-initialise thread local data that has already been allocated on index load
+			@param index [in] The index the thread is searching
 			@param thread_number [in] The therad number (counts from 0)
 			@return Thread local data
 		*/
-		thread_data &get_thread_local_data(size_t thread_number);
+		thread_data &get_thread_local_data(loaded_index &index, size_t thread_number);
+
+		/*
+			JASS_ANYTIME_API::GET_INDEX()
+			-----------------------------
+		*/
+		/*!
+			@brief Return the current index, which will not be deleted while the returned pointer is held (even if the index is replaced).
+			@return The current index, or nullptr if no index has been loaded
+		*/
+		std::shared_ptr<loaded_index> get_index(void) const
+			{
+			return std::atomic_load(&current_index);
+			}
+
+		/*
+			JASS_ANYTIME_API::READ_SHARD()
+			------------------------------
+		*/
+		/*!
+			@brief Load one shard (or segment) of an index
+			@param into [out] The loaded shard
+			@param index_version [in] What verison of the index is this - normally 2.
+			@param directory [in] The path to the shard
+			@param verbose [in] if true, diagnostics are printed while the shard is loading
+			@return JASS_ERROR_OK on success, else an error code.
+		*/
+		JASS_ERROR read_shard(std::shared_ptr<shard> &into, size_t index_version, const std::string &directory, bool verbose);
+
+		/*
+			JASS_ANYTIME_API::MAKE_INDEX()
+			------------------------------
+		*/
+		/*!
+			@brief Make an index from shards that have already been loaded (numbering the documents of each shard after those in the shards before it)
+			@param into [out] The index
+			@param index_version [in] The version of the shards
+			@param shards [in] The shards (which might also be shards of the current index)
+			@param directories [in] The path to each shard
+			@return JASS_ERROR_OK on success, else an error code.
+		*/
+		JASS_ERROR make_index(std::shared_ptr<loaded_index> &into, size_t index_version, const std::vector<std::shared_ptr<shard>> &shards, const std::vector<std::string> &directories);
+
+		/*
+			JASS_ANYTIME_API::READ_INDEX()
+			------------------------------
+		*/
+		/*!
+			@brief Load an index (one shard from each directory), ready to be searched
+			@param into [out] The loaded index
+			@param index_version [in] What verison of the index is this - normally 2 (all shards must be the same version).
+			@param directories [in] The path to each shard
+			@param verbose [in] if true, diagnostics are printed while the index is loading
+			@return JASS_ERROR_OK on success, else an error code.
+		*/
+		JASS_ERROR read_index(std::shared_ptr<loaded_index> &into, size_t index_version, const std::vector<std::string> &directories, bool verbose);
+
+		/*
+			JASS_ANYTIME_API::WARM_INDEX()
+			------------------------------
+		*/
+		/*!
+			@brief Page the postings of newly loaded shards into memory and allocate the thread local data for each of the threads that have searched the current index.
+			@param index [in] The index to warm
+			@param cold [in] The shards of index that have just been loaded (the others are shared with the current index, so are already warm)
+		*/
+		void warm_index(loaded_index &index, const std::vector<std::shared_ptr<shard>> &cold);
+
+		/*
+			JASS_ANYTIME_API::SWAP_IN_INDEX()
+			---------------------------------
+		*/
+		/*!
+			@brief Load and warm the index in the given directories and swap it in for the current index.  The caller must hold segments_mutex.
+			@param index_version [in] The version of the index
+			@param directories [in] The path to each shard
+			@param verbose [in] Print progress as the index is loaded
+			@return JASS_ERROR_OK on success, else an error code (in which case the current index is still in use).
+		*/
+		JASS_ERROR swap_in_index(size_t index_version, const std::vector<std::string> &directories, bool verbose);
+
+		/*
+			JASS_ANYTIME_API::SWAP_IN_SHARDS()
+			----------------------------------
+		*/
+		/*!
+			@brief Make an index from the given shards (all but one shared with the current index), warm it, and swap it in for the current index.
+			@param index_version [in] The version of the shards
+			@param shards [in] The shards of the new index
+			@param directories [in] The path to each shard
+			@param added [in] The one shard that is not in the current index
+			@return JASS_ERROR_OK on success, else an error code (in which case the current index is still in use).
+		*/
+		JASS_ERROR swap_in_shards(size_t index_version, const std::vector<std::shared_ptr<shard>> &shards, const std::vector<std::string> &directories, const std::shared_ptr<shard> &added);
+
+		/*
+			JASS_ANYTIME_API::SEARCH_SHARD()
+			--------------------------------
+		*/
+		/*!
+			@brief Process the (already sorted) segments of one shard for the current query
+			@param search [in/out] The search of the shard
+			@param index [in] The shard
+			@param scale_rsv_scores [in] Should the impacts be scaled to fit in the accumulators
+			@param largest_possible_rsv_with_overflow [in] The largest possible rsv (over all the shards) before scaling
+			@param query_terms_count [in] The number of terms in the query
+		*/
+		static void search_shard(shard_search &search, const shard &index, bool scale_rsv_scores, uint32_t largest_possible_rsv_with_overflow, size_t query_terms_count);
+
+		/*
+			JASS_ANYTIME_API::SEGMENT_MERGER()
+			----------------------------------
+		*/
+		/*!
+			@brief The segment merger thread, call merge_segments() until there is nothing to merge then wait for add_segment() (or stop_segment_merger()).
+			@param thiss [in] Pointer to the object to merge the segments of
+		*/
+		static void segment_merger(JASS_anytime_api *thiss);
+
+		/*
+			JASS_ANYTIME_API::MERGE_SEGMENTS()
+			----------------------------------
+		*/
+		/*!
+			@brief Merge one run of merger_fan_in adjacent segments of a similar size (the smallest such run) into a single segment and swap it in.
+			@details Segments are of a similar size if they have the same number of base-merger_fan_in digits in their document count (a tiered, log-structured, merge policy).
+			@return true if segments were merged, false if there was nothing to merge (or the merge failed)
+		*/
+		bool merge_segments(void);
 
 	public:
 		/*
@@ -160,12 +500,107 @@ class JASS_anytime_api
 		*/
 		JASS_ERROR load_index(size_t index_version, const std::string &directory = "", bool verbose = false);		// verbose prints progress as it loads the index
 
+		/*
+			JASS_ANYTIME_API::LOAD_SHARDED_INDEX()
+			--------------------------------------
+		*/
+		/*!
+			@brief Load a document-partitioned (sharded) JASS index, one shard from each of the given directories.
+			@details Each query is searched on all the shards in parallel (one thread per shard) and the top-k of each shard are merged into a single
+			results list by rsv.  The documents in shard n are numbered after those of shards 0 to n-1.  The rsvs of different shards can only be
+			compared if the shards gave each document the impacts it would have in the whole collection, so build the shards from the same collection
+			statistics and quantization bounds: index the whole collection with JASS_index -Sw \<file\> and then each shard with -Sr \<file\>.  Shards
+			quantized on their own each use their own IDF, document count, mean length, and score range, so the merged results list is an approximation.
+			@param index_version [in] What verison of the index is this - normally 2 (all shards must be the same version).
+			@param directories [in] The path to each shard
+			@param verbose [in] if true, diagnostics are printed while the index is loading, default = false
+			@return JASS_ERROR_OK on success, else an error code.
+		*/
+		JASS_ERROR load_sharded_index(size_t index_version, const std::vector<std::string> &directories, bool verbose = false);
+
+		/*
+			JASS_ANYTIME_API::REPLACE_INDEX()
+			---------------------------------
+		*/
+		/*!
+			@brief Load a new JASS index from the given directory and swap it for the current index without stopping searching.
+			@details See replace_sharded_index().
+			@param index_version [in] What verison of the index is this - normally 2.
+			@param directory[in] The path to the index, default = "."
+			@param verbose [in] if true, diagnostics are printed while the index is loading, default = false
+			@return JASS_ERROR_OK on success, else an error code (in which case the current index is still in use).
+		*/
+		JASS_ERROR replace_index(size_t index_version, const std::string &directory = "", bool verbose = false);
+
+		/*
+			JASS_ANYTIME_API::REPLACE_SHARDED_INDEX()
+			-----------------------------------------
+		*/
+		/*!
+			@brief Load a new document-partitioned (sharded) JASS index and swap it for the current index without stopping searching.
+			@details This method is intended to be called from a thread other than the search threads.  The new index is loaded and
+			warmed (its postings paged in and its accumulators allocated) while searches continue on the current index.  Then the new index
+			is atomically swapped in.  Queries that started before the swap finish on the old index, and the old index is deleted when the last of
+			them finishes.  Queries that start after the swap use the new index.  If no index has been loaded this method loads one.  The
+			top-k, accumulator width, and accumulator manager of the current index are used for the new index, and the postings budget is unchanged.
+			@param index_version [in] What verison of the index is this - normally 2 (all shards must be the same version).
+			@param directories [in] The path to each shard
+			@param verbose [in] if true, diagnostics are printed while the index is loading, default = false
+			@return JASS_ERROR_OK on success, else an error code (in which case the current index is still in use).
+		*/
+		JASS_ERROR replace_sharded_index(size_t index_version, const std::vector<std::string> &directories, bool verbose = false);
+
+		/*
+			JASS_ANYTIME_API::ADD_SEGMENT()
+			-------------------------------
+		*/
+		/*!
+			@brief Add an index of newly arrived documents (a segment) to the end of the current index, without stopping searching.
+			@details This is incremental indexing: the new documents are indexed (with JASS_index) into a (small) JASS v2 index of their own, and
+			that index is searched along with the existing segments (as a document-partitioned index, see load_sharded_index()) so the new documents
+			are searchable as soon as they are indexed.  The documents in the new segment are numbered after those already in the index.  For the
+			rsvs of the new documents to be comparable to those of the existing documents the new segment must be quantized against the collection
+			statistics of the index (JASS_index -Sr, see JASS::merge_jass_v2).  If no index has been loaded this method loads the segment as the index.  If the segment merger is running (see start_segment_merger()) it
+			is told there is a new segment.
+			@param directory [in] The path to the new segment
+			@param verbose [in] if true, diagnostics are printed while the index is loading, default = false
+			@return JASS_ERROR_OK on success, else an error code (in which case the current index is still in use).
+		*/
+		JASS_ERROR add_segment(const std::string &directory, bool verbose = false);
+
+		/*
+			JASS_ANYTIME_API::START_SEGMENT_MERGER()
+			----------------------------------------
+		*/
+		/*!
+			@brief Start a background thread that merges the segments of the index so that the number of segments stays small (JASS v2 indexes only).
+			@details Whenever there are fan_in adjacent segments of a similar size (the same order of magnitude in base fan_in) they are merged
+			(see JASS::merge_jass_v2) into a new segment in directory, which is then swapped in (see replace_sharded_index()) for them.  So, as
+			segments are added with add_segment(), small segments are merged into larger ones, which are in turn merged into even larger ones (a
+			log-structured merge).  Segments created by the merger are deleted once they have themselves been merged, other segments are left on disk.
+			The impact scores are copied (not re-quantized) so merging does not change the results of a query, but nor does it correct segments that
+			were quantized against different collection statistics (see add_segment()).
+			@param directory [in] The directory to write the merged segments into (it is created if it does not exist)
+			@param fan_in [in] The number of segments to merge at once (at least 2), default = 4
+			@return JASS_ERROR_OK on success, else an error code.
+		*/
+		JASS_ERROR start_segment_merger(const std::string &directory, size_t fan_in = 4);
+
+		/*
+			JASS_ANYTIME_API::STOP_SEGMENT_MERGER()
+			---------------------------------------
+		*/
+		/*!
+			@brief Stop the segment merger thread (after it finishes any merge it is doing).  Does nothing if the merger is not running.
+		*/
+		void stop_segment_merger(void);
+
 		/*
 			JASS_ANYTIME_API::GET_DOCUMENT_COUNT()
 			--------------------------------------
 		*/
 		/*!
-         @brief Return the number of documents in the index
+         @brief Return the number of documents in the index (over all the shards)
          @return The number of documetns in the collection, or 0 if no index has been loaded
 		*/
 		uint32_t get_document_count(void);
@@ -216,6 +651,38 @@ class JASS_anytime_api
 			accumulator_manager = name;
 			}
 
+		/*
+			JASS_ANYTIME_API::SET_CHECKSUM_VERIFICATION()
+			---------------------------------------------
+		*/
+		/*!
+			@brief Verify the CRC-32C checksum of each index file when it is loaded (by load_index(), replace_index(), etc.)
+			@details Verification reads every byte of the index, so it takes time, which is reported if the index is loaded verbosely.  An index that fails is not loaded (JASS_ERROR_BAD_CHECKSUM).
+			@param thread_count [in] The number of threads to use to compute the checksums (0 = don't verify, the default)
+		*/
+		void set_checksum_verification(size_t thread_count)
+			{
+			checksum_threads = thread_count;
+			}
+
+		/*
+			JASS_ANYTIME_API::SET_POSTINGS_ON_DEMAND()
+			------------------------------------------
+		*/
+		/*!
+			@brief Read the segments from disk as they are needed rather than loading the postings into memory (for indexes larger than memory)
+			@details The segments of each query are read (with direct I/O where possible) as soon as the query is parsed, with io_threads reads in
+			flight at once so as to keep an NVMe drive busy.  Recently used segments are kept in a cache of cache_size bytes (per shard).  Call before
+			the index is loaded.
+			@param cache_size [in] The size of the segment cache in bytes (0 = load the postings into memory, the default)
+			@param io_threads [in] The number of reads to have in flight at once (per shard)
+		*/
+		void set_postings_on_demand(size_t cache_size, size_t io_threads = 8)
+			{
+			postings_cache_size = cache_size;
+			postings_io_threads = io_threads;
+			}
+
 		/*
 			JASS_ANYTIME_API::SET_POSTINGS_TO_PROCESS_PROPORTION()
 			------------------------------------------------------
@@ -362,6 +829,15 @@ class JASS_anytime_api
          @return On success, a vector of results, one for each thread.  On failure, an empty vvector or results
 		*/
 		std::vector<JASS_anytime_thread_result> threaded_search(std::vector<std::string> &query_list, size_t thread_count);
+
+		/*
+			JASS_ANYTIME_API::UNITTEST()
+			----------------------------
+		*/
+		/*!
+			@brief Unit test this class
+		*/
+		static void unittest(void);
 	} ;
 
 /*
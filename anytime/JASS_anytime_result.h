@@ -28,6 +28,7 @@ class JASS_anytime_result
 		std::string results_list;			///< The results list
 		size_t postings_processed;			///< The number of postings processed for this query
 		size_t search_time_in_ns;			///< The time it took to resolve the query
+		size_t segments_failed;				///< The number of segments that could not be read from disk (if not 0 then the results list is incomplete)
 
 	/*
 		JASS_ANYTIME_RESULT::JASS_ANYTIME_RESULT()
@@ -41,7 +42,8 @@ class JASS_anytime_result
 		query(),
 		results_list(),
 		postings_processed(0),
-		search_time_in_ns(0)
+		search_time_in_ns(0),
+		segments_failed(0)
 		{
 		/* Nothing */
 		}
@@ -57,13 +59,15 @@ class JASS_anytime_result
       @param results_list [in] The results list (normally in TREC format)
       @param postings_processed [in] The numvber of postings processed (that is, <docid, impact> pairs)
       @param search_time_in_ns [in] The time it took to resolve the query
+      @param segments_failed [in] The number of segments that could not be read from disk (so were not processed)
 	*/
-	JASS_anytime_result(const std::string &query_id, const std::string &query, const std::string &results_list, size_t postings_processed, size_t search_time_in_ns) :
+	JASS_anytime_result(const std::string &query_id, const std::string &query, const std::string &results_list, size_t postings_processed, size_t search_time_in_ns, size_t segments_failed = 0) :
 		query_id(query_id),
 		query(query),
 		results_list(results_list),
 		postings_processed(postings_processed),
-		search_time_in_ns(search_time_in_ns)
+		search_time_in_ns(search_time_in_ns),
+		segments_failed(segments_failed)
 		{
 		/* Nothing */
 		}
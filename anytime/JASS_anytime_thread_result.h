@@ -48,10 +48,11 @@ class JASS_anytime_thread_result
          @param results_list [in] The results list (normally in TREC format)
          @param postings_processed [in] The numvber of postings processed (that is, <docid, impact> pairs)
          @param search_time_in_ns [in] The time it took to resolve the query
+         @param segments_failed [in] The number of segments that could not be read from disk (so were not processed)
 		*/
-		void push_back(const std::string &query_id, const std::string &query, const std::string &results_list, size_t postings_processed, size_t search_time_in_ns)
+		void push_back(const std::string &query_id, const std::string &query, const std::string &results_list, size_t postings_processed, size_t search_time_in_ns, size_t segments_failed = 0)
 			{
-			results[query_id] = JASS_anytime_result(query_id, query, results_list, postings_processed, search_time_in_ns);
+			results[query_id] = JASS_anytime_result(query_id, query, results_list, postings_processed, search_time_in_ns, segments_failed);
 			}
 
 		/*
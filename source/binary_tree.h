@@ -214,10 +214,11 @@ namespace JASS
 				@param key [in] The key to search for.
 				@param parent [in] A pointer to the parent node (used as the "up" pointer for a new node).
 				@param current [in] A reference to the current node pointer.
+				@param arena [in] If a new node is needed it (and its key and element) are allocated from here.
 				@param new_node [in] A pointer to the node to add to the tree (do not use, this is used internally to avoid memory wastage).
 				@return The element associated with the key, or an empty element if a new node for the key was created.
 			*/
-			ELEMENT &find_and_add(const KEY &key, node *parent, std::atomic<node *> &current, node *new_node = nullptr)
+			ELEMENT &find_and_add(const KEY &key, node *parent, std::atomic<node *> &current, allocator &arena, node *new_node = nullptr)
 				{
 				if (current.load() == nullptr)
 					{
@@ -226,7 +227,7 @@ namespace JASS
 					*/
 					node *empty = nullptr;
 					if (new_node == nullptr)
-						new_node = new (pool.malloc(sizeof(node), sizeof(void *))) node(key, pool);
+						new_node = new (arena.malloc(sizeof(node), sizeof(void *))) node(key, arena);
 					new_node->parent = parent;
 					/*
 						If the Compare and Swap fails then there are two possible reasons: Either some other thread has created
@@ -236,17 +237,17 @@ namespace JASS
 						If the Compare and Swap was successful then the answer is current.load()->element.
 					*/
 					if (!current.compare_exchange_strong(empty, new_node))
-						return find_and_add(key, parent, current, new_node);
+						return find_and_add(key, parent, current, arena, new_node);
 					else
 						return current.load()->element;
 					}
 				/*
-					Search on the left or the right
+					Search on the left or the right (passing on any node we've already made so that it isn't wasted)
 				*/
 				else if (key < current.load()->key)
-					return find_and_add(key, current.load(), current.load()->right);
+					return find_and_add(key, current.load(), current.load()->right, arena, new_node);
 				else if (current.load()->key < key)
-					return find_and_add(key, current.load(), current.load()->left);
+					return find_and_add(key, current.load(), current.load()->left, arena, new_node);
 
 				/*
 					Found the element, or we created one.
@@ -347,7 +348,48 @@ namespace JASS
 			*/
 			ELEMENT &operator[](const KEY &key)
 				{
-				return find_and_add(key, nullptr, root);
+				return find_and_add(key, nullptr, root, pool);
+				}
+
+			/*
+				BINARY_TREE::INSERT()
+				---------------------
+			*/
+			/*!
+				@brief Return a reference to the element stored for the given key, making a new empty element (allocated from arena) if there isn't one.
+				@details This is operator[] for use by several threads at once, each with its own arena (such as a thread-local allocator_pool), so that
+				the threads don't contend on the allocator.  The arena must live as long as the tree.
+				@param key [in] They key to find the data for.
+				@param arena [in] If a new node is needed it (and its key and element) are allocated from here.
+				@return The element associated with the key - or an empty element if no key previously existed.
+			*/
+			ELEMENT &insert(const KEY &key, allocator &arena)
+				{
+				return find_and_add(key, nullptr, root, arena);
+				}
+
+			/*
+				BINARY_TREE::FIND()
+				-------------------
+			*/
+			/*!
+				@brief Return a pointer to the element stored for the given key, but unlike operator[] don't add it if it isn't there.
+				@param key [in] They key to find the data for.
+				@return The element associated with the key - or nullptr if the key is not in the tree.
+			*/
+			const ELEMENT *find(const KEY &key) const
+				{
+				node *current = root.load();
+
+				while (current != nullptr)
+					if (key < current->key)
+						current = current->right.load();
+					else if (current->key < key)
+						current = current->left.load();
+					else
+						return &current->element;
+
+				return nullptr;
 				}
 			
 			/*
@@ -390,6 +432,15 @@ namespace JASS
 					output << key.first;
 				
 				JASS_assert(output.str() == "9876543210");
+
+				/*
+					Check find() finds what is there and doesn't add what isn't
+				*/
+				JASS_assert(*tree.find(slice("7")) == slice("seven"));
+				JASS_assert(tree.find(slice("10")) == nullptr);
+				std::ostringstream unchanged;
+				unchanged << tree;
+				JASS_assert(strcmp(unchanged.str().c_str(), answer) == 0);
 				
 				puts("binary_tree::PASSED");
 				}
@@ -5,15 +5,21 @@
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
 #include <stdio.h>
+#include <string.h>
+#include <immintrin.h>
 
 #include <ios>
+#include <array>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 
+#include "maths.h"
 #include "asserts.h"
+#include "threads.h"
 #include "checksum.h"
 #include "unittest_data.h"
 
@@ -97,6 +103,195 @@ namespace JASS
 		return fletcher_16(file);
 		}
 
+	/*
+		CRC32C_POLYNOMIAL
+		-----------------
+		The CRC-32C (Castagnoli) polynomial (bit reversed)
+	*/
+	static constexpr uint32_t crc32c_polynomial = 0x82F63B78;
+
+	/*
+		CRC32C_MULTIPLY_MODULO_P()
+		--------------------------
+		Multiply a and b modulo the CRC-32C polynomial (in the bit reversed representation used by the CRC).  a must not be 0.
+		This is multmodp() from zlib.
+	*/
+	static uint32_t crc32c_multiply_modulo_p(uint32_t a, uint32_t b)
+		{
+		uint32_t bit = (uint32_t)1 << 31;
+		uint32_t product = 0;
+
+		for (;;)
+			{
+			if (a & bit)
+				{
+				product ^= b;
+				if ((a & (bit - 1)) == 0)
+					break;
+				}
+			bit >>= 1;
+			b = b & 1 ? (b >> 1) ^ crc32c_polynomial : b >> 1;
+			}
+
+		return product;
+		}
+
+	/*
+		CRC32C_X_TO_THE_N_MODULO_P()
+		----------------------------
+		Return x^(n * 2^k) modulo the CRC-32C polynomial.  This is x2nmodp() from zlib.
+	*/
+	static uint32_t crc32c_x_to_the_n_modulo_p(size_t n, size_t k)
+		{
+		/*
+			x^(2^k) modulo p, for k = 0..31 (after 32 squarings the sequence repeats)
+		*/
+		static const std::array<uint32_t, 32> x_to_the_2_to_the_k = []()
+			{
+			std::array<uint32_t, 32> table;
+			uint32_t power = (uint32_t)1 << 30;			// x^1
+
+			for (auto &entry : table)
+				{
+				entry = power;
+				power = crc32c_multiply_modulo_p(power, power);
+				}
+			return table;
+			}();
+
+		uint32_t power = (uint32_t)1 << 31;				// x^0
+		while (n != 0)
+			{
+			if (n & 1)
+				power = crc32c_multiply_modulo_p(x_to_the_2_to_the_k[k & 31], power);
+			n >>= 1;
+			k++;
+			}
+
+		return power;
+		}
+
+	/*
+		CRC32C_SERIAL()
+		---------------
+		Compute the CRC-32C of a sequence of bytes, 8 bytes at a time, given the CRC-32C of the bytes before it.
+	*/
+	static uint32_t crc32c_serial(const uint8_t *from, size_t length, uint32_t crc)
+		{
+		uint64_t state = ~crc;
+
+		for (; length >= sizeof(uint64_t); length -= sizeof(uint64_t), from += sizeof(uint64_t))
+			{
+			uint64_t word;
+			memcpy(&word, from, sizeof(word));
+			state = _mm_crc32_u64(state, word);
+			}
+
+		for (; length > 0; length--, from++)
+			state = _mm_crc32_u8((uint32_t)state, *from);
+
+		return ~(uint32_t)state;
+		}
+
+	/*
+		CHECKSUM::CRC32C_COMBINE()
+		--------------------------
+	*/
+	uint32_t checksum::crc32c_combine(uint32_t first, uint32_t second, size_t second_length)
+		{
+		return crc32c_multiply_modulo_p(crc32c_x_to_the_n_modulo_p(second_length, 3), first) ^ second;
+		}
+
+	/*
+		CHECKSUM::CRC32C()
+		------------------
+	*/
+	uint32_t checksum::crc32c(const void *data, size_t length, uint32_t crc)
+		{
+		const uint8_t *from = (const uint8_t *)data;
+
+		/*
+			Short sequences are not worth interleaving
+		*/
+		if (length < 4096)
+			return crc32c_serial(from, length, crc);
+
+		/*
+			The crc32 instruction has a latency of 3 cycles but a throughput of 1 per cycle, so compute the CRC of three lanes at once
+		*/
+		size_t lane_length = (length / 3) & ~(sizeof(uint64_t) - 1);
+		const uint8_t *lane_1 = from;
+		const uint8_t *lane_2 = from + lane_length;
+		const uint8_t *lane_3 = from + 2 * lane_length;
+		uint64_t state_1 = ~crc;
+		uint64_t state_2 = ~(uint32_t)0;
+		uint64_t state_3 = ~(uint32_t)0;
+
+		for (size_t offset = 0; offset < lane_length; offset += sizeof(uint64_t))
+			{
+			uint64_t word_1;
+			uint64_t word_2;
+			uint64_t word_3;
+			memcpy(&word_1, lane_1 + offset, sizeof(word_1));
+			memcpy(&word_2, lane_2 + offset, sizeof(word_2));
+			memcpy(&word_3, lane_3 + offset, sizeof(word_3));
+			state_1 = _mm_crc32_u64(state_1, word_1);
+			state_2 = _mm_crc32_u64(state_2, word_2);
+			state_3 = _mm_crc32_u64(state_3, word_3);
+			}
+
+		/*
+			Combine the lanes then do the tail
+		*/
+		crc = crc32c_combine(~(uint32_t)state_1, ~(uint32_t)state_2, lane_length);
+		crc = crc32c_combine(crc, ~(uint32_t)state_3, lane_length);
+
+		return crc32c_serial(from + 3 * lane_length, length - 3 * lane_length, crc);
+		}
+
+	/*
+		CHECKSUM::CRC32C_PARALLEL()
+		---------------------------
+	*/
+	uint32_t checksum::crc32c_parallel(const void *data, size_t length, size_t thread_count)
+		{
+		static constexpr size_t smallest_part = 1024 * 1024;		// don't start a thread for less than this
+		const uint8_t *from = (const uint8_t *)data;
+
+		thread_count = maths::minimum(thread_count, length / smallest_part);
+		if (thread_count <= 1)
+			return crc32c(data, length);
+
+		/*
+			Each thread computes the CRC of one part of the sequence (the last part gets what is left over)
+		*/
+		size_t part_length = length / thread_count;
+		std::vector<uint32_t> part_crc(thread_count);
+		std::vector<thread> thread_pool;
+		for (size_t part = 1; part < thread_count; part++)
+			{
+			size_t this_part_length = part == thread_count - 1 ? length - part * part_length : part_length;
+			thread_pool.push_back(thread([&part_crc, part, from, part_length, this_part_length]()
+				{
+				part_crc[part] = crc32c(from + part * part_length, this_part_length);
+				}));
+			}
+
+		part_crc[0] = crc32c(from, part_length);
+
+		/*
+			Wait for the threads and combine the CRCs of the parts
+		*/
+		uint32_t crc = part_crc[0];
+		for (size_t part = 1; part < thread_count; part++)
+			{
+			thread_pool[part - 1].join();
+			crc = crc32c_combine(crc, part_crc[part], part == thread_count - 1 ? length - part * part_length : part_length);
+			}
+
+		return crc;
+		}
+
 	/*
 		CHECKSUM::UNITTEST()
 		--------------------
@@ -143,6 +338,26 @@ namespace JASS
 		checksum = checksum::fletcher_16(stream);
 		JASS_assert(checksum == 0xF7DE);
 		
+		/*
+			CRC-32C, the check value is the CRC of "123456789" (from the CRC catalogue: https://reveng.sourceforge.io/crc-catalogue/17plus.htm#crc.cat.crc-32c)
+		*/
+		JASS_assert(checksum::crc32c("123456789", 9) == 0xE3069283);
+		JASS_assert(checksum::crc32c("", 0) == 0);
+
+		/*
+			The interleaved, incremental, combined, and parallel CRCs must all agree
+		*/
+		std::string long_string;
+		while (long_string.size() < 3 * 1024 * 1024 + 17)
+			long_string += unittest_data::ten_documents;
+		uint32_t serial_crc = 0;
+		for (size_t byte = 0; byte < long_string.size(); byte += 1000)
+			serial_crc = checksum::crc32c(&long_string[byte], maths::minimum((size_t)1000, long_string.size() - byte), serial_crc);
+
+		JASS_assert(checksum::crc32c(long_string.data(), long_string.size()) == serial_crc);
+		JASS_assert(checksum::crc32c_combine(checksum::crc32c(long_string.data(), 12345), checksum::crc32c(&long_string[12345], long_string.size() - 12345), long_string.size() - 12345) == serial_crc);
+		JASS_assert(checksum::crc32c_parallel(long_string.data(), long_string.size(), 3) == serial_crc);
+
 		/*
 			Passed!
 		*/
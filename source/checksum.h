@@ -94,6 +94,49 @@ namespace JASS
 			*/
 			static uint16_t fletcher_16_file(const std::string &filename);
 
+			/*
+				CHECKSUM::CRC32C()
+				------------------
+			*/
+			/*!
+				@brief Compute the CRC-32C (Castagnoli) of a sequence of bytes using the SSE4.2 crc32 instruction.
+				@details CRC-32C is the CRC used by iSCSI, ext4, and so on, so it can be checked with standard tools.  Three interleaved CRCs are computed
+				(to hide the latency of the crc32 instruction) and combined with crc32c_combine().  The CRC of a long sequence can be computed a part at a time by passing
+				the CRC of the previous parts as the initial CRC.
+				@param data [in] A pointer to a sequence of bytes to checksum.
+				@param length [in] The number of bytes to checksum.
+				@param crc [in] The CRC-32C of the bytes before data (default = 0, the start of the sequence).
+				@return The CRC-32C of the sequence.
+			*/
+			static uint32_t crc32c(const void *data, size_t length, uint32_t crc = 0);
+
+			/*
+				CHECKSUM::CRC32C_COMBINE()
+				--------------------------
+			*/
+			/*!
+				@brief Given the CRC-32C of two sequences, compute the CRC-32C of their concatination.
+				@details This is the algorithm used by zlib's crc32_combine() (using the CRC-32C polynomial), it takes time proportional to log(second_length).
+				@param first [in] The CRC-32C of the first sequence.
+				@param second [in] The CRC-32C of the second sequence.
+				@param second_length [in] The length (in bytes) of the second sequence.
+				@return The CRC-32C of the first sequence followed by the second sequence.
+			*/
+			static uint32_t crc32c_combine(uint32_t first, uint32_t second, size_t second_length);
+
+			/*
+				CHECKSUM::CRC32C_PARALLEL()
+				---------------------------
+			*/
+			/*!
+				@brief Compute the CRC-32C of a sequence of bytes using several threads (each computes the CRC of part of the sequence, which are then combined).
+				@param data [in] A pointer to a sequence of bytes to checksum.
+				@param length [in] The number of bytes to checksum.
+				@param thread_count [in] The number of threads to use (short sequences use fewer).
+				@return The CRC-32C of the sequence.
+			*/
+			static uint32_t crc32c_parallel(const void *data, size_t length, size_t thread_count);
+
 			/*
 				CHECKSUM::UNITTEST()
 				--------------------
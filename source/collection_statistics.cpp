@@ -0,0 +1,183 @@
+/*
+	COLLECTION_STATISTICS.CPP
+	-------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+
+#include <iomanip>
+#include <sstream>
+#include <filesystem>
+
+#include "file.h"
+#include "asserts.h"
+#include "unittest_data.h"
+#include "collection_statistics.h"
+#include "index_manager_sequential.h"
+
+namespace JASS
+	{
+	/*
+		COLLECTION_STATISTICS::OPERATOR()()
+		-----------------------------------
+	*/
+	void collection_statistics::operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+		{
+		uint64_t collection_frequency = 0;
+		for (compress_integer::integer which = 0; which < document_frequency; which++)
+			collection_frequency += term_frequencies[which];
+
+		terms[std::string(reinterpret_cast<const char *>(term.address()), term.size())] = term_statistics{document_frequency, collection_frequency};
+		}
+
+	/*
+		COLLECTION_STATISTICS::FIND()
+		-----------------------------
+	*/
+	bool collection_statistics::find(const slice &term, term_statistics &into) const
+		{
+		auto found = terms.find(std::string(reinterpret_cast<const char *>(term.address()), term.size()));
+		if (found == terms.end())
+			return false;
+
+		into = found->second;
+		return true;
+		}
+
+	/*
+		COLLECTION_STATISTICS::WRITE()
+		------------------------------
+	*/
+	bool collection_statistics::write(const std::string &filename) const
+		{
+		std::ostringstream out;
+
+		/*
+			The bounds are written with enough digits to be read back exactly (so the impacts are exactly the same)
+		*/
+		out << "JASSv2 collection statistics\n";
+		out << "quantizer " << quantizer << '\n';
+		out << "documents " << documents << '\n';
+		out << "length " << length << '\n';
+		out << "rsv " << std::setprecision(17) << smallest_rsv << ' ' << largest_rsv << '\n';
+		out << "terms " << terms.size() << '\n';
+		for (const auto &[term, statistics] : terms)
+			out << statistics.document_frequency << ' ' << statistics.collection_frequency << ' ' << term << '\n';
+
+		return file::write_entire_file(filename, out.str());
+		}
+
+	/*
+		COLLECTION_STATISTICS::READ()
+		-----------------------------
+	*/
+	bool collection_statistics::read(const std::string &filename)
+		{
+		std::string contents;
+		if (file::read_entire_file(filename, contents) == 0)
+			return false;
+
+		std::istringstream in(contents);
+		std::string line;
+		std::string keyword;
+		size_t term_count;
+
+		std::getline(in, line);
+		if (line != "JASSv2 collection statistics")
+			return false;
+
+		in >> keyword;
+		if (keyword != "quantizer")
+			return false;
+		in.get();
+		std::getline(in, quantizer);
+
+		in >> keyword >> documents;
+		if (keyword != "documents")
+			return false;
+		in >> keyword >> length;
+		if (keyword != "length")
+			return false;
+		in >> keyword >> smallest_rsv >> largest_rsv;
+		if (keyword != "rsv")
+			return false;
+		in >> keyword >> term_count;
+		if (keyword != "terms" || !in)
+			return false;
+
+		terms.clear();
+		terms.reserve(term_count);
+		for (size_t which = 0; which < term_count; which++)
+			{
+			term_statistics statistics;
+			std::string term;
+
+			in >> statistics.document_frequency >> statistics.collection_frequency;
+			in.get();
+			std::getline(in, term);
+			if (!in)
+				return false;
+			terms[term] = statistics;
+			}
+
+		return true;
+		}
+
+	/*
+		COLLECTION_STATISTICS::UNITTEST()
+		---------------------------------
+	*/
+	void collection_statistics::unittest(void)
+		{
+		/*
+			Build an index and gather its statistics
+		*/
+		index_manager_sequential index;
+		index_manager_sequential::unittest_build_index(index, unittest_data::ten_documents);
+
+		collection_statistics statistics(10, 55);
+		index.iterate(statistics);
+		statistics.quantizer = "atire_bm25 k1=0.9 b=0.4 uniform";
+		statistics.smallest_rsv = 0.1;
+		statistics.largest_rsv = 1.0 / 3.0;
+
+		term_statistics found;
+		JASS_assert(statistics.find(slice("nine"), found));
+		JASS_assert(found.document_frequency == 9);
+		JASS_assert(found.collection_frequency == 9);
+		JASS_assert(!statistics.find(slice("eleven"), found));
+
+		/*
+			Write them out and read them back, they must be exactly the same
+		*/
+		std::string filename = (std::filesystem::temp_directory_path() / "jass_collection_statistics_unittest.txt").string();
+		JASS_assert(statistics.write(filename));
+
+		collection_statistics loaded;
+		JASS_assert(loaded.read(filename));
+		JASS_assert(loaded.quantizer == statistics.quantizer);
+		JASS_assert(loaded.documents == 10);
+		JASS_assert(loaded.length == 55);
+		JASS_assert(loaded.smallest_rsv == statistics.smallest_rsv);
+		JASS_assert(loaded.largest_rsv == statistics.largest_rsv);
+		for (const char *term : {"one", "two", "three", "four", "five", "six", "seven", "eight", "nine", "ten"})
+			{
+			term_statistics expected;
+			JASS_assert(statistics.find(slice(term), expected));
+			JASS_assert(loaded.find(slice(term), found));
+			JASS_assert(found.document_frequency == expected.document_frequency);
+			JASS_assert(found.collection_frequency == expected.collection_frequency);
+			}
+
+		/*
+			A file that isn't a statistics file (or is truncated) must fail to load
+		*/
+		file::write_entire_file(filename, "JASSv2 collection statistics\nquantizer tfidf\ndocuments 10\n");
+		JASS_assert(!loaded.read(filename));
+		std::filesystem::remove(filename);
+		JASS_assert(!loaded.read(filename));
+
+		puts("collection_statistics::PASSED");
+		}
+	}
@@ -0,0 +1,174 @@
+/*
+	COLLECTION_STATISTICS.H
+	-----------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief The statistics a ranking function needs to score a collection, and the bounds the scores were quantized between.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "slice.h"
+#include "index_manager.h"
+
+namespace JASS
+	{
+	/*
+		CLASS COLLECTION_STATISTICS
+		---------------------------
+	*/
+	/*!
+		@brief The statistics a ranking function needs to score a collection, and the bounds the scores were quantized between.
+		@details The impact of a posting depends on the collection as well as on the document (the number of documents, the mean
+		document length, the document and collection frequency of the term, and the smallest and largest score in the collection).
+		So two indexes built separately (the shards of a document-partitioned collection, or a base index and the deltas added
+		to it) give the same document different impacts.  If they are all quantized against the same collection_statistics then
+		a document gets the same impact no matter which index it is in, and so the rsvs from the different indexes can be compared.
+
+		Used as an index_manager::delegate, the document and collection frequency of each term in the index are recorded.  The
+		statistics are written to (and read from) a text file:
+		JASSv2 collection statistics
+		quantizer \<the ranking function and quantization method\>
+		documents \<the number of documents\>
+		length \<the sum of the document lengths\>
+		rsv \<the smallest score\> \<the largest score\>
+		terms \<the number of terms\>
+		\<document frequency\> \<collection frequency\> \<term\>
+		...
+	*/
+	class collection_statistics : public index_manager::delegate
+		{
+		public:
+			/*
+				CLASS COLLECTION_STATISTICS::TERM_STATISTICS
+				--------------------------------------------
+			*/
+			/*!
+				@brief The statistics of one term
+			*/
+			class term_statistics
+				{
+				public:
+					compress_integer::integer document_frequency;	///< The number of documents the term occurs in
+					uint64_t collection_frequency;						///< The number of times the term occurs in the collection
+				};
+
+		private:
+			std::unordered_map<std::string, term_statistics> terms;		///< The statistics of each term in the collection
+
+		public:
+			std::string quantizer;				///< The ranking function and quantization method the bounds are for (scores from different rankers can't be compared)
+			uint64_t length;						///< The sum of the document lengths (as passed to the ranking function)
+			double smallest_rsv;					///< The smallest score in the collection (the score given the smallest impact)
+			double largest_rsv;					///< The largest score in the collection (the score given the largest impact)
+
+		public:
+			/*
+				COLLECTION_STATISTICS::COLLECTION_STATISTICS()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param documents [in] The number of documents in the collection
+				@param length [in] The sum of the document lengths
+			*/
+			explicit collection_statistics(size_t documents = 0, uint64_t length = 0) :
+				index_manager::delegate(documents),
+				length(length),
+				smallest_rsv(0),
+				largest_rsv(0)
+				{
+				/* Nothing */
+				}
+
+			/*
+				COLLECTION_STATISTICS::OPERATOR()()
+				-----------------------------------
+			*/
+			/*!
+				@brief Record the document frequency and collection frequency of the term (the term frequencies must not yet have been quantized).
+				@param term [in] The term name.
+				@param postings [in] The postings lists.
+				@param document_frequency [in] The document frequency of the term
+				@param document_ids [in] An array (of length document_frequency) of document ids.
+				@param term_frequencies [in] An array (of length document_frequency) of term frequencies (corresponding to document_ids).
+			*/
+			virtual void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies);
+
+			/*
+				COLLECTION_STATISTICS::OPERATOR()()
+				-----------------------------------
+			*/
+			/*!
+				@brief The callback function for primary keys (external document ids) is operator().  Not needed for statistics.
+				@param document_id [in] The internal document identfier.
+				@param primary_key [in] This document's primary key (external document identifier).
+			*/
+			virtual void operator()(size_t document_id, const slice &primary_key)
+				{
+				/* Nothing */
+				}
+
+			/*
+				COLLECTION_STATISTICS::FINISH()
+				-------------------------------
+			*/
+			/*!
+				@brief Do any final cleaning up
+			*/
+			virtual void finish(void)
+				{
+				/* Nothing */
+				}
+
+			/*
+				COLLECTION_STATISTICS::FIND()
+				-----------------------------
+			*/
+			/*!
+				@brief Look up the statistics of a term
+				@param term [in] The term to look up.
+				@param into [out] The statistics of the term (unchanged if the term is not in the collection).
+				@return true if the term is in the collection, else false.
+			*/
+			bool find(const slice &term, term_statistics &into) const;
+
+			/*
+				COLLECTION_STATISTICS::WRITE()
+				------------------------------
+			*/
+			/*!
+				@brief Write the statistics to a file.
+				@param filename [in] The name of the file to write.
+				@return true on success, false if the file could not be written.
+			*/
+			bool write(const std::string &filename) const;
+
+			/*
+				COLLECTION_STATISTICS::READ()
+				-----------------------------
+			*/
+			/*!
+				@brief Read the statistics from a file written by write(), replacing those in this object.
+				@param filename [in] The name of the file to read.
+				@return true on success, false if the file could not be read or is not a statistics file.
+			*/
+			bool read(const std::string &filename);
+
+			/*
+				COLLECTION_STATISTICS::UNITTEST()
+				---------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
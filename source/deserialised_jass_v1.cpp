@@ -5,10 +5,13 @@
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
 #include <algorithm>
+#include <sstream>
 #include <filesystem>
 
 #include "file.h"
 #include "slice.h"
+#include "timer.h"
+#include "checksum.h"
 #include "serialise_jass_v1.h"
 #include "compress_integer_all.h"
 #include "deserialised_jass_v1.h"
@@ -149,7 +152,7 @@ namespace JASS
 		/*
 			Read the postings
 		*/
-		auto postings_memory_length = file::read_entire_file(filename, postings_memory);
+		auto postings_memory_length = file::read_entire_file(filename, postings_memory, postings_resident);
 
 		/*
 			This can take some time so make some noise when we're finished
@@ -188,6 +191,91 @@ namespace JASS
 		return read_index_explicit((path / PRIMARY_KEY_FILENAME).string(), (path / VOCAB_FILENAME).string(), (path / TERMS_FILENAME).string(), (path / POSTINGS_FILENAME).string());
 		}
 
+	/*
+		DESERIALISED_JASS_V1::VERIFY_CHECKSUMS()
+		----------------------------------------
+	*/
+	bool deserialised_jass_v1::verify_checksums(const std::string &directory, size_t thread_count) const
+		{
+		if (verbose)
+			{
+			printf("Verifying checksums... ");
+			fflush(stdout);
+			}
+
+		std::string manifest;
+		if (file::read_entire_file((std::filesystem::path(directory) / CHECKSUM_FILENAME).string(), manifest) == 0)
+			{
+			if (verbose)
+				puts("failed (no checksum file)");
+			return false;
+			}
+
+		/*
+			Each line of the manifest is <crc> <length> <filename>, every one of the index files must be listed
+		*/
+		std::pair<const char *, const file::file_read_only *> index_files[] =
+			{
+			{PRIMARY_KEY_FILENAME, &primary_key_memory},
+			{VOCAB_FILENAME, &vocabulary_memory},
+			{TERMS_FILENAME, &vocabulary_terms_memory},
+			{POSTINGS_FILENAME, &postings_memory}
+			};
+		size_t files_verified = 0;
+		size_t total_bytes = 0;
+		auto verify_time = timer::start();
+
+		std::istringstream lines(manifest);
+		uint32_t expected_crc;
+		uint64_t expected_length;
+		std::string filename;
+		while (lines >> std::hex >> expected_crc >> std::dec >> expected_length >> filename)
+			for (const auto &[name, memory] : index_files)
+				if (filename == name)
+					{
+					const uint8_t *contents;
+					size_t length = memory->read_entire_file(contents);
+
+					/*
+						If the file isn't held in memory (for example, a vocabulary that has been front coded) then check the file on disk
+					*/
+					file::file_read_only from_disk;
+					if (contents == nullptr)
+						{
+						file::read_entire_file((std::filesystem::path(directory) / name).string(), from_disk);
+						length = from_disk.read_entire_file(contents);
+						}
+
+					if (length != expected_length || checksum::crc32c_parallel(contents, length, thread_count) != expected_crc)
+						{
+						if (verbose)
+							printf("failed (%s is corrupt)\n", name);
+						return false;
+						}
+					total_bytes += length;
+					files_verified++;
+					}
+
+		if (files_verified != sizeof(index_files) / sizeof(*index_files))
+			{
+			if (verbose)
+				puts("failed (checksum file is incomplete)");
+			return false;
+			}
+
+		/*
+			Report the throughput so we know what it costs to verify on load
+		*/
+		if (verbose)
+			{
+			double seconds = (double)timer::stop(verify_time).nanoseconds() / 1000000000.0;
+			double megabytes = (double)total_bytes / (1024.0 * 1024.0);
+			printf("done (%.1f MB in %.3f seconds, %.0f MB/second)\n", megabytes, seconds, seconds == 0 ? 0 : megabytes / seconds);
+			}
+
+		return true;
+		}
+
 	/*
 		DESERIALISED_JASS_V1::CODEX()
 		-----------------------------
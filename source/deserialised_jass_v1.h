@@ -35,11 +35,12 @@ namespace JASS
 	*/
 	class deserialised_jass_v1
 		{
-		private:
+		public:
 			static constexpr const char *PRIMARY_KEY_FILENAME = "CIdoclist.bin";
 			static constexpr const char *VOCAB_FILENAME = "CIvocab.bin";
 			static constexpr const char *TERMS_FILENAME = "CIvocab_terms.bin";
 			static constexpr const char *POSTINGS_FILENAME = "CIpostings.bin";
+			static constexpr const char *CHECKSUM_FILENAME = "CIchecksums.txt";
 
 		public:
 			/*
@@ -157,6 +158,7 @@ namespace JASS
 			std::vector<metadata> vocabulary_list;				///< The (sorted in alphabetical order) array of vocbulary terms
 
 			file::file_read_only postings_memory;				///< Memory used to store the postings
+			bool postings_resident;									///< Should the postings be read into memory when the index is loaded (or paged in on use)?
 
 		protected:
 			/*
@@ -219,7 +221,8 @@ namespace JASS
 			explicit deserialised_jass_v1(bool verbose = false) :
 				verbose(verbose),
 				documents(0),
-				terms(0)
+				terms(0),
+				postings_resident(true)
 				{
 				/* Nothing */
 				}
@@ -236,6 +239,21 @@ namespace JASS
 				/* Nothing */
 				}
 				
+			/*
+				DESERIALISED_JASS_V1::SET_POSTINGS_RESIDENT()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Should the postings be read into memory by read_index() (the default), or only mapped and paged in as they are used?
+				@details Call before read_index().  The postings are not resident when they are too large for memory and the segments are
+				instead read on demand (see segment_cache).
+				@param resident [in] true to read the postings when the index is loaded, false to page them in on use.
+			*/
+			void set_postings_resident(bool resident)
+				{
+				postings_resident = resident;
+				}
+
 			/*
 				DESERIALISED_JASS_V1::READ_INDEX()
 				----------------------------------
@@ -247,6 +265,19 @@ namespace JASS
 			*/
 			size_t read_index(const std::string &directory = "");
 
+			/*
+				DESERIALISED_JASS_V1::VERIFY_CHECKSUMS()
+				----------------------------------------
+			*/
+			/*!
+				@brief Check that the (already loaded) index has not been corrupted by comparing the CRC-32C of each file to that in CIchecksums.txt
+				@details The CRCs are computed from the index in memory (so this also pages the index into memory).  If verbose then the throughput is reported.
+				@param directory [in] The directory the index was loaded from (where CIchecksums.txt is)
+				@param thread_count [in] The number of threads to use to compute the CRCs (default = 1)
+				@return true if every file has the length and CRC-32C listed in CIchecksums.txt, false if not (or if there is no CIchecksums.txt).
+			*/
+			bool verify_checksums(const std::string &directory = "", size_t thread_count = 1) const;
+
 			/*
 				DESERIALISED_JASS_V1::CODEX()
 				-----------------------------
@@ -287,6 +318,20 @@ namespace JASS
 				return buffer;
 				}
 
+			/*
+				DESERIALISED_JASS_V1::POSTINGS_SIZE()
+				-------------------------------------
+			*/
+			/*!
+				@brief Return the size (in bytes) of the postings "file"
+				@return The size of the postings "file"
+			*/
+			size_t postings_size(void) const
+				{
+				const uint8_t *buffer = nullptr;
+				return postings_memory.read_entire_file(buffer);
+				}
+
 			/*
 				DESERIALISED_JASS_V1::DOCUMENT_COUNT()
 				--------------------------------------
@@ -310,7 +355,7 @@ namespace JASS
 				@param term [in] Find the metadata for this term
 				@return true on success, false on fail (e.g. term not in dictionary)
 			*/
-			bool postings_details(metadata &metadata, const query_term &term) const
+			virtual bool postings_details(metadata &metadata, const query_term &term) const
 				{
 				auto found = std::lower_bound(vocabulary_list.begin(), vocabulary_list.end(), term.token());
 
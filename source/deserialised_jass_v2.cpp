@@ -22,23 +22,32 @@ namespace JASS
 			printf("Loading vocab... ");
 			fflush(stdout);
 			}
+		/*
+			A front coded vocabulary doesn't need the vocabulary files once it has been built, so only keep them in memory if the
+			vocabulary_list (which points into them) is being used.
+		*/
+		file::file_read_only front_coded_vocab_memory;
+		file::file_read_only front_coded_vocab_terms_memory;
+		file::file_read_only &vocab_memory = front_coded ? front_coded_vocab_memory : vocabulary_memory;
+		file::file_read_only &vocab_terms_memory = front_coded ? front_coded_vocab_terms_memory : vocabulary_terms_memory;
+
 		/*
 			Read the file of tripples that are the pointers to the terms (and the postings too)
 		*/
-		auto length = file::read_entire_file(vocab_filename, vocabulary_memory);
+		auto length = file::read_entire_file(vocab_filename, vocab_memory);
 		if (length == 0)
 			return 0;
 		const uint8_t *vocab;
-		vocabulary_memory.read_entire_file(vocab);
+		vocab_memory.read_entire_file(vocab);
 
 		/*
 			Read the file of strings that is the vocabulary
 		*/
-		auto bytes = file::read_entire_file(terms_filename, vocabulary_terms_memory);
+		auto bytes = file::read_entire_file(terms_filename, vocab_terms_memory);
 		if (bytes == 0)
 			return 0;
 		const uint8_t *vocab_terms;
-		vocabulary_terms_memory.read_entire_file(vocab_terms);
+		vocab_terms_memory.read_entire_file(vocab_terms);
 
 		/*
 			Build the vocabulary
@@ -56,9 +65,13 @@ namespace JASS
 			compress_integer_variable_byte::decompress_into(&postings_pointer, from);
 			compress_integer_variable_byte::decompress_into(&impact, from);
 
-			vocabulary_list.push_back(metadata(slice(reinterpret_cast<const char*>(vocab_terms + term_pointer)), postings_base + postings_pointer, impact));
+			if (front_coded)
+				front_coded_vocabulary.push_back(slice(reinterpret_cast<const char*>(vocab_terms + term_pointer)), postings_pointer, impact);
+			else
+				vocabulary_list.push_back(metadata(slice(reinterpret_cast<const char*>(vocab_terms + term_pointer)), postings_base + postings_pointer, impact));
 			terms++;
 			}
+		front_coded_vocabulary.shrink_to_fit();
 
 		/*
 			This can take some time so make some noise when we're finished
@@ -13,6 +13,7 @@
 #pragma once
 
 #include "deserialised_jass_v1.h"
+#include "vocabulary_front_coded.h"
 #include "compress_integer_variable_byte.h"
 
 namespace JASS
@@ -26,6 +27,10 @@ namespace JASS
 	*/
 	class deserialised_jass_v2 : public deserialised_jass_v1
 		{
+		protected:
+			bool front_coded;											///< Should the vocabulary be front coded in memory (rather than a vocabulary_list)?
+			vocabulary_front_coded front_coded_vocabulary;	///< The vocabulary (if front_coded)
+
 		protected:
 			/*
 				DESERIALISED_JASS_V2::READ_VOCABULARY()
@@ -60,7 +65,8 @@ namespace JASS
 				@param verbose [in] Should the index reading methods produce messages on stdout?
 			*/
 			explicit deserialised_jass_v2(bool verbose = false) :
-				deserialised_jass_v1(verbose)
+				deserialised_jass_v1(verbose),
+				front_coded(false)
 				{
 				/* Nothing */
 				}
@@ -77,6 +83,22 @@ namespace JASS
 				/* Nothing */
 				}
 
+			/*
+				DESERIALISED_JASS_V2::SET_FRONT_CODED_VOCABULARY()
+				--------------------------------------------------
+			*/
+			/*!
+				@brief Should the vocabulary be held in memory front coded (see vocabulary_front_coded)?
+				@details Call before read_index().  A front coded vocabulary is typically 4-8 times smaller than the vocabulary_list (which
+				needs the vocabulary files to remain in memory too), but it can only be searched with postings_details(), begin() and end()
+				do not iterate over it.
+				@param compress [in] true to front code the vocabulary, false to use a vocabulary_list (the default)
+			*/
+			void set_front_coded_vocabulary(bool compress)
+				{
+				front_coded = compress;
+				}
+
 			/*
 				DESERIALISED_JASS_V2::POSTINGS_DETAILS()
 				----------------------------------------
@@ -87,8 +109,20 @@ namespace JASS
 				@param term [in] Find the metadata for this term
 				@return true on success, false on fail (e.g. term not in dictionary)
 			*/
-			bool postings_details(metadata &metadata, const query_term &term) const
+			virtual bool postings_details(metadata &metadata, const query_term &term) const
 				{
+				if (front_coded)
+					{
+					uint64_t postings_offset;
+					uint64_t impacts;
+
+					if (!front_coded_vocabulary.find(term.token(), postings_offset, impacts))
+						return false;
+
+					metadata = deserialised_jass_v1::metadata(term.token(), postings() + postings_offset, impacts);
+					return true;
+					}
+
 				auto found = std::lower_bound(vocabulary_list.begin(), vocabulary_list.end(), term.token());
 
 				/*
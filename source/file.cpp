@@ -33,7 +33,7 @@ namespace JASS
 		FILE::FILE_READ_ONLY::OPEN()
 		----------------------------
 	*/
-	size_t file::file_read_only::open(const std::string &filename)
+	size_t file::file_read_only::open(const std::string &filename, bool populate)
 		{
 		#ifdef _MSC_VER
 			hFile = CreateFile(filename.c_str(), GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, NULL);
@@ -88,7 +88,7 @@ namespace JASS
 			#ifdef __APPLE__
 				file_contents = (uint8_t *)mmap(nullptr, statistics.st_size, PROT_READ, MAP_PRIVATE, reader, 0);
 			#else
-				file_contents = (uint8_t *)mmap(nullptr, statistics.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, reader, 0);
+				file_contents = (uint8_t *)mmap(nullptr, statistics.st_size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), reader, 0);
 			#endif
 
 			/*
@@ -96,8 +96,11 @@ namespace JASS
 			*/
 			close(reader);
 
-			if (file_contents == nullptr)
+			if (file_contents == MAP_FAILED)
+				{
+				file_contents = nullptr;
 				return 0;
+				}
 
 			/*
 				Remember the file size
@@ -86,9 +86,10 @@ namespace JASS
 					/*!
 						@brief Open and read the file into memory
 						@param filename [in] The name of the file to read
+						@param populate [in] Should the file be read now (true), or paged in as it is used (false)
 						@return The size of the file
 					*/
-					size_t open(const std::string &filename);
+					size_t open(const std::string &filename, bool populate = true);
 
 					/*
 						FILE::FILE_READ_ONLY::~FILE_READ_ONLY()
@@ -453,11 +454,12 @@ namespace JASS
 				@details Because into is a string it is naturally '\0' terminated by the C++ std::string class.
 				@param filename [in] The path of the file to read.
 				@param into [out] The std::string to write into.  This string will be re-sized to the size of the file.
+				@param populate [in] Should the file be read now (true), or paged in as it is used (false)
 				@return The size of the file in bytes
 			*/
-			static size_t read_entire_file(const std::string &filename, file_read_only &into)
+			static size_t read_entire_file(const std::string &filename, file_read_only &into, bool populate = true)
 				{
-				return into.open(filename);
+				return into.open(filename, populate);
 				}
 
 			/*
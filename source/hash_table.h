@@ -13,6 +13,9 @@
 #pragma once
 
 #include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
 #include <algorithm>
 
 #include "allocator_pool.h"
@@ -27,10 +30,13 @@ namespace JASS
 	*/
 	/*!
 		@brief Thread-safe hash table (without delete).
-		@details The thread-safe hash table is implemented as an array of pointers to the thread-safe binary tree.  The only
-		way to access elements is with operator[], thus making it easier to access and easier to implement as thread safe.
-		As a thread-safe lock-free structure using a pool allocator, its possible for there to be a leak if multiple threads
-		try and allocate the same node (or same node in the same tree) at the same time. Destructors of ELEMENT and KEY are
+		@details The thread-safe hash table is implemented as an array of pointers to the thread-safe binary tree.  Elements
+		are added with operator[] (or insert(), which allocates from a given arena) and looked up with find(), thus making it
+		easier to access and easier to implement as thread safe.  Insertion is lock-free, a new tree or node is published with
+		a single Compare and Swap, so several threads can insert at once (each with its own arena so that they don't contend on
+		the allocator either).  As a thread-safe lock-free structure using a pool allocator, its possible for there to be a leak if multiple threads
+		try and allocate the same node (or same node in the same tree) at the same time.  Iteration is not thread-safe (it must not
+		happen while other threads are inserting). Destructors of ELEMENT and KEY are
 		never called as all memory is managed by the pool allocator.  There is no way to remove an element from the hash table
 		once added.
 		@tparam KEY The type used as the key to the element (must include KEY(allocator, KEY) copy constructor).
@@ -261,23 +267,56 @@ namespace JASS
 				@return The element associated with the key.
 			*/
 			ELEMENT &operator[](const KEY &key)
+				{
+				return insert(key, memory_pool);
+				}
+
+			/*
+				HASH_TABLE::INSERT()
+				--------------------
+			*/
+			/*!
+				@brief Return a reference to the element associated with the key, creating an empty one (allocated from arena) if there isn't one.
+				@details This is operator[] for use by several threads at once, each with its own arena (such as a thread-local allocator_pool), so that
+				the threads only contend when they add to the same bucket at the same moment.  The arena must live as long as the hash table.
+				@param key [in] The key to look up.
+				@param arena [in] If a new tree or node is needed it (and its key and element) are allocated from here.
+				@return The element associated with the key.
+			*/
+			ELEMENT &insert(const KEY &key, allocator &arena)
 				{
 				size_t hash = hash_pearson::hash<BITS>(key);
-				
-				if (table[hash].load() == nullptr)
+				binary_tree<KEY, ELEMENT> *tree = table[hash].load();
+
+				if (tree == nullptr)
 					{
-					binary_tree<KEY, ELEMENT> *empty = nullptr;
-					binary_tree<KEY, ELEMENT> *new_tree = new (memory_pool.malloc(sizeof(*new_tree), sizeof(void *))) binary_tree<KEY, ELEMENT>(memory_pool);
-					
-					table[hash].compare_exchange_strong(empty, new_tree);
+					binary_tree<KEY, ELEMENT> *new_tree = new (arena.malloc(sizeof(*new_tree), sizeof(void *))) binary_tree<KEY, ELEMENT>(arena);
+
 					/*
-						If the Compare and Swap fails then ignore as it simply means there is now a tree in the table, it doesn't mean the key is in the tree.
+						If the Compare and Swap fails then another thread got there first, so use its tree (the new one is wasted, but its
+						only a few bytes of arena).  It doesn't mean the key is in the tree.
 					*/
+					if (table[hash].compare_exchange_strong(tree, new_tree))
+						tree = new_tree;
 					}
-				/*
-					Turn the atomic pointer into a binary_tree and call operator[]
-				*/
-				return (*table[hash].load())[key];
+
+				return tree->insert(key, arena);
+				}
+
+			/*
+				HASH_TABLE::FIND()
+				------------------
+			*/
+			/*!
+				@brief Return a pointer to the element associated with the key, but unlike operator[] don't create one if there isn't one.
+				@param key [in] The key to look up.
+				@return The element associated with the key, or nullptr if the key is not in the hash table.
+			*/
+			const ELEMENT *find(const KEY &key) const
+				{
+				binary_tree<KEY, ELEMENT> *tree = table[hash_pearson::hash<BITS>(key)].load();
+
+				return tree == nullptr ? nullptr : tree->find(key);
 				}
 
 			/*
@@ -319,7 +358,50 @@ namespace JASS
 				for (const auto element : map)
 					output << element.first;
 				JASS_assert(output.str() == "0614538729");
-	
+
+				/*
+					Check find()
+				*/
+				JASS_assert(*map.find(slice("4")) == slice("four"));
+				JASS_assert(map.find(slice("x")) == nullptr);
+
+				/*
+					Check concurrent insert(), each thread with its own arena.  Every thread must get the same element for the same key.
+				*/
+				constexpr size_t thread_count = 4;
+				constexpr size_t key_count = 5000;
+				std::vector<std::string> keys;
+				for (size_t which = 0; which < key_count; which++)
+					keys.push_back(std::to_string(which));
+
+				allocator_pool shared_pool;
+				hash_table<slice, slice, 8> shared(shared_pool);			// small so that there are many collisions
+				std::vector<allocator_pool> arenas(thread_count);
+				std::vector<std::vector<slice *>> found(thread_count, std::vector<slice *>(key_count));
+				std::vector<std::thread> threads;
+				for (size_t which = 0; which < thread_count; which++)
+					threads.push_back(std::thread([&, which]()
+						{
+						for (size_t key = 0; key < key_count; key++)
+							{
+							size_t index = (key + which * key_count / thread_count) % key_count;		// each thread starts in a different place
+							found[which][index] = &shared.insert(slice((void *)keys[index].data(), keys[index].size()), arenas[which]);
+							}
+						}));
+				for (auto &thread : threads)
+					thread.join();
+
+				for (size_t which = 1; which < thread_count; which++)
+					JASS_assert(found[which] == found[0]);
+
+				size_t unique_keys = 0;
+				for (const auto element : shared)
+					{
+					unique_keys++;
+					JASS_assert(shared.find(element.first) == &element.second);
+					}
+				JASS_assert(unique_keys == key_count);
+
 				puts("hash_table::PASSED");
 				}
 		};
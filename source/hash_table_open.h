@@ -0,0 +1,602 @@
+/*
+	HASH_TABLE_OPEN.H
+	-----------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Open addressing (SIMD probed) resizable hash table (without delete).
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <string.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "slice.h"
+#include "asserts.h"
+#include "allocator_pool.h"
+
+namespace JASS
+	{
+	/*
+		CLASS HASH_TABLE_OPEN
+		---------------------
+	*/
+	/*!
+		@brief Open addressing resizable hash table (without delete), in the style of Google's Swiss Table.
+		@details Unlike hash_table, which is a fixed size array of binary trees, this table is a single array of slots that doubles in size once
+		it is 7/8 full, so finding a term does not chase pointers down a tree.  The slots are in groups of 16, and alongside the slots is an array
+		of one byte tags, the bottom 7 bits of the hash of the key in each slot (or EMPTY).  A lookup hashes the key, compares the tag with all 16
+		tags of a group in one SIMD instruction, and only looks at the slots whose tag matches.  If the group has an empty slot the key is not in
+		the table, otherwise the next group is probed (triangular probing over the groups).  Each slot holds the hash, the key (a slice, which is
+		the address and length), and the first 8 bytes of the key, so most mismatches (and all matches of keys of 8 or fewer bytes) are decided
+		without looking at the key's bytes.  The keys and elements are allocated from the pool allocator (so elements do not move when the table
+		grows), the slots and tags are not.  This object is not thread-safe.  Destructors of ELEMENT and KEY are never called as all memory is
+		managed by the pool allocator.  There is no way to remove an element from the hash table once added.
+		@tparam KEY The type used as the key to the element (must have address() and size(), and include a KEY(allocator, KEY) copy constructor).
+		@tparam ELEMENT The element data returned given the key (must include ELEMENT(allocator) constructur).
+	*/
+	template <typename KEY, typename ELEMENT>
+	class hash_table_open
+		{
+		/*!
+			@brief Output a human readable serialisation to an ostream
+			@relates hash_table_open
+		*/
+		template<typename A, typename B> friend std::ostream &operator<<(std::ostream &stream, const hash_table_open<A, B> &map);
+
+		protected:
+			static constexpr size_t GROUP_SIZE = 16;						///< The number of slots probed at once (the width of an SSE register in bytes)
+			static constexpr uint8_t EMPTY = 0x80;							///< The tag of an empty slot (a full slot's tag has the high bit clear)
+			static constexpr size_t INITIAL_CAPACITY = 1024;			///< The number of slots in a new table
+
+			/*
+				CLASS HASH_TABLE_OPEN::SLOT
+				---------------------------
+			*/
+			/*!
+				@brief The contents of a single slot in the hash table.
+			*/
+			class slot
+				{
+				public:
+					uint64_t hash;						///< The full hash of the key (so the table can grow without re-hashing)
+					uint64_t prefix;					///< The first 8 bytes of the key (zero padded)
+					KEY key;								///< The key
+					ELEMENT *element;					///< The element (allocated from the pool)
+				};
+
+		protected:
+			/*
+				CLASS HASH_TABLE_OPEN::ITERATOR
+				-------------------------------
+			*/
+			/*!
+				@brief Iterate over the hash table.
+			*/
+			class iterator
+				{
+				private:
+					const hash_table_open<KEY, ELEMENT> &iterand;				///< The hash table being iterated over.
+					size_t location;														///< Current slot in the hash table.
+
+				public:
+					/*
+						HASH_TABLE_OPEN::ITERATOR::ITERATOR
+						-----------------------------------
+					*/
+					/*!
+						@brief Constructor.
+						@param over [in] The hash table to iterate over.
+						@param current [in] The slot to start at.
+					*/
+					iterator(const hash_table_open &over, size_t current) :
+						iterand(over),
+						location(current)
+						{
+						while (location < iterand.capacity && iterand.tags[location] == EMPTY)
+							location++;
+						}
+
+					/*
+						HASH_TABLE_OPEN::ITERATOR::OPERATOR*()
+						--------------------------------------
+					*/
+					/*!
+						@brief Return a reference to the object at the current location.
+						@return The current object.
+					*/
+					const typename std::pair<const KEY &, const ELEMENT &> operator*() const
+						{
+						return std::pair<const KEY &, const ELEMENT &>(iterand.slots[location].key, *iterand.slots[location].element);
+						}
+
+					/*
+						HASH_TABLE_OPEN::ITERATOR::OPERATOR!=()
+						---------------------------------------
+					*/
+					/*!
+						@brief Compare two iterator objects for non-equality.
+						@param other [in] The iterator object to compare to.
+						@return true if they differ, else false.
+					*/
+					bool operator!=(const iterator &other) const
+						{
+						return location != other.location;
+						}
+
+					/*
+						HASH_TABLE_OPEN::ITERATOR::OPERATOR++()
+						---------------------------------------
+					*/
+					/*!
+						@brief Increment this iterator.
+					*/
+					iterator &operator++()
+						{
+						do
+							location++;
+						while (location < iterand.capacity && iterand.tags[location] == EMPTY);
+
+						return *this;
+						}
+				};
+
+		protected:
+			allocator &memory_pool;							///< The keys and elements are allocated from here
+			size_t capacity;									///< The number of slots in the table (a power of 2, and a multiple of GROUP_SIZE)
+			size_t elements;									///< The number of slots in use
+			std::unique_ptr<uint8_t[]> tags;				///< The tag of each slot (or EMPTY)
+			std::unique_ptr<slot[]> slots;				///< The slots
+
+		protected:
+			/*
+				HASH_TABLE_OPEN::HASH()
+				-----------------------
+			*/
+			/*!
+				@brief Hash the key 8 bytes at a time (multiply and fold).
+				@param key [in] The key to hash.
+				@return A 64-bit hash value.
+			*/
+			static inline uint64_t hash(const KEY &key)
+				{
+				const uint8_t *byte = reinterpret_cast<const uint8_t *>(key.address());
+				size_t length = key.size();
+				uint64_t result = 0x9E3779B97F4A7C15ULL ^ length;
+				uint64_t word;
+
+				for (; length >= sizeof(word); length -= sizeof(word), byte += sizeof(word))
+					{
+					memcpy(&word, byte, sizeof(word));
+					result = (result ^ word) * 0xFF51AFD7ED558CCDULL;
+					result ^= result >> 32;
+					}
+				if (length != 0)
+					{
+					word = 0;
+					memcpy(&word, byte, length);
+					result = (result ^ word) * 0xFF51AFD7ED558CCDULL;
+					}
+
+				/*
+					Finalise (from MurmurHash3's fmix64) so that both the high bits (the group) and the low bits (the tag) depend on every byte
+				*/
+				result ^= result >> 33;
+				result *= 0xC4CEB9FE1A85EC53ULL;
+				result ^= result >> 33;
+
+				return result;
+				}
+
+			/*
+				HASH_TABLE_OPEN::PREFIX()
+				-------------------------
+			*/
+			/*!
+				@brief Return the first 8 bytes of the key (zero padded if the key is shorter).
+				@param key [in] The key.
+				@return The prefix.
+			*/
+			static inline uint64_t prefix(const KEY &key)
+				{
+				uint64_t result = 0;
+				memcpy(&result, key.address(), key.size() < sizeof(result) ? key.size() : sizeof(result));
+				return result;
+				}
+
+			/*
+				HASH_TABLE_OPEN::SAME()
+				-----------------------
+			*/
+			/*!
+				@brief Is the key in the slot the same as the given key.
+				@param in [in] The slot.
+				@param key [in] The key.
+				@param key_prefix [in] The first 8 bytes of key.
+				@return true if they are the same, else false.
+			*/
+			static inline bool same(const slot &in, const KEY &key, uint64_t key_prefix)
+				{
+				if (in.prefix != key_prefix || in.key.size() != key.size())
+					return false;
+				if (key.size() <= sizeof(key_prefix))
+					return true;
+				return memcmp(reinterpret_cast<const uint8_t *>(in.key.address()) + sizeof(key_prefix), reinterpret_cast<const uint8_t *>(key.address()) + sizeof(key_prefix), key.size() - sizeof(key_prefix)) == 0;
+				}
+
+			/*
+				HASH_TABLE_OPEN::MATCH()
+				------------------------
+			*/
+			/*!
+				@brief Return a bitmap of the slots in a group that have the given tag.
+				@param group [in] The tags of the 16 slots in the group.
+				@param tag [in] The tag to look for.
+				@return Bit n is set if slot n of the group has the tag.
+			*/
+			static inline uint32_t match(__m128i group, uint8_t tag)
+				{
+				return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(tag)))));
+				}
+
+			/*
+				HASH_TABLE_OPEN::ALLOCATE()
+				---------------------------
+			*/
+			/*!
+				@brief Allocate (empty) tags and slots for a table of the given capacity.
+				@param new_capacity [in] The number of slots.
+			*/
+			void allocate(size_t new_capacity)
+				{
+				capacity = new_capacity;
+				tags.reset(new uint8_t[capacity]);
+				memset(tags.get(), EMPTY, capacity);
+				slots.reset(new slot[capacity]);
+				}
+
+			/*
+				HASH_TABLE_OPEN::FIND_EMPTY()
+				-----------------------------
+			*/
+			/*!
+				@brief Return the first empty slot on the probe sequence of the given hash.
+				@param key_hash [in] The hash.
+				@return The location of the empty slot.
+			*/
+			size_t find_empty(uint64_t key_hash) const
+				{
+				size_t mask = capacity / GROUP_SIZE - 1;
+				size_t group = (key_hash >> 7) & mask;
+				for (size_t step = 1; ; step++)
+					{
+					uint32_t empty = match(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&tags[group * GROUP_SIZE])), EMPTY);
+					if (empty != 0)
+						return group * GROUP_SIZE + _tzcnt_u32(empty);
+					group = (group + step) & mask;
+					}
+				}
+
+			/*
+				HASH_TABLE_OPEN::GROW()
+				-----------------------
+			*/
+			/*!
+				@brief Double the size of the table, moving each slot to its place in the new table.
+			*/
+			void grow(void)
+				{
+				size_t old_capacity = capacity;
+				std::unique_ptr<uint8_t[]> old_tags(std::move(tags));
+				std::unique_ptr<slot[]> old_slots(std::move(slots));
+
+				allocate(old_capacity * 2);
+				for (size_t which = 0; which < old_capacity; which++)
+					if (old_tags[which] != EMPTY)
+						{
+						size_t into = find_empty(old_slots[which].hash);
+						tags[into] = old_tags[which];
+						slots[into] = old_slots[which];
+						}
+				}
+
+			/*
+				HASH_TABLE_OPEN::LOCATE()
+				-------------------------
+			*/
+			/*!
+				@brief Find the slot holding the key, or the empty slot where it would go.
+				@param key [in] The key to look for.
+				@param key_hash [in] The hash of the key.
+				@param key_prefix [in] The first 8 bytes of the key.
+				@param found [out] true if the key is in the table, else false.
+				@return The location of the key, or the empty slot where it would go.
+			*/
+			size_t locate(const KEY &key, uint64_t key_hash, uint64_t key_prefix, bool &found) const
+				{
+				uint8_t tag = key_hash & 0x7F;
+				size_t mask = capacity / GROUP_SIZE - 1;
+				size_t group = (key_hash >> 7) & mask;
+
+				for (size_t step = 1; ; step++)
+					{
+					__m128i group_tags = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&tags[group * GROUP_SIZE]));
+
+					for (uint32_t candidates = match(group_tags, tag); candidates != 0; candidates &= candidates - 1)
+						{
+						size_t location = group * GROUP_SIZE + _tzcnt_u32(candidates);
+						if (same(slots[location], key, key_prefix))
+							{
+							found = true;
+							return location;
+							}
+						}
+
+					/*
+						There is no delete, so an empty slot in the group means the key is not in the table (and this is where it would go)
+					*/
+					uint32_t empty = match(group_tags, EMPTY);
+					if (empty != 0)
+						{
+						found = false;
+						return group * GROUP_SIZE + _tzcnt_u32(empty);
+						}
+
+					group = (group + step) & mask;
+					}
+				}
+
+		public:
+			/*
+				HASH_TABLE_OPEN::HASH_TABLE_OPEN()
+				----------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param pool [in] The keys and elements are allocated using the pool.
+				@param initial_capacity [in] The initial number of slots (rounded up to a power of 2, at least GROUP_SIZE).
+			*/
+			hash_table_open(allocator &pool, size_t initial_capacity = INITIAL_CAPACITY) :
+				memory_pool(pool),
+				capacity(0),
+				elements(0)
+				{
+				size_t new_capacity = GROUP_SIZE;
+				while (new_capacity < initial_capacity)
+					new_capacity *= 2;
+				allocate(new_capacity);
+				}
+
+			/*
+				HASH_TABLE_OPEN::~HASH_TABLE_OPEN()
+				-----------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			~hash_table_open()
+				{
+				/* Nothing */
+				}
+
+			/*
+				HASH_TABLE_OPEN::BEGIN()
+				------------------------
+			*/
+			/*!
+				@brief Return an iterator pointing to the first element in the hash table.
+				@return Iterator pointing to first element in the hash table.
+			*/
+			iterator begin() const
+				{
+				return iterator(*this, 0);
+				}
+
+			/*
+				HASH_TABLE_OPEN::END()
+				----------------------
+			*/
+			/*!
+				@brief Return an iterator pointing past the end of the hash table.
+				@return Iterator pointing past the end of the hash table.
+			*/
+			iterator end() const
+				{
+				return iterator(*this, capacity);
+				}
+
+			/*
+				HASH_TABLE_OPEN::SIZE()
+				-----------------------
+			*/
+			/*!
+				@brief Return the number of elements in the hash table.
+				@return The number of elements.
+			*/
+			size_t size(void) const
+				{
+				return elements;
+				}
+
+			/*
+				HASH_TABLE_OPEN::TEXT_RENDER()
+				------------------------------
+			*/
+			/*!
+				@brief Write the contents of this object to the output steam.
+				@param stream [in] The stream to write to.
+			*/
+			void text_render(std::ostream &stream) const
+				{
+				for (const auto &[key, element] : *this)
+					stream << key << "->" << element << '\n';
+				}
+
+			/*
+				HASH_TABLE_OPEN::OPERATOR[]()
+				-----------------------------
+			*/
+			/*!
+				@brief Return a reference to the element associated with the key.  If there is no element the create an empty one.
+				@param key [in] The key to look up.
+				@return The element associated with the key.
+			*/
+			ELEMENT &operator[](const KEY &key)
+				{
+				uint64_t key_hash = hash(key);
+				uint64_t key_prefix = prefix(key);
+				bool found;
+				size_t location = locate(key, key_hash, key_prefix, found);
+
+				if (found)
+					return *slots[location].element;
+
+				/*
+					Grow (then find the new empty slot) if this would make the table more than 7/8 full
+				*/
+				if (elements + 1 > capacity / 8 * 7)
+					{
+					grow();
+					location = find_empty(key_hash);
+					}
+
+				slot &into = slots[location];
+				into.hash = key_hash;
+				into.prefix = key_prefix;
+				into.key = KEY(memory_pool, key);
+				into.element = new (memory_pool.malloc(sizeof(ELEMENT), alignof(ELEMENT))) ELEMENT(memory_pool);
+				tags[location] = key_hash & 0x7F;
+				elements++;
+
+				return *into.element;
+				}
+
+			/*
+				HASH_TABLE_OPEN::FIND()
+				-----------------------
+			*/
+			/*!
+				@brief Return a pointer to the element associated with the key, but unlike operator[] don't create one if there isn't one.
+				@param key [in] The key to look up.
+				@return The element associated with the key, or nullptr if the key is not in the hash table.
+			*/
+			const ELEMENT *find(const KEY &key) const
+				{
+				bool found;
+				size_t location = locate(key, hash(key), prefix(key), found);
+
+				return found ? slots[location].element : nullptr;
+				}
+
+			/*
+				HASH_TABLE_OPEN::UNITTEST()
+				---------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				/*
+					Check inserting and find()
+				*/
+				allocator_pool pool;
+				hash_table_open<slice, slice> map(pool, 16);
+
+				map[slice("5")] = slice("five");
+				map[slice("3")] = slice("three");
+				map[slice("7")] = slice("seven");
+				map[slice("a_key_longer_than_eight_bytes")] = slice("long");
+				map[slice("a_key_longer_than_eight_bytes_too")] = slice("longer");
+				map[slice("0")];
+
+				JASS_assert(map.size() == 6);
+				JASS_assert(*map.find(slice("5")) == slice("five"));
+				JASS_assert(*map.find(slice("a_key_longer_than_eight_bytes")) == slice("long"));
+				JASS_assert(*map.find(slice("a_key_longer_than_eight_bytes_too")) == slice("longer"));
+				JASS_assert(*map.find(slice("0")) == slice());
+				JASS_assert(map.find(slice("x")) == nullptr);
+				JASS_assert(map.find(slice("a_key_longer_than_eight_bytes_to")) == nullptr);
+				JASS_assert(map.find(slice("a_key_lo")) == nullptr);
+
+				/*
+					Check serialising (the order is the slot order, so sort it)
+				*/
+				std::ostringstream serialised;
+				serialised << map;
+				std::istringstream lines(serialised.str());
+				std::vector<std::string> got;
+				for (std::string line; std::getline(lines, line);)
+					got.push_back(line);
+				std::sort(got.begin(), got.end());
+				std::vector<std::string> answer = {"0->", "3->three", "5->five", "7->seven", "a_key_longer_than_eight_bytes->long", "a_key_longer_than_eight_bytes_too->longer"};
+				JASS_assert(got == answer);
+
+				/*
+					Check growth: the elements must not move and every key must still be found
+				*/
+				constexpr size_t key_count = 100'000;
+				std::vector<std::string> keys;
+				for (size_t which = 0; which < key_count; which++)
+					keys.push_back("key" + std::to_string(which));
+
+				hash_table_open<slice, slice> big(pool, 16);
+				std::vector<slice *> elements;
+				for (const auto &key : keys)
+					elements.push_back(&big[slice((void *)key.data(), key.size())]);
+
+				JASS_assert(big.size() == key_count);
+				for (size_t which = 0; which < key_count; which++)
+					{
+					slice key((void *)keys[which].data(), keys[which].size());
+					JASS_assert(big.find(key) == elements[which]);
+					JASS_assert(&big[key] == elements[which]);
+					}
+				JASS_assert(big.size() == key_count);
+
+				/*
+					Check the iterator
+				*/
+				size_t count = 0;
+				for (const auto &[key, element] : big)
+					{
+					JASS_assert(big.find(key) == &element);
+					count++;
+					}
+				JASS_assert(count == key_count);
+
+				puts("hash_table_open::PASSED");
+				}
+		};
+
+	/*
+		OPERATOR<<()
+		------------
+	*/
+	/*!
+		@brief Dump the contents of a hash table down an output stream.
+		@param stream [in] The stream to write to.
+		@param map [in] The hash table to write.
+		@tparam KEY The type used as the key to the elements.
+		@tparam ELEMENT The element data returned given the key.
+		@return The stream once the table has been written.
+	*/
+	template <typename KEY, typename ELEMENT>
+	inline std::ostream &operator<<(std::ostream &stream, const hash_table_open<KEY, ELEMENT> &map)
+		{
+		map.text_render(stream);
+		return stream;
+		}
+	}
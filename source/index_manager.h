@@ -160,6 +160,21 @@ namespace JASS
 					virtual void operator()(delegate &callback, size_t document_id, const slice &primary_key) = 0;
 				};
 
+		protected:
+			/*
+				INDEX_MANAGER::SET_HIGHEST_DOCUMENT_ID()
+				----------------------------------------
+			*/
+			/*!
+				@brief Set the highest document id seen so far (so the next call to begin_document() starts document_id + 1).
+				@details This is used by indexers that index parts of a collection, each with their own range of document ids.
+				@param document_id [in] The new highest document id.
+			*/
+			void set_highest_document_id(compress_integer::integer document_id)
+				{
+				highest_document_id = document_id;
+				}
+
 		public:
 			/*
 				INDEX_MANAGER::INDEX_MANAGER()
@@ -0,0 +1,274 @@
+/*
+	INDEX_MANAGER_CONCURRENT.CPP
+	----------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+
+#include <thread>
+#include <sstream>
+#include <algorithm>
+
+#include "asserts.h"
+#include "unittest_data.h"
+#include "instream_memory.h"
+#include "instream_document_trec.h"
+#include "index_manager_sequential.h"
+#include "index_manager_concurrent.h"
+
+namespace JASS
+	{
+	/*
+		INDEX_MANAGER_CONCURRENT::WRITER::BEGIN_DOCUMENT()
+		--------------------------------------------------
+	*/
+	void index_manager_concurrent::writer::begin_document(const slice &document_primary_key)
+		{
+		if (next_document_id != 0)
+			{
+			document_id = next_document_id;
+			next_document_id = 0;
+			}
+		else
+			document_id = target.next_document_id++;
+
+		primary_key = slice(arena, document_primary_key);
+		}
+
+	/*
+		INDEX_MANAGER_CONCURRENT::WRITER::END_DOCUMENT()
+		------------------------------------------------
+	*/
+	void index_manager_concurrent::writer::end_document(compress_integer::integer document_length)
+		{
+		this->document_length = document_length;
+
+			{
+			std::lock_guard<std::mutex> lock(target.mutex);
+
+			/*
+				The documents can finish in any order, so make room for this one (and any before it that haven't finished yet)
+			*/
+			auto &lengths = target.get_document_length_vector();
+			if (lengths.size() <= document_id)
+				{
+				lengths.resize(document_id + 1);
+				target.primary_key.resize(document_id);
+				}
+			lengths[document_id] = document_length;
+			target.primary_key[document_id - 1] = primary_key;
+
+			if (document_id > target.get_highest_document_id())
+				target.set_highest_document_id(document_id);
+			}
+		}
+
+	/*
+		INDEX_MANAGER_CONCURRENT::INDEX_MANAGER_CONCURRENT()
+		----------------------------------------------------
+	*/
+	index_manager_concurrent::index_manager_concurrent() :
+		index_manager(),
+		index(memory),
+		next_document_id(1),
+		own_writer(&get_writer())
+		{
+		/* Nothing */
+		}
+
+	/*
+		INDEX_MANAGER_CONCURRENT::GET_WRITER()
+		--------------------------------------
+	*/
+	index_manager_concurrent::writer &index_manager_concurrent::get_writer(void)
+		{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		writers.push_back(std::make_unique<writer>(*this, writers.size()));
+		return *writers.back();
+		}
+
+	/*
+		INDEX_MANAGER_CONCURRENT::GATHER()
+		----------------------------------
+	*/
+	compress_integer::integer index_manager_concurrent::gather(const term_postings &term)
+		{
+		/*
+			Linearize each writer's postings list one after the other
+		*/
+		size_t document_frequency = 0;
+		run_starts.clear();
+		for (const writer_postings *current = term.head.load(); current != nullptr; current = current->next)
+			{
+			run_starts.push_back(document_frequency);
+			document_frequency += current->postings.linearize(&document_ids[document_frequency], &term_frequencies[document_frequency], document_ids.size() - document_frequency);
+			}
+
+		if (run_starts.size() == 1)
+			return static_cast<compress_integer::integer>(document_frequency);
+
+		/*
+			Each run is in document id order, so merge them (pairwise, bottom up)
+		*/
+		for (size_t which = 0; which < document_frequency; which++)
+			postings[which] = std::pair(document_ids[which], term_frequencies[which]);
+
+		run_starts.push_back(document_frequency);
+		while (run_starts.size() > 2)
+			{
+			size_t into = 0;
+			size_t which;
+			for (which = 0; which + 2 < run_starts.size(); which += 2)
+				{
+				std::inplace_merge(postings.begin() + run_starts[which], postings.begin() + run_starts[which + 1], postings.begin() + run_starts[which + 2]);
+				run_starts[into++] = run_starts[which];
+				}
+			for (; which < run_starts.size(); which++)
+				run_starts[into++] = run_starts[which];
+			run_starts.resize(into);
+			}
+
+		for (size_t which = 0; which < document_frequency; which++)
+			{
+			document_ids[which] = postings[which].first;
+			term_frequencies[which] = postings[which].second;
+			}
+
+		return static_cast<compress_integer::integer>(document_frequency);
+		}
+
+	/*
+		INDEX_MANAGER_CONCURRENT::ITERATE()
+		-----------------------------------
+	*/
+	void index_manager_concurrent::iterate(index_manager::delegate &callback)
+		{
+		size_t documents = get_highest_document_id();
+		document_ids.resize(documents + 1);
+		term_frequencies.resize(documents + 1);
+		postings.resize(documents + 1);
+
+		/*
+			Iterate over the hash table calling the callback function with each term->postings pair.
+		*/
+		for (const auto &[term, lists] : index)
+			{
+			auto document_frequency = gather(lists);
+			callback(term, lists.head.load()->postings, document_frequency, &document_ids[0], &term_frequencies[0]);
+			}
+
+		/*
+			Iterate over the primary keys calling the callback function with each docid->key pair.
+			Note that the search engine counts documents from 1, not from 0.
+		*/
+		size_t instance = 0;
+		callback(instance, slice("-"));
+		for (const auto &key : primary_key)
+			callback(++instance, key);
+		}
+
+	/*
+		INDEX_MANAGER_CONCURRENT::ITERATE()
+		-----------------------------------
+	*/
+	void index_manager_concurrent::iterate(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback)
+		{
+		size_t documents = get_highest_document_id();
+		document_ids.resize(documents + 1);
+		term_frequencies.resize(documents + 1);
+		postings.resize(documents + 1);
+
+		/*
+			Iterate over the hash table calling the callback function with each term->postings pair.
+		*/
+		for (const auto &[term, lists] : index)
+			{
+			auto document_frequency = gather(lists);
+			quantizer(callback, term, lists.head.load()->postings, document_frequency, &document_ids[0], &term_frequencies[0]);
+			}
+
+		/*
+			Iterate over the primary keys calling the callback function with each docid->key pair.
+			Note that the search engine counts documents from 1, not from 0.
+		*/
+		size_t instance = 0;
+		quantizer(callback, instance, slice("-"));
+		for (const auto &key : primary_key)
+			quantizer(callback, ++instance, key);
+		}
+
+	/*
+		INDEX_MANAGER_CONCURRENT::UNITTEST()
+		------------------------------------
+	*/
+	void index_manager_concurrent::unittest(void)
+		{
+		using unittest_delegate = index_manager_sequential::unittest_delegate;
+
+		/*
+			Index the documents of collection into index.  Each thread indexes every threads'th document (and tells the writer the document id).
+		*/
+		auto build = [](index_manager &index, const std::string &collection, size_t thread_number, size_t threads, index_manager_concurrent::writer *writer)
+			{
+			class parser parser;
+			compress_integer::integer document_id = 0;
+			index_manager_sequential::unittest_for_each_document(collection, [&](document &document)
+				{
+				document_id++;
+				if ((document_id - 1) % threads != thread_number)
+					return;
+				if (writer != nullptr)
+					writer->set_document_id(document_id);
+				index_manager_sequential::unittest_index_document(index, parser, document);
+				});
+			};
+
+		/*
+			The answer is the sequential index, in sorted order
+		*/
+		std::string collection = unittest_data::ten_documents + unittest_data::ten_documents + unittest_data::ten_documents;
+		index_manager_sequential sequential;
+		build(sequential, collection, 0, 1, nullptr);
+		unittest_delegate expected;
+		sequential.iterate(expected);
+		std::sort(expected.postings.begin(), expected.postings.end());
+
+		/*
+			Index with several threads at once, each with its own writer
+		*/
+		index_manager_concurrent concurrent;
+		std::vector<std::thread> threads;
+		constexpr size_t THREADS = 3;
+		for (size_t which = 0; which < THREADS; which++)
+			{
+			auto &writer = concurrent.get_writer();
+			threads.push_back(std::thread([&build, &collection, &writer, which]() { build(writer, collection, which, THREADS, &writer); }));
+			}
+		for (auto &thread : threads)
+			thread.join();
+
+		unittest_delegate got;
+		concurrent.iterate(got);
+		std::sort(got.postings.begin(), got.postings.end());
+		JASS_assert(got.postings == expected.postings);
+		JASS_assert(got.primary_keys.str() == expected.primary_keys.str());
+		JASS_assert(concurrent.get_highest_document_id() == sequential.get_highest_document_id());
+		JASS_assert(concurrent.get_document_length_vector() == sequential.get_document_length_vector());
+
+		/*
+			Used as an ordinary (single threaded) index_manager it must be the same as the sequential index
+		*/
+		index_manager_concurrent single;
+		build(single, collection, 0, 1, nullptr);
+		unittest_delegate single_got;
+		single.iterate(single_got);
+		std::sort(single_got.postings.begin(), single_got.postings.end());
+		JASS_assert(single_got.postings == expected.postings);
+		JASS_assert(single_got.primary_keys.str() == expected.primary_keys.str());
+		JASS_assert(single.get_document_length_vector() == sequential.get_document_length_vector());
+
+		puts("index_manager_concurrent::PASSED");
+		}
+	}
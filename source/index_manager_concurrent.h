@@ -0,0 +1,358 @@
+/*
+	INDEX_MANAGER_CONCURRENT.H
+	--------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Thread-safe indexer object with a single shared (lock-free) dictionary.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "parser.h"
+#include "hash_table.h"
+#include "index_manager.h"
+#include "allocator_pool.h"
+#include "index_postings.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INDEX_MANAGER_CONCURRENT
+		------------------------------
+	*/
+	/*!
+		@brief Thread-safe indexer object with a single shared (lock-free) dictionary.
+		@details Several threads index into the one in-memory index at the same time, each through its own writer (see get_writer()).
+		The dictionary is a hash_table shared by all the writers, terms are added to it with a lock-free insert() and each writer allocates
+		from its own (thread-local) allocator_pool arena so the writers don't contend on the allocator.  Each term has one postings list for
+		each writer that has seen the term (added with a single Compare and Swap the first time the writer sees it), so appending a posting
+		never contends with another writer.  A writer's documents are numbered in increasing order so each of these lists is in document id
+		order, and at iterate() time the lists of each term are merged (the lists of a term, not the indexes, so there is no final merge of
+		dictionaries).  The primary keys and document lengths are stored (under a lock) once per document.  The index_manager methods
+		(begin_document(), term(), end_document()) of this object use a writer of its own, so it can also be used as a (single-threaded)
+		index_manager.  iterate() must not be called while any writer is indexing.
+	*/
+	class index_manager_concurrent : public index_manager
+		{
+		private:
+			/*
+				CLASS INDEX_MANAGER_CONCURRENT::WRITER_POSTINGS
+				-----------------------------------------------
+			*/
+			/*!
+				@brief The postings list of a term from one writer.
+			*/
+			class writer_postings
+				{
+				public:
+					size_t writer;							///< The writer that owns this postings list (and the only one that appends to it)
+					index_postings postings;			///< The postings list
+					writer_postings *next;				///< The next writer's postings list for the same term
+
+				public:
+					/*
+						INDEX_MANAGER_CONCURRENT::WRITER_POSTINGS::WRITER_POSTINGS()
+						------------------------------------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param arena [in] The writer's arena.
+						@param writer [in] The writer that owns this postings list.
+					*/
+					writer_postings(allocator &arena, size_t writer) :
+						writer(writer),
+						postings(arena),
+						next(nullptr)
+						{
+						/* Nothing */
+						}
+				};
+
+			/*
+				CLASS INDEX_MANAGER_CONCURRENT::TERM_POSTINGS
+				---------------------------------------------
+			*/
+			/*!
+				@brief The element stored in the dictionary, a (lock-free) list of the postings lists of each writer that has seen the term.
+			*/
+			class term_postings
+				{
+				public:
+					std::atomic<writer_postings *> head;		///< The postings list of each writer (most recently added first)
+
+				public:
+					/*
+						INDEX_MANAGER_CONCURRENT::TERM_POSTINGS::TERM_POSTINGS()
+						--------------------------------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param arena [in] The arena (unused).
+					*/
+					term_postings(allocator &arena) :
+						head(nullptr)
+						{
+						/* Nothing */
+						}
+
+					/*
+						INDEX_MANAGER_CONCURRENT::TERM_POSTINGS::GET()
+						----------------------------------------------
+					*/
+					/*!
+						@brief Return the given writer's postings list for this term, adding one (allocated from arena) if it doesn't have one.
+						@param writer [in] The writer.
+						@param arena [in] The writer's arena.
+						@return The writer's postings list.
+					*/
+					index_postings &get(size_t writer, allocator &arena)
+						{
+						for (writer_postings *current = head.load(); current != nullptr; current = current->next)
+							if (current->writer == writer)
+								return current->postings;
+
+						/*
+							Only this writer ever adds a list for this writer, so if it wasn't there it still isn't.  Push a new one on the front.
+						*/
+						writer_postings *list = new (arena.malloc(sizeof(writer_postings), sizeof(void *))) writer_postings(arena, writer);
+						writer_postings *front = head.load();
+						do
+							list->next = front;
+						while (!head.compare_exchange_weak(front, list));
+
+						return list->postings;
+						}
+				};
+
+		public:
+			/*
+				CLASS INDEX_MANAGER_CONCURRENT::WRITER
+				--------------------------------------
+			*/
+			/*!
+				@brief Index documents into the shared index.  Each thread that is indexing must have its own writer.
+			*/
+			class writer : public index_manager
+				{
+				friend class index_manager_concurrent;
+
+				private:
+					index_manager_concurrent &target;						///< The index this writer adds to
+					size_t id;														///< This writer's number
+					allocator_pool arena;										///< This writer's (thread-local) memory
+					compress_integer::integer document_id;				///< The document being indexed
+					compress_integer::integer next_document_id;		///< If not 0, the document id to give the next document (see set_document_id())
+					slice primary_key;											///< The primary key of the document being indexed
+
+				public:
+					compress_integer::integer document_length;			///< The length of the most recently indexed document
+
+				public:
+					/*
+						INDEX_MANAGER_CONCURRENT::WRITER::WRITER()
+						------------------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param target [in] The index to add to.
+						@param id [in] This writer's number.
+					*/
+					writer(index_manager_concurrent &target, size_t id) :
+						target(target),
+						id(id),
+						document_id(0),
+						next_document_id(0),
+						document_length(0)
+						{
+						/* Nothing */
+						}
+
+					/*
+						INDEX_MANAGER_CONCURRENT::WRITER::SET_DOCUMENT_ID()
+						---------------------------------------------------
+					*/
+					/*!
+						@brief Set the document id of the next document (rather than taking the next unused one).
+								@details This is for callers that number the documents themselves (such as index_manager_parallel).  The documents given
+						to a writer must be in increasing document id order, and every document id from 1 to the highest must be used exactly once.
+						@param document_id [in] The document id of the next document.
+					*/
+					void set_document_id(compress_integer::integer document_id)
+						{
+						next_document_id = document_id;
+						}
+
+					/*
+						INDEX_MANAGER_CONCURRENT::WRITER::BEGIN_DOCUMENT()
+						--------------------------------------------------
+					*/
+					/*!
+						@brief Tell this object that you're about to start indexing a new object.
+						@param document_primary_key [in] The document's primary key (or external document identifier).
+					*/
+					virtual void begin_document(const slice &document_primary_key);
+
+					/*
+						INDEX_MANAGER_CONCURRENT::WRITER::TERM()
+						----------------------------------------
+					*/
+					/*!
+						@brief Hand a new term from the token stream to this object.
+						@param term [in] The term from the token stream.
+					*/
+					virtual void term(const parser::token &term)
+						{
+						target.index.insert(term.lexeme, arena).get(id, arena).push_back(document_id, term.count);
+						}
+
+					/*
+						INDEX_MANAGER_CONCURRENT::WRITER::END_DOCUMENT()
+						------------------------------------------------
+					*/
+					/*!
+						@brief Tell this object that you've finished with the current document.
+						@param document_length [in] The length of the document.
+					*/
+					virtual void end_document(compress_integer::integer document_length);
+				};
+
+		private:
+			allocator_pool memory;											///< The dictionary and the iteration buffers are allocated from here
+			hash_table<slice, term_postings, 24> index;				///< The dictionary, shared by all the writers
+			std::atomic<compress_integer::integer> next_document_id;	///< The next unused document id
+			std::mutex mutex;													///< Protects writers, primary_key, and the document length vector
+			std::vector<std::unique_ptr<writer>> writers;			///< The writers (which own the memory of the index so they live as long as this object)
+			std::vector<slice> primary_key;								///< The primary key of each document (document_id - 1)
+			writer *own_writer;												///< The writer used by begin_document(), term(), and end_document() of this object
+
+			/*
+				Each of these buffers is re-used in the merging process
+			*/
+			std::vector<compress_integer::integer> document_ids;			///< The document ids of a term (one writer's run after the other, then merged)
+			std::vector<index_postings_impact::impact_type> term_frequencies;	///< The term frequencies of a term
+			std::vector<std::pair<compress_integer::integer, index_postings_impact::impact_type>> postings;	///< The postings of a term as it is merged
+			std::vector<size_t> run_starts;										///< Where each writer's postings start in document_ids and term_frequencies
+
+		private:
+			/*
+				INDEX_MANAGER_CONCURRENT::GATHER()
+				----------------------------------
+			*/
+			/*!
+				@brief Linearize the postings lists of each writer for the term and merge them into document_ids and term_frequencies (in document id order).
+				@param term [in] The postings lists of the term.
+				@return The document frequency of the term.
+			*/
+			compress_integer::integer gather(const term_postings &term);
+
+		public:
+			/*
+				INDEX_MANAGER_CONCURRENT::INDEX_MANAGER_CONCURRENT()
+				----------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+			*/
+			index_manager_concurrent();
+
+			/*
+				INDEX_MANAGER_CONCURRENT::~INDEX_MANAGER_CONCURRENT()
+				-----------------------------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~index_manager_concurrent()
+				{
+				/* Nothing */
+				}
+
+			/*
+				INDEX_MANAGER_CONCURRENT::GET_WRITER()
+				--------------------------------------
+			*/
+			/*!
+				@brief Return a new writer, to be used by a single thread to index into this index.  This method is thread-safe.
+				@return A writer that exists for as long as this object does.
+			*/
+			writer &get_writer(void);
+
+			/*
+				INDEX_MANAGER_CONCURRENT::BEGIN_DOCUMENT()
+				------------------------------------------
+			*/
+			/*!
+				@brief Tell this object that you're about to start indexing a new object.
+				@param document_primary_key [in] The document's primary key (or external document identifier).
+			*/
+			virtual void begin_document(const slice &document_primary_key)
+				{
+				own_writer->begin_document(document_primary_key);
+				}
+
+			/*
+				INDEX_MANAGER_CONCURRENT::TERM()
+				--------------------------------
+			*/
+			/*!
+				@brief Hand a new term from the token stream to this object.
+				@param term [in] The term from the token stream.
+			*/
+			virtual void term(const parser::token &term)
+				{
+				own_writer->term(term);
+				}
+
+			/*
+				INDEX_MANAGER_CONCURRENT::END_DOCUMENT()
+				----------------------------------------
+			*/
+			/*!
+				@brief Tell this object that you've finished with the current document.
+				@param document_length [in] The length of the document.
+			*/
+			virtual void end_document(compress_integer::integer document_length)
+				{
+				own_writer->end_document(document_length);
+				}
+
+			/*
+				INDEX_MANAGER_CONCURRENT::ITERATE()
+				-----------------------------------
+			*/
+			/*!
+				@brief Iterate over the index calling callback.operator() with each postings list.
+				@param callback [in] The callback to call.
+			*/
+			virtual void iterate(index_manager::delegate &callback);
+
+			/*
+				INDEX_MANAGER_CONCURRENT::ITERATE()
+				-----------------------------------
+			*/
+			/*!
+				@brief Iterate over the index calling callback.operator() with each postings list.
+				@param quantizer [in] The quantizer that will quantize then call the serialiser callback.
+				@param callback [in] The callback that the quantizer should call.
+			*/
+			virtual void iterate(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback);
+
+			/*
+				INDEX_MANAGER_CONCURRENT::UNITTEST()
+				------------------------------------
+			*/
+			/*!
+				@brief Unit test this class.
+			*/
+			static void unittest(void);
+		};
+	}
@@ -0,0 +1,330 @@
+/*
+	INDEX_MANAGER_PARALLEL.CPP
+	--------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include "parser.h"
+#include "asserts.h"
+#include "unittest_data.h"
+#include "instream_memory.h"
+#include "instream_document_trec.h"
+#include "index_manager_parallel.h"
+
+namespace JASS
+	{
+	/*
+		INDEX_MANAGER_PARALLEL::INDEX_MANAGER_PARALLEL()
+		------------------------------------------------
+	*/
+	index_manager_parallel::index_manager_parallel(size_t threads, std::function<std::unique_ptr<document_indexer>(void)> indexer_factory, size_t batch_size, bool shared_dictionary) :
+		batch_size(batch_size == 0 ? 1 : batch_size),
+		primary_key(memory, 1000, 1.5),
+		current(std::make_unique<batch>()),
+		shared(shared_dictionary ? std::make_unique<index_manager_concurrent>() : nullptr),
+		shutting_down(false),
+		finished(false)
+		{
+		threads = threads == 0 ? 1 : threads;
+		queue_length = threads * 2;
+		current->first_document_id = 1;
+
+		lengths.reserve(1'000'000);
+		lengths.push_back(0);			// document 0 doesn't exist
+
+		for (size_t which = 0; which < threads; which++)
+			{
+			workers.push_back(std::make_unique<worker>());
+			workers.back()->writer = shared == nullptr ? nullptr : &shared->get_writer();
+			workers.back()->indexer = indexer_factory();
+			}
+
+		for (auto &which : workers)
+			this->threads.push_back(thread(work, this, which.get()));
+		}
+
+	/*
+		INDEX_MANAGER_PARALLEL::~INDEX_MANAGER_PARALLEL()
+		-------------------------------------------------
+	*/
+	index_manager_parallel::~index_manager_parallel()
+		{
+		finish();
+		}
+
+	/*
+		INDEX_MANAGER_PARALLEL::WORK()
+		------------------------------
+	*/
+	void index_manager_parallel::work(index_manager_parallel *manager, worker *me)
+		{
+		document document;
+
+		for (;;)
+			{
+			std::unique_ptr<batch> next;
+
+				{
+				std::unique_lock<std::mutex> lock(manager->mutex);
+				manager->not_empty.wait(lock, [manager](){ return manager->shutting_down || !manager->queue.empty(); });
+
+				if (manager->queue.empty())
+					return;				// shutting down and nothing left to do
+
+				next = std::move(manager->queue.front());
+				manager->queue.pop_front();
+				}
+			manager->not_full.notify_one();
+
+			/*
+				Index each document in the batch, with its document id, into this worker's private index (or through its writer into the shared index)
+			*/
+			std::vector<compress_integer::integer> batch_lengths(next->ends.size());
+			size_t start = 0;
+			for (size_t which = 0; which < next->ends.size(); which++)
+				{
+				document.primary_key = next->primary_keys[which];
+				document.contents = slice(next->contents.data() + start, next->ends[which] - start);
+				start = next->ends[which] + 1;		// skip over the '\0'
+
+				if (me->writer != nullptr)
+					{
+					me->writer->set_document_id(next->first_document_id + (compress_integer::integer)which);
+					me->indexer->index(*me->writer, document);
+					batch_lengths[which] = me->writer->document_length;
+					}
+				else
+					{
+					me->index.set_document_id(next->first_document_id + (compress_integer::integer)which);
+					me->indexer->index(me->index, document);
+					batch_lengths[which] = me->index.document_length;
+					}
+				}
+
+			/*
+				The lengths are stored in document id order
+			*/
+			std::lock_guard<std::mutex> lock(manager->mutex);
+			size_t end = next->first_document_id + batch_lengths.size();
+			if (manager->lengths.size() < end)
+				manager->lengths.resize(end);
+			std::copy(batch_lengths.begin(), batch_lengths.end(), manager->lengths.begin() + next->first_document_id);
+			}
+		}
+
+	/*
+		INDEX_MANAGER_PARALLEL::DISPATCH()
+		----------------------------------
+	*/
+	void index_manager_parallel::dispatch(void)
+		{
+		compress_integer::integer next_document_id = current->first_document_id + (compress_integer::integer)current->ends.size();
+
+			{
+			std::unique_lock<std::mutex> lock(mutex);
+			not_full.wait(lock, [this](){ return queue.size() < queue_length; });
+			queue.push_back(std::move(current));
+			}
+		not_empty.notify_one();
+
+		current = std::make_unique<batch>();
+		current->first_document_id = next_document_id;
+		}
+
+	/*
+		INDEX_MANAGER_PARALLEL::ADD_DOCUMENT()
+		--------------------------------------
+	*/
+	void index_manager_parallel::add_document(const document &document)
+		{
+		primary_key.push_back(slice(memory, document.primary_key));
+		current->primary_keys.push_back(primary_key.back());
+
+		const char *contents = reinterpret_cast<const char *>(document.contents.address());
+		current->contents.insert(current->contents.end(), contents, contents + document.contents.size());
+		current->ends.push_back(current->contents.size());
+		current->contents.push_back('\0');
+
+		if (current->ends.size() >= batch_size)
+			dispatch();
+		}
+
+	/*
+		INDEX_MANAGER_PARALLEL::FINISH()
+		--------------------------------
+	*/
+	void index_manager_parallel::finish(void)
+		{
+		if (finished)
+			return;
+		finished = true;
+
+		/*
+			Send the last (partial) batch
+		*/
+		if (current->ends.size() != 0)
+			dispatch();
+
+		/*
+			Tell the workers to stop (once the queue is empty) and wait for them
+		*/
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+			shutting_down = true;
+			}
+		not_empty.notify_all();
+
+		for (auto &which : threads)
+			which.join();
+
+		/*
+			Now we know how many documents there are and how long they are
+		*/
+		set_document_length_vector(lengths);
+		}
+
+	/*
+		INDEX_MANAGER_PARALLEL::ITERATE()
+		---------------------------------
+	*/
+	void index_manager_parallel::iterate(index_manager::delegate &callback)
+		{
+		finish();
+
+		/*
+			The shared index has the postings, primary keys, and lengths of every document so it can do the work
+		*/
+		if (shared != nullptr)
+			{
+			shared->iterate(callback);
+			return;
+			}
+
+		merge([&callback](const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+			{
+			callback(term, postings, document_frequency, document_ids, term_frequencies);
+			});
+
+		/*
+			Iterate over the primary keys calling the callback function with each docid->key pair.
+			Note that the search engine counts documents from 1, not from 0.
+		*/
+		size_t instance = 0;
+		callback(instance, slice("-"));
+		for (const auto &key : primary_key)
+			callback(++instance, key);
+		}
+
+	/*
+		INDEX_MANAGER_PARALLEL::ITERATE()
+		---------------------------------
+	*/
+	void index_manager_parallel::iterate(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback)
+		{
+		finish();
+
+		/*
+			The shared index has the postings, primary keys, and lengths of every document so it can do the work
+		*/
+		if (shared != nullptr)
+			{
+			shared->iterate(quantizer, callback);
+			return;
+			}
+
+		merge([&quantizer, &callback](const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+			{
+			quantizer(callback, term, postings, document_frequency, document_ids, term_frequencies);
+			});
+
+		/*
+			Iterate over the primary keys calling the callback function with each docid->key pair.
+			Note that the search engine counts documents from 1, not from 0.
+		*/
+		size_t instance = 0;
+		quantizer(callback, instance, slice("-"));
+		for (const auto &key : primary_key)
+			quantizer(callback, ++instance, key);
+		}
+
+	/*
+		INDEX_MANAGER_PARALLEL::UNITTEST()
+		----------------------------------
+	*/
+	void index_manager_parallel::unittest(void)
+		{
+		/*
+			Parse documents the same way index_manager_sequential::unittest_build_index() does
+		*/
+		class unittest_indexer : public document_indexer
+			{
+			private:
+				class parser parser;
+
+			public:
+				virtual void index(index_manager &index, document &document)
+					{
+					index_manager_sequential::unittest_index_document(index, parser, document);
+					}
+			};
+
+		/*
+			The merged postings lists are written out using the arrays (the postings parameter is for the first shard's postings only)
+		*/
+		using unittest_delegate = index_manager_sequential::unittest_delegate;
+
+		/*
+			Index the same documents several times so that postings lists have documents from several workers (the batches are 3 documents)
+		*/
+		std::string collection = unittest_data::ten_documents + unittest_data::ten_documents + unittest_data::ten_documents;
+
+		index_manager_sequential sequential;
+		index_manager_sequential::unittest_build_index(sequential, collection);
+		unittest_delegate expected;
+		sequential.iterate(expected);
+		std::sort(expected.postings.begin(), expected.postings.end());
+
+		index_manager_parallel parallel(3, [](){ return std::make_unique<unittest_indexer>(); }, 3);
+		index_manager_sequential::unittest_for_each_document(collection, [&parallel](document &document) { parallel.add_document(document); });
+
+		unittest_delegate got;
+		parallel.iterate(got);
+		std::sort(got.postings.begin(), got.postings.end());
+
+		JASS_assert(got.postings == expected.postings);
+		JASS_assert(got.primary_keys.str() == expected.primary_keys.str());
+		JASS_assert(parallel.get_highest_document_id() == 30);
+		JASS_assert(parallel.get_document_length_vector() == sequential.get_document_length_vector());
+
+		/*
+			Iterating a second time gives the same answer
+		*/
+		unittest_delegate again;
+		parallel.iterate(again);
+		std::sort(again.postings.begin(), again.postings.end());
+		JASS_assert(again.postings == expected.postings);
+
+		/*
+			The workers indexing into a single shared dictionary must give the same answer
+		*/
+		index_manager_parallel shared(3, [](){ return std::make_unique<unittest_indexer>(); }, 3, true);
+		index_manager_sequential::unittest_for_each_document(collection, [&shared](document &document) { shared.add_document(document); });
+
+		unittest_delegate shared_got;
+		shared.iterate(shared_got);
+		std::sort(shared_got.postings.begin(), shared_got.postings.end());
+
+		JASS_assert(shared_got.postings == expected.postings);
+		JASS_assert(shared_got.primary_keys.str() == expected.primary_keys.str());
+		JASS_assert(shared.get_highest_document_id() == 30);
+		JASS_assert(shared.get_document_length_vector() == sequential.get_document_length_vector());
+
+		puts("index_manager_parallel::PASSED");
+		}
+	}
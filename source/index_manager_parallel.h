@@ -0,0 +1,391 @@
+/*
+	INDEX_MANAGER_PARALLEL.H
+	------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Multi-threaded indexer object that indexes batches of documents in parallel then merges the results.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+#include "threads.h"
+#include "document.h"
+#include "dynamic_array.h"
+#include "allocator_pool.h"
+#include "index_manager_sequential.h"
+#include "index_manager_concurrent.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INDEX_MANAGER_PARALLEL
+		----------------------------
+	*/
+	/*!
+		@brief Multi-threaded indexer object.
+		@details Documents are handed to this object (by a single reader thread) with add_document().  They are grouped into batches of
+		consecutive documents and each batch is given to one of a pool of worker threads.  Each worker parses (with its own document_indexer)
+		and inverts the batch into its own private index_manager_sequential using the batch's (global) document ids, so no locking is needed
+		during indexing.  At iterate() time the postings lists of each term are gathered from each worker's index and merged (in document id
+		order) before being passed to the callback, so the result is the same as if the documents had been indexed with a single
+		index_manager_sequential.  Alternatively (see the constructor) the workers can all index into a single index_manager_concurrent (each
+		through its own writer) so there are no per-worker dictionaries to merge at iterate() time.  Unlike index_manager_sequential, documents are not indexed with begin_document(), term(), and end_document(),
+		they are passed to add_document() and the document_indexer does that.
+	*/
+	class index_manager_parallel : public index_manager
+		{
+		public:
+			/*
+				CLASS INDEX_MANAGER_PARALLEL::DOCUMENT_INDEXER
+				----------------------------------------------
+			*/
+			/*!
+				@brief Base class for the object that parses a single document and adds it to an index (one of these is used by each worker thread).
+			*/
+			class document_indexer
+				{
+				public:
+					/*
+						INDEX_MANAGER_PARALLEL::DOCUMENT_INDEXER::~DOCUMENT_INDEXER()
+						-------------------------------------------------------------
+					*/
+					/*!
+						@brief Destructor.
+					*/
+					virtual ~document_indexer()
+						{
+						/* Nothing */
+						}
+
+					/*
+						INDEX_MANAGER_PARALLEL::DOCUMENT_INDEXER::INDEX()
+						-------------------------------------------------
+					*/
+					/*!
+						@brief Parse the document and add it to the index by calling index.begin_document(), index.term() for each term, then index.end_document().
+						@param index [in] The index to add the document to.
+						@param document [in] The document to parse.
+					*/
+					virtual void index(index_manager &index, document &document) = 0;
+				};
+
+		private:
+			/*
+				CLASS INDEX_MANAGER_PARALLEL::SHARD
+				-----------------------------------
+			*/
+			/*!
+				@brief The private index of a single worker thread.  The primary keys and document lengths are kept by the index_manager_parallel.
+			*/
+			class shard : public index_manager_sequential
+				{
+				public:
+					compress_integer::integer document_length;			///< The length of the most recently indexed document
+
+				public:
+					/*
+						INDEX_MANAGER_PARALLEL::SHARD::SHARD()
+						--------------------------------------
+					*/
+					/*!
+						@brief Constructor
+					*/
+					shard() :
+						document_length(0)
+						{
+						/* Nothing */
+						}
+
+					/*
+						INDEX_MANAGER_PARALLEL::SHARD::SET_DOCUMENT_ID()
+						------------------------------------------------
+					*/
+					/*!
+						@brief Set the document id of the next document to be indexed.
+						@param document_id [in] The document id of the next document.
+					*/
+					void set_document_id(compress_integer::integer document_id)
+						{
+						set_highest_document_id(document_id - 1);
+						}
+
+					/*
+						INDEX_MANAGER_PARALLEL::SHARD::BEGIN_DOCUMENT()
+						-----------------------------------------------
+					*/
+					/*!
+						@brief Tell this object that you're about to start indexing a new object (the primary key is not kept).
+						@param document_primary_key [in] The document's primary key (or external document identifier).
+					*/
+					virtual void begin_document(const slice &document_primary_key)
+						{
+						index_manager::begin_document(document_primary_key);
+						}
+
+					/*
+						INDEX_MANAGER_PARALLEL::SHARD::END_DOCUMENT()
+						---------------------------------------------
+					*/
+					/*!
+						@brief Tell this object that you've finished with the current document (the length is remembered, but not kept).
+						@param document_length [in] The length of the document.
+					*/
+					virtual void end_document(compress_integer::integer document_length)
+						{
+						this->document_length = document_length;
+						}
+				};
+
+			/*
+				CLASS INDEX_MANAGER_PARALLEL::BATCH
+				-----------------------------------
+			*/
+			/*!
+				@brief A batch of consecutive documents waiting to be indexed.
+			*/
+			class batch
+				{
+				public:
+					compress_integer::integer first_document_id;		///< The document id of the first document in the batch
+					std::vector<slice> primary_keys;						///< The primary key of each document in the batch
+					std::vector<char> contents;							///< The contents of all the documents in the batch (each '\0' terminated)
+					std::vector<size_t> ends;								///< The end of each document in contents
+				};
+
+			/*
+				CLASS INDEX_MANAGER_PARALLEL::WORKER
+				------------------------------------
+			*/
+			/*!
+				@brief The state of a single worker thread.
+			*/
+			class worker
+				{
+				public:
+					shard index;													///< The worker's private index
+					index_manager_concurrent::writer *writer;				///< The worker's writer into the shared index (or nullptr if the index is private)
+					std::unique_ptr<document_indexer> indexer;			///< The worker's parser
+				};
+
+		private:
+			size_t batch_size;												///< The number of documents in a batch
+			allocator_pool memory;											///< The primary keys are allocated from here
+			dynamic_array<slice> primary_key;							///< The list of primary keys (i.e. external document identifiers)
+			std::unique_ptr<batch> current;								///< The batch being filled by add_document()
+			std::unique_ptr<index_manager_concurrent> shared;		///< The index shared by all the workers (or nullptr if each worker has its own)
+			std::vector<std::unique_ptr<worker>> workers;			///< The state of each worker thread
+			std::vector<thread> threads;									///< The worker threads
+			std::deque<std::unique_ptr<batch>> queue;					///< Batches waiting to be indexed
+			size_t queue_length;												///< The maximum number of batches waiting to be indexed (add_document() blocks when full)
+			std::vector<compress_integer::integer> lengths;			///< The length of each document (indexed by document id)
+			std::mutex mutex;													///< Protects queue, lengths, and shutting_down
+			std::condition_variable not_empty;							///< Signalled when a batch is added to the queue (or on shutdown)
+			std::condition_variable not_full;							///< Signalled when a batch is taken from the queue
+			bool shutting_down;												///< Set when the workers should exit (once the queue is empty)
+			bool finished;														///< Has finish() been called?
+
+			/*
+				Each of these buffers is re-used in the merging process
+			*/
+			std::vector<compress_integer::integer> gathered_ids;			///< The document ids from each shard (one run after the other)
+			std::vector<index_postings_impact::impact_type> gathered_tfs;	///< The term frequencies from each shard (one run after the other)
+			std::vector<compress_integer::integer> merged_ids;				///< The merged document ids
+			std::vector<index_postings_impact::impact_type> merged_tfs;		///< The merged term frequencies
+
+		private:
+			/*
+				INDEX_MANAGER_PARALLEL::WORK()
+				------------------------------
+			*/
+			/*!
+				@brief The worker thread, index batches from the queue until shutdown.
+				@param manager [in] The index_manager_parallel this thread is working for.
+				@param me [in] The state of this worker.
+			*/
+			static void work(index_manager_parallel *manager, worker *me);
+
+			/*
+				INDEX_MANAGER_PARALLEL::DISPATCH()
+				----------------------------------
+			*/
+			/*!
+				@brief Send the current batch to the workers (blocking if the queue is full).
+			*/
+			void dispatch(void);
+
+			/*
+				INDEX_MANAGER_PARALLEL::MERGE()
+				-------------------------------
+			*/
+			/*!
+				@brief Merge the postings lists of each term from each worker's index and call callback(term, postings, document_frequency, document_ids, term_frequencies) with each.
+				@param callback [in] The function to call with each term.
+			*/
+			template <typename FUNCTOR>
+			void merge(FUNCTOR &&callback)
+				{
+				size_t documents = get_highest_document_id();
+				gathered_ids.resize(documents + 1);
+				gathered_tfs.resize(documents + 1);
+				merged_ids.resize(documents + 1);
+				merged_tfs.resize(documents + 1);
+
+				std::vector<std::pair<size_t, size_t>> runs;
+				for (size_t which = 0; which < workers.size(); which++)
+					for (const auto &[term, postings] : workers[which]->index.index)
+						{
+						/*
+							If an earlier worker has this term then it has already been done
+						*/
+						bool done = false;
+						for (size_t earlier = 0; earlier < which && !done; earlier++)
+							done = workers[earlier]->index.index.find(term) != nullptr;
+						if (done)
+							continue;
+
+						/*
+							Linearize each worker's postings list for this term, one after the other
+						*/
+						runs.clear();
+						size_t gathered = 0;
+						for (size_t later = which; later < workers.size(); later++)
+							{
+							const index_postings *list = later == which ? &postings : workers[later]->index.index.find(term);
+							if (list == nullptr)
+								continue;
+							size_t document_frequency = list->linearize(gathered_ids.data() + gathered, gathered_tfs.data() + gathered, gathered_ids.size() - gathered);
+							runs.push_back(std::pair(gathered, gathered + document_frequency));
+							gathered += document_frequency;
+							}
+
+						if (runs.size() == 1)
+							{
+							callback(term, postings, (compress_integer::integer)gathered, gathered_ids.data(), gathered_tfs.data());
+							continue;
+							}
+
+						/*
+							Each run is in document id order (but they interleave) so repeatedly take from the run with the lowest next document id until it passes
+							the next document id of another run.
+						*/
+						size_t merged = 0;
+						for (;;)
+							{
+							size_t lowest = runs.size();
+							compress_integer::integer second = (std::numeric_limits<compress_integer::integer>::max)();
+							for (size_t run = 0; run < runs.size(); run++)
+								if (runs[run].first < runs[run].second)
+									{
+									if (lowest == runs.size() || gathered_ids[runs[run].first] < gathered_ids[runs[lowest].first])
+										{
+										if (lowest != runs.size())
+											second = gathered_ids[runs[lowest].first];
+										lowest = run;
+										}
+									else if (gathered_ids[runs[run].first] < second)
+										second = gathered_ids[runs[run].first];
+									}
+
+							if (lowest == runs.size())
+								break;
+
+							auto &[from, end] = runs[lowest];
+							while (from < end && gathered_ids[from] < second)
+								{
+								merged_ids[merged] = gathered_ids[from];
+								merged_tfs[merged] = gathered_tfs[from];
+								merged++;
+								from++;
+								}
+							}
+
+						callback(term, postings, (compress_integer::integer)merged, merged_ids.data(), merged_tfs.data());
+						}
+				}
+
+		public:
+			/*
+				INDEX_MANAGER_PARALLEL::INDEX_MANAGER_PARALLEL()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param threads [in] The number of worker threads.
+				@param indexer_factory [in] Called once for each worker thread to make the object that parses and indexes documents.
+				@param batch_size [in] The number of documents given to a worker at a time.
+				@param shared_dictionary [in] If true then the workers index into a single shared index_manager_concurrent rather than each into their own index.
+			*/
+			index_manager_parallel(size_t threads, std::function<std::unique_ptr<document_indexer>(void)> indexer_factory, size_t batch_size = 1024, bool shared_dictionary = false);
+
+			/*
+				INDEX_MANAGER_PARALLEL::~INDEX_MANAGER_PARALLEL()
+				-------------------------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~index_manager_parallel();
+
+			/*
+				INDEX_MANAGER_PARALLEL::ADD_DOCUMENT()
+				--------------------------------------
+			*/
+			/*!
+				@brief Add a document to the index.  The document is copied so it can be re-used as soon as this method returns.  This method is not thread safe.
+				@param document [in] The document to index.
+			*/
+			void add_document(const document &document);
+
+			/*
+				INDEX_MANAGER_PARALLEL::FINISH()
+				--------------------------------
+			*/
+			/*!
+				@brief Wait for all the documents to be indexed (after which no more can be added).  This is called by iterate(), so it is only necessary to call it before
+				calling get_highest_document_id() or get_document_length_vector().
+			*/
+			void finish(void);
+
+			/*
+				INDEX_MANAGER_PARALLEL::ITERATE()
+				---------------------------------
+			*/
+			/*!
+				@brief Iterate over the index calling callback.operator() with each postings list.
+				@param callback [in] The callback to call.
+			*/
+			virtual void iterate(index_manager::delegate &callback);
+
+			/*
+				INDEX_MANAGER_PARALLEL::ITERATE()
+				---------------------------------
+			*/
+			/*!
+				@brief Iterate over the index calling callback.operator() with each postings list.
+				@param quantizer [in] The quantizer that will quantize then call the serialiser callback.
+				@param callback [in] The callback that the quantizer should call.
+			*/
+			virtual void iterate(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback);
+
+			/*
+				INDEX_MANAGER_PARALLEL::UNITTEST()
+				----------------------------------
+			*/
+			/*!
+				@brief Unit test this class.
+			*/
+			static void unittest(void);
+		};
+	}
@@ -12,12 +12,15 @@
 */
 #pragma once
 
+#include <memory>
+#include <string>
 #include <vector>
 #include <sstream>
 
 #include "parser.h"
 #include "posting.h"
 #include "hash_table.h"
+#include "dynamic_array.h"
 #include "index_manager.h"
 #include "unittest_data.h"
 #include "index_postings.h"
@@ -37,6 +40,9 @@ namespace JASS
 	*/
 	class index_manager_sequential : public index_manager
 		{
+		friend class index_manager_parallel;
+		friend class index_manager_spilling;
+
 		private:
 			allocator_pool memory;														///< All memory in allocatged from this allocator.
 			hash_table<slice, index_postings, 24> index;							///< The index is a hash table of index_postings keyed on the term (a slice).
@@ -47,8 +53,7 @@ namespace JASS
 			*/
 			compress_integer::integer *document_ids;					///< The re-used buffer storing decoded document ids
 			index_postings_impact::impact_type *term_frequencies;	///< The re-used buffer storing the term frequencies
-			size_t temporary_size;											///< The number of bytes in temporary
-			uint8_t *temporary;												///< Temporary buffer - cannot be used to store anything between calls
+			size_t buffer_length;											///< The number of elements in document_ids and term_frequencies
 
 		public:
 			/*
@@ -148,11 +153,11 @@ namespace JASS
 			*/
 			void make_space(void)
 				{
-				auto new_temporary_size = get_highest_document_id() * (sizeof(*document_ids) / 7 + 1) * sizeof(*temporary);
+				size_t new_buffer_length = get_highest_document_id();
 
-				if (new_temporary_size > temporary_size)
+				if (new_buffer_length > buffer_length)
 					{
-					temporary_size = new_temporary_size;
+					buffer_length = new_buffer_length;
 					/*
 						we don't delete the old buffers because the memory object doesn't support allow us to do so
 						but, this would only be needed if the called serialises then adds then serialises without
@@ -160,7 +165,6 @@ namespace JASS
 					*/
 					document_ids = reinterpret_cast<decltype(document_ids)>(memory.malloc(get_highest_document_id() * sizeof(*document_ids)));
 					term_frequencies = reinterpret_cast<decltype(term_frequencies)>(memory.malloc(get_highest_document_id() * sizeof(*term_frequencies)));
-					temporary = reinterpret_cast<decltype(temporary)>(memory.malloc(temporary_size));
 					}
 				}
 
@@ -178,8 +182,7 @@ namespace JASS
 				primary_key(memory, 1000, 1.5),
 				document_ids(nullptr),
 				term_frequencies(nullptr),
-				temporary_size(0),
-				temporary(nullptr)
+				buffer_length(0)
 				{
 				/* Nothing */
 				}
@@ -306,7 +309,7 @@ namespace JASS
 				*/
 				for (const auto &[key, value] : index)
 					{
-					auto document_frequency = value.linearize(temporary, temporary_size, document_ids, term_frequencies, get_highest_document_id());
+					auto document_frequency = value.linearize(document_ids, term_frequencies, get_highest_document_id());
 					callback(key, value, document_frequency, document_ids, term_frequencies);
 					}
 
@@ -341,7 +344,7 @@ namespace JASS
 				*/
 				for (const auto &[term, postings] : index)
 					{
-					auto document_frequency = postings.linearize(temporary, temporary_size, document_ids, term_frequencies, get_highest_document_id());
+					auto document_frequency = postings.linearize(document_ids, term_frequencies, get_highest_document_id());
 					quantizer(callback, term, postings, document_frequency, document_ids, term_frequencies);
 					}
 					
@@ -356,79 +359,109 @@ namespace JASS
 				}
 
 			/*
-				INDEX_MANAGER_SEQUENTIAL::UNITTEST_BUILD_INDEX()
-				------------------------------------------------
-				Build a index from the standard 10-document collection.
+				CLASS INDEX_MANAGER_SEQUENTIAL::UNITTEST_DELEGATE
+				-------------------------------------------------
 			*/
 			/*!
-				@brief Build and index for the 10 sample documents.  This is used by several unit tests that need a valid index.
-				@param index [out] The index once built.
-				@param document_collection [in] The documents to index.
+				@brief Unit test callback that keeps each postings list (as "term-><docid,tf>...") and the docid->primary key list, so that the
+				index managers can be compared to each other (after sorting the postings lists, as their term orders differ).
 			*/
-			static void unittest_build_index(index_manager_sequential &index, const std::string &document_collection)
+			class unittest_delegate : public index_manager::delegate
 				{
-				class parser parser;								// We need a parser
-				document document;						// That creates documents
-				std::shared_ptr<instream> file(new instream_memory(document_collection.c_str(), document_collection.size()));			// From this stream (the standard 10 document stream).
-				instream_document_trec source(file);	// Set up the instream
-				
-				/*
-					Build an index
-				*/
-				do
+				public:
+					std::vector<std::string> postings;			///< The postings lists, one string each
+					std::ostringstream primary_keys;				///< The docid->primary key pairs
+
+				public:
+					unittest_delegate() : index_manager::delegate(0) {}
+					virtual void operator()(const slice &term, const index_postings &, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+						{
+						std::ostringstream line;
+						line << term << "->";
+						for (compress_integer::integer which = 0; which < document_frequency; which++)
+							line << "<" << document_ids[which] << "," << term_frequencies[which] << ">";
+						postings.push_back(line.str());
+						}
+					virtual void operator()(size_t document_id, const slice &primary_key)
+						{
+						primary_keys << document_id << "->" << primary_key << std::endl;
+						}
+					virtual void finish(void)
+						{
+						/* Nothing */
+						}
+				};
+
+			/*
+				INDEX_MANAGER_SEQUENTIAL::UNITTEST_FOR_EACH_DOCUMENT()
+				------------------------------------------------------
+			*/
+			/*!
+				@brief Split a TREC collection into documents and call a function with each, in order.  This is used by several unit tests.
+				@param document_collection [in] The documents.
+				@param function [in] The function to call with each document (a document &).
+			*/
+			template <typename FUNCTION>
+			static void unittest_for_each_document(const std::string &document_collection, FUNCTION &&function)
+				{
+				document document;
+				std::shared_ptr<instream> file(new instream_memory(document_collection.c_str(), document_collection.size()));
+				instream_document_trec source(file);
+
+				for (;;)
 					{
-					compress_integer::integer document_length = 0;
-					/*
-						Read the next document and give it to the parser (until eof).
-					*/
 					document.rewind();
 					source.read(document);
 					if (document.isempty())
 						break;
-					parser.set_document(document);
-					
-					/*
-						Mark the start of a new document.
-					*/
-					index.begin_document(document.primary_key);
+					function(document);
+					}
+				}
 
-					/*
-						For each document, read the token stream and add to the hash table.
-					*/
-					bool finished = false;
-					do
+			/*
+				INDEX_MANAGER_SEQUENTIAL::UNITTEST_INDEX_DOCUMENT()
+				---------------------------------------------------
+			*/
+			/*!
+				@brief Parse a document and add its alphabetic and numeric tokens to an index.  This is used by several unit tests.
+				@param index [in/out] The index (any index_manager).
+				@param parser [in] The parser to use.
+				@param document [in] The document.
+			*/
+			static void unittest_index_document(index_manager &index, class parser &parser, document &document)
+				{
+				compress_integer::integer document_length = 0;
+
+				parser.set_document(document);
+				index.begin_document(document.primary_key);
+				for (;;)
+					{
+					const auto &token = parser.get_next_token();
+					if (token.type == JASS::parser::token::eof)
+						break;
+					if (token.type == JASS::parser::token::alpha || token.type == JASS::parser::token::numeric)
 						{
-						/*
-							Get the next token.
-						*/
-						const auto &token = parser.get_next_token();
-						
-						/*
-							Different behaviour based on its type.
-						*/
-						switch (token.type)
-							{
-							case JASS::parser::token::eof:
-								document_length++;
-								finished = true;						// finish up.
-								break;
-							case JASS::parser::token::alpha:
-							case JASS::parser::token::numeric:
-								document_length++;
-								index.term(token);					// add it to the index.
-								break;
-							default:
-								break;									// ignore.
-							}
+						document_length++;
+						index.term(token);
 						}
-					while (!finished);
-					
-					/*
-						Mark that we're at the end of the document
-					*/
-					index.end_document(document_length);
 					}
-				while (!document.isempty());
+				index.end_document(document_length + 1);			// the count includes the eof token
+				}
+
+			/*
+				INDEX_MANAGER_SEQUENTIAL::UNITTEST_BUILD_INDEX()
+				------------------------------------------------
+				Build a index from the standard 10-document collection.
+			*/
+			/*!
+				@brief Build and index for the 10 sample documents.  This is used by several unit tests that need a valid index.
+				@param index [out] The index once built (any index_manager).
+				@param document_collection [in] The documents to index.
+			*/
+			static void unittest_build_index(index_manager &index, const std::string &document_collection)
+				{
+				class parser parser;
+				unittest_for_each_document(document_collection, [&index, &parser](document &document) { unittest_index_document(index, parser, document); });
 				}
 
 			/*
@@ -0,0 +1,370 @@
+/*
+	INDEX_MANAGER_SPILLING.CPP
+	--------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+
+#include "parser.h"
+#include "asserts.h"
+#include "unittest_data.h"
+#include "instream_memory.h"
+#include "instream_document_trec.h"
+#include "index_manager_spilling.h"
+#include "compress_integer_variable_byte.h"
+
+namespace JASS
+	{
+	/*
+		INDEX_MANAGER_SPILLING::RUN_READER::RUN_READER()
+		------------------------------------------------
+	*/
+	index_manager_spilling::run_reader::run_reader(const std::string &filename) :
+		source(filename, "rb"),
+		buffer(BUFFER_SIZE),
+		buffer_start(0),
+		buffer_end(0),
+		at_eof(false),
+		document_frequency(0)
+		{
+		/* Nothing */
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::RUN_READER::ENSURE()
+		--------------------------------------------
+	*/
+	void index_manager_spilling::run_reader::ensure(size_t bytes)
+		{
+		if (buffer_end - buffer_start >= bytes || at_eof)
+			return;
+
+		/*
+			Move what we have to the start of the buffer and fill the remainder from the file
+		*/
+		memmove(&buffer[0], &buffer[buffer_start], buffer_end - buffer_start);
+		buffer_end -= buffer_start;
+		buffer_start = 0;
+
+		size_t wanted = buffer.size() - buffer_end;
+		size_t got = source.read(&buffer[buffer_end], wanted);
+		buffer_end += got;
+		if (got < wanted)
+			at_eof = true;
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::RUN_READER::GET_INTEGER()
+		-------------------------------------------------
+	*/
+	uint64_t index_manager_spilling::run_reader::get_integer(void)
+		{
+		uint64_t value;
+
+		ensure(10);		// the longest 64-bit variable byte encoded integer
+		const uint8_t *from = &buffer[buffer_start];
+		compress_integer_variable_byte::decompress_into(&value, from);
+		buffer_start = from - &buffer[0];
+
+		return value;
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::RUN_READER::NEXT_TERM()
+		-----------------------------------------------
+	*/
+	bool index_manager_spilling::run_reader::next_term(void)
+		{
+		ensure(1);
+		if (buffer_start >= buffer_end)
+			{
+			term.clear();
+			return false;
+			}
+
+		size_t length = get_integer();
+		ensure(length);
+		term.assign(reinterpret_cast<char *>(&buffer[buffer_start]), length);
+		buffer_start += length;
+
+		document_frequency = static_cast<compress_integer::integer>(get_integer());
+
+		return true;
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::RUN_READER::READ_POSTINGS()
+		---------------------------------------------------
+	*/
+	void index_manager_spilling::run_reader::read_postings(compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+		{
+		compress_integer::integer document_id = 0;
+
+		for (compress_integer::integer which = 0; which < document_frequency; which++)
+			{
+			document_id += static_cast<compress_integer::integer>(get_integer());
+			document_ids[which] = document_id;
+			term_frequencies[which] = static_cast<index_postings_impact::impact_type>(get_integer());
+			}
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::INDEX_MANAGER_SPILLING()
+		------------------------------------------------
+	*/
+	index_manager_spilling::index_manager_spilling(size_t memory_budget, const std::string &directory) :
+		directory(directory),
+		memory_budget(memory_budget),
+		primary_key(memory, 1000, 1.5),
+		current_documents(0),
+		empty_run_size(0)
+		{
+		/* Nothing */
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::~INDEX_MANAGER_SPILLING()
+		-------------------------------------------------
+	*/
+	index_manager_spilling::~index_manager_spilling()
+		{
+		for (const auto &filename : runs)
+			::remove(filename.c_str());
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::BEGIN_DOCUMENT()
+		----------------------------------------
+	*/
+	void index_manager_spilling::begin_document(const slice &document_primary_key)
+		{
+		index_manager::begin_document(document_primary_key);
+		primary_key.push_back(slice(memory, document_primary_key));
+
+		if (current == nullptr)
+			{
+			current = std::make_unique<run>();
+			current_documents = 0;
+			empty_run_size = current->memory.size();
+			}
+
+		current->set_document_id(get_highest_document_id());
+		current->begin_document(document_primary_key);
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::END_DOCUMENT()
+		--------------------------------------
+	*/
+	void index_manager_spilling::end_document(compress_integer::integer document_length)
+		{
+		index_manager::end_document(document_length);
+		current_documents++;
+
+		if (current->memory.size() - empty_run_size > memory_budget)
+			spill();
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::SPILL()
+		-------------------------------
+	*/
+	void index_manager_spilling::spill(void)
+		{
+		/*
+			Sort the terms (the order must match the order std::string puts them in as that is what merge() uses)
+		*/
+		std::vector<std::pair<slice, const index_postings *>> terms;
+		for (const auto &[term, postings] : current->index)
+			terms.push_back(std::pair(term, &postings));
+
+		std::sort(terms.begin(), terms.end(), [](const auto &first, const auto &second)
+			{
+			int cmp = memcmp(first.first.address(), second.first.address(), std::min(first.first.size(), second.first.size()));
+			return cmp < 0 || (cmp == 0 && first.first.size() < second.first.size());
+			});
+
+		/*
+			Write each term, its document frequency, then the d-gaps and term frequencies (all variable byte encoded)
+		*/
+		std::vector<compress_integer::integer> document_ids(current_documents + 1);
+		std::vector<index_postings_impact::impact_type> term_frequencies(current_documents + 1);
+		std::vector<uint8_t> encoded;
+		auto into = std::back_inserter(encoded);
+
+		std::string filename = file::mkstemp(directory + "/jass_run_");
+		file out(filename, "wb");
+		for (const auto &[term, postings] : terms)
+			{
+			auto document_frequency = postings->linearize(&document_ids[0], &term_frequencies[0], document_ids.size());
+
+			encoded.clear();
+			compress_integer_variable_byte::compress_into(into, (uint64_t)term.size());
+			encoded.insert(encoded.end(), reinterpret_cast<const uint8_t *>(term.address()), reinterpret_cast<const uint8_t *>(term.address()) + term.size());
+			compress_integer_variable_byte::compress_into(into, (uint64_t)document_frequency);
+
+			compress_integer::integer previous = 0;
+			for (compress_integer::integer which = 0; which < document_frequency; which++)
+				{
+				compress_integer_variable_byte::compress_into(into, (uint64_t)(document_ids[which] - previous));
+				compress_integer_variable_byte::compress_into(into, (uint64_t)term_frequencies[which]);
+				previous = document_ids[which];
+				}
+
+			out.write(&encoded[0], encoded.size());
+			}
+
+		runs.push_back(filename);
+		current.reset();
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::MERGE()
+		-------------------------------
+	*/
+	void index_manager_spilling::merge(const std::function<void(const slice &term, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)> &callback)
+		{
+		if (current != nullptr)
+			spill();
+
+		std::vector<compress_integer::integer> document_ids(get_highest_document_id() + 1);
+		std::vector<index_postings_impact::impact_type> term_frequencies(get_highest_document_id() + 1);
+
+		/*
+			Open each run and read its first term
+		*/
+		std::vector<std::unique_ptr<run_reader>> readers;
+		for (const auto &filename : runs)
+			{
+			readers.push_back(std::make_unique<run_reader>(filename));
+			if (!readers.back()->next_term())
+				readers.pop_back();
+			}
+
+		/*
+			k-way merge the runs on the term
+		*/
+		std::string lowest;
+		while (readers.size() != 0)
+			{
+			lowest = readers[0]->term;
+			for (const auto &reader : readers)
+				if (reader->term < lowest)
+					lowest = reader->term;
+
+			/*
+				The runs are in document id order so the postings of each run go on the end of the previous
+			*/
+			compress_integer::integer document_frequency = 0;
+			for (const auto &reader : readers)
+				if (reader->term == lowest)
+					{
+					reader->read_postings(&document_ids[document_frequency], &term_frequencies[document_frequency]);
+					document_frequency += reader->document_frequency;
+					reader->next_term();
+					}
+
+			callback(slice(vocabulary_memory, slice((void *)lowest.data(), lowest.size())), document_frequency, &document_ids[0], &term_frequencies[0]);
+
+			readers.erase(std::remove_if(readers.begin(), readers.end(), [](const auto &reader){ return reader->term.empty(); }), readers.end());
+			}
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::ITERATE()
+		---------------------------------
+	*/
+	void index_manager_spilling::iterate(index_manager::delegate &callback)
+		{
+		allocator_pool pool;
+		index_postings postings(pool);			// the postings lists are only on disk, so there is no index_postings object for them
+
+		merge([&callback, &postings](const slice &term, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+			{
+			callback(term, postings, document_frequency, document_ids, term_frequencies);
+			});
+
+		/*
+			Iterate over the primary keys calling the callback function with each docid->key pair.
+			Note that the search engine counts documents from 1, not from 0.
+		*/
+		size_t instance = 0;
+		callback(instance, slice("-"));
+		for (const auto &key : primary_key)
+			callback(++instance, key);
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::ITERATE()
+		---------------------------------
+	*/
+	void index_manager_spilling::iterate(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback)
+		{
+		allocator_pool pool;
+		index_postings postings(pool);			// the postings lists are only on disk, so there is no index_postings object for them
+
+		merge([&quantizer, &callback, &postings](const slice &term, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+			{
+			quantizer(callback, term, postings, document_frequency, document_ids, term_frequencies);
+			});
+
+		/*
+			Iterate over the primary keys calling the callback function with each docid->key pair.
+			Note that the search engine counts documents from 1, not from 0.
+		*/
+		size_t instance = 0;
+		quantizer(callback, instance, slice("-"));
+		for (const auto &key : primary_key)
+			quantizer(callback, ++instance, key);
+		}
+
+	/*
+		INDEX_MANAGER_SPILLING::UNITTEST()
+		----------------------------------
+	*/
+	void index_manager_spilling::unittest(void)
+		{
+		using unittest_delegate = index_manager_sequential::unittest_delegate;
+
+		/*
+			The answer is the sequential index, in term order
+		*/
+		std::string collection = unittest_data::ten_documents + unittest_data::ten_documents;
+		index_manager_sequential sequential;
+		index_manager_sequential::unittest_build_index(sequential, collection);
+		unittest_delegate expected;
+		sequential.iterate(expected);
+		std::sort(expected.postings.begin(), expected.postings.end());
+
+		/*
+			A budget of 1 byte spills after every document
+		*/
+		index_manager_spilling spilling(1);
+		unittest_delegate got;
+		index_manager_sequential::unittest_build_index(spilling, collection);
+
+		JASS_assert(spilling.get_run_count() == 20);
+		spilling.iterate(got);
+
+		/*
+			The postings lists come out in term order
+		*/
+		std::vector<std::string> terms;
+		for (const auto &line : got.postings)
+			terms.push_back(line.substr(0, line.find("->")));
+		JASS_assert(std::is_sorted(terms.begin(), terms.end()));
+
+		std::sort(got.postings.begin(), got.postings.end());
+		JASS_assert(got.postings == expected.postings);
+		JASS_assert(got.primary_keys.str() == expected.primary_keys.str());
+		JASS_assert(spilling.get_document_length_vector() == sequential.get_document_length_vector());
+
+		puts("index_manager_spilling::PASSED");
+		}
+	}
@@ -0,0 +1,298 @@
+/*
+	INDEX_MANAGER_SPILLING.H
+	------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief External memory indexer object that spills sorted runs to disk and merges them at serialisation time.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "file.h"
+#include "dynamic_array.h"
+#include "allocator_pool.h"
+#include "index_manager_sequential.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INDEX_MANAGER_SPILLING
+		----------------------------
+	*/
+	/*!
+		@brief External memory (spill to disk) indexer object for collections whose index is larger than memory.
+		@details Documents are indexed into an in-memory index_manager_sequential (the current run).  Once that run uses more than the memory
+		budget it is written to disk as a run file, with the terms in sorted order, and a new run is started.  At iterate() time the runs are
+		merged (a k-way merge on the term) and, because each run holds a contiguous range of document ids, each term's postings list is the
+		concatenation of its postings lists from each run.  Each merged postings list is passed to the callback as soon as it is built, so only
+		one postings list (plus a read buffer per run) is ever in memory at once.  The postings lists are passed to the callback in term order.
+		The primary keys and document lengths are kept in memory.
+	*/
+	class index_manager_spilling : public index_manager
+		{
+		private:
+			/*
+				CLASS INDEX_MANAGER_SPILLING::RUN_READER
+				----------------------------------------
+			*/
+			/*!
+				@brief Read the postings lists from a run file, one term at a time.
+			*/
+			class run_reader
+				{
+				private:
+					static constexpr size_t BUFFER_SIZE = 1024 * 1024;		///< The number of bytes to read from disk at a time
+
+				private:
+					file source;											///< The run file
+					std::vector<uint8_t> buffer;						///< Bytes read from the file, but not yet decoded
+					size_t buffer_start;									///< The first undecoded byte in buffer
+					size_t buffer_end;									///< The end of the valid bytes in buffer
+					bool at_eof;											///< Have we read to the end of the file
+
+				public:
+					std::string term;										///< The current term (empty at end of run)
+					compress_integer::integer document_frequency;	///< The document frequency of the current term
+
+				private:
+					/*
+						INDEX_MANAGER_SPILLING::RUN_READER::ENSURE()
+						--------------------------------------------
+					*/
+					/*!
+						@brief Make sure there are at least bytes bytes (or the rest of the file) in the buffer.
+						@param bytes [in] The number of bytes needed.
+					*/
+					void ensure(size_t bytes);
+
+					/*
+						INDEX_MANAGER_SPILLING::RUN_READER::GET_INTEGER()
+						-------------------------------------------------
+					*/
+					/*!
+						@brief Decode the next variable byte encoded integer from the run.
+						@return The integer
+					*/
+					uint64_t get_integer(void);
+
+				public:
+					/*
+						INDEX_MANAGER_SPILLING::RUN_READER::RUN_READER()
+						------------------------------------------------
+					*/
+					/*!
+						@brief Constructor, open the run and read the first term.
+						@param filename [in] The name of the run file.
+					*/
+					run_reader(const std::string &filename);
+
+					/*
+						INDEX_MANAGER_SPILLING::RUN_READER::NEXT_TERM()
+						-----------------------------------------------
+					*/
+					/*!
+						@brief Read the next term and its document frequency (the postings of the current term must have been read with read_postings()).
+						@return false at end of run, else true
+					*/
+					bool next_term(void);
+
+					/*
+						INDEX_MANAGER_SPILLING::RUN_READER::READ_POSTINGS()
+						---------------------------------------------------
+					*/
+					/*!
+						@brief Read the postings of the current term.
+						@param document_ids [out] The document ids (there must be room for document_frequency of them).
+						@param term_frequencies [out] The term frequencies (there must be room for document_frequency of them).
+					*/
+					void read_postings(compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies);
+				};
+
+			/*
+				CLASS INDEX_MANAGER_SPILLING::RUN
+				---------------------------------
+			*/
+			/*!
+				@brief The in-memory index of the current run.  The primary keys and document lengths are kept by the index_manager_spilling.
+			*/
+			class run : public index_manager_sequential
+				{
+				public:
+					/*
+						INDEX_MANAGER_SPILLING::RUN::SET_DOCUMENT_ID()
+						----------------------------------------------
+					*/
+					/*!
+						@brief Set the document id of the next document to be indexed.
+						@param document_id [in] The document id of the next document.
+					*/
+					void set_document_id(compress_integer::integer document_id)
+						{
+						set_highest_document_id(document_id - 1);
+						}
+
+					/*
+						INDEX_MANAGER_SPILLING::RUN::BEGIN_DOCUMENT()
+						---------------------------------------------
+					*/
+					/*!
+						@brief Tell this object that you're about to start indexing a new object (the primary key is not kept).
+						@param document_primary_key [in] The document's primary key (or external document identifier).
+					*/
+					virtual void begin_document(const slice &document_primary_key)
+						{
+						index_manager::begin_document(document_primary_key);
+						}
+
+					/*
+						INDEX_MANAGER_SPILLING::RUN::END_DOCUMENT()
+						-------------------------------------------
+					*/
+					/*!
+						@brief Tell this object that you've finished with the current document (the length is not kept).
+						@param document_length [in] The length of the document.
+					*/
+					virtual void end_document(compress_integer::integer document_length)
+						{
+						/* Nothing */
+						}
+				};
+
+		private:
+			std::string directory;											///< The run files are written into this directory
+			size_t memory_budget;											///< Spill the current run to disk once it uses more than this many bytes
+			allocator_pool memory;											///< The primary keys are allocated from here
+			allocator_pool vocabulary_memory;							///< The terms passed to iterate()'s callback are allocated from here (as serialisers keep them)
+			dynamic_array<slice> primary_key;							///< The list of primary keys (i.e. external document identifiers)
+			std::unique_ptr<run> current;									///< The run being indexed (or nullptr if there isn't one)
+			size_t current_documents;										///< The number of documents in the current run
+			size_t empty_run_size;											///< The memory used by a run before anything is indexed into it
+			std::vector<std::string> runs;								///< The filenames of the runs on disk, in document id order
+
+		private:
+			/*
+				INDEX_MANAGER_SPILLING::SPILL()
+				-------------------------------
+			*/
+			/*!
+				@brief Write the current run to disk and delete it.
+			*/
+			void spill(void);
+
+			/*
+				INDEX_MANAGER_SPILLING::MERGE()
+				-------------------------------
+			*/
+			/*!
+				@brief Merge the runs, calling callback(term, document_frequency, document_ids, term_frequencies) with each term in sorted order.
+				@param callback [in] The function to call with each term.
+			*/
+			void merge(const std::function<void(const slice &term, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)> &callback);
+
+		public:
+			/*
+				INDEX_MANAGER_SPILLING::INDEX_MANAGER_SPILLING()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param memory_budget [in] The number of bytes of postings to hold in memory before spilling to disk.
+				@param directory [in] The directory to write the run files to.
+			*/
+			index_manager_spilling(size_t memory_budget, const std::string &directory = ".");
+
+			/*
+				INDEX_MANAGER_SPILLING::~INDEX_MANAGER_SPILLING()
+				-------------------------------------------------
+			*/
+			/*!
+				@brief Destructor, deletes the run files.
+			*/
+			virtual ~index_manager_spilling();
+
+			/*
+				INDEX_MANAGER_SPILLING::BEGIN_DOCUMENT()
+				----------------------------------------
+			*/
+			/*!
+				@brief Tell this object that you're about to start indexing a new object.
+				@param document_primary_key [in] The document's primary key (or external document identifier).
+			*/
+			virtual void begin_document(const slice &document_primary_key);
+
+			/*
+				INDEX_MANAGER_SPILLING::TERM()
+				------------------------------
+			*/
+			/*!
+				@brief Hand a new term from the token stream to this object.
+				@param term [in] The term from the token stream.
+			*/
+			virtual void term(const parser::token &term)
+				{
+				current->term(term);
+				}
+
+			/*
+				INDEX_MANAGER_SPILLING::END_DOCUMENT()
+				--------------------------------------
+			*/
+			/*!
+				@brief Tell this object that you've finished with the current document, spilling the current run to disk if it is too large.
+				@param document_length [in] The length of the document.
+			*/
+			virtual void end_document(compress_integer::integer document_length);
+
+			/*
+				INDEX_MANAGER_SPILLING::GET_RUN_COUNT()
+				---------------------------------------
+			*/
+			/*!
+				@brief Return the number of runs written to disk so far.
+				@return The number of runs
+			*/
+			size_t get_run_count(void) const
+				{
+				return runs.size();
+				}
+
+			/*
+				INDEX_MANAGER_SPILLING::ITERATE()
+				---------------------------------
+			*/
+			/*!
+				@brief Iterate over the index calling callback.operator() with each postings list.
+				@param callback [in] The callback to call.
+			*/
+			virtual void iterate(index_manager::delegate &callback);
+
+			/*
+				INDEX_MANAGER_SPILLING::ITERATE()
+				---------------------------------
+			*/
+			/*!
+				@brief Iterate over the index calling callback.operator() with each postings list.
+				@param quantizer [in] The quantizer that will quantize then call the serialiser callback.
+				@param callback [in] The callback that the quantizer should call.
+			*/
+			virtual void iterate(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback);
+
+			/*
+				INDEX_MANAGER_SPILLING::UNITTEST()
+				----------------------------------
+			*/
+			/*!
+				@brief Unit test this class.
+			*/
+			static void unittest(void);
+		};
+	}
@@ -16,13 +16,16 @@
 #pragma once
 
 #include <map>
+#include <array>
 #include <tuple>
+#include <limits>
+#include <memory>
+#include <vector>
 #include <sstream>
 #include <iostream>
 
 #include "maths.h"
 #include "posting.h"
-#include "dynamic_array.h"
 #include "compress_integer.h"
 #include "allocator_pool.h"
 #include "index_postings_impact.h"
@@ -36,12 +39,16 @@ namespace JASS
 	*/
 	/*!
 		@brief Non-thread-safe object that accumulates a single postings list during indexing.
+		@details The postings are stored compressed, the d-gap and term frequency of each posting are variable byte encoded together (see encode())
+		into blocks allocated from the allocator.  Each new block makes the list grow by growth_factor, and the most recent posting is held
+		un-encoded so that its term frequency can still be incremented.  A term seen in only one document uses no blocks at all.
 	*/
 	class index_postings
 		{
 		private:
-			static constexpr size_t initial_size = 16;		///< Initially allocate space for 4 elements
-			static constexpr double growth_factor = 1.5;		///< Grow dynamic arrays by a factor of 1.5
+			static constexpr size_t initial_size = 16;		///< Initially allocate space for (about) 8 postings
+			static constexpr double growth_factor = 1.5;		///< Grow the postings list by a factor of 1.5
+			static constexpr size_t largest_posting = 8;		///< The longest a single encoded posting can be (5 bytes for the flagged gap, 3 for the term frequency)
 
 		protected:
 			/*
@@ -75,10 +82,119 @@ namespace JASS
 						}
 				};
 
+			/*
+				INDEX_POSTINGS::BLOCK
+				---------------------
+			*/
+			/*!
+				@brief A block of encoded postings.  The encoded bytes follow this header in the same allocation.
+			*/
+			class block
+				{
+				public:
+					block *next;					///< The next block in the postings list (or nullptr)
+					uint32_t used;					///< The number of bytes of this block that hold postings
+					uint32_t size;					///< The number of bytes in this block (excluding this header)
+
+				public:
+					/*
+						INDEX_POSTINGS::BLOCK::DATA()
+						-----------------------------
+					*/
+					/*!
+						@brief Return a pointer to the encoded postings.
+						@return The start of the encoded postings.
+					*/
+					uint8_t *data(void)
+						{
+						return reinterpret_cast<uint8_t *>(this + 1);
+						}
+
+					/*
+						INDEX_POSTINGS::BLOCK::DATA()
+						-----------------------------
+					*/
+					/*!
+						@brief Return a pointer to the encoded postings.
+						@return The start of the encoded postings.
+					*/
+					const uint8_t *data(void) const
+						{
+						return reinterpret_cast<const uint8_t *>(this + 1);
+						}
+				};
+
 		private:
+			allocator &memory_pool;																///< All blocks are allocated from here
+			block *first;																			///< The first block of encoded postings (or nullptr)
+			block *last;																			///< The block currently being added to (or nullptr)
+			uint32_t allocated;																	///< The total number of bytes in the blocks (used to compute the size of the next block)
 			compress_integer::integer highest_document;									///< The higest document number seen in this postings list (counting from 1)
-			dynamic_array<uint8_t> document_ids;											///< Array holding the docids (variable byte encoded)
-			dynamic_array<index_postings_impact::impact_type> term_frequencies;	///< Array holding the term frequencies (as integers)
+			compress_integer::integer document_frequency;								///< The number of postings in this list
+			compress_integer::integer pending_gap;											///< The d-gap of the most recent posting (which is not yet encoded)
+			index_postings_impact::impact_type pending_frequency;						///< The term frequency of the most recent posting (which is not yet encoded)
+
+		private:
+			/*
+				INDEX_POSTINGS::ENCODE()
+				------------------------
+			*/
+			/*!
+				@brief Append a posting to the encoded postings, growing the list if there is not enough room.
+				@details Each posting is the variable byte encoded value (d-gap << 1 | (term_frequency != 1)), followed by the variable byte encoded
+				term frequency only if it is not 1.  As most term frequencies are 1, most postings take the same space as the d-gap alone.
+				@param gap [in] The difference between this document id and the previous one.
+				@param term_frequency [in] The term frequency.
+			*/
+			void encode(compress_integer::integer gap, index_postings_impact::impact_type term_frequency)
+				{
+				if (last == nullptr || last->size - last->used < largest_posting)
+					{
+					/*
+						Allocate a new block that is big enough to make the whole list grow by growth_factor
+					*/
+					uint32_t size = allocated == 0 ? initial_size : static_cast<uint32_t>(allocated * (growth_factor - 1.0));
+					size = maths::maximum(size, static_cast<uint32_t>(initial_size));
+					block *next = reinterpret_cast<block *>(memory_pool.malloc(sizeof(block) + size, sizeof(block *)));
+					next->next = nullptr;
+					next->used = 0;
+					next->size = size;
+					allocated += size;
+
+					if (last == nullptr)
+						first = next;
+					else
+						last->next = next;
+					last = next;
+					}
+
+				uint8_t *into = last->data() + last->used;
+				uint8_t *start = into;
+				compress_integer_variable_byte::compress_into(into, (static_cast<uint64_t>(gap) << 1) | (term_frequency != 1));
+				if (term_frequency != 1)
+					compress_integer_variable_byte::compress_into(into, static_cast<uint32_t>(term_frequency));
+				last->used += static_cast<uint32_t>(into - start);
+				}
+
+			/*
+				INDEX_POSTINGS::ADD_POSTING()
+				-----------------------------
+			*/
+			/*!
+				@brief Add a new posting to the end of the list.  The previous one is encoded, this one is held until the next one arrives (or linearize() is called).
+				@param document_id [in] The document id.
+				@param term_frequency [in] The term frequency.
+			*/
+			void add_posting(compress_integer::integer document_id, index_postings_impact::impact_type term_frequency)
+				{
+				if (document_frequency != 0)
+					encode(pending_gap, pending_frequency);
+
+				pending_gap = document_id - highest_document;
+				pending_frequency = term_frequency;
+				highest_document = document_id;
+				document_frequency++;
+				}
 
 		public:
 			index_postings() = delete;
@@ -92,9 +208,14 @@ namespace JASS
 				@param memory_pool [in] All allocation is from this allocator.
 			*/
 			index_postings(allocator &memory_pool) :
+				memory_pool(memory_pool),
+				first(nullptr),
+				last(nullptr),
+				allocated(0),
 				highest_document(0),															// starts at 0, counts from 1
-				document_ids(memory_pool, initial_size, growth_factor),					// give the allocator to the array
-				term_frequencies(memory_pool, initial_size, growth_factor)					// give the allocator to the array
+				document_frequency(0),
+				pending_gap(0),
+				pending_frequency(0)
 				{
 				/* Nothing */
 				}
@@ -116,34 +237,20 @@ namespace JASS
 				if (document_id == highest_document)
 					{
 					/*
-						If this is the second or subseqent occurrence then just add 1 to the term frequency (and make sure it doesn't overflow).
+						If this is the second or subseqent occurrence then just add to the term frequency (and make sure it doesn't overflow).
+						The most recent posting is not encoded yet so it can be changed in place.
 					*/
-					index_postings_impact::impact_type &frequency = term_frequencies.back();
-
-
-					if (index_postings_impact::largest_impact - frequency > amount)			// that is, without overflow: if (frequency + amount < index_postings_impact::largest_impact)
-						frequency += amount;			// cppcheck produces a false positive "Variable 'frequency' is modified but its new value is never used." - it looks like it doesn't fully understand that frequency is a reference.
+					if (index_postings_impact::largest_impact - pending_frequency > amount)			// that is, without overflow: if (frequency + amount < index_postings_impact::largest_impact)
+						pending_frequency += amount;
 					else
-						frequency = index_postings_impact::largest_impact;
+						pending_frequency = index_postings_impact::largest_impact;
 					}
 				else
 					{
 					/*
-						First time we've seen this term in this document so add a new document ID and set the term frequency to 1.
+						First time we've seen this term in this document so add a new document ID and set the term frequency.
 					*/
-					uint8_t space[10];				// worst case for a 64-bit integer (70 bits / 7 bits per byte = 10 bytes)
-					uint8_t *ending = space;		// write into here;
-
-					/*
-						Compress into the temporary buffer then copy into the postings
-					*/
-					compress_integer_variable_byte::compress_into(ending, document_id - highest_document);
-
-					for (uint8_t *byte = space; byte < ending; byte++)
-						document_ids.push_back(*byte);
-					term_frequencies.push_back(amount);
-
-					highest_document = document_id;
+					add_posting(document_id, amount);
 					}
 				}
 
@@ -167,25 +274,10 @@ namespace JASS
 				*/
 				JASS_assert(highest_document == 0);
 
-				size_t postings_list_length = data.size();
-				for (size_t current = 0; current < postings_list_length; current++)
+				for (const auto &current : data)
 					{
-					uint8_t space[10];					// worst case for a 64-bit integer (70 bits / 7 bits per byte = 10 bytes)
-					uint8_t *ending = space;			// write into here;
-					
-					/*
-						Compress into the temporary buffer then copy into the postings
-					*/
-					highest_document += data[current].docid;
-					compress_integer_variable_byte::compress_into(ending, data[current].docid);
-					for (uint8_t *byte = space; byte < ending; byte++)
-						document_ids.push_back(*byte);
-
-					/*
-						Set the term frequency
-					*/
-					decltype(index_postings_impact::largest_impact) frequency = data[current].term_frequency;
-					term_frequencies.push_back(JASS::maths::minimum(frequency, index_postings_impact::largest_impact));
+					decltype(index_postings_impact::largest_impact) frequency = current.term_frequency;
+					add_posting(highest_document + current.docid, JASS::maths::minimum(frequency, index_postings_impact::largest_impact));
 					}
 				}
 
@@ -195,51 +287,56 @@ namespace JASS
 			*/
 			/*!
 				@brief Turn the internal format used to accumulate postings into a docid and term-frequencies array.
-				@param temporary [in] Buffer used as scratch space.
-				@param temporary_size [in] Length, in bytes, of temporary.
+				@details This is a single sequential pass over the encoded blocks (decoding the d-gaps and term frequencies together).
 				@param ids [out] Buffer to store the document ids.
 				@param frequencies [out] Buffer to store the term frequencies.
 				@param id_and_frequencies_length [in] The length of the id and frequencies buffers.
 
 				@return Returns the document frequency of this term, or 0 on failure.
 			*/
-			compress_integer::integer linearize(uint8_t *temporary, size_t temporary_size, compress_integer::integer *ids, index_postings_impact::impact_type *frequencies, size_t id_and_frequencies_length) const
+			compress_integer::integer linearize(compress_integer::integer *ids, index_postings_impact::impact_type *frequencies, size_t id_and_frequencies_length) const
 				{
-				/*
-					Linearize the term frequencies
-				*/
-				size_t document_frequency = term_frequencies.serialise(frequencies, id_and_frequencies_length);
-
 				if (document_frequency > id_and_frequencies_length)
 					return 0;
 
-				/*
-					Linearize the document ids, which will still be variable byte encoded
-				*/
-				auto needs = document_ids.serialise(temporary, temporary_size);
-				if (needs > temporary_size)
-					return 0;
+				compress_integer::integer *current_id = ids;
+				index_postings_impact::impact_type *current_frequency = frequencies;
+				compress_integer::integer sum = 0;
 
 				/*
-					Decompress the document ids
+					Decode the blocks, undoing the d-gaps as we go
 				*/
-				compress_integer_variable_byte::static_decode(ids, document_frequency, temporary, needs);
+				for (const block *current = first; current != nullptr; current = current->next)
+					{
+					const uint8_t *from = current->data();
+					const uint8_t *end = from + current->used;
+					while (from < end)
+						{
+						uint64_t value;
+						compress_integer_variable_byte::decompress_into(&value, from);
+						sum += static_cast<compress_integer::integer>(value >> 1);
+						*current_id++ = sum;
+						if (value & 1)
+							{
+							uint32_t term_frequency;
+							compress_integer_variable_byte::decompress_into(&term_frequency, from);
+							*current_frequency++ = static_cast<index_postings_impact::impact_type>(term_frequency);
+							}
+						else
+							*current_frequency++ = 1;
+						}
+					}
 
 				/*
-					Decode the deltas
+					Add the most recent posting, which is not encoded
 				*/
-				compress_integer::integer sum = 0;
-				auto end = ids + document_frequency;
-				for (auto current = ids; current < end; current++)
+				if (document_frequency != 0)
 					{
-					sum += *current;
-					*current = sum;
+					*current_id = sum + pending_gap;
+					*current_frequency = pending_frequency;
 					}
 
-				/*
-					And return the document frequency
-				*/
-				return static_cast<compress_integer::integer>(document_frequency);
+				return document_frequency;
 				}
 
 			/*
@@ -253,7 +350,7 @@ namespace JASS
 			*/
 			void impact_order(size_t documents_in_collection, index_postings_impact &postings_list) const
 				{
-				auto document_frequency = linearize(postings_list.temporary, postings_list.temporary_size, postings_list.document_ids, postings_list.term_frequencies, postings_list.number_of_postings);
+				auto document_frequency = linearize(postings_list.document_ids, postings_list.term_frequencies, postings_list.number_of_postings);
 				impact_order(documents_in_collection, postings_list, document_frequency, postings_list.document_ids, postings_list.term_frequencies);
 				}
 
@@ -378,17 +475,13 @@ std::ostream &operator<<(std::ostream &stream, const index_postings &data);
 			*/
 			void text_render(std::ostream &stream) const
 				{
-				size_t document_frequency = term_frequencies.serialise(nullptr, 0);
-
 				/*
 					Serialise the postings
 				*/
 				auto id_list = std::make_unique<compress_integer::integer []>(document_frequency);
 				auto tf_list = std::make_unique<index_postings_impact::impact_type []>(document_frequency);
-				size_t temporary_size = document_frequency * 10;		 // worst case is that each integer is encoded in 10 bytes and so the linear buffer is 10 times the number of document frequencies
-				auto temporary = std::make_unique<uint8_t []>(temporary_size);
 
-				linearize(temporary.get(), temporary_size, id_list.get(), tf_list.get(), document_frequency);
+				linearize(id_list.get(), tf_list.get(), document_frequency);
 
 				/*
 					write out the postings
@@ -422,6 +515,52 @@ std::ostream &operator<<(std::ostream &stream, const index_postings &data);
 
 				JASS_assert(strcmp(result.str().c_str(), "<1,2><2,1><173252,1>") == 0);
 
+				/*
+					A long list (many blocks) with a mix of large and small gaps and term frequencies
+				*/
+				index_postings long_postings(pool);
+				std::vector<compress_integer::integer> expected_ids;
+				std::vector<index_postings_impact::impact_type> expected_frequencies;
+				compress_integer::integer document_id = 0;
+				for (compress_integer::integer which = 0; which < 10000; which++)
+					{
+					document_id += which % 7 == 0 ? 100000 + which : 1 + which % 3;
+					size_t frequency = which % 5 == 0 ? 1 + which % 300 : 1;
+					for (size_t times = 0; times < frequency; times++)
+						long_postings.push_back(document_id);
+					expected_ids.push_back(document_id);
+					expected_frequencies.push_back(static_cast<index_postings_impact::impact_type>(maths::minimum(frequency, static_cast<size_t>(index_postings_impact::largest_impact))));
+					}
+
+				std::vector<compress_integer::integer> ids(expected_ids.size());
+				std::vector<index_postings_impact::impact_type> frequencies(expected_ids.size());
+				JASS_assert(long_postings.linearize(&ids[0], &frequencies[0], ids.size()) == expected_ids.size());
+				JASS_assert(ids == expected_ids);
+				JASS_assert(frequencies == expected_frequencies);
+
+				/*
+					Too little space to linearize into
+				*/
+				JASS_assert(long_postings.linearize(&ids[0], &frequencies[0], ids.size() - 1) == 0);
+
+				/*
+					Add a D1-encoded postings list all at once
+				*/
+				std::vector<JASS::posting> list(3);
+				list[0].docid = 1;
+				list[0].term_frequency = 3;
+				list[1].docid = 4;
+				list[1].term_frequency = 1;
+				list[2].docid = 200;
+				list[2].term_frequency = 70000;
+				index_postings block_postings(pool);
+				block_postings.push_back(list);
+				std::ostringstream block_result;
+				block_postings.text_render(block_result);
+				std::ostringstream block_answer;
+				block_answer << "<1,3><5,1><205," << (size_t)index_postings_impact::largest_impact << ">";
+				JASS_assert(block_result.str() == block_answer.str());
+
 				puts("index_postings::PASSED");
 				}
 		};
@@ -190,8 +190,6 @@ namespace JASS
 			compress_integer::integer *postings;	///< The list of document IDs, strung together for each postings segment.
 			compress_integer::integer *document_ids;					///< The re-used buffer storing decoded document ids - used while impact ordering
 			index_postings_impact::impact_type *term_frequencies;	///< The re-used buffer storing the term frequencies - used while impact ordering
-			size_t temporary_size;											///< The number of bytes in temporary
-			uint8_t *temporary;												///< Temporary buffer - cannot be used to store anything between calls
 
 		public:
 			/*
@@ -211,9 +209,7 @@ namespace JASS
 				number_of_postings(document_count),
 				postings(static_cast<decltype(postings)>(memory.malloc((document_count + largest_impact + 1) * sizeof(*postings)))),			// longest length is total_postings + all impacts + 1
 				document_ids((decltype(document_ids))memory.malloc(document_count * sizeof(*document_ids))),
-				term_frequencies((decltype(term_frequencies))memory.malloc(document_count * sizeof(*term_frequencies))),
-				temporary_size(document_count * (sizeof(*document_ids) / 7 + 1) * sizeof(*temporary)),
-				temporary((decltype(temporary))memory.malloc(temporary_size))			// enough space to decompress variable-byte encodings
+				term_frequencies((decltype(term_frequencies))memory.malloc(document_count * sizeof(*term_frequencies)))
 				{
 				/* Nothing */
 				}
@@ -6,7 +6,11 @@
 */
 #include <string.h>
 
+#include <string>
+
 #include "assert.h"
+#include "unittest_data.h"
+#include "instream_memory.h"
 #include "instream_deflate.h"
 #include "compress_general_zlib.h"
 
@@ -68,10 +72,23 @@ namespace JASS
 
 		if (state == Z_STREAM_END)
 			{
-			got = document.contents.size() - stream.avail_out;		// number of bytes that were decompressed
-			document.contents.resize(got);
-			bytes_read += got;
-			return;										// at EOF
+			/*
+				A .gz file can be many gzip members one after the other (a .warc.gz file is usually one per record), so if there is more then start again
+			*/
+			if (stream.avail_in <= 0)
+				{
+				stream.avail_in = (uInt)source->fetch(buffer, buffer_length);
+				stream.next_in = buffer;
+				}
+			if (stream.avail_in <= 0)
+				{
+				got = document.contents.size() - stream.avail_out;		// number of bytes that were decompressed
+				document.contents.resize(got);
+				bytes_read += got;
+				return;										// at EOF
+				}
+			inflateReset(&stream);
+			state = Z_OK;
 			}
 
 		if (stream.avail_out == 0)
@@ -92,6 +109,26 @@ namespace JASS
 	*/
 	void instream_deflate::unittest(void)
 		{
+		/*
+			Two compressed streams one after the other (as in a multi-member .gz file) decompress as one, even when read a few bytes at a time
+		*/
+		compress_general_zlib compressor;
+		std::string half_1 = unittest_data::ten_documents.substr(0, unittest_data::ten_documents.size() / 2);
+		std::string half_2 = unittest_data::ten_documents.substr(unittest_data::ten_documents.size() / 2);
+		std::string compressed(unittest_data::ten_documents.size() * 2, '\0');
+		size_t member_1 = compressor.encode(&compressed[0], compressed.size(), half_1.data(), half_1.size());
+		size_t member_2 = compressor.encode(&compressed[member_1], compressed.size() - member_1, half_2.data(), half_2.size());
+		compressed.resize(member_1 + member_2);
+
+		std::shared_ptr<instream> file(new instream_memory(compressed.data(), compressed.size()));
+		instream_deflate reader(file);
+		std::string got;
+		uint8_t chunk[37];
+		size_t bytes;
+		while ((bytes = reader.fetch(chunk, sizeof(chunk))) != 0)
+			got.append(reinterpret_cast<char *>(chunk), bytes);
+		JASS_assert(got == unittest_data::ten_documents);
+
 		/*
 			Yay, we passed!
 		*/
@@ -6,9 +6,19 @@
 */
 #include <string.h>
 
+#include <string>
+#include <algorithm>
+
 #include "assert.h"
+#include "asserts.h"
+#include "file.h"
 #include "instream_file.h"
+#include "instream_mmap.h"
+#include "instream_zstd.h"
+#include "unittest_data.h"
 #include "instream_deflate.h"
+#include "compress_general_zlib.h"
+#include "compress_general_zstd.h"
 #include "instream_directory_iterator.h"
 
 namespace JASS
@@ -17,12 +27,132 @@ namespace JASS
 		INSTREAM_DIRECTORY_ITERATOR::INSTREAM_DIRECTORY_ITERATOR()
 		----------------------------------------------------------
 	*/
-	instream_directory_iterator::instream_directory_iterator(const std::string &directory_name) :
+	instream_directory_iterator::instream_directory_iterator(const std::string &directory_name, size_t threads, size_t read_ahead) :
 		source(directory_name),
-		reader(nullptr)
+		reader(nullptr),
+		stopping(false),
+		current_file(0),
+		current_offset(0)
 		{
 		current = begin(source);
 		last = end(source);
+
+		if (threads <= 1)
+			return;
+
+		/*
+			In parallel mode start a thread for each of the first threads files (in directory order)
+		*/
+		for (; current != last; current++)
+			filenames.push_back(current->path().string());
+
+		threads = (std::min)(threads, filenames.size());
+		size_t blocks = (std::max)(static_cast<size_t>(1), read_ahead / (threads * block_size));		// read_ahead is shared between the threads
+		for (size_t which = 0; which < threads; which++)
+			decompressed.push_back(std::make_unique<queue_spsc<std::unique_ptr<block>>>(blocks));
+		for (size_t which = 0; which < threads; which++)
+			decompressors.push_back(thread(decompress, this, which));
+		}
+
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::~INSTREAM_DIRECTORY_ITERATOR()
+		-----------------------------------------------------------
+	*/
+	instream_directory_iterator::~instream_directory_iterator()
+		{
+		stopping = true;
+		for (auto &which : decompressors)
+			which.join();
+		}
+
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::OPEN()
+		-----------------------------------
+	*/
+	std::shared_ptr<instream> instream_directory_iterator::open(const std::string &filename, bool map)
+		{
+		bool deflate = filename.size() > 3 && filename.compare(filename.size() - 3, 3, ".gz") == 0;
+		bool zstd = filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".zst") == 0;
+
+		if (map && !deflate && !zstd)
+			return std::shared_ptr<instream>(new instream_mmap(filename));
+
+		std::shared_ptr<instream> file(new instream_file(filename));
+		if (deflate)
+			return std::shared_ptr<instream>(new instream_deflate(file));
+		if (zstd)
+			return std::shared_ptr<instream>(new instream_zstd(file));
+
+		return file;
+		}
+
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::DECOMPRESS()
+		-----------------------------------------
+	*/
+	void instream_directory_iterator::decompress(instream_directory_iterator *me, size_t first)
+		{
+		auto &into = *me->decompressed[first];
+		size_t threads = me->decompressed.size();
+
+		for (size_t which = first; which < me->filenames.size(); which += threads)
+			{
+			std::shared_ptr<instream> reader = open(me->filenames[which]);
+			for (;;)
+				{
+				auto next = std::make_unique<block>();
+				next->data.resize(block_size);
+				next->size = reader->fetch(next->data.data(), next->data.size());
+				bool end_of_file = next->size == 0;
+
+				if (!into.push(next, me->stopping))
+					return;
+				if (end_of_file)
+					break;
+				}
+			}
+		}
+
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::READ_PARALLEL()
+		--------------------------------------------
+	*/
+	void instream_directory_iterator::read_parallel(document &buffer)
+		{
+		uint8_t *into = static_cast<uint8_t *>(buffer.contents.address());
+		size_t wanted = buffer.contents.size();
+		size_t got = 0;
+
+		while (got < wanted)
+			{
+			if (current_block == nullptr)
+				{
+				if (current_file >= filenames.size())
+					break;
+
+				current_block = decompressed[current_file % decompressed.size()]->pop();
+				current_offset = 0;
+				if (current_block->size == 0)
+					{
+					current_file++;					// the end of this file
+					current_block.reset();
+					continue;
+					}
+				}
+
+			size_t bytes = (std::min)(wanted - got, current_block->size - current_offset);
+			memcpy(into + got, current_block->data.data() + current_offset, bytes);
+			got += bytes;
+			current_offset += bytes;
+
+			if (current_offset == current_block->size)
+				current_block.reset();
+			}
+
+		if (got == 0)
+			buffer.contents = slice();
+		else
+			buffer.contents.resize(got);
 		}
 
 	/*
@@ -31,6 +161,12 @@ namespace JASS
 	*/
 	void instream_directory_iterator::read(document &document)
 		{
+		if (decompressors.size() != 0)
+			{
+			read_parallel(document);
+			return;
+			}
+
 		/*
 			Is this the first time this method is called?
 		*/
@@ -38,9 +174,7 @@ namespace JASS
 			if (current != last)
 				{
 //puts(current->path().string().c_str());
-				reader = std::shared_ptr<instream>(new instream_file(current->path().string()));
-				if (current->path().string().rfind(".gz") != std::string::npos)
-					reader = std::shared_ptr<JASS::instream>(new instream_deflate(reader));
+				reader = open(current->path().string());
 				current++;
 				}
 
@@ -66,9 +200,7 @@ namespace JASS
 			if (current != last)
 				{
 //puts(current->path().string().c_str());
-				reader = std::shared_ptr<instream>(new instream_file(current->path().string()));
-				if (current->path().string().rfind(".gz") != std::string::npos)
-					reader = std::shared_ptr<JASS::instream>(new instream_deflate(reader));
+				reader = open(current->path().string());
 				current++;
 				}
 			else
@@ -90,6 +222,65 @@ namespace JASS
 
 		document blob;
 		source.read(blob);
+
+		/*
+			Make a directory of plain, .gz, and .zst files (each holding some of the test documents)
+		*/
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "jass_instream_directory_iterator_unittest";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directory(directory);
+
+		compress_general_zlib zlib;
+		compress_general_zstd zstd;
+		std::string collection = unittest_data::ten_documents + unittest_data::ten_documents + unittest_data::ten_documents;
+		size_t length = collection.size() / 5;
+		for (size_t which = 0; which < 5; which++)
+			{
+			std::string part = collection.substr(which * length, which == 4 ? std::string::npos : length);
+			std::string compressed(part.size() * 2 + 1024, '\0');
+			std::string filename = (directory / ("part_" + std::to_string(which))).string();
+			if (which % 3 == 1)
+				{
+				compressed.resize(zlib.encode(&compressed[0], compressed.size(), part.data(), part.size()));
+				file::write_entire_file(filename + ".gz", compressed);
+				}
+			else if (which % 3 == 2)
+				{
+				compressed.resize(zstd.encode(&compressed[0], compressed.size(), part.data(), part.size()));
+				file::write_entire_file(filename + ".zst", compressed);
+				}
+			else
+				file::write_entire_file(filename, part);
+			}
+
+		/*
+			The files are read in the same order (so the same bytes) in serial and in parallel (with a read-ahead of one block per thread)
+		*/
+		std::string serial;
+		std::string parallel[3];
+		for (size_t threads = 1; threads <= 3; threads++)
+			{
+			instream_directory_iterator reader(directory.string(), threads, 1);
+			std::string &into = threads == 1 ? serial : parallel[threads - 1];
+			uint8_t chunk[101];
+			size_t bytes;
+			while ((bytes = reader.fetch(chunk, sizeof(chunk))) != 0)
+				into.append(reinterpret_cast<char *>(chunk), bytes);
+			}
+		JASS_assert(serial.size() == collection.size());
+		JASS_assert(parallel[1] == serial);
+		JASS_assert(parallel[2] == serial);
+
+		/*
+			Destroy before the threads have finished
+		*/
+		auto unfinished = std::make_unique<instream_directory_iterator>(directory.string(), 2, 1);
+		uint8_t byte;
+		JASS_assert(unfinished->fetch(&byte, 1) == 1);
+		unfinished.reset();
+
+		std::filesystem::remove_all(directory);
+
 		/*
 			Yay, we passed!
 		*/
@@ -12,9 +12,15 @@
 */
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 #include <filesystem>
 
+#include "threads.h"
 #include "instream.h"
+#include "queue_spsc.h"
 
 namespace JASS
 	{
@@ -24,9 +30,32 @@ namespace JASS
 	*/
 	/*!
 		@brief Subclass of instream for reading data from multiple files in a directory (as if they were all concatinated).
+		@details Files ending in .gz are decompressed with instream_deflate, and those ending in .zst with instream_zstd.  With more than one
+		thread the files are decompressed concurrently: thread t of T decompresses files t, t + T, t + 2T, ... (in directory order) one block at
+		a time, passing the blocks (then an empty block at the end of each file) through its own queue_spsc.  read() takes file f from queue
+		f % T, so the result is exactly the same as with one thread.  Each queue is bounded so that between them the threads decompress at most
+		read_ahead bytes ahead of read() (but always at least one block each), no matter how many threads there are.  As each file is made of whole documents, whole documents (or whole batches of them) are decompressed at once.
 	*/
 	class instream_directory_iterator : public instream
 		{
+		protected:
+			/*
+				CLASS INSTREAM_DIRECTORY_ITERATOR::BLOCK
+				----------------------------------------
+			*/
+			/*!
+				@brief A block of decompressed data.
+			*/
+			class block
+				{
+				public:
+					std::vector<uint8_t> data;				///< The buffer
+					size_t size;								///< The number of bytes of data in the buffer (0 at the end of a file)
+				};
+
+		protected:
+			static constexpr size_t block_size = 1024 * 1024;			///< The size of a block of decompressed data (in parallel mode)
+
 		protected:
 			std::filesystem::directory_iterator source;		///< Use the C++17 directory iterator
 			std::filesystem::directory_iterator current;		///< Where we are in the current iteration
@@ -35,6 +64,36 @@ namespace JASS
 			std::shared_ptr<instream> reader;					///< A chain of instram objects responsible for sourcing the data
 			size_t bytes_read;										///< The number of bytes that have been read from the file.
 
+			std::vector<std::string> filenames;													///< In parallel mode, the files in the directory (in directory order)
+			std::vector<std::unique_ptr<queue_spsc<std::unique_ptr<block>>>> decompressed;	///< In parallel mode, the blocks decompressed by each thread
+			std::vector<thread> decompressors;													///< In parallel mode, the threads
+			std::atomic<bool> stopping;															///< Set by the destructor to stop the threads before they are finished
+			size_t current_file;																		///< In parallel mode, the file read() is reading from
+			std::unique_ptr<block> current_block;												///< In parallel mode, the block read() is reading from
+			size_t current_offset;																	///< How far into current_block read() has got
+
+		protected:
+			/*
+				INSTREAM_DIRECTORY_ITERATOR::DECOMPRESS()
+				-----------------------------------------
+			*/
+			/*!
+				@brief A thread that decompresses every threads-th file (starting at file first) into blocks, in parallel mode.
+				@param me [in] The instream_directory_iterator this thread is decompressing for.
+				@param first [in] The first file to decompress (and the queue to pass the blocks through).
+			*/
+			static void decompress(instream_directory_iterator *me, size_t first);
+
+			/*
+				INSTREAM_DIRECTORY_ITERATOR::READ_PARALLEL()
+				--------------------------------------------
+			*/
+			/*!
+				@brief read() in parallel mode.
+				@param buffer [out] buffer.contents.size() bytes of data are read into buffer which is resized to the number of bytes read on eof.
+			*/
+			void read_parallel(document &buffer);
+
 		public:
 			/*
 				INSTREAM_DIRECTORY_ITERATOR::INSTREAM_DIRECTORY_ITERATOR()
@@ -43,8 +102,10 @@ namespace JASS
 			/*!
 				@brief Constructor
 				@param directory_name [in] The name of the directory to search within
+				@param threads [in] The number of files to decompress at once (1 reads one file after the other in this thread).
+				@param read_ahead [in] With more than one thread, the most that all the threads together decompress ahead of read() (in bytes).
 			*/
-			instream_directory_iterator(const std::string &directory_name);
+			instream_directory_iterator(const std::string &directory_name, size_t threads = 1, size_t read_ahead = 256 * 1024 * 1024);
 
 			/*
 				INSTREAM_DIRECTORY_ITERATOR::~INSTREAM_DIRECTORY_ITERATOR()
@@ -53,10 +114,19 @@ namespace JASS
 			/*!
 				@brief Destructor.
 			*/
-			virtual ~instream_directory_iterator()
-				{
-				/* Nothing */
-				}
+			virtual ~instream_directory_iterator();
+
+			/*
+				INSTREAM_DIRECTORY_ITERATOR::OPEN()
+				-----------------------------------
+			*/
+			/*!
+				@brief Open a file for reading, decompressing it if its name ends in .gz (deflate) or .zst (zstd).
+				@param filename [in] The name of the file.
+				@param map [in] Should a file that is not compressed be memory mapped (instream_mmap) rather than read (instream_file)?
+				@return The instream to read the (decompressed) file from.
+			*/
+			static std::shared_ptr<instream> open(const std::string &filename, bool map = false);
 
 			/*
 				INSTREAM_DIRECTORY_ITERATOR::READ()
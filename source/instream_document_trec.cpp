@@ -6,13 +6,16 @@
 */
 #include <stdio.h>
 #include <string.h>
+#include <immintrin.h>
 
 #include <new>
 #include <memory>
 #include <algorithm>
 
+#include "file.h"
 #include "assert.h"
 #include "unittest_data.h"
+#include "instream_mmap.h"
 #include "instream_memory.h"
 #include "instream_document_trec.h"
 
@@ -24,13 +27,24 @@ namespace JASS
 	*/
 	instream_document_trec::instream_document_trec(std::shared_ptr<instream> &source, size_t buffer_size, const std::string &document_tag, const std::string &document_primary_key_tag) :
 		instream(source),
-		buffer_size(buffer_size)
+		buffer_size(buffer_size),
+		zero_copy(false),
+		mapped(nullptr)
 		{
 		/*
-			Allocate the internal buffer and keep a pointer to its end.
+			If the source is a memory mapped file then the whole file is the buffer, otherwise allocate the internal buffer and keep a pointer to its end.
 		*/
-		buffer = new uint8_t[buffer_size + 1];
-		buffer_end = buffer;
+		if ((mapped = dynamic_cast<instream_mmap *>(source.get())) != nullptr && mapped->address() != nullptr)
+			{
+			buffer = const_cast<uint8_t *>(mapped->address());			// never written to
+			buffer_end = buffer + mapped->size();
+			}
+		else
+			{
+			mapped = nullptr;
+			buffer = new uint8_t[buffer_size + 1];
+			buffer_end = buffer;
+			}
 		buffer_used = 0;
 
 		/*
@@ -58,7 +72,8 @@ namespace JASS
 	*/
 	instream_document_trec::~instream_document_trec()
 		{
-		delete [] buffer;
+		if (mapped == nullptr)
+			delete [] buffer;
 		}
 
 	/*
@@ -76,6 +91,57 @@ namespace JASS
 		primary_key_end_tag = "</" + primary_key_tag + ">";
 		}
 		
+	/*
+		INSTREAM_DOCUMENT_TREC::FIND()
+		------------------------------
+	*/
+	uint8_t *instream_document_trec::find(uint8_t *start, uint8_t *end, const std::string &tag)
+		{
+		const uint8_t *pattern = reinterpret_cast<const uint8_t *>(tag.c_str());
+		size_t length = tag.size();
+		uint8_t *current = start;
+
+		if (length == 0 || static_cast<size_t>(end - start) < length)
+			return end;
+
+#ifdef __AVX2__
+		/*
+			At each of 32 positions at once, check the first and the last byte of the tag, and check the rest only where both match
+		*/
+		__m256i first = _mm256_set1_epi8(pattern[0]);
+		__m256i last = _mm256_set1_epi8(pattern[length - 1]);
+		for (; current + length - 1 + 32 <= end; current += 32)
+			{
+			__m256i at_first = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((__m256i *)current));
+			__m256i at_last = _mm256_cmpeq_epi8(last, _mm256_loadu_si256((__m256i *)(current + length - 1)));
+			uint32_t candidates = _mm256_movemask_epi8(_mm256_and_si256(at_first, at_last));
+			while (candidates != 0)
+				{
+				uint8_t *found = current + _tzcnt_u32(candidates);
+				if (memcmp(found + 1, pattern + 1, length - 1) == 0)
+					return found;
+				candidates = _blsr_u32(candidates);
+				}
+			}
+#endif
+
+		/*
+			The remainder (or all of it without AVX2), look for the first byte then check the rest
+		*/
+		uint8_t *last_start = end - length;
+		while (current <= last_start)
+			{
+			uint8_t *found = static_cast<uint8_t *>(memchr(current, pattern[0], last_start - current + 1));
+			if (found == nullptr)
+				return end;
+			if (memcmp(found + 1, pattern + 1, length - 1) == 0)
+				return found;
+			current = found + 1;
+			}
+
+		return end;
+		}
+
 	/*
 		INSTREAM_DOCUMENT_TREC::READ()
 		------------------------------
@@ -88,8 +154,17 @@ namespace JASS
 			Find the start tag
 		*/
 		uint8_t *document_start;
-		if ((document_start = std::search(unread_data, buffer_end, document_start_tag.c_str(), document_start_tag.c_str() + document_start_tag.size())) == buffer_end)
+		if ((document_start = find(unread_data, buffer_end, document_start_tag)) == buffer_end)
 			{
+			/*
+				A memory mapped file is all in memory, so this is end of file.
+			*/
+			if (mapped != nullptr)
+				{
+				object.primary_key = object.contents = slice();
+				return;
+				}
+
 			/*
 				We might be at the end of a buffer and half-way through a tag so we copy the remainder of the file to the
 				start of the buffer and fill the remainder.
@@ -101,7 +176,7 @@ namespace JASS
 			fetch(buffer_end, buffer + buffer_size - buffer_end);
 			unread_data = buffer;
 		
-			if ((document_start = std::search(unread_data, buffer_end, document_start_tag.c_str(), document_start_tag.c_str() + document_start_tag.size())) == buffer_end)
+			if ((document_start = find(unread_data, buffer_end, document_start_tag)) == buffer_end)
 				{
 				/*
 					Most probably end of file.
@@ -116,8 +191,17 @@ namespace JASS
 			Find the end tag
 		*/
 		uint8_t *document_end;
-		if ((document_end = std::search(document_start, buffer_end, document_end_tag.c_str(), document_end_tag.c_str() + document_end_tag.size())) == buffer_end)
+		if ((document_end = find(document_start, buffer_end, document_end_tag)) == buffer_end)
 			{
+			/*
+				As above, a memory mapped file is all in memory, so this is end of file.
+			*/
+			if (mapped != nullptr)
+				{
+				object.primary_key = object.contents = slice();
+				return;
+				}
+
 			/*
 				This happens when we move find the start tag in the buffer, but the end tag is not in memory.  We play the 
 				same game as above and shift the start tag to the start of the buffer.
@@ -126,7 +210,7 @@ namespace JASS
 			buffer_end -= document_start - buffer;
 			fetch(buffer_end, buffer_size - (buffer_end - buffer));
 			document_start = buffer;
-			if ((document_end = std::search(document_start, buffer_end, document_end_tag.c_str(), document_end_tag.c_str() + document_end_tag.size())) == buffer_end)
+			if ((document_end = find(document_start, buffer_end, document_end_tag)) == buffer_end)
 				{
 				/*
 					We are either at end of file of have a document that is too large to index (so pretend EOF)
@@ -142,11 +226,11 @@ namespace JASS
 			Extract the document's primary key.
 		*/
 		uint8_t *document_id_end = document_end;
-		uint8_t *document_id_start = std::search(document_start, document_end, primary_key_start_tag.c_str(), primary_key_start_tag.c_str() + primary_key_start_tag.size());
+		uint8_t *document_id_start = find(document_start, document_end, primary_key_start_tag);
 		if (document_id_start != document_end)
 			{
 			document_id_start += primary_key_start_tag.size();
-			document_id_end = std::search(document_id_start, document_end, primary_key_end_tag.c_str(), primary_key_end_tag.c_str() + primary_key_end_tag.size());
+			document_id_end = find(document_id_start, document_end, primary_key_end_tag);
 
 			/*
 				Trim whitespace from the start and end of the primary key.
@@ -158,13 +242,24 @@ namespace JASS
 			}
 
 		/*
-			Copy the id into the document object and get the document
+			Copy the id into the document object and get the document (or point to them in zero copy mode)
 		*/
-		object.contents = slice(object.contents_allocator, document_start, document_end);
-		if (document_id_end == document_end)
-			object.primary_key = slice(object.primary_key_allocator, "Unknown");
+		if (zero_copy)
+			{
+			object.contents = slice(document_start, document_end);
+			if (document_id_end == document_end)
+				object.primary_key = slice(object.primary_key_allocator, "Unknown");
+			else
+				object.primary_key = slice(document_id_start, document_id_end);
+			}
 		else
-			object.primary_key = slice(object.primary_key_allocator, document_id_start, document_id_end);
+			{
+			object.contents = slice(object.contents_allocator, document_start, document_end);
+			if (document_id_end == document_end)
+				object.primary_key = slice(object.primary_key_allocator, "Unknown");
+			else
+				object.primary_key = slice(object.primary_key_allocator, document_id_start, document_id_end);
+			}
 		}
 		
 	/*
@@ -249,6 +344,64 @@ namespace JASS
 		slicer_13.read(indexable_object);
 		JASS_assert(indexable_object.contents.size() == 92);
 
+		/*
+			Zero copy gives the same documents, each pointing into the buffer
+		*/
+		buffer.reset(new instream_memory((uint8_t *)unittest_data::ten_documents.c_str(), unittest_data::ten_documents.size()));
+		instream_document_trec zero_copy_slicer(buffer, 200, "DOC", "DOCNO");
+		zero_copy_slicer.set_zero_copy(true);
+		const std::string *expected[] = {&unittest_data::ten_document_1, &unittest_data::ten_document_2, &unittest_data::ten_document_3, &unittest_data::ten_document_4, &unittest_data::ten_document_5, &unittest_data::ten_document_6, &unittest_data::ten_document_7, &unittest_data::ten_document_8, &unittest_data::ten_document_9, &unittest_data::ten_document_10};
+		for (const auto *which : expected)
+			{
+			zero_copy_slicer.read(indexable_object);
+			JASS_assert(std::string((char *)&indexable_object.contents[0], indexable_object.contents.size()) == *which);
+			JASS_assert(indexable_object.contents.address() >= zero_copy_slicer.buffer && indexable_object.contents.address() < zero_copy_slicer.buffer_end);
+			}
+		zero_copy_slicer.read(indexable_object);
+		JASS_assert(indexable_object.contents.size() == 0);
+
+		/*
+			From a memory mapped file the documents are in the mapping
+		*/
+		auto filename = file::mkstemp("jass");
+		file::write_entire_file(filename, unittest_data::ten_documents);
+		do
+			{
+			std::shared_ptr<instream> mapping(new instream_mmap(filename));
+			instream_document_trec mapped_slicer(mapping);
+			mapped_slicer.set_zero_copy(true);
+			const uint8_t *file_start = static_cast<instream_mmap *>(mapping.get())->address();
+			for (const auto *which : expected)
+				{
+				mapped_slicer.read(indexable_object);
+				JASS_assert(std::string((char *)&indexable_object.contents[0], indexable_object.contents.size()) == *which);
+				JASS_assert(indexable_object.contents.address() >= file_start && indexable_object.contents.address() < file_start + unittest_data::ten_documents.size());
+				}
+			mapped_slicer.read(indexable_object);
+			JASS_assert(indexable_object.contents.size() == 0);
+			}
+		while (0);
+		(void)remove(filename.c_str());
+
+		/*
+			find() gives the same answer as std::search() wherever the tag is (including either side of each 32-byte block)
+		*/
+		std::string tag = "</DOCNO>";
+		for (size_t length = 0; length < 100; length++)
+			for (size_t where = 0; where <= length; where++)
+				{
+				std::string haystack;
+				while (haystack.size() < length)
+					haystack += "</DOC></DOCNO <";							// lots of near misses
+				haystack.resize(length);
+				if (where + tag.size() <= length)
+					haystack.replace(where, tag.size(), tag);
+
+				uint8_t *start = (uint8_t *)&haystack[0];
+				uint8_t *end = start + haystack.size();
+				JASS_assert(find(start, end, tag) == std::search(start, end, tag.begin(), tag.end()));
+				}
+
 		/*
 			Success
 		*/	
@@ -19,6 +19,7 @@
 
 #include "slice.h"
 #include "instream.h"
+#include "instream_mmap.h"
 
 namespace JASS
 	{
@@ -30,7 +31,11 @@ namespace JASS
 		@brief Child class of instream for creating documents from TREC pre-web (i.e. news articles) data.
 		@details Connect an object of this class to an input stream and it will return TREC new-article formatted documents
 		one per read.  This is done by looking for \<DOC> and \</DOC> tags in the source stream.  Document primary keys are
-		assumed to be between \<DOCNO> and \</DOCNO> tags.
+		assumed to be between \<DOCNO> and \</DOCNO> tags.  The tags are found 32 bytes at a time by comparing the first and last
+		bytes of the tag at each position (with AVX2) and checking the whole tag only where both match.  By default the document
+		is copied into the document's allocator, but with set_zero_copy() the document is a slice of the internal buffer instead,
+		which saves a copy of the collection if each document is finished with before the next read().  If the source is an
+		instream_mmap then the buffer is the memory mapped file, so (with set_zero_copy()) documents are never copied at all.
 	*/
 	class instream_document_trec : public instream
 		{
@@ -47,6 +52,9 @@ namespace JASS
 			std::string primary_key_start_tag;			///< The primary key's start tag ("<DOCNO>" by default)
 			std::string primary_key_end_tag;				///< The primary key's end tag ("</DOCNO>" by default)
 
+			bool zero_copy;									///< Should documents be slices of buffer (true) or copies (false)?
+			instream_mmap *mapped;							///< If source is a memory mapped file then this is it (and buffer is the file), else nullptr
+
 		protected:
 			/*
 				INSTREAM_DOCUMENT_TREC::INSTREAM_DOCUMENT_TREC()
@@ -72,6 +80,19 @@ namespace JASS
 			*/
 			void set_tags(const std::string &document_tag, const std::string &primary_key_tag);
 
+			/*
+				INSTREAM_DOCUMENT_TREC::FIND()
+				------------------------------
+			*/
+			/*!
+				@brief Find the first occurrence of tag in the memory from start to end.
+				@param start [in] The start of the memory to search.
+				@param end [in] The end of the memory to search.
+				@param tag [in] The string to look for.
+				@return A pointer to the start of the first occurrence of tag, or end if it does not occur.
+			*/
+			static uint8_t *find(uint8_t *start, uint8_t *end, const std::string &tag);
+
 			/*
 				INSTREAM_DOCUMENT_TREC::FETCH()
 				-------------------------------
@@ -118,6 +139,21 @@ namespace JASS
 			*/
 			virtual ~instream_document_trec();
 
+			/*
+				INSTREAM_DOCUMENT_TREC::SET_ZERO_COPY()
+				---------------------------------------
+			*/
+			/*!
+				@brief Return documents as slices of the internal buffer rather than copying them.
+				@details The document's contents and primary key are then only valid until the next call to read(), and this instream
+				cannot be the source of another instream (as fetch() relies on the copy).
+				@param zero_copy [in] true to return slices of the internal buffer, false (the default) to copy.
+			*/
+			void set_zero_copy(bool zero_copy)
+				{
+				this->zero_copy = zero_copy;
+				}
+
 			/*
 				INSTREAM_DOCUMENT_TREC::READ()
 				------------------------------
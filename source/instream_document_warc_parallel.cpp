@@ -0,0 +1,675 @@
+/*
+	INSTREAM_DOCUMENT_WARC_PARALLEL.CPP
+	-----------------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef _MSC_VER
+	#include <sys/mman.h>
+#endif
+
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+
+#include "zlib.h"
+#include "ascii.h"
+#include "asserts.h"
+#include "instream_document_warc_parallel.h"
+
+namespace JASS
+	{
+	/*
+		IS_GZIP_MEMBER()
+		----------------
+	*/
+	/*!
+		@brief Does a gzip member (magic number 1f 8b, deflate, and no reserved flags) start at at?
+		@param at [in] The candidate.
+		@param end [in] The end of the data.
+		@return true if it looks like a gzip member header, else false.
+	*/
+	static bool is_gzip_member(const uint8_t *at, const uint8_t *end)
+		{
+		return end - at >= 10 && at[0] == 0x1F && at[1] == 0x8B && at[2] == 0x08 && (at[3] & 0xE0) == 0;
+		}
+
+	/*
+		STARTS_WITH_NOCASE()
+		--------------------
+	*/
+	/*!
+		@brief Does the (lowercase) ASCII word start at at (ignoring case) and end there (followed by a character that isn't alphanumeric)?
+		@param at [in] The candidate.
+		@param end [in] The end of the data.
+		@param word [in] The lowercase word.
+		@return true if word is at at, else false.
+	*/
+	static bool starts_with_nocase(const uint8_t *at, const uint8_t *end, const char *word)
+		{
+		for (; *word != '\0'; at++, word++)
+			if (at >= end || ascii::tolower(*at) != static_cast<uint8_t>(*word))
+				return false;
+
+		return at >= end || !ascii::isalnum(*at);
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::INSTREAM_DOCUMENT_WARC_PARALLEL()
+		------------------------------------------------------------------
+	*/
+	instream_document_warc_parallel::instream_document_warc_parallel(const std::string &filename, size_t threads, size_t unit_size) :
+		instream(),
+		current_file(0),
+		threads(threads),
+		unit_size(unit_size == 0 ? 1 : unit_size),
+		contents(nullptr),
+		file_length(0),
+		gzipped(false),
+		stopping(false),
+		current_unit(0),
+		expected_start(0),
+		current_document(0),
+		zero_copy(false)
+		{
+		if (std::filesystem::is_directory(std::filesystem::path(filename)))
+			{
+			for (const auto &entry : std::filesystem::directory_iterator(filename))
+				filenames.push_back(entry.path().string());
+			}
+		else
+			filenames.push_back(filename);
+
+		if (filenames.size() != 0)
+			open_file(filenames[0]);
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::OPEN_FILE()
+		--------------------------------------------
+	*/
+	void instream_document_warc_parallel::open_file(const std::string &filename)
+		{
+		current_unit = 0;
+		expected_start = 0;
+		mapping = std::make_unique<file::file_read_only>();
+		file_length = mapping->open(filename, false);
+		mapping->read_entire_file(contents);
+		if (file_length == 0)
+			{
+			contents = nullptr;
+			return;
+			}
+
+#ifndef _MSC_VER
+		madvise(const_cast<uint8_t *>(contents), file_length, MADV_SEQUENTIAL);
+		madvise(const_cast<uint8_t *>(contents), file_length, MADV_WILLNEED);
+#endif
+
+		/*
+			Cut the file into units
+		*/
+		const uint8_t *end = contents + file_length;
+		gzipped = is_gzip_member(contents, end);
+		unit_start.push_back(0);
+		if (gzipped)
+			{
+			/*
+				Start a unit at the first gzip member header at or after unit_size bytes from the start of the last unit
+			*/
+			const uint8_t *at = contents + unit_size;
+			while (at < end)
+				{
+				if ((at = static_cast<const uint8_t *>(memchr(at, 0x1F, end - at))) == nullptr)
+					break;
+				if (is_gzip_member(at, end))
+					{
+					unit_start.push_back(at - contents);
+					at += unit_size;
+					}
+				else
+					at++;
+				}
+			}
+		else
+			{
+			/*
+				Start a unit at the first record at or after unit_size bytes from the start of the last unit
+			*/
+			record_header header;
+			const uint8_t *at = contents;
+			while ((at = next_record(at, end, header)) != nullptr && at < end)
+				if (static_cast<size_t>(at - contents) - unit_start.back() >= unit_size)
+					unit_start.push_back(at - contents);
+			}
+		unit_start.push_back(file_length);
+
+		/*
+			Start the threads
+		*/
+		size_t units = unit_start.size() - 1;
+		size_t workers_needed = (std::max)(static_cast<size_t>(1), (std::min)(threads, units));
+		for (size_t which = 0; which < workers_needed; which++)
+			finished.push_back(std::make_unique<queue_spsc<std::unique_ptr<unit>>>(4));
+		for (size_t which = 0; which < workers_needed; which++)
+			workers.push_back(thread(work, this, which));
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::CLOSE_FILE()
+		---------------------------------------------
+	*/
+	void instream_document_warc_parallel::close_file(void)
+		{
+		stopping = true;
+		for (auto &which : workers)
+			which.join();
+		stopping = false;
+
+		workers.clear();
+		finished.clear();
+		unit_start.clear();
+		current.reset();
+		contents = nullptr;
+		file_length = 0;
+		mapping.reset();
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::~INSTREAM_DOCUMENT_WARC_PARALLEL()
+		-------------------------------------------------------------------
+	*/
+	instream_document_warc_parallel::~instream_document_warc_parallel()
+		{
+		close_file();
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::NEXT_RECORD()
+		----------------------------------------------
+	*/
+	const uint8_t *instream_document_warc_parallel::next_record(const uint8_t *at, const uint8_t *end, record_header &header)
+		{
+		/*
+			Find the "WARC/" at the start of the record (skipping the blank lines between records)
+		*/
+		while (at < end && (*at == '\r' || *at == '\n'))
+			at++;
+		while (end - at >= 5 && memcmp(at, "WARC/", 5) != 0)
+			{
+			if ((at = static_cast<const uint8_t *>(memchr(at, '\n', end - at))) == nullptr)
+				return nullptr;
+			at++;
+			}
+		if (end - at < 5)
+			return nullptr;
+
+		/*
+			Decode each "name: value" header line up to the blank line
+		*/
+		header.start = at;
+		header.primary_key = nullptr;
+		header.primary_key_length = 0;
+		header.content_length = 0;
+		for (const uint8_t *line = at; ; )
+			{
+			const uint8_t *end_of_line = static_cast<const uint8_t *>(memchr(line, '\n', end - line));
+			if (end_of_line == nullptr)
+				return nullptr;			// truncated
+			const uint8_t *next_line = end_of_line + 1;
+			if (end_of_line > line && *(end_of_line - 1) == '\r')
+				end_of_line--;
+
+			if (end_of_line == line)
+				{
+				header.content = next_line;
+				break;
+				}
+
+			const uint8_t *colon = static_cast<const uint8_t *>(memchr(line, ':', end_of_line - line));
+			if (colon != nullptr)
+				{
+				size_t name_length = colon - line;
+				const uint8_t *value = colon + 1;
+				const uint8_t *value_end = end_of_line;
+				while (value < value_end && ascii::isspace(*value))
+					value++;
+				while (value_end > value && ascii::isspace(*(value_end - 1)))
+					value_end--;
+
+				if (name_length == 14 && memcmp(line, "Content-Length", 14) == 0)
+					header.content_length = strtoull(reinterpret_cast<const char *>(value), nullptr, 10);
+				else if ((name_length == 12 && memcmp(line, "WARC-TREC-ID", 12) == 0) || (name_length == 12 && memcmp(line, "ClueWeb22-ID", 12) == 0))
+					{
+					header.primary_key = value;
+					header.primary_key_length = value_end - value;
+					}
+				}
+			line = next_line;
+			}
+
+		header.content_length = (std::min)(header.content_length, static_cast<size_t>(end - header.content));
+		return header.content + header.content_length;
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::STRIP_HTML()
+		---------------------------------------------
+	*/
+	uint8_t *instream_document_warc_parallel::strip_html(uint8_t *start, uint8_t *end)
+		{
+		uint8_t *into = start;
+		uint8_t *from = start;
+
+		while (from < end)
+			{
+			/*
+				Copy the text up to the next '<'
+			*/
+			uint8_t *open = static_cast<uint8_t *>(memchr(from, '<', end - from));
+			if (open == nullptr)
+				open = end;
+			memmove(into, from, open - from);
+			into += open - from;
+			if (open == end)
+				break;
+
+			/*
+				A '<' that can't start markup (such as "1 < 2") is text
+			*/
+			uint8_t next = open + 1 < end ? open[1] : ' ';
+			if (!ascii::isalpha(next) && next != '/' && next != '!' && next != '?')
+				{
+				*into++ = '<';
+				from = open + 1;
+				continue;
+				}
+
+			/*
+				Skip the markup.  The contents of a comment, script, or style can include '>' (and "<b>") so they are skipped to their end.
+			*/
+			const char *element = starts_with_nocase(open + 1, end, "script") ? "script" : starts_with_nocase(open + 1, end, "style") ? "style" : nullptr;
+			if (end - open >= 4 && memcmp(open, "<!--", 4) == 0)
+				{
+				uint8_t *close = open + 4;
+				while ((close = static_cast<uint8_t *>(memchr(close, '-', end - close))) != nullptr && (end - close < 3 || memcmp(close, "-->", 3) != 0))
+					close++;
+				from = close == nullptr ? end : close + 3;
+				}
+			else
+				{
+				uint8_t *close = open + 1;
+				if (element != nullptr)
+					while ((close = static_cast<uint8_t *>(memchr(close, '<', end - close))) != nullptr && !(close + 1 < end && close[1] == '/' && starts_with_nocase(close + 2, end, element)))
+						close++;
+				if (close != nullptr)
+					close = static_cast<uint8_t *>(memchr(close, '>', end - close));
+				from = close == nullptr ? end : close + 1;
+				}
+
+			*into++ = ' ';
+			}
+
+		return into;
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::DECOMPRESS()
+		---------------------------------------------
+	*/
+	void instream_document_warc_parallel::decompress(unit &into, size_t which) const
+		{
+		size_t at = unit_start[which];
+		size_t end = unit_start[which + 1];
+
+		into.start = at;
+		into.failed = false;
+
+		if (!gzipped)
+			{
+			into.data.assign(contents + at, contents + end);
+			into.next = end;
+			return;
+			}
+
+		/*
+			Decompress one whole gzip member after another until we reach the start of a later unit (normally the next one)
+		*/
+		z_stream stream = {};
+		if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)			// gzip header, checked CRC
+			{
+			into.failed = true;
+			return;
+			}
+
+		size_t used = 0;
+		into.data.resize((end - at) * 4 + 64 * 1024);
+		do
+			{
+			if (!is_gzip_member(contents + at, contents + file_length))
+				{
+				at = file_length;				// trailing junk (such as padding) at the end of the file
+				break;
+				}
+
+			inflateReset(&stream);
+			stream.next_in = const_cast<Bytef *>(contents + at);
+			stream.avail_in = static_cast<uInt>((std::min)(file_length - at, static_cast<size_t>((std::numeric_limits<uInt>::max)())));
+			int state;
+			do
+				{
+				if (into.data.size() - used < 64 * 1024)
+					into.data.resize(into.data.size() * 2);
+				stream.next_out = into.data.data() + used;
+				stream.avail_out = static_cast<uInt>((std::min)(into.data.size() - used, static_cast<size_t>((std::numeric_limits<uInt>::max)())));
+				state = inflate(&stream, Z_NO_FLUSH);
+				used = stream.next_out - into.data.data();
+				}
+			while (state == Z_OK);
+
+			if (state != Z_STREAM_END)
+				{
+				into.failed = true;
+				break;
+				}
+			at = stream.next_in - contents;
+			}
+		while (at < file_length && (at < end || !std::binary_search(unit_start.begin(), unit_start.end(), at)));
+
+		inflateEnd(&stream);
+		into.data.resize(used);
+		into.next = at;
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::PARSE()
+		----------------------------------------
+	*/
+	void instream_document_warc_parallel::parse(unit &into)
+		{
+		const uint8_t *at = into.data.data();
+		const uint8_t *end = at + into.data.size();
+		const uint8_t *next;
+		record_header header;
+
+		while ((next = next_record(at, end, header)) != nullptr)
+			{
+			if (header.primary_key != nullptr)
+				{
+				uint8_t *body = const_cast<uint8_t *>(header.content);
+				uint8_t *body_end = body + header.content_length;
+
+				/*
+					Skip the HTTP header (up to the first blank line)
+				*/
+				if (body_end - body >= 5 && memcmp(body, "HTTP/", 5) == 0)
+					{
+					uint8_t *line = body;
+					while ((line = static_cast<uint8_t *>(memchr(line, '\n', body_end - line))) != nullptr)
+						{
+						line++;
+						if (line < body_end && *line == '\n')
+							{
+							line++;
+							break;
+							}
+						if (line + 1 < body_end && line[0] == '\r' && line[1] == '\n')
+							{
+							line += 2;
+							break;
+							}
+						}
+					body = line == nullptr ? body_end : line;
+					}
+
+				body_end = strip_html(body, body_end);
+				into.documents.emplace_back(slice(const_cast<uint8_t *>(header.primary_key), header.primary_key_length), slice(body, body_end));
+				}
+			at = next;
+			}
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::WORK()
+		---------------------------------------
+	*/
+	void instream_document_warc_parallel::work(instream_document_warc_parallel *me, size_t first)
+		{
+		size_t units = me->unit_start.size() - 1;
+		size_t threads = me->finished.size();
+
+		for (size_t which = first; which < units; which += threads)
+			{
+			auto into = std::make_unique<unit>();
+			me->decompress(*into, which);
+			if (!into->failed)
+				parse(*into);
+
+			if (!me->finished[first]->push(into, me->stopping))
+				return;
+			}
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::READ()
+		---------------------------------------
+	*/
+	void instream_document_warc_parallel::read(document &object)
+		{
+		for (;;)
+			{
+			if (current != nullptr && current_document < current->documents.size())
+				{
+				const auto &[primary_key, contents] = current->documents[current_document++];
+				if (zero_copy)
+					{
+					object.primary_key = primary_key;
+					object.contents = contents;
+					}
+				else
+					{
+					object.primary_key = slice(object.primary_key_allocator, primary_key);
+					object.contents = slice(object.contents_allocator, contents);
+					}
+				return;
+				}
+
+			/*
+				Get the next unit, skipping those already covered by the unit before (because they started at a false gzip header)
+			*/
+			current.reset();
+			size_t units = unit_start.size() == 0 ? 0 : unit_start.size() - 1;
+			while (current_unit < units)
+				{
+				auto next = finished[current_unit % finished.size()]->pop();
+				current_unit++;
+
+				if (next->start < expected_start)
+					continue;
+				if (next->failed)
+					{
+					printf("JASS::instream_document_warc_parallel::read failure trying to decompress at byte %zu\n", next->start);
+					current_unit = units;
+					break;
+					}
+
+				expected_start = next->next;
+				current = std::move(next);
+				current_document = 0;
+				break;
+				}
+
+			if (current == nullptr)
+				{
+				/*
+					At the end of this file so move on to the next (if there is one)
+				*/
+				if (current_file + 1 < filenames.size())
+					{
+					close_file();
+					open_file(filenames[++current_file]);
+					continue;
+					}
+
+				object.primary_key = object.contents = slice();
+				return;
+				}
+			}
+		}
+
+	/*
+		GZIP()
+		------
+	*/
+	/*!
+		@brief Compress data as a gzip member (for the unit test).
+		@param data [in] The data to compress.
+		@param level [in] The zlib compression level (Z_NO_COMPRESSION stores the data as is).
+		@return The gzip member.
+	*/
+	static std::string gzip(const std::string &data, int level = Z_DEFAULT_COMPRESSION)
+		{
+		z_stream stream = {};
+		deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		std::string compressed(deflateBound(&stream, data.size()), '\0');
+		stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+		stream.avail_in = static_cast<uInt>(data.size());
+		stream.next_out = reinterpret_cast<Bytef *>(&compressed[0]);
+		stream.avail_out = static_cast<uInt>(compressed.size());
+		deflate(&stream, Z_FINISH);
+		compressed.resize(stream.total_out);
+		deflateEnd(&stream);
+		return compressed;
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC_PARALLEL::UNITTEST()
+		-------------------------------------------
+	*/
+	void instream_document_warc_parallel::unittest(void)
+		{
+		/*
+			A warcinfo record then some responses (the third of which contains a gzip header)
+		*/
+		auto record = [](const std::string &key, const std::string &content)
+			{
+			return
+				"WARC/1.0\r\n"
+				"WARC-Type: " + std::string(key == "" ? "warcinfo" : "response") + "\r\n" +
+				(key == "" ? std::string("") : "WARC-TREC-ID: " + key + "\r\n") +
+				"Content-Type: application/http; msgtype=response\r\n"
+				"Content-Length: " + std::to_string(content.size()) + "\r\n"
+				"\r\n" +
+				content +
+				"\r\n\r\n";
+			};
+		std::string html = "<html><head><title>Page</title><style>p {color:red}</style><script>var x = \"<b>\";</script></head><body><!-- a <comment> --><p>Hello world</p> 1 < 2</body></html>";
+		std::string text = "   Page       Hello world  1 < 2  ";
+		std::string false_header = std::string("\x1f\x8b\x08\x00", 4) + "0123456789";
+
+		std::vector<std::string> records;
+		std::vector<std::pair<std::string, std::string>> answer;
+		records.push_back(record("", "software: JASS\r\n"));
+		for (size_t which = 0; which < 6; which++)
+			{
+			std::string key = "clueweb-" + std::to_string(which);
+			std::string body = which == 2 ? false_header : "Document " + std::to_string(which);
+			records.push_back(record(key, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\n" + body + html));
+			answer.push_back(std::make_pair(key, body + text));
+			}
+
+		/*
+			Write it as a .warc.gz (one gzip member per record, the third stored so the false header is in the file) and as a .warc
+		*/
+		std::string compressed;
+		std::string uncompressed;
+		for (size_t which = 0; which < records.size(); which++)
+			{
+			compressed += gzip(records[which], which == 3 ? Z_NO_COMPRESSION : Z_DEFAULT_COMPRESSION);
+			uncompressed += records[which];
+			}
+		JASS_assert(std::search(compressed.begin(), compressed.end(), false_header.begin(), false_header.begin() + 4) != compressed.end());
+
+		auto gz_filename = file::mkstemp("jass");
+		auto plain_filename = file::mkstemp("jass");
+		file::write_entire_file(gz_filename, compressed);
+		file::write_entire_file(plain_filename, uncompressed);
+
+		/*
+			Check that both give the right documents, in order, however they are cut up and however many threads there are
+		*/
+		for (const auto *filename : {&gz_filename, &plain_filename})
+			for (size_t unit_size : {static_cast<size_t>(1), static_cast<size_t>(300), static_cast<size_t>(1024 * 1024)})
+				for (size_t threads = 1; threads <= 3; threads++)
+					{
+					instream_document_warc_parallel reader(*filename, threads, unit_size);
+					reader.set_zero_copy(threads == 2);
+					document got;
+					for (const auto &[key, contents] : answer)
+						{
+						got.rewind();
+						reader.read(got);
+						JASS_assert(std::string(reinterpret_cast<char *>(got.primary_key.address()), got.primary_key.size()) == key);
+						JASS_assert(std::string(reinterpret_cast<char *>(got.contents.address()), got.contents.size()) == contents);
+						}
+					reader.read(got);
+					JASS_assert(got.isempty());
+					}
+
+		/*
+			Destroy before the threads have finished
+		*/
+		auto unfinished = std::make_unique<instream_document_warc_parallel>(gz_filename, 2, 1);
+		document first;
+		unfinished->read(first);
+		JASS_assert(!first.isempty());
+		unfinished.reset();
+
+		/*
+			A directory of WARC files (compressed and not) gives the documents of each file in turn
+		*/
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "jass_instream_document_warc_parallel_unittest";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directory(directory);
+		std::vector<std::pair<std::string, std::string>> directory_answer;
+		for (size_t which = 0; which < 3; which++)
+			{
+			std::filesystem::path part = directory / ("part_" + std::to_string(which) + (which == 1 ? ".warc" : ".warc.gz"));
+			file::write_entire_file(part.string(), which == 1 ? uncompressed : compressed);
+			directory_answer.insert(directory_answer.end(), answer.begin(), answer.end());		// each file holds the same documents so the order of the files doesn't matter
+			}
+
+		for (size_t threads = 1; threads <= 3; threads++)
+			{
+			instream_document_warc_parallel reader(directory.string(), threads, 300);
+			document got;
+			for (const auto &[key, contents] : directory_answer)
+				{
+				got.rewind();
+				reader.read(got);
+				JASS_assert(std::string(reinterpret_cast<char *>(got.primary_key.address()), got.primary_key.size()) == key);
+				JASS_assert(std::string(reinterpret_cast<char *>(got.contents.address()), got.contents.size()) == contents);
+				}
+			reader.read(got);
+			JASS_assert(got.isempty());
+			}
+		std::filesystem::remove_all(directory);
+
+		(void)remove(gz_filename.c_str());
+		(void)remove(plain_filename.c_str());
+
+		/*
+			A file that doesn't exist has no documents
+		*/
+		instream_document_warc_parallel missing(gz_filename, 2);
+		document none;
+		missing.read(none);
+		JASS_assert(none.isempty());
+
+		puts("instream_document_warc_parallel::PASSED");
+		}
+	}
@@ -0,0 +1,240 @@
+/*
+	INSTREAM_DOCUMENT_WARC_PARALLEL.H
+	---------------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Extract documents from a WARC file (or a .warc.gz file, or a directory of them) decompressing and parsing records in parallel.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "threads.h"
+#include "instream.h"
+#include "queue_spsc.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INSTREAM_DOCUMENT_WARC_PARALLEL
+		-------------------------------------
+	*/
+	/*!
+		@brief Extract documents from a WARC file (or a .warc.gz file, or a directory of them) decompressing and parsing records in parallel.
+		@details The file is memory mapped and cut into units of about unit_size bytes.  In a .warc.gz file each record is (usually) its own
+		gzip member, so a unit starts at a gzip member header (1f 8b 08) found at or after each multiple of unit_size, and in an uncompressed
+		WARC file the units start at a record (found by skipping from record to record using the Content-Length).  Thread t of T decompresses
+		units t, t + T, t + 2T, ... then splits them into records and strips the HTTP header and the HTML markup (tags, comments, scripts,
+		and styles) from each, and passes them through its own queue_spsc.  read() takes unit u from queue u % T, so the documents come out
+		in file order and the docids are the same however many threads are used.
+
+		The gzip header magic number can also appear inside compressed data.  A unit that starts at such a false boundary fails to decompress
+		(or decompresses to rubbish), but the unit before it decompresses whole members from its start, so it runs past the false boundary
+		and carries on until it reaches the start of a later unit.  read() then skips over the units it has already covered.
+
+		Only records with a WARC-TREC-ID (or ClueWeb22-ID) are documents (so warcinfo and request records are skipped).
+
+		Given a directory, the files are read one after the other (in directory order, as instream_directory_iterator does), each in parallel,
+		so a collection gives the same documents whether it is one file or many.
+	*/
+	class instream_document_warc_parallel : public instream
+		{
+		protected:
+			/*
+				CLASS INSTREAM_DOCUMENT_WARC_PARALLEL::RECORD_HEADER
+				----------------------------------------------------
+			*/
+			/*!
+				@brief The parts of a WARC record header we need.
+			*/
+			class record_header
+				{
+				public:
+					const uint8_t *start;				///< The start of the record ("WARC/")
+					const uint8_t *primary_key;		///< The document's primary key (or nullptr if the record doesn't have one)
+					size_t primary_key_length;			///< The length of the primary key
+					const uint8_t *content;				///< The start of the record's content (the HTTP response)
+					size_t content_length;				///< The length of the content
+				};
+
+			/*
+				CLASS INSTREAM_DOCUMENT_WARC_PARALLEL::UNIT
+				-------------------------------------------
+			*/
+			/*!
+				@brief A unit of work, the documents in part of the file.
+			*/
+			class unit
+				{
+				public:
+					size_t start;										///< Where in the file the unit starts
+					size_t next;										///< Where in the file the unit after this one starts (the end of the last gzip member decompressed)
+					bool failed;										///< Did the unit fail to decompress?
+					std::vector<uint8_t> data;						///< The (decompressed) records
+					std::vector<std::pair<slice, slice>> documents;	///< The primary key and contents of each document (pointing into data)
+				};
+
+		protected:
+			std::vector<std::string> filenames;			///< The files to read (one, or those in the directory)
+			size_t current_file;								///< The file being read (an index into filenames)
+			size_t threads;									///< The number of threads to decompress and parse each file with
+			size_t unit_size;									///< The number of bytes of a file to give a thread at a time
+
+			std::unique_ptr<file::file_read_only> mapping;	///< The memory mapped file
+			const uint8_t *contents;						///< The contents of the file
+			size_t file_length;								///< The length of the file
+			bool gzipped;										///< Is the file a (multi-member) gzip file?
+
+			std::vector<size_t> unit_start;				///< Where in the file each unit starts (then the length of the file)
+			std::vector<std::unique_ptr<queue_spsc<std::unique_ptr<unit>>>> finished;		///< The units decompressed and parsed by each thread
+			std::vector<thread> workers;					///< The threads
+			std::atomic<bool> stopping;					///< Set by the destructor to stop the threads before they are finished
+
+			size_t current_unit;								///< The next unit read() will take from a queue
+			size_t expected_start;							///< Where in the file the next unit read() uses must start (earlier units have been covered)
+			std::unique_ptr<unit> current;				///< The unit read() is returning documents from
+			size_t current_document;						///< The next document in current to return
+			bool zero_copy;									///< Should documents be slices of the unit (true) or copies (false)?
+
+		protected:
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::OPEN_FILE()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Map a file, cut it into units, and start the threads decompressing and parsing them.
+				@param filename [in] The WARC file, compressed with gzip (.warc.gz) or not.
+			*/
+			void open_file(const std::string &filename);
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::CLOSE_FILE()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Stop the threads (whether or not they have finished) and unmap the file.
+			*/
+			void close_file(void);
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::NEXT_RECORD()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Find and decode the header of the next WARC record.
+				@param at [in] Where to start looking.
+				@param end [in] The end of the data.
+				@param header [out] The record's header.
+				@return A pointer to the end of the record (or nullptr if there are no more records).
+			*/
+			static const uint8_t *next_record(const uint8_t *at, const uint8_t *end, record_header &header);
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::STRIP_HTML()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Remove the HTML tags, comments, scripts, and styles from a document (in place), replacing each with a space.
+				@param start [in/out] The document.
+				@param end [in] The end of the document.
+				@return The new end of the document.
+			*/
+			static uint8_t *strip_html(uint8_t *start, uint8_t *end);
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::DECOMPRESS()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Decompress a unit (or copy it if the file is not compressed).
+				@param into [in/out] The unit (into.start is the start of the unit).
+				@param which [in] The unit number.
+			*/
+			void decompress(unit &into, size_t which) const;
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::PARSE()
+				----------------------------------------
+			*/
+			/*!
+				@brief Split a unit into documents, stripping the HTTP header and the HTML from each.
+				@param into [in/out] The unit.
+			*/
+			static void parse(unit &into);
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::WORK()
+				---------------------------------------
+			*/
+			/*!
+				@brief A thread that decompresses and parses every threads-th unit (starting at first).
+				@param me [in] The instream_document_warc_parallel this thread is working for.
+				@param first [in] The first unit (and the queue to pass the units through).
+			*/
+			static void work(instream_document_warc_parallel *me, size_t first);
+
+		public:
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::INSTREAM_DOCUMENT_WARC_PARALLEL()
+				------------------------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param filename [in] The WARC file, compressed with gzip (.warc.gz) or not, or a directory of them.
+				@param threads [in] The number of threads to decompress and parse with.
+				@param unit_size [in] The number of bytes of the file to give a thread at a time.
+			*/
+			instream_document_warc_parallel(const std::string &filename, size_t threads = 1, size_t unit_size = 4 * 1024 * 1024);
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::~INSTREAM_DOCUMENT_WARC_PARALLEL()
+				-------------------------------------------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~instream_document_warc_parallel();
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::SET_ZERO_COPY()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Return documents as slices of the decompressed data rather than copying them.
+				@details The document's contents and primary key are then only valid until the next call to read().
+				@param zero_copy [in] true to return slices of the decompressed data, false (the default) to copy.
+			*/
+			void set_zero_copy(bool zero_copy)
+				{
+				this->zero_copy = zero_copy;
+				}
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::READ()
+				---------------------------------------
+			*/
+			/*!
+				@brief Read the next document from the file into document.
+				@param buffer [out] The next document in the file.
+			*/
+			virtual void read(document &buffer);
+
+			/*
+				INSTREAM_DOCUMENT_WARC_PARALLEL::UNITTEST()
+				-------------------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
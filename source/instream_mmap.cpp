@@ -0,0 +1,119 @@
+/*
+	INSTREAM_MMAP.CPP
+	-----------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _MSC_VER
+	#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+
+#include "asserts.h"
+#include "instream_mmap.h"
+
+namespace JASS
+	{
+	/*
+		INSTREAM_MMAP::INSTREAM_MMAP()
+		------------------------------
+	*/
+	instream_mmap::instream_mmap(const std::string &filename) :
+		instream(),
+		contents(nullptr),
+		file_length(0),
+		bytes_read(0)
+		{
+		/*
+			Map the file without reading it (populate = false) then ask for it to be read ahead, as it will be read from start to end
+		*/
+		file_length = mapping.open(filename, false);
+		mapping.read_entire_file(contents);
+		if (file_length == 0)
+			contents = nullptr;
+
+#ifndef _MSC_VER
+		if (contents != nullptr)
+			{
+			madvise(const_cast<uint8_t *>(contents), file_length, MADV_SEQUENTIAL);
+			madvise(const_cast<uint8_t *>(contents), file_length, MADV_WILLNEED);
+			}
+#endif
+		}
+
+	/*
+		INSTREAM_MMAP::READ()
+		---------------------
+	*/
+	void instream_mmap::read(document &document)
+		{
+		size_t bytes = (std::min)(document.contents.size(), file_length - bytes_read);
+
+		if (bytes == 0)
+			{
+			document.contents = slice();
+			return;
+			}
+
+		memcpy(document.contents.address(), contents + bytes_read, bytes);
+		document.contents.resize(bytes);
+		bytes_read += bytes;
+		}
+
+	/*
+		INSTREAM_MMAP::UNITTEST()
+		-------------------------
+	*/
+	void instream_mmap::unittest(void)
+		{
+		const char *example_file = "123456789012345678901234567890";			// sample to be written and read back
+		auto filename = file::mkstemp("jass");
+		file::write_entire_file(filename, example_file);
+
+		/*
+			NOTE: The scope is created so that the object is deleted before removal of the temporary file.
+		*/
+		do
+			{
+			instream_mmap reader(filename);
+
+			/*
+				The mapping is the file
+			*/
+			JASS_assert(reader.size() == strlen(example_file));
+			JASS_assert(memcmp(reader.address(), example_file, reader.size()) == 0);
+
+			/*
+				and it can be read like any other file
+			*/
+			document document;
+			document.contents = slice(document.contents_allocator, 16);
+			reader.read(document);
+			JASS_assert(document.contents.size() == 16);
+			JASS_assert(memcmp(document.contents.address(), example_file, 16) == 0);
+
+			reader.read(document);
+			JASS_assert(document.contents.size() == 14);
+			JASS_assert(memcmp(document.contents.address(), example_file + 16, 14) == 0);
+
+			reader.read(document);
+			JASS_assert(document.contents.size() == 0);
+			}
+		while (0);
+		(void)remove(filename.c_str());
+
+		/*
+			A file that does not exist is empty
+		*/
+		instream_mmap missing(filename);
+		JASS_assert(missing.size() == 0 && missing.address() == nullptr);
+		uint8_t byte;
+		JASS_assert(missing.fetch(&byte, 1) == 0);
+
+		puts("instream_mmap::PASSED");
+		}
+	}
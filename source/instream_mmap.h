@@ -0,0 +1,109 @@
+/*
+	INSTREAM_MMAP.H
+	---------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Subclass of instream for reading data from a disk file that is memory mapped (rather than read).
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <string>
+
+#include "file.h"
+#include "instream.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INSTREAM_MMAP
+		-------------------
+	*/
+	/*!
+		@brief Subclass of instream for reading data from a disk file that is memory mapped (rather than read).
+		@details The whole file is mapped read-only and the operating system is told it will be read sequentially (so it reads ahead and drops
+		pages already read).  read() copies out of the mapping, as instream_file would, but an instream that knows about this class (such as
+		instream_document_trec) can use address() and size() to split documents straight out of the mapping, so the collection is never
+		copied between the disk cache and the parser.
+	*/
+	class instream_mmap : public instream
+		{
+		protected:
+			file::file_read_only mapping;		///< The memory mapped file
+			const uint8_t *contents;			///< The contents of the file
+			size_t file_length;					///< The length of the file
+			size_t bytes_read;					///< The number of bytes that have been read from the file.
+
+		public:
+			/*
+				INSTREAM_MMAP::INSTREAM_MMAP()
+				------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param filename [in] The name of the file to use as the input stream
+			*/
+			instream_mmap(const std::string &filename);
+
+			/*
+				INSTREAM_MMAP::~INSTREAM_MMAP()
+				-------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~instream_mmap()
+				{
+				/* Nothing */
+				}
+
+			/*
+				INSTREAM_MMAP::ADDRESS()
+				------------------------
+			*/
+			/*!
+				@brief Return a pointer to the (read-only) contents of the file.
+				@return The start of the file in memory (or nullptr if the file could not be mapped, or is empty).
+			*/
+			const uint8_t *address(void) const
+				{
+				return contents;
+				}
+
+			/*
+				INSTREAM_MMAP::SIZE()
+				---------------------
+			*/
+			/*!
+				@brief Return the length of the file.
+				@return The length of the file in bytes.
+			*/
+			size_t size(void) const
+				{
+				return file_length;
+				}
+
+			/*
+				INSTREAM_MMAP::READ()
+				---------------------
+			*/
+			/*!
+				@brief Read buffer.contents.size() bytes of data into buffer.contents, resizing on eof.
+				@param buffer [out] buffer.contents.size() bytes of data are read from source into buffer which is resized to the number of bytes read on eof.
+			*/
+			virtual void read(document &buffer);
+
+			/*
+				INSTREAM_MMAP::UNITTEST()
+				-------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+}
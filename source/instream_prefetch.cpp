@@ -0,0 +1,178 @@
+/*
+	INSTREAM_PREFETCH.CPP
+	---------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+
+#include <string>
+#include <algorithm>
+
+#include "asserts.h"
+#include "unittest_data.h"
+#include "instream_memory.h"
+#include "instream_prefetch.h"
+#include "instream_document_trec.h"
+
+namespace JASS
+	{
+	/*
+		INSTREAM_PREFETCH::INSTREAM_PREFETCH()
+		--------------------------------------
+	*/
+	instream_prefetch::instream_prefetch(std::shared_ptr<instream> &source, size_t block_size, size_t block_count) :
+		instream(source),
+		blocks(block_count == 0 ? 1 : block_count),
+		full(blocks.size() + 1),
+		empty(blocks.size()),
+		stopping(false),
+		current(blocks.size()),
+		current_offset(0),
+		at_eof(false)
+		{
+		for (size_t which = 0; which < blocks.size(); which++)
+			{
+			blocks[which].data.resize(block_size == 0 ? 1 : block_size);
+			blocks[which].size = 0;
+			empty.push(which);
+			}
+
+		reader.push_back(thread(fill, this));
+		}
+
+	/*
+		INSTREAM_PREFETCH::~INSTREAM_PREFETCH()
+		---------------------------------------
+	*/
+	instream_prefetch::~instream_prefetch()
+		{
+		stopping = true;
+		for (auto &which : reader)
+			which.join();
+		}
+
+	/*
+		INSTREAM_PREFETCH::FILL()
+		-------------------------
+	*/
+	void instream_prefetch::fill(instream_prefetch *me)
+		{
+		size_t which;
+
+		/*
+			Wait for read() to hand back a block (or for the destructor to tell us to stop)
+		*/
+		while (me->empty.pop(which, me->stopping))
+			{
+			/*
+				Fill it and pass it on, a block of no bytes is the end of the source
+			*/
+			block &into = me->blocks[which];
+			into.size = me->source->fetch(into.data.data(), into.data.size());
+			me->full.push(which);
+
+			if (into.size == 0)
+				break;
+			}
+		}
+
+	/*
+		INSTREAM_PREFETCH::READ()
+		-------------------------
+	*/
+	void instream_prefetch::read(document &buffer)
+		{
+		uint8_t *into = static_cast<uint8_t *>(buffer.contents.address());
+		size_t wanted = buffer.contents.size();
+		size_t got = 0;
+
+		while (got < wanted && !at_eof)
+			{
+			if (current == blocks.size())
+				{
+				current = full.pop();
+				current_offset = 0;
+				if (blocks[current].size == 0)
+					{
+					at_eof = true;
+					break;
+					}
+				}
+
+			/*
+				Copy as much as we can from the current block, and once its all gone hand it back to the thread to re-fill
+			*/
+			block &from = blocks[current];
+			size_t bytes = (std::min)(wanted - got, from.size - current_offset);
+			memcpy(into + got, from.data.data() + current_offset, bytes);
+			got += bytes;
+			current_offset += bytes;
+
+			if (current_offset == from.size)
+				{
+				empty.push(current);
+				current = blocks.size();
+				}
+			}
+
+		if (got == 0)
+			buffer.contents = slice();
+		else
+			buffer.contents.resize(got);
+		}
+
+	/*
+		INSTREAM_PREFETCH::UNITTEST()
+		-----------------------------
+	*/
+	void instream_prefetch::unittest(void)
+		{
+		/*
+			Reading through tiny blocks (so the thread has to wait for read() to hand them back) gives the same bytes as the source
+		*/
+		std::shared_ptr<instream> memory(new instream_memory(unittest_data::ten_documents.c_str(), unittest_data::ten_documents.size()));
+		instream_prefetch reader(memory, 7, 3);
+
+		std::string got;
+		uint8_t chunk[16];
+		size_t bytes;
+		while ((bytes = reader.fetch(chunk, sizeof(chunk))) != 0)
+			{
+			JASS_assert(bytes == sizeof(chunk) || got.size() + bytes == unittest_data::ten_documents.size());			// only the last read is short
+			got.append(reinterpret_cast<char *>(chunk), bytes);
+			}
+		JASS_assert(got == unittest_data::ten_documents);
+		JASS_assert(reader.fetch(chunk, sizeof(chunk)) == 0);			// still at EOF
+
+		/*
+			As a stage in a pipeline (read | prefetch | split into documents)
+		*/
+		std::shared_ptr<instream> source(new instream_memory(unittest_data::ten_documents.c_str(), unittest_data::ten_documents.size()));
+		std::shared_ptr<instream> prefetcher(new instream_prefetch(source, 64, 2));
+		instream_document_trec slicer(prefetcher);
+		document document;
+		size_t documents = 0;
+		for (;;)
+			{
+			document.rewind();
+			slicer.read(document);
+			if (document.isempty())
+				break;
+			if (documents++ == 0)
+				JASS_assert(std::string((char *)&document.contents[0], document.contents.size()) == unittest_data::ten_document_1);
+			}
+		JASS_assert(documents == 10);
+
+		/*
+			Destroy before reaching the end of the source (the thread must stop)
+		*/
+		std::shared_ptr<instream> unfinished_source(new instream_memory(unittest_data::ten_documents.c_str(), unittest_data::ten_documents.size()));
+		auto unfinished = std::make_unique<instream_prefetch>(unfinished_source, 5, 2);
+		JASS_assert(unfinished->fetch(chunk, 3) == 3);
+		JASS_assert(memcmp(chunk, unittest_data::ten_documents.c_str(), 3) == 0);
+		unfinished.reset();
+
+		puts("instream_prefetch::PASSED");
+		}
+	}
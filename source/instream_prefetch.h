@@ -0,0 +1,115 @@
+/*
+	INSTREAM_PREFETCH.H
+	-------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Subclass of instream that reads ahead from its source in a thread of its own.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "threads.h"
+#include "instream.h"
+#include "queue_spsc.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INSTREAM_PREFETCH
+		-----------------------
+	*/
+	/*!
+		@brief Subclass of instream that reads ahead from its source in a thread of its own.
+		@details This makes a pipeline stage of everything before it in the pipeline, so that reading from disk and decompressing (for
+		example, read_file | de-zip) happen at the same time as whatever is after it (for example, | split into documents | index).  The
+		thread fills a fixed number of blocks and passes them through a queue_spsc to read(), which passes them back once they have been
+		copied out, so the read-ahead is bounded.  A block of no bytes marks the end of the source.
+	*/
+	class instream_prefetch : public instream
+		{
+		private:
+			/*
+				CLASS INSTREAM_PREFETCH::BLOCK
+				------------------------------
+			*/
+			/*!
+				@brief A block of data read from the source.
+			*/
+			class block
+				{
+				public:
+					std::vector<uint8_t> data;				///< The buffer
+					size_t size;								///< The number of bytes of data in the buffer (0 at end of source)
+				};
+
+		private:
+			std::vector<block> blocks;					///< The blocks (in the full queue, the empty queue, or being read from)
+			queue_spsc<size_t> full;					///< Blocks filled by the thread waiting for read()
+			queue_spsc<size_t> empty;					///< Blocks read() has finished with waiting for the thread
+			std::atomic<bool> stopping;				///< Set by the destructor to stop the thread before the end of the source
+			size_t current;								///< The block read() is copying from (or blocks.size() for none)
+			size_t current_offset;						///< How far into the current block read() has got
+			bool at_eof;									///< Has read() seen the end of the source?
+			std::vector<thread> reader;				///< The thread that reads from source
+
+		private:
+			/*
+				INSTREAM_PREFETCH::FILL()
+				-------------------------
+			*/
+			/*!
+				@brief The thread that fills empty blocks from the source until the end of the source (or until stopping).
+				@param me [in] The instream_prefetch this thread is reading for.
+			*/
+			static void fill(instream_prefetch *me);
+
+		public:
+			/*
+				INSTREAM_PREFETCH::INSTREAM_PREFETCH()
+				--------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param source [in] The instream to read ahead from.
+				@param block_size [in] The number of bytes to read from source at a time.
+				@param block_count [in] The number of blocks (so the read-ahead is at most block_size * block_count bytes).
+			*/
+			instream_prefetch(std::shared_ptr<instream> &source, size_t block_size = 1024 * 1024, size_t block_count = 16);
+
+			/*
+				INSTREAM_PREFETCH::~INSTREAM_PREFETCH()
+				---------------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~instream_prefetch();
+
+			/*
+				INSTREAM_PREFETCH::READ()
+				-------------------------
+			*/
+			/*!
+				@brief Read buffer.contents.size() bytes of data into buffer.contents, resizing on eof.
+				@param buffer [out] buffer.contents.size() bytes of data are read from source into buffer which is resized to the number of bytes read on eof.
+			*/
+			virtual void read(document &buffer);
+
+			/*
+				INSTREAM_PREFETCH::UNITTEST()
+				-----------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
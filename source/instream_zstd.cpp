@@ -0,0 +1,125 @@
+/*
+	INSTREAM_ZSTD.CPP
+	-----------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "asserts.h"
+#include "instream_zstd.h"
+#include "unittest_data.h"
+#include "instream_memory.h"
+#include "compress_general_zstd.h"
+
+namespace JASS
+	{
+	/*
+		INSTREAM_ZSTD::INSTREAM_ZSTD()
+		------------------------------
+	*/
+	instream_zstd::instream_zstd(std::shared_ptr<instream> &source) :
+		instream(source),
+		stream(ZSTD_createDStream()),
+		buffer(ZSTD_DStreamInSize()),
+		input{buffer.data(), 0, 0},
+		at_eof(false)
+		{
+		ZSTD_initDStream(stream);
+		}
+
+	/*
+		INSTREAM_ZSTD::~INSTREAM_ZSTD()
+		-------------------------------
+	*/
+	instream_zstd::~instream_zstd()
+		{
+		ZSTD_freeDStream(stream);
+		}
+
+	/*
+		INSTREAM_ZSTD::READ()
+		---------------------
+	*/
+	void instream_zstd::read(document &document)
+		{
+		ZSTD_outBuffer output = {document.contents.address(), document.contents.size(), 0};
+
+		while (output.pos < output.size)
+			{
+			/*
+				Get more compressed data if we've used it all
+			*/
+			if (input.pos == input.size && !at_eof)
+				{
+				input.size = source->fetch(buffer.data(), buffer.size());
+				input.pos = 0;
+				at_eof = input.size == 0;
+				}
+
+			size_t was = output.pos;
+			size_t state = ZSTD_decompressStream(stream, &output, &input);
+			if (ZSTD_isError(state))
+				{
+				printf("JASS::instream_zstd::read failure trying to decompress (zstd reports:%s)\n", ZSTD_getErrorName(state));
+				document.contents = slice();
+				return;
+				}
+
+			/*
+				At EOF once there is no more input and zstd has nothing left to flush
+			*/
+			if (at_eof && output.pos == was)
+				break;
+			}
+
+		if (output.pos == 0)
+			document.contents = slice();
+		else
+			document.contents.resize(output.pos);
+		}
+
+	/*
+		INSTREAM_ZSTD::UNITTEST()
+		-------------------------
+	*/
+	void instream_zstd::unittest(void)
+		{
+		/*
+			Compress the test data as two frames, one after the other
+		*/
+		compress_general_zstd compressor;
+		std::string half_1 = unittest_data::ten_documents.substr(0, unittest_data::ten_documents.size() / 2);
+		std::string half_2 = unittest_data::ten_documents.substr(unittest_data::ten_documents.size() / 2);
+		std::string compressed(unittest_data::ten_documents.size() * 2, '\0');
+		size_t frame_1 = compressor.encode(&compressed[0], compressed.size(), half_1.data(), half_1.size());
+		size_t frame_2 = compressor.encode(&compressed[frame_1], compressed.size() - frame_1, half_2.data(), half_2.size());
+		JASS_assert(frame_1 != 0 && frame_2 != 0);
+		compressed.resize(frame_1 + frame_2);
+
+		/*
+			Decompress it, a few bytes at a time
+		*/
+		std::shared_ptr<instream> file(new instream_memory(compressed.data(), compressed.size()));
+		instream_zstd reader(file);
+		std::string got;
+		uint8_t chunk[37];
+		size_t bytes;
+		while ((bytes = reader.fetch(chunk, sizeof(chunk))) != 0)
+			got.append(reinterpret_cast<char *>(chunk), bytes);
+		JASS_assert(got == unittest_data::ten_documents);
+
+		/*
+			Corrupt data is an error (so the read returns nothing)
+		*/
+		std::string garbage = "this is not zstd";
+		std::shared_ptr<instream> bad_file(new instream_memory(garbage.data(), garbage.size()));
+		instream_zstd bad_reader(bad_file);
+		JASS_assert(bad_reader.fetch(chunk, sizeof(chunk)) == 0);
+
+		puts("instream_zstd::PASSED");
+		}
+	}
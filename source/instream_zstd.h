@@ -0,0 +1,78 @@
+/*
+	INSTREAM_ZSTD.H
+	---------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Subclass of instream for reading from .zst files (files compressed with zstd).
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <vector>
+
+#include "zstd.h"
+#include "instream.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INSTREAM_ZSTD
+		-------------------
+	*/
+	/*!
+		@brief Subclass of instream for reading from .zst files (files compressed with zstd).
+		@details The file can be any number of zstd frames one after the other (such as those written by compress_general_zstd::encode(), or
+		by the zstd command line tool), they are decompressed as if they were one stream.
+	*/
+	class instream_zstd : public instream
+		{
+		private:
+			ZSTD_DStream *stream;						///< The zstd stream processing data structure
+			std::vector<uint8_t> buffer;				///< Internal buffer of compressed data
+			ZSTD_inBuffer input;							///< The compressed data in buffer that has not yet been decompressed
+			bool at_eof;									///< Has the end of source been reached?
+
+		public:
+			/*
+				INSTREAM_ZSTD::INSTREAM_ZSTD()
+				------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param source [in] The instream to read the compressed data from.
+			*/
+			instream_zstd(std::shared_ptr<instream> &source);
+
+			/*
+				INSTREAM_ZSTD::~INSTREAM_ZSTD()
+				-------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~instream_zstd();
+
+			/*
+				INSTREAM_ZSTD::READ()
+				---------------------
+			*/
+			/*!
+				@brief Read buffer.contents.size() bytes of data into buffer.contents, resizing on eof.
+				@param buffer [out] buffer.contents.size() bytes of data are read from source into buffer which is resized to the number of bytes read on eof.
+			*/
+			virtual void read(document &buffer);
+
+			/*
+				INSTREAM_ZSTD::UNITTEST()
+				-------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
@@ -0,0 +1,87 @@
+/*
+	JSON_SCANNER.CPP
+	----------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <random>
+#include <algorithm>
+
+#include "asserts.h"
+#include "json_scanner.h"
+
+namespace JASS
+	{
+	/*
+		JSON_SCANNER::UNITTEST()
+		------------------------
+	*/
+	void json_scanner::unittest(void)
+		{
+		json_scanner scanner;
+		std::vector<uint32_t> positions;
+
+		/*
+			Operators in strings are not structural, and neither are escaped quotes
+		*/
+		std::string text = "{\"a:b\": 1, \"c\\\"d\": [2, 3], \"e\\\\\": {}}";
+		size_t found = scanner.index(reinterpret_cast<const uint8_t *>(text.data()), reinterpret_cast<const uint8_t *>(text.data() + text.size()), positions);
+		std::string structural;
+		for (size_t which = 0; which < found; which++)
+			structural += text[positions[which]];
+		JASS_assert(structural == "{\"\":,\"\":[,],\"\":{}}");
+
+		/*
+			Check against a byte at a time scan of random JSON-like text (so that strings and escapes cross the 64 byte blocks)
+		*/
+		std::mt19937 random(17);
+		const char alphabet[] = "ab \"\\:,{}[]";
+		for (size_t length = 0; length < 300; length++)
+			{
+			text.clear();
+			for (size_t byte = 0; byte < length; byte++)
+				text += alphabet[random() % (sizeof(alphabet) - 1)];
+
+			std::vector<uint32_t> expected;
+			bool in_string = false;
+			bool escaped = false;			// a backslash outside a string isn't JSON, but it is treated the same as one inside a string
+			for (size_t byte = 0; byte < length; byte++)
+				{
+				bool is_operator = strchr(":,{}[]", text[byte]) != nullptr;
+				if (escaped)
+					escaped = false;
+				else if (text[byte] == '\\')
+					{
+					escaped = true;
+					continue;
+					}
+				else if (text[byte] == '"')
+					{
+					expected.push_back(static_cast<uint32_t>(byte));
+					in_string = !in_string;
+					continue;
+					}
+				if (is_operator && !in_string)
+					expected.push_back(static_cast<uint32_t>(byte));
+				}
+
+			found = scanner.index(reinterpret_cast<const uint8_t *>(text.data()), reinterpret_cast<const uint8_t *>(text.data() + text.size()), positions);
+			JASS_assert(found == expected.size());
+			JASS_assert(std::equal(expected.begin(), expected.end(), positions.begin()));
+			}
+
+		/*
+			The prefix-xor
+		*/
+		JASS_assert(prefix_xor(0) == 0);
+		JASS_assert(prefix_xor(1) == ~0ULL);
+		JASS_assert(prefix_xor(0x11) == 0x0F);
+		JASS_assert(prefix_xor(1ULL << 63) == 1ULL << 63);
+
+		puts("json_scanner::PASSED");
+		}
+	}
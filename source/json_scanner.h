@@ -0,0 +1,283 @@
+/*
+	JSON_SCANNER.H
+	--------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Find the structural characters of JSON 64 bytes at a time (stage 1 of simdjson).
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include <vector>
+
+#include "forceinline.h"
+
+namespace JASS
+	{
+	/*
+		CLASS JSON_SCANNER
+		------------------
+	*/
+	/*!
+		@brief Find the structural characters of JSON 64 bytes at a time (stage 1 of simdjson).
+		@details Each block of 64 bytes is turned into bitmasks of its backslashes, quotes, and the characters {}[]:, using AVX2 compares.
+		A quote preceded by an odd number of backslashes is escaped.  The prefix-xor (carry-less multiply by all ones) of the unescaped
+		quotes marks the bytes inside strings, and the structural characters are the unescaped quotes and the {}[]:, outside of strings.
+		Whether the previous block ended in a string (or part way through an escape) is carried from block to block.  Parsing is then a walk
+		over the positions of the structural characters (so a parser need never look at the bytes inside a string or between values).
+		See: G. Langdale, D. Lemire (2019), Parsing Gigabytes of JSON per Second, The VLDB Journal 28:941-960.
+	*/
+	class json_scanner
+		{
+		private:
+			uint64_t escape_carry;				///< 1 if the previous block ended in a backslash that escapes the first byte of this block
+			uint64_t in_string_carry;			///< All 1s if the previous block ended inside a string, else 0
+
+		private:
+			/*
+				JSON_SCANNER::EQUALS()
+				----------------------
+			*/
+			/*!
+				@brief Return a bitmask of the bytes in the 64-byte block that are equal to value.
+				@param low [in] The first 32 bytes of the block.
+				@param high [in] The second 32 bytes of the block.
+				@param value [in] The byte to look for.
+				@return Bit i is set if byte i of the block is value.
+			*/
+#ifdef __AVX2__
+			forceinline static uint64_t equals(__m256i low, __m256i high, uint8_t value)
+				{
+				__m256i pattern = _mm256_set1_epi8(value);
+				uint64_t bottom = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, pattern)));
+				uint64_t top = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, pattern)));
+				return bottom | (top << 32);
+				}
+#endif
+
+			/*
+				JSON_SCANNER::ESCAPED()
+				-----------------------
+			*/
+			/*!
+				@brief Return a bitmask of the bytes in the block that are escaped by a backslash, and update escape_carry.
+				@details Backslashes are rare in JSON so this is a loop over the backslashes (if any) rather than the branch-free simdjson method.
+				@param backslash [in] The backslashes in the block.
+				@return Bit i is set if byte i of the block is escaped.
+			*/
+			forceinline uint64_t escaped(uint64_t backslash)
+				{
+				uint64_t escaped = escape_carry;
+				escape_carry = 0;
+
+				for (; backslash != 0; backslash &= backslash - 1)
+					{
+					uint64_t bit = backslash & -backslash;
+					if ((escaped & bit) != 0)
+						continue;							// this backslash is itself escaped
+					if (bit == (1ULL << 63))
+						escape_carry = 1;					// escapes the first byte of the next block
+					else
+						escaped |= bit << 1;
+					}
+
+				return escaped;
+				}
+
+		public:
+			/*
+				JSON_SCANNER::JSON_SCANNER()
+				----------------------------
+			*/
+			/*!
+				@brief Constructor
+			*/
+			json_scanner() :
+				escape_carry(0),
+				in_string_carry(0)
+				{
+				/* Nothing */
+				}
+
+			/*
+				JSON_SCANNER::RESET()
+				---------------------
+			*/
+			/*!
+				@brief Start scanning a new JSON text (outside of any string).
+			*/
+			void reset(void)
+				{
+				escape_carry = 0;
+				in_string_carry = 0;
+				}
+
+			/*
+				JSON_SCANNER::PREFIX_XOR()
+				--------------------------
+			*/
+			/*!
+				@brief Compute the prefix-xor of the bits of a 64-bit integer (bit i of the answer is the xor of bits 0 to i of bitmap).
+				@param bitmap [in] The bits.
+				@return The prefix-xor.
+			*/
+			forceinline static uint64_t prefix_xor(uint64_t bitmap)
+				{
+#ifdef __PCLMUL__
+				return _mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, bitmap), _mm_set1_epi8(-1), 0));
+#else
+				bitmap ^= bitmap << 1;
+				bitmap ^= bitmap << 2;
+				bitmap ^= bitmap << 4;
+				bitmap ^= bitmap << 8;
+				bitmap ^= bitmap << 16;
+				bitmap ^= bitmap << 32;
+				return bitmap;
+#endif
+				}
+
+			/*
+				JSON_SCANNER::NEXT_BLOCK()
+				--------------------------
+			*/
+			/*!
+				@brief Find the structural characters in the next 64 bytes of the JSON text.
+				@param block [in] The 64 bytes (all 64 must be readable).
+				@return Bit i is set if byte i of the block is a structural character (an unescaped quote, or one of {}[]:, outside of a string).
+			*/
+			forceinline uint64_t next_block(const uint8_t *block)
+				{
+				uint64_t backslash;
+				uint64_t quote;
+				uint64_t operators;
+
+#ifdef __AVX2__
+				__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+				__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+
+				backslash = equals(low, high, '\\');
+				quote = equals(low, high, '"');
+				operators = equals(low, high, ':') | equals(low, high, ',') | equals(low, high, '{') | equals(low, high, '}') | equals(low, high, '[') | equals(low, high, ']');
+#else
+				backslash = quote = operators = 0;
+				for (size_t byte = 0; byte < 64; byte++)
+					{
+					uint64_t bit = 1ULL << byte;
+					switch (block[byte])
+						{
+						case '\\':
+							backslash |= bit;
+							break;
+						case '"':
+							quote |= bit;
+							break;
+						case ':':
+						case ',':
+						case '{':
+						case '}':
+						case '[':
+						case ']':
+							operators |= bit;
+							break;
+						default:
+							break;
+						}
+					}
+#endif
+				if (backslash != 0 || escape_carry != 0)
+					quote &= ~escaped(backslash);
+
+				/*
+					The bytes from an opening quote up to (but not including) its closing quote are in a string
+				*/
+				uint64_t in_string = prefix_xor(quote) ^ in_string_carry;
+				in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+				return quote | (operators & ~in_string);
+				}
+
+			/*
+				JSON_SCANNER::INDEX()
+				---------------------
+			*/
+			/*!
+				@brief Find the positions of all the structural characters in a JSON text.
+				@param start [in] The start of the JSON text.
+				@param end [in] The end of the JSON text.
+				@param positions [out] The offsets (from start) of the structural characters, in order.  This is grown as needed but never shrunk, so keep it between calls to avoid allocating.
+				@return The number of structural characters (the number of valid elements of positions).
+			*/
+			size_t index(const uint8_t *start, const uint8_t *end, std::vector<uint32_t> &positions)
+				{
+				size_t length = end - start;
+				if (positions.size() < length + 64)
+					positions.resize(length + 64);				// there can't be more structural characters than bytes (+64 for the writes past the end)
+
+				reset();
+				uint32_t *into = positions.data();
+				uint32_t offset = 0;
+				for (; offset + 64 <= length; offset += 64)
+					into = flatten(into, offset, next_block(start + offset));
+
+				/*
+					The last (partial) block is padded with spaces
+				*/
+				if (offset < length)
+					{
+					uint8_t last[64];
+					memset(last, ' ', sizeof(last));
+					memcpy(last, start + offset, length - offset);
+					into = flatten(into, offset, next_block(last));
+					}
+
+				return into - positions.data();
+				}
+
+			/*
+				JSON_SCANNER::FLATTEN()
+				-----------------------
+			*/
+			/*!
+				@brief Convert a bitmask of structural characters into their positions.
+				@details The positions are written 4 at a time (with no test for whether there are 4 bits left) because most blocks have several.
+				@param into [out] Where to write the positions (there must be room for 64).
+				@param offset [in] The position of bit 0 of the bitmask.
+				@param bits [in] The bitmask.
+				@return A pointer to the element after the last position written.
+			*/
+			forceinline static uint32_t *flatten(uint32_t *into, uint32_t offset, uint64_t bits)
+				{
+				uint32_t *end = into + _mm_popcnt_u64(bits);
+				while (bits != 0)
+					{
+					into[0] = offset + static_cast<uint32_t>(_tzcnt_u64(bits));
+					bits = _blsr_u64(bits);
+					into[1] = offset + static_cast<uint32_t>(_tzcnt_u64(bits));
+					bits = _blsr_u64(bits);
+					into[2] = offset + static_cast<uint32_t>(_tzcnt_u64(bits));
+					bits = _blsr_u64(bits);
+					into[3] = offset + static_cast<uint32_t>(_tzcnt_u64(bits));
+					bits = _blsr_u64(bits);
+					into += 4;
+					}
+				return end;
+				}
+
+			/*
+				JSON_SCANNER::UNITTEST()
+				------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
@@ -0,0 +1,296 @@
+/*
+	MERGE_JASS_V2.CPP
+	-----------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <filesystem>
+
+#include "file.h"
+#include "asserts.h"
+#include "quantize.h"
+#include "allocator_pool.h"
+#include "merge_jass_v2.h"
+#include "unittest_data.h"
+#include "index_postings.h"
+#include "collection_statistics.h"
+#include "serialise_jass_v2.h"
+#include "deserialised_jass_v2.h"
+#include "index_manager_sequential.h"
+
+namespace JASS
+	{
+	/*
+		MERGE_JASS_V2::SEGMENT::READ()
+		------------------------------
+	*/
+	bool merge_jass_v2::segment::read(const std::string &directory, compress_integer::integer first_document)
+		{
+		index = std::make_unique<deserialised_jass_v2>(false);
+		if (index->read_index(directory) == 0)
+			return false;
+
+		std::string codex_name;
+		decoder.reset(index->codex(codex_name, d_ness));
+		this->first_document = first_document;
+		current = index->begin();
+		headers.resize(index_postings_impact::largest_impact + 1);
+		decoded.resize(index->document_count() + 64);			// we add 64 so that decompressors can overflow
+
+		return true;
+		}
+
+	/*
+		MERGE_JASS_V2::SEGMENT::DECODE()
+		--------------------------------
+	*/
+	size_t merge_jass_v2::segment::decode(std::pair<compress_integer::integer, index_postings_impact::impact_type> *into)
+		{
+		auto metadata = *current;
+		uint32_t smallest;
+		uint32_t largest;
+		query::DOCID_TYPE document_frequency;
+		size_t impacts = index->get_segment_list(&headers[0], metadata, 1, smallest, largest, document_frequency);
+
+		/*
+			The index counts documents from 0, but the serialisers count from 1
+		*/
+		auto *end = into;
+		for (size_t which = 0; which < impacts; which++)
+			{
+			const auto &header = headers[which];
+			decoder->decode(&decoded[0], header.segment_frequency, index->postings() + header.offset, header.end - header.offset);
+
+			compress_integer::integer id = 0;
+			for (size_t posting = 0; posting < header.segment_frequency; posting++)
+				{
+				id = d_ness == 1 ? id + decoded[posting] : decoded[posting];
+				*end++ = std::pair(id + first_document + 1, static_cast<index_postings_impact::impact_type>(header.impact));
+				}
+			}
+
+		/*
+			The postings list is stored in impact order, but the serialiser needs it in document order
+		*/
+		std::sort(into, end);
+
+		return end - into;
+		}
+
+	/*
+		MERGE_JASS_V2::MERGE()
+		----------------------
+	*/
+	size_t merge_jass_v2::merge(const std::string &destination, const std::vector<std::string> &sources)
+		{
+		if (sources.size() == 0)
+			return 0;
+
+		/*
+			Load each segment, numbering its documents after those of the segments before it
+		*/
+		std::vector<segment> segments(sources.size());
+		size_t documents = 0;
+		for (size_t which = 0; which < sources.size(); which++)
+			{
+			if (!segments[which].read(sources[which], static_cast<compress_integer::integer>(documents)))
+				return 0;
+			documents += segments[which].index->document_count();
+			}
+
+		/*
+			The merged index is written with the codex of the first segment (the first byte of the postings file is the codex)
+		*/
+		auto codex = serialise_jass_v1::jass_v1_codex::elias_gamma_simd_vb;
+		if (segments[0].index->postings_size() != 0)
+			codex = static_cast<serialise_jass_v1::jass_v1_codex>(segments[0].index->postings()[0]);
+		int8_t alignment = codex == serialise_jass_v1::jass_v1_codex::qmx || codex == serialise_jass_v1::jass_v1_codex::qmx_d4 || codex == serialise_jass_v1::jass_v1_codex::qmx_d0 ? 16 : 1;
+
+		/*
+			The segments must outlive the serialiser as it keeps the terms (which are in the segment's vocabulary) until finish()
+		*/
+		allocator_pool memory;
+		index_postings postings(memory);			// the postings lists are only in the segments, so there is no index_postings object for them
+		std::vector<std::pair<compress_integer::integer, index_postings_impact::impact_type>> merged(documents);
+		std::vector<compress_integer::integer> document_ids(documents);
+		std::vector<index_postings_impact::impact_type> term_frequencies(documents);
+
+		serialise_jass_v2 serialiser(documents, codex, alignment, destination);
+
+		/*
+			k-way merge the vocabularies of the segments (which are sorted in the same order)
+		*/
+		for (;;)
+			{
+			const slice *lowest = nullptr;
+			for (const auto &source : segments)
+				if (source.current != source.index->end() && (lowest == nullptr || slice::strict_weak_order_less_than(source.current->term, *lowest)))
+					lowest = &source.current->term;
+
+			if (lowest == nullptr)
+				break;
+			slice term = *lowest;
+
+			/*
+				The documents of each segment are numbered after those of the segments before it, so the postings of each segment go on the end of the previous
+			*/
+			size_t document_frequency = 0;
+			for (auto &source : segments)
+				if (source.current != source.index->end() && source.current->term == term)
+					{
+					document_frequency += source.decode(&merged[document_frequency]);
+					source.current++;
+					}
+
+			for (size_t which = 0; which < document_frequency; which++)
+				{
+				document_ids[which] = merged[which].first;
+				term_frequencies[which] = merged[which].second;
+				}
+
+			serialiser(term, postings, static_cast<compress_integer::integer>(document_frequency), &document_ids[0], &term_frequencies[0]);
+			}
+
+		/*
+			The primary keys are those of each segment, in order.  Note that the search engine counts documents from 1, not from 0.
+		*/
+		index_manager::delegate &primary_key_serialiser = serialiser;
+		size_t instance = 0;
+		primary_key_serialiser(instance, slice("-"));
+		for (const auto &source : segments)
+			for (const auto &key : source.index->primary_keys())
+				primary_key_serialiser(++instance, slice(const_cast<char *>(key.data()), key.size()));
+
+		serialiser.finish();
+
+		return documents;
+		}
+
+	/*
+		MERGE_JASS_V2::UNITTEST()
+		-------------------------
+	*/
+	void merge_jass_v2::unittest(void)
+		{
+		const char *directories[] = {"merge_jass_v2.first", "merge_jass_v2.second", "merge_jass_v2.merged", "merge_jass_v2.expected"};
+		for (const auto *directory : directories)
+			std::filesystem::create_directories(directory);
+
+		/*
+			Serialise the ten document collection as each of two segments, and twice over as one index (the answer)
+		*/
+		auto serialise = [](const std::string &collection, const std::string &directory)
+			{
+			index_manager_sequential index;
+			index_manager_sequential::unittest_build_index(index, collection);
+			serialise_jass_v2 serialiser(index.get_highest_document_id(), serialise_jass_v1::jass_v1_codex::elias_gamma_simd_vb, 1, directory);
+			index.iterate(serialiser);
+			serialiser.finish();
+			};
+
+		serialise(unittest_data::ten_documents, directories[0]);
+		serialise(unittest_data::ten_documents, directories[1]);
+		serialise(unittest_data::ten_documents + unittest_data::ten_documents, directories[3]);
+
+		/*
+			Merging the two segments must give the same index as indexing the whole collection at once
+		*/
+		size_t documents = merge(directories[2], std::vector<std::string>{directories[0], directories[1]});
+		JASS_assert(documents == 20);
+
+		std::string merged_primary_keys;
+		std::string expected_primary_keys;
+		file::read_entire_file((std::filesystem::path(directories[2]) / "CIdoclist.bin").string(), merged_primary_keys);
+		file::read_entire_file((std::filesystem::path(directories[3]) / "CIdoclist.bin").string(), expected_primary_keys);
+		JASS_assert(merged_primary_keys == expected_primary_keys);
+
+		/*
+			The postings lists are serialised in a different order (so the files differ) but each term must have the same postings
+		*/
+		auto same_postings = [documents](const std::string &merged_directory, const std::string &expected_directory)
+			{
+			segment merged;
+			segment expected;
+			JASS_assert(merged.read(merged_directory, 0));
+			JASS_assert(expected.read(expected_directory, 0));
+			JASS_assert(merged.index->end() - merged.current == expected.index->end() - expected.current);
+
+			std::vector<std::pair<compress_integer::integer, index_postings_impact::impact_type>> merged_postings(documents);
+			std::vector<std::pair<compress_integer::integer, index_postings_impact::impact_type>> expected_postings(documents);
+			for (; expected.current != expected.index->end(); merged.current++, expected.current++)
+				{
+				JASS_assert(merged.current->term == expected.current->term);
+				size_t document_frequency = expected.decode(&expected_postings[0]);
+				JASS_assert(merged.decode(&merged_postings[0]) == document_frequency);
+				JASS_assert(std::equal(merged_postings.begin(), merged_postings.begin() + document_frequency, expected_postings.begin()));
+				}
+			};
+		same_postings(directories[2], directories[3]);
+
+		deserialised_jass_v2 loaded(false);
+		JASS_assert(loaded.read_index(directories[2]) != 0);
+		JASS_assert(loaded.verify_checksums(directories[2]));
+
+		/*
+			Merging copies the impacts, so the merged index only ranks as the whole collection would if each segment was quantized against
+			the same collection statistics.  Segments quantized against the statistics of the whole collection (JASS_index -Sr) must merge into
+			the whole collection quantized on its own.
+		*/
+		auto serialise_quantized = [](const std::string &collection, const std::string &directory, collection_statistics *statistics)
+			{
+			index_manager_sequential index;
+			index_manager_sequential::unittest_build_index(index, collection);
+			double mean_length = statistics == nullptr ? 0 : static_cast<double>(statistics->length) / static_cast<double>(statistics->documents);
+			std::shared_ptr<ranking_function_atire_bm25> ranker(new ranking_function_atire_bm25(0.9, 0.4, index.get_document_length_vector(), mean_length));
+			quantize<ranking_function_atire_bm25> quantizer(index.get_highest_document_id(), ranker);
+			if (statistics != nullptr)
+				JASS_assert(quantizer.use_statistics(*statistics));
+			index.iterate(quantizer);
+
+			serialise_jass_v2 serialiser(index.get_highest_document_id(), serialise_jass_v1::jass_v1_codex::elias_gamma_simd_vb, 1, directory);
+			index.iterate(quantizer, serialiser);
+			serialiser.finish();
+			};
+
+		std::string second_segment = unittest_data::ten_document_6 + unittest_data::ten_document_7 + unittest_data::ten_document_8 + unittest_data::ten_document_9 + unittest_data::ten_document_10;
+		collection_statistics whole;
+			{
+			index_manager_sequential index;
+			index_manager_sequential::unittest_build_index(index, unittest_data::ten_documents + second_segment);
+			for (auto length : index.get_document_length_vector())
+				whole.length += length;
+			whole.documents = index.get_highest_document_id();
+			index.iterate(whole);
+
+			std::shared_ptr<ranking_function_atire_bm25> ranker(new ranking_function_atire_bm25(0.9, 0.4, index.get_document_length_vector()));
+			quantize<ranking_function_atire_bm25> quantizer(index.get_highest_document_id(), ranker);
+			index.iterate(quantizer);
+			quantizer.get_bounds(whole.smallest_rsv, whole.largest_rsv);
+			}
+
+		for (const auto *directory : directories)
+			{
+			std::filesystem::remove_all(directory);
+			std::filesystem::create_directories(directory);
+			}
+		serialise_quantized(unittest_data::ten_documents, directories[0], &whole);
+		serialise_quantized(second_segment, directories[1], &whole);
+		serialise_quantized(unittest_data::ten_documents + second_segment, directories[3], nullptr);
+		JASS_assert(merge(directories[2], std::vector<std::string>{directories[0], directories[1]}) == 15);
+		same_postings(directories[2], directories[3]);
+
+		/*
+			Failure cases
+		*/
+		JASS_assert(merge(directories[2], std::vector<std::string>{}) == 0);
+		JASS_assert(merge(directories[2], std::vector<std::string>{"merge_jass_v2.does_not_exist"}) == 0);
+
+		for (const auto *directory : directories)
+			std::filesystem::remove_all(directory);
+
+		puts("merge_jass_v2::PASSED");
+		}
+	}
@@ -0,0 +1,111 @@
+/*
+	MERGE_JASS_V2.H
+	---------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Merge several JASS v2 indexes (segments of one collection) into a single JASS v2 index.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "index_postings_impact.h"
+#include "deserialised_jass_v2.h"
+
+namespace JASS
+	{
+	/*
+		CLASS MERGE_JASS_V2
+		-------------------
+	*/
+	/*!
+		@brief Merge several JASS v2 indexes (segments of one collection) into a single JASS v2 index.
+		@details This is the building block of incremental indexing: newly arrived documents are indexed into a small segment of their own
+		(which can be searched alongside the existing segments, see JASS_anytime_api::add_segment()), and from time to time the segments are
+		merged into larger ones.  The documents of each segment are numbered after those of the segments before it (the same numbering
+		the search engine uses when it searches the segments as a document-partitioned index).  The impact scores are copied from the segments
+		as they are (they are not re-quantized, the term frequencies are gone), so searching the merged index gives the same results as searching
+		the segments.  That is only the ranking of the whole collection if every segment gave its documents the impacts they have in the whole
+		collection, which requires that every segment was quantized against the same collection statistics: index the base with JASS_index -Sw
+		\<file\> and each new segment with -Sr \<file\> (see collection_statistics).  New segments are then scored with the statistics of the base
+		(terms not in the base with their own), so as the collection grows the base should, from time to time, be re-indexed and the statistics
+		re-written.  Each segment is decompressed with its own codex, and the merged index is compressed with the codex of the first segment.
+	*/
+	class merge_jass_v2
+		{
+		private:
+			/*
+				CLASS MERGE_JASS_V2::SEGMENT
+				----------------------------
+			*/
+			/*!
+				@brief One of the indexes being merged, along with the decompressor for its postings and a cursor into its vocabulary.
+			*/
+			class segment
+				{
+				public:
+					std::unique_ptr<deserialised_jass_v2> index;								///< The index
+					std::unique_ptr<compress_integer> decoder;								///< The decompressor for the postings of this index
+					int32_t d_ness;																	///< The d-ness of the postings (1 for d1 encoded)
+					compress_integer::integer first_document;									///< Added to each document id to number this segment's documents after those of the segments before it
+					std::vector<deserialised_jass_v1::metadata>::const_iterator current;	///< The next term (in the vocabulary) to merge
+					std::vector<deserialised_jass_v1::segment_header> headers;			///< Buffer holding the impact headers of a postings list
+					std::vector<compress_integer::integer> decoded;							///< Buffer holding one decompressed impact segment
+
+				public:
+					/*
+						MERGE_JASS_V2::SEGMENT::READ()
+						------------------------------
+					*/
+					/*!
+						@brief Load the index from the given directory and set the cursor to the first term.
+						@param directory [in] The directory holding the index.
+						@param first_document [in] The number of documents in the segments before this one.
+						@return true on success, false if the index could not be read.
+					*/
+					bool read(const std::string &directory, compress_integer::integer first_document);
+
+					/*
+						MERGE_JASS_V2::SEGMENT::DECODE()
+						--------------------------------
+					*/
+					/*!
+						@brief Decompress the postings list of the term at the cursor into <document id, impact> pairs, in document order.
+						@details The document ids are counted from 1 (the way the serialisers count), and first_document is added to each.
+						@param into [out] The postings are written here (which must have room for the document frequency of the term).
+						@return The document frequency of the term.
+					*/
+					size_t decode(std::pair<compress_integer::integer, index_postings_impact::impact_type> *into);
+				};
+
+		public:
+			/*
+				MERGE_JASS_V2::MERGE()
+				----------------------
+			*/
+			/*!
+				@brief Merge the JASS v2 index in each of the source directories into a single JASS v2 index in the destination directory.
+				@param destination [in] The directory to write the merged index into (which must exist, and must not be one of the sources).
+				@param sources [in] The directory of each index to merge, in document order.
+				@return The number of documents in the merged index, or 0 on error (no sources, or a source could not be read).
+			*/
+			static size_t merge(const std::string &destination, const std::vector<std::string> &sources);
+
+			/*
+				MERGE_JASS_V2::UNITTEST()
+				-------------------------
+			*/
+			/*!
+				@brief Unit test this class.
+			*/
+			static void unittest(void);
+		};
+	}
@@ -5,6 +5,7 @@
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
 #include <string.h>
+#include <immintrin.h>
 
 #include <algorithm>
 
@@ -14,10 +15,75 @@
 #include "assert.h"
 #include "unicode.h"
 #include "document.h"
+#include "forceinline.h"
 #include "unittest_data.h"
 
 namespace JASS
 	{
+#ifdef __AVX2__
+	/*
+		CLASS CHARACTER_CLASS
+		---------------------
+	*/
+	/*!
+		@brief A set of ASCII characters (such as the alphabetics) that can be tested for 32 bytes at a time.
+		@details Each byte is looked up (with vpshufb) in a table indexed by its low nibble and a table indexed by its high nibble, and is in
+		the class if the two entries share a bit.  The low nibble table has bit h set for each member with high nibble h, and the high nibble
+		table has bit h set for high nibble h (for h < 8 only), so non-ASCII bytes are never members.  The tables are built from the ascii::
+		methods so the answers are the same as the byte at a time ones.
+	*/
+	class character_class
+		{
+		private:
+			__m256i low_nibble;				///< For each low nibble, which high nibbles are members (repeated in both lanes)
+			__m256i high_nibble;			///< For each high nibble, its bit (repeated in both lanes)
+
+		public:
+			/*
+				CHARACTER_CLASS::CHARACTER_CLASS()
+				----------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param is_member [in] The ascii:: method that defines the class.
+			*/
+			character_class(int (*is_member)(uint8_t))
+				{
+				uint8_t low[32] = {};
+				uint8_t high[32] = {};
+
+				for (uint8_t character = 0; character < 0x80; character++)
+					if (is_member(character))
+						low[character & 0x0F] = low[16 + (character & 0x0F)] |= 1 << (character >> 4);
+				for (size_t nibble = 0; nibble < 8; nibble++)
+					high[nibble] = high[16 + nibble] = 1 << nibble;
+
+				low_nibble = _mm256_loadu_si256((__m256i *)low);
+				high_nibble = _mm256_loadu_si256((__m256i *)high);
+				}
+
+			/*
+				CHARACTER_CLASS::MEMBERS()
+				--------------------------
+			*/
+			/*!
+				@brief Return a bitmap (bit i for byte i) of which of the 32 bytes are in the class.
+				@param bytes [in] The bytes to test.
+				@return The members.
+			*/
+			forceinline uint32_t members(__m256i bytes) const
+				{
+				__m256i low = _mm256_shuffle_epi8(low_nibble, _mm256_and_si256(bytes, _mm256_set1_epi8(0x0F)));
+				__m256i high = _mm256_shuffle_epi8(high_nibble, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F)));
+				return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(low, high), _mm256_setzero_si256())));
+				}
+		};
+
+	static const character_class ascii_space(ascii::isspace);		///< ASCII white space
+	static const character_class ascii_alpha(ascii::isalpha);		///< ASCII alphabetics
+	static const character_class ascii_digit(ascii::isdigit);		///< ASCII digits
+#endif
+
 	/*
 		PARSER::BUILD_UNICODE_ALPHABETIC_TOKEN()
 		----------------------------------------
@@ -91,6 +157,22 @@ namespace JASS
 			We skip over non-indexable characters before the start of the first token
 			Start with the assumption that we're skipping over ASCII white space
 		*/
+#ifdef __AVX2__
+		/*
+			Most runs of white space are a single space, so only look at 32 bytes at a time once the run is longer than that
+		*/
+		if (current + 32 < end_of_document && ascii::isspace(current[0]) && ascii::isspace(current[1]))
+			while (current + 32 < end_of_document)
+				{
+				uint32_t not_space = ~ascii_space.members(_mm256_loadu_si256((__m256i *)current));
+				if (not_space != 0)
+					{
+					current += _tzcnt_u32(not_space);
+					break;
+					}
+				current += 32;
+				}
+#endif
 		while (ascii::isspace(*current))
 			if (++current >= end_of_document)
 				return eof_token;
@@ -136,7 +218,26 @@ namespace JASS
 			*/
 			*buffer_pos++ = ascii::tolower(*current);
 			current++;
-		
+
+#ifdef __AVX2__
+			/*
+				Copy 32 bytes at a time while there's room (ASCII alphabetics are lower cased by setting bit 5), and stop at the first non-alphabetic
+			*/
+			while (current + 32 < end_of_document && buffer_pos + 32 <= buffer_end)
+				{
+				__m256i bytes = _mm256_loadu_si256((__m256i *)current);
+				_mm256_storeu_si256((__m256i *)buffer_pos, _mm256_or_si256(bytes, _mm256_set1_epi8(0x20)));
+				uint32_t not_alpha = ~ascii_alpha.members(bytes);
+				if (not_alpha != 0)
+					{
+					current += _tzcnt_u32(not_alpha);
+					buffer_pos += _tzcnt_u32(not_alpha);
+					break;
+					}
+				current += 32;
+				buffer_pos += 32;
+				}
+#endif
 			while (ascii::isalpha(*current))
 				{
 				if (buffer_pos < buffer_end)
@@ -166,7 +267,26 @@ namespace JASS
 			*/
 			*buffer_pos++ = *current;
 			current++;
-		
+
+#ifdef __AVX2__
+			/*
+				Copy 32 bytes at a time while there's room, and stop at the first non-digit
+			*/
+			while (current + 32 < end_of_document && buffer_pos + 32 <= buffer_end)
+				{
+				__m256i bytes = _mm256_loadu_si256((__m256i *)current);
+				_mm256_storeu_si256((__m256i *)buffer_pos, bytes);
+				uint32_t not_digit = ~ascii_digit.members(bytes);
+				if (not_digit != 0)
+					{
+					current += _tzcnt_u32(not_digit);
+					buffer_pos += _tzcnt_u32(not_digit);
+					break;
+					}
+				current += 32;
+				buffer_pos += 32;
+				}
+#endif
 			while (ascii::isdigit(*current))
 				{
 				if (buffer_pos < buffer_end)
@@ -574,6 +694,36 @@ namespace JASS
 		JASS_assert(unittest_count("Zap\xE1\x8E\xA0") == 1);
 		JASS_assert(unittest_count("123\xE2\x85\xA9") == 1);
 
+		/*
+			Check long runs of white space, alphabetics (with case folding), and digits, long enough to be processed 32 bytes at a time.
+			Including an ASCII run that continues as Unicode (where E-acute folds to e) and a token that must be truncated.
+		*/
+		std::string long_tokens = std::string(40, ' ') + "HelloWorldThisIsAVeryLongTokenOfLettersABCDEFGH\t\n 12345678901234567890123456789012345678 ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJ\xC3\x89" "cole " + std::string(2000, 'Q') + " end of the string";
+		std::string long_tokens_answer[] =
+			{
+			"helloworldthisisaverylongtokenoflettersabcdefgh",
+			"12345678901234567890123456789012345678",
+			"abcdefghijklmnopqrstuvwxyzabcdefghijecole",
+			std::string(token::max_token_length, 'q'),
+			"end",
+			"of",
+			"the",
+			"string"
+			};
+		(void)long_tokens_answer;				// Silence the  "Unused variable" message when in Release
+		tokenizer.set_document(long_tokens);
+		count = 0;
+		do
+			{
+			const auto &token = tokenizer.get_next_token();
+			if (token.type != token::eof)
+				JASS_assert(std::string((char *)token.lexeme.address(), token.lexeme.size()) == long_tokens_answer[count]);
+			count++;
+			type = token.type;
+			}
+		while (type != token::eof);
+		JASS_assert(count == 9);
+
 		/*
 			Check unusual cases
 		*/
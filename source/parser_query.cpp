@@ -4,6 +4,7 @@
 	Copyright (c) 2017 Andrew Trotman
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
+#include <random>
 #include <sstream>
 #include <algorithm>
 
@@ -142,6 +143,42 @@ namespace JASS
 		return valid_token;
 		}
 
+	/*
+		PARSER_QUERY::GET_NEXT_TOKEN_ASCII()
+		------------------------------------
+	*/
+	parser_query::token_status parser_query::get_next_token_ascii(slice &token)
+		{
+		/*
+			Skip over everything that isn't alpha-numeric
+		*/
+		while (current < end_of_query && !ascii::isalnum(*current))
+			current++;
+
+		if (current >= end_of_query)
+			return eof_token;
+
+		/*
+			The token is the sequence of alphas (lowercased) or of numerics
+		*/
+		uint8_t *start_of_token = buffer_pos;
+		if (ascii::isalpha(*current))
+			do
+				*buffer_pos++ = ascii::tolower(*current++);
+			while (current < end_of_query && ascii::isalpha(*current));
+		else
+			do
+				*buffer_pos++ = *current++;
+			while (current < end_of_query && ascii::isdigit(*current));
+
+		/*
+			'\0' terminate then write to the slice
+		*/
+		token = slice(start_of_token, buffer_pos - start_of_token);
+		*buffer_pos++ = '\0';
+		return valid_token;
+		}
+
 	/*
 		PARSER_QUERY::UNITTEST_TEST_ONE()
 		---------------------------------
@@ -229,6 +266,56 @@ namespace JASS
 		for (const auto &term : *raw_tokens)
 			raw_answer << term;
 		JASS_assert(raw_answer.str() == "(.,1)(;,1)(A,1)");
+		JASS_assert(parser->get_normalised_query() == ". ; A");
+		delete raw_tokens;
+
+		/*
+			Duplicates are counted and the normalised query is the same regardless of case, order, and punctuation
+		*/
+		got = unittest_test_one(parser, memory, "the cat, THE hat; the 2 cats");
+		JASS_assert(got == "(2,1)(cat,1)(hat,1)(the,3)(cats,1)");
+		JASS_assert(parser->get_normalised_query() == "2 cat hat the the the cats");
+		got = unittest_test_one(parser, memory, parser->get_normalised_query());
+		JASS_assert(got == "(2,1)(cat,1)(hat,1)(the,3)(cats,1)");
+		JASS_assert(parser->get_normalised_query() == "2 cat hat the the the cats");
+
+		/*
+			A query too long for the fixed buffer (so the terms are allocated) gives the same answer
+		*/
+		std::string long_query;
+		for (size_t word = 0; word < fixed_buffer_size; word++)
+			long_query += "A ";
+		got = unittest_test_one(parser, memory, long_query);
+		JASS_assert(got == "(a," + std::to_string(fixed_buffer_size) + ")");
+
+		/*
+			The ASCII parser and the Unicode parser give the same terms for random ASCII queries (containing every ASCII character)
+		*/
+		std::mt19937 random(17);
+		for (size_t test = 0; test < 1000; test++)
+			{
+			std::string ascii_query;
+			size_t length = random() % 40;
+			for (size_t byte = 0; byte < length; byte++)
+				ascii_query += static_cast<char>(random() % 2 == 0 ? random() % 0x80 : "aZ9 "[random() % 4]);
+
+			query_term_list *expected_tokens = new query_term_list;
+			parser->current = (uint8_t *)const_cast<char *>(ascii_query.c_str());
+			parser->end_of_query = parser->current + ascii_query.size();
+			parser->buffer_pos = (uint8_t *)memory.malloc(unicode::max_casefold_expansion_factor * unicode::max_utf8_bytes * ascii_query.size() + 1);
+			parser->buffer_end = parser->buffer_pos + unicode::max_casefold_expansion_factor * unicode::max_utf8_bytes * ascii_query.size() + 1;
+			slice term;
+			token_status status;
+			while ((status = parser->get_next_token(term)) != eof_token)
+				if (status == valid_token)
+					expected_tokens->push_back(term);
+			expected_tokens->sort_unique();
+			std::ostringstream expected;
+			expected << *expected_tokens;
+			delete expected_tokens;
+
+			JASS_assert(unittest_test_one(parser, memory, ascii_query) == expected.str());
+			}
 
 		delete parser;
 
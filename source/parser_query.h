@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <string>
+
 #include "allocator.h"
 #include "dynamic_array.h"
 #include "query_term_list.h"
@@ -26,9 +28,18 @@ namespace JASS
 	*/
 	/*!
 		@brief Simple interface to parsing queries
+		@details Most queries are a few short ASCII words, so those (and all raw queries) that fit are normalised into a buffer that is part of
+		the parser (so a parser should not be shared between threads) rather than one allocated for each query, using the ASCII character tables
+		rather than the Unicode ones, and duplicate terms are counted as they are found.  All other queries go through the Unicode parser
+		(the two give the same terms for ASCII queries).  After parsing, the normalised query (the unique terms in sorted order, each
+		repeated as many times as it occurs, seperated by spaces) is available from get_normalised_query(), and two queries with the same
+		normalised query have the same query_term_list, so it can be used as the key of a results cache.
 	*/
 	class parser_query
 		{
+		private:
+			static constexpr size_t fixed_buffer_size = 4096;		///< The size of the buffer used to normalise short ASCII queries.
+
 		private:
 			/*!
 				@enum token_status
@@ -59,6 +70,8 @@ namespace JASS
 			uint8_t *end_of_query;					///< Pointer to the end of the inoput query string.
 			uint8_t *buffer_pos;						///< Loction where the next token will be written during tokenization and normaloisation.
 			uint8_t *buffer_end;						///< End of the normalised token buffer.
+			std::string normalised;					///< The normalised query (see get_normalised_query()).
+			uint8_t fixed_buffer[fixed_buffer_size];	///< The normalised token buffer for short ASCII queries.
 
 		private:
 			/*
@@ -81,6 +94,54 @@ namespace JASS
 			*/
 			token_status get_next_token_raw(slice &token);
 
+			/*
+				PARSER_QUERY::GET_NEXT_TOKEN_ASCII()
+				------------------------------------
+			*/
+			/*!
+				@brief Return the next parsed token from an ASCII query, this is the same as get_next_token() but uses the ASCII character tables.
+				@param token [in] a slice of the token.
+			*/
+			token_status get_next_token_ascii(slice &token);
+
+			/*
+				PARSER_QUERY::IS_ASCII()
+				------------------------
+			*/
+			/*!
+				@brief Check whether a string is entirely ASCII (has no bytes with the high bit set).
+				@param start [in] The start of the string.
+				@param end [in] The end of the string.
+				@return true if ASCII, else false.
+			*/
+			static bool is_ascii(const uint8_t *start, const uint8_t *end)
+				{
+				uint8_t all = 0;
+				while (start < end)
+					all |= *start++;
+				return all < 0x80;
+				}
+
+			/*
+				PARSER_QUERY::NORMALISE()
+				-------------------------
+			*/
+			/*!
+				@brief Construct the normalised query (see get_normalised_query()) from the parsed query.
+				@param parsed_query [in] The parsed query (after sort_unique()).
+			*/
+			void normalise(query_term_list &parsed_query)
+				{
+				normalised.clear();			// keeps its capacity, so after the first few queries this does not allocate
+				for (const auto &term : parsed_query)
+					for (size_t occurence = 0; occurence < term.frequency(); occurence++)
+						{
+						if (normalised.size() != 0)
+							normalised += ' ';
+						normalised.append(reinterpret_cast<const char *>(term.token().address()), term.token().size());
+						}
+				}
+
 			/*
 				PARSER_QUERY::UNITTEST_TEST_ONE()
 				---------------------------------
@@ -126,6 +187,33 @@ namespace JASS
 				current = (uint8_t *)(const_cast<char *>(query.c_str()));							// get a pointer to the start of the query string
 				end_of_query = current + query.size();			// get a pointer to the end of the query string
 
+				/*
+					If the list is empty (so none of the terms already in it are in fixed_buffer) and the query is ASCII and short, then
+					normalise into fixed_buffer.  ASCII tokens are no longer than the query and each is followed by a '\0'.
+				*/
+				slice term;												// Each term as returned by the parser.
+				token_status status;
+				if (parsed_query.size() == 0 && 2 * query.size() <= fixed_buffer_size && (which_parser == parser_type::raw || is_ascii(current, end_of_query)))
+					{
+					buffer_pos = fixed_buffer;
+					buffer_end = fixed_buffer + fixed_buffer_size;
+
+					if (which_parser == parser_type::query)
+						{
+						while ((status = get_next_token_ascii(term)) != eof_token)
+							parsed_query.push_back_unique(term);
+						}
+					else	// (which_parser == parser_type::raw)
+						{
+						while ((status = get_next_token_raw(term)) != eof_token)
+							parsed_query.push_back_unique(term);
+						}
+
+					parsed_query.sort_unique();			// the duplicates are already counted, but the terms must be in the same order as the general case
+					normalise(parsed_query);
+					return;
+					}
+
 				/*
 					Allocate space for the normalised query terms
 				*/
@@ -138,8 +226,6 @@ namespace JASS
 				/*
 					Parse the query to get all of the search terms
 				*/
-				slice term;												// Each term as returned by the parser.
-				token_status status;
 				if (which_parser == parser_type::query)
 					{
 					while ((status = get_next_token(term)) != eof_token)		// get the next token
@@ -157,6 +243,22 @@ namespace JASS
 					Now unique the terms in the query and increment the occurence accounts appropriately.
 				*/
 				parsed_query.sort_unique();
+				normalise(parsed_query);
+				}
+
+			/*
+				PARSER_QUERY::GET_NORMALISED_QUERY()
+				------------------------------------
+			*/
+			/*!
+				@brief Return the normalised form of the last query parsed (its unique terms in sorted order, each repeated as many times as
+				it occurs in the query, seperated by spaces).  Queries with the same normalised form have the same query_term_list so it can be
+				used as a cache key.
+				@return The normalised query (valid until the next call to parse()).
+			*/
+			const std::string &get_normalised_query(void) const
+				{
+				return normalised;
 				}
 
 			/*
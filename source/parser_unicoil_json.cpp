@@ -44,6 +44,23 @@ namespace JASS
 		const auto &token3 = tokenizer.get_next_token();
 		JASS_assert(token3.type == token::eof);
 
+		/*
+			Impacts of 0 are skipped, escapes stay in the term, structural characters in terms are part of the term, and a long document crosses the 64-byte blocks of the scanner
+		*/
+		std::string longer = "\"[SEP]\": 0, \"a\\\"b\": 7, \"c:d,{}\": 12";
+		std::string expected = "a\\\"b 7 c:d,{} 12 ";
+		for (size_t term = 0; term < 20; term++)
+			{
+			longer += ", \"term" + std::to_string(term) + "\": " + std::to_string(term + 1);
+			expected += "term" + std::to_string(term) + " " + std::to_string(term + 1) + " ";
+			}
+		tokenizer.set_document(longer);
+
+		std::string got;
+		for (const auto *token = &tokenizer.get_next_token(); token->type != token::eof; token = &tokenizer.get_next_token())
+			got += std::string(reinterpret_cast<char *>(token->lexeme.address()), token->lexeme.size()) + " " + std::to_string(token->count) + " ";
+		JASS_assert(got == expected);
+
 		/*
 			Success
 		*/
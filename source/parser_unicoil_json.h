@@ -22,11 +22,12 @@
 */
 #pragma once
 
-#include <charconv>
+#include <vector>
 
 #include "ascii.h"
 #include "parser.h"
 #include "unicode.h"
+#include "json_scanner.h"
 
 namespace JASS
 	{
@@ -39,6 +40,28 @@ namespace JASS
 	*/
 	class parser_unicoil_json : public parser
 		{
+		private:
+			json_scanner scanner;						///< Finds the structural characters (quotes, colons, commas, etc.) of the document
+			std::vector<uint32_t> structural;		///< The positions of the structural characters in the document (grown, but never shrunk)
+			size_t structurals;							///< The number of structural characters in the document
+			size_t next_structural;						///< The next structural character to look at
+			const uint8_t *start_of_document;		///< The start of the document (the positions are relative to this)
+
+		private:
+			/*
+				PARSER_UNICOIL_JSON::INDEX()
+				----------------------------
+			*/
+			/*!
+				@brief Find the structural characters of the document (which starts at current).
+			*/
+			void index(void)
+				{
+				start_of_document = current;
+				structurals = scanner.index(current, end_of_document, structural);
+				next_structural = 0;
+				}
+
 		public:
 			/*
 				PARSER_UNICOIL_JSON::PARSER_UNICOIL_JSON()
@@ -48,7 +71,10 @@ namespace JASS
 				@brief Constructor
 			*/
 			parser_unicoil_json() :
-				parser()
+				parser(),
+				structurals(0),
+				next_structural(0),
+				start_of_document(nullptr)
 				{
 				/* Nothing */
 				}
@@ -67,94 +93,100 @@ namespace JASS
 				*/
 				}
 
+			/*
+				PARSER_UNICOIL_JSON::SET_DOCUMENT()
+				-----------------------------------
+			*/
+			/*!
+				@brief Start parsing from the start of this document.
+				@param document [in] Start parsing from the start of this document.
+			*/
+			virtual void set_document(const class document &document)
+				{
+				parser::set_document(document);
+				index();
+				}
+
+			/*
+				PARSER_UNICOIL_JSON::SET_DOCUMENT()
+				-----------------------------------
+			*/
+			/*!
+				@brief Parse a string (rather than a document).
+				@param document [in] The string to parse.
+			*/
+			virtual void set_document(const std::string &document)
+				{
+				parser::set_document(document);
+				index();
+				}
+
 			/*
 				PARSER_UNICOIL_JSON::GET_NEXT_TOKEN()
 				-------------------------------------
 			*/
 			/*!
 				@brief Continue parsing the input looking for the next token.  Note that the definition of token here is no the normal JASS definition, ##term (and worse) are considered tokens!
+				@details Only the structural characters are looked at.  A term is a string followed by a colon, and the impact is the digits
+				between the colon and the next structural character.  Terms with an impact of 0 are skipped.
 				@return A reference to a token object that is valid until either the next call to get_next_token() or the parser is destroyed.
 			*/
 			virtual const class parser::token &get_next_token(void)
 				{
-				/*
-					Check for EOF
-				*/
-				if (current >= end_of_document)
-					return eof_token;
-
-				/*
-					Set up the parser
-				*/
-				uint8_t *buffer_pos = current_token.buffer;
-				uint8_t *buffer_end = current_token.buffer + sizeof(current_token.buffer);
-
-				/*
-					Find the term
-				*/
-				while (current < end_of_document)
+				while (next_structural < structurals)
 					{
-					if (*current == '"')
-						break;
-					current++;
-					}
-
-				current++;
-
-				/*
-					Copy the term to the token buffer
-				*/
-				while (current < end_of_document)
-					{
-					if (*current == '\\')
+					/*
+						Find the next string, its closing quote is the next structural character as there are none inside a string
+					*/
+					const uint8_t *term_start = start_of_document + structural[next_structural++];
+					if (*term_start != '"' || next_structural >= structurals)
+						continue;
+					term_start++;
+					const uint8_t *term_end = start_of_document + structural[next_structural++];
+
+					/*
+						It's a term if it's followed by a colon (otherwise it's a value)
+					*/
+					if (next_structural >= structurals || start_of_document[structural[next_structural]] != ':')
+						continue;
+					const uint8_t *count_start = start_of_document + structural[next_structural++] + 1;
+					const uint8_t *count_end = next_structural < structurals ? start_of_document + structural[next_structural] : end_of_document;
+
+					/*
+						Get the impact
+					*/
+					while (count_start < count_end && !ascii::isdigit(*count_start))
+						count_start++;
+					size_t count = 0;
+					while (count_start < count_end && ascii::isdigit(*count_start))
 						{
-						if (buffer_pos < buffer_end)
-							*buffer_pos++ = *current;
-						current++;				// escaped characters in JSON
+						if (count < 1'000'000'000)					// don't overflow (it'll be too large anyway)
+							count = count * 10 + *count_start - '0';
+						count_start++;
 						}
-					else if (*current == '"')
-						break;
-					if (buffer_pos < buffer_end)
-						*buffer_pos++ = *current;
-					current++;
-					}
+					if (count == 0)
+						continue;
 
-				/*
-					Find the term count
-				*/
-				while (current < end_of_document)
-					{
-					if (ascii::isdigit(*current))
-						break;
-					current++;
-					}
-
-				const uint8_t *count_start = current;
-
-				while (current < end_of_document)
-					{
-					if (!ascii::isdigit(*current))
-						break;
-					current++;
-					}
+					/*
+						Construct a token object.  The term is as it is in the JSON (escapes and all) and is not copied, the lexeme is part of the document
+					*/
+					size_t length = static_cast<size_t>(term_end - term_start) < token::max_token_length ? term_end - term_start : token::max_token_length;
+					current_token.lexeme = slice((void *)term_start, length);
+					current_token.type = token::alpha;
 
-				const uint8_t *count_finish = current;
-
-				/*
-					Construct a token object
-				*/
-				current_token.lexeme = slice((void *)current_token.buffer, (void *)buffer_pos);
-				current_token.type = token::alpha;
-				std::from_chars((char *)count_start, (char *)count_finish, current_token.count);
+					if (count > index_postings_impact::largest_impact)
+						{
+						std::cout << current_token.lexeme;
+						std::cout << " " << count << "\n";
+						count = index_postings_impact::largest_impact;
+						}
+					current_token.count = static_cast<index_postings_impact::impact_type>(count);
 
-				if (current_token.count > index_postings_impact::largest_impact)
-					{
-					std::cout << current_token.lexeme;
-					std::cout << " " << current_token.count << "\n";
-					current_token.count = index_postings_impact::largest_impact;
+					return current_token;
 					}
 
-				return current_token.count > 0 ? current_token : get_next_token();
+				current = end_of_document;
+				return eof_token;
 				}
 
 			/*
@@ -13,15 +13,40 @@
 #pragma once
 
 #include <math.h>
+#include <string.h>
 
+#include <map>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sstream>
 #include <iostream>
+#include <algorithm>
 
 #include "index_manager.h"
+#include "serialise_fan_out.h"
+#include "collection_statistics.h"
 #include "index_manager_sequential.h"
 #include "ranking_function_atire_bm25.h"
 
 namespace JASS
 	{
+	/*
+		ENUM QUANTIZATION_METHOD
+		------------------------
+	*/
+	/*!
+		@brief How scores are mapped into the impact range.
+	*/
+	enum class quantization_method
+		{
+		uniform,					///< Uniform quantization between the smallest and largest score in the collection (Anh et al.)
+		logarithmic,			///< Log-scale, giving more impacts to the (many) low scores and fewer to the (few) high scores
+		equi_depth,				///< Equi-depth (quantile), each impact holds about the same number of postings across the collection
+		per_term					///< Each term's own postings are spread (by quantile) over the impacts that uniform quantization gives its range
+		};
+
 	/*
 		CLASS QUANTIZE
 		--------------
@@ -31,23 +56,470 @@ namespace JASS
 		@details Generic quantization class that performs uniform quantization according to the equations in
 		V. N. Anh, O. de Kretser, A. Moffat (2001) Vector-space ranking with effective early termination. SIGIR 2001, PP.35-42.
 		The ranking function itself is a template parameter, and also passed to the constructor as the ranker
-		might need initialisation (BM25 does).
+		might need initialisation (BM25 does).  The ranker must provide compute_scores() which scores a whole postings list (or part of one) at once.
 
 		Uniform quantization if most effedctive for BM25 was BM25 has an exponential decay in the rsv scores and
 		so high impact segments are short and low impact scores are long.  The best documents have high impact scores
 		for each query term and so have high result list rsvs are rare.  Uniform quantization also does not require
 		decoding so the cost of ranking is an integer add!
+
+		However, uniform quantization also wastes most impacts on the few high scores and leaves huge low impact segments, which
+		an anytime search processes last (if at all) under a postings budget.  The other quantization_methods spread the postings
+		more evenly over the impacts.  Equi-depth counts the scores in the first pass (in a histogram keyed on the top bits of the
+		float score, so no bounds are needed) and maps each score through a table built from it.  Per-term quantization keeps each
+		term's smallest and largest score where uniform quantization puts them (so terms remain comparable) and spreads the term's
+		postings evenly between.
+
+		An index built from part of a collection (a shard, or a delta added to a base index) can be quantized against the
+		collection_statistics of the whole collection (see use_statistics()), in which case the scores are computed from those
+		statistics and quantized between their bounds, and so each document gets the same impacts it would get in the whole collection.
 	*/
 	template <typename RANKER>
 	class quantize : public index_manager::delegate, public index_manager::quantizing_delegate
 		{
+		private:
+			static constexpr size_t BATCH_POSTINGS = 1 << 20;		///< With more than one thread, score a batch once it holds this many postings
+			static constexpr size_t BATCH_ITEMS = 16 * 1024;		///< With more than one thread, score a batch once it holds this many postings lists
+			static constexpr size_t HISTOGRAM_SHIFT = 12;			///< Equi-depth histogram bins are the top (32 - HISTOGRAM_SHIFT) bits of the (order preserving) float score
+			static constexpr size_t HISTOGRAM_BINS = static_cast<size_t>(1) << (32 - HISTOGRAM_SHIFT);		///< The number of equi-depth histogram bins
+
+			/*
+				CLASS QUANTIZE::ITEM
+				--------------------
+			*/
+			/*!
+				@brief A postings list in a batch
+			*/
+			class item
+				{
+				public:
+					slice term;												///< The term
+					const index_postings *postings;					///< The postings list
+					size_t postings_start;								///< Where the postings start in the batch's document_ids and term_frequencies
+					compress_integer::integer document_frequency;	///< The document frequency of the term (the length of the postings list)
+					compress_integer::integer scoring_frequency;		///< The document frequency of the term to score with (from the collection_statistics if there are any)
+					uint64_t collection_frequency;						///< The number of times the term occurs in the collection (from the collection_statistics if there are any)
+				};
+
+			/*
+				CLASS QUANTIZE::BATCH
+				---------------------
+			*/
+			/*!
+				@brief A sequence of postings lists to be scored by the threads
+			*/
+			class batch
+				{
+				public:
+					index_manager::delegate *writer;														///< The writer to pass the quantized lists to (or nullptr if computing the bounds)
+					std::vector<item> items;																///< The postings lists in order
+					std::vector<compress_integer::integer> document_ids;							///< The document ids of all the postings lists
+					std::vector<index_postings_impact::impact_type> term_frequencies;		///< The term frequencies of all the postings lists (which become the impacts)
+
+				public:
+					/*
+						QUANTIZE::BATCH::BATCH()
+						------------------------
+					*/
+					/*!
+						@brief Constructor
+					*/
+					batch() :
+						writer(nullptr)
+						{
+						/* Nothing */
+						}
+				};
+
 		private:
 			double largest_rsv;												///< The largest score seen for any document/term pair.
 			double smallest_rsv;												///< The smallest score seen for any document/term pair.
 			std::shared_ptr<RANKER> ranker;								///< The ranker to use for quantization.
 			compress_integer::integer documents_in_collection;		///< The number of documents in the collection.
+			size_t threads;													///< The number of threads used to score the postings.
+			std::vector<std::vector<double>> scores;					///< Each thread's buffer for the scores of the postings it is scoring.
+			std::vector<double> thread_largest_rsv;					///< The largest score seen by each thread in the batch being processed.
+			std::vector<double> thread_smallest_rsv;					///< The smallest score seen by each thread in the batch being processed.
+			batch filling;														///< The batch being added to.
+			batch processing;													///< The batch the threads are scoring.
+			std::vector<std::thread> workers;							///< The threads scoring processing.
+			quantization_method method;									///< How scores are mapped to impacts.
+			std::vector<std::vector<uint64_t>> histogram;			///< Each thread's count of the scores in each equi-depth bin.
+			std::vector<index_postings_impact::impact_type> bin_impact;		///< The impact of each equi-depth bin (built once the bounds are known).
+			std::vector<std::vector<double>> sorted;					///< Each thread's buffer for the sorted scores of a term (for per-term quantization).
+			const collection_statistics *statistics;					///< If not nullptr then score with these statistics and quantize between their bounds (see use_statistics()).
 			static constexpr double impact_range = index_postings_impact::largest_impact - index_postings_impact::smallest_impact; ///< The number of values in the impact ordering range (normally 255).
 
+		private:
+			/*
+				QUANTIZE::COLLECTION_FREQUENCY()
+				--------------------------------
+			*/
+			/*!
+				@brief Return the number of times a term occurs in the collection (the sum of its term frequencies).
+				@param term_frequencies [in] The term frequencies of the term.
+				@param document_frequency [in] The length of term_frequencies.
+				@return The collection frequency.
+			*/
+			static uint64_t collection_frequency(const index_postings_impact::impact_type *term_frequencies, compress_integer::integer document_frequency)
+				{
+				uint64_t sum = 0;
+				for (compress_integer::integer which = 0; which < document_frequency; which++)
+					sum += term_frequencies[which];
+				return sum;
+				}
+
+			/*
+				QUANTIZE::SCORING_FREQUENCIES()
+				-------------------------------
+			*/
+			/*!
+				@brief Replace the document frequency and collection frequency of a term with those from the collection_statistics (if there are any, and the term is in them).
+				@param term [in] The term.
+				@param document_frequency [in / out] The document frequency of the term.
+				@param collection_frequency [in / out] The number of times the term occurs in the collection.
+			*/
+			void scoring_frequencies(const slice &term, compress_integer::integer &document_frequency, uint64_t &collection_frequency) const
+				{
+				collection_statistics::term_statistics whole;
+				if (statistics != nullptr && statistics->find(term, whole))
+					{
+					document_frequency = whole.document_frequency;
+					collection_frequency = whole.collection_frequency;
+					}
+				}
+
+			/*
+				QUANTIZE::BOUND()
+				-----------------
+			*/
+			/*!
+				@brief Score (part of) a postings list and update the smallest and largest scores seen.
+				@param thread_number [in] The thread doing the scoring.
+				@param document_frequency [in] The document frequency of the term.
+				@param collection_frequency [in] The number of times the term occurs in the collection.
+				@param document_ids [in] The document ids to score.
+				@param term_frequencies [in] The term frequencies (corresponding to document_ids).
+				@param postings [in] The number of postings to score.
+				@param smallest [in / out] The smallest score seen.
+				@param largest [in / out] The largest score seen.
+			*/
+			void bound(size_t thread_number, compress_integer::integer document_frequency, uint64_t collection_frequency, const compress_integer::integer *document_ids, const index_postings_impact::impact_type *term_frequencies, size_t postings, double &smallest, double &largest)
+				{
+				auto &score = scores[thread_number];
+				if (score.size() < postings)
+					score.resize(postings);
+				ranker->compute_scores(&score[0], document_frequency, collection_frequency, documents_in_collection, document_ids, term_frequencies, postings);
+
+				/*
+					Keep a running tally of the largest and smallest rsv we've seen so far
+				*/
+				double low = smallest;
+				double high = largest;
+				for (size_t which = 0; which < postings; which++)
+					{
+					low = score[which] < low ? score[which] : low;
+					high = score[which] > high ? score[which] : high;
+					}
+				smallest = low;
+				largest = high;
+
+				if (method == quantization_method::equi_depth)
+					{
+					auto &count = histogram[thread_number];
+					for (size_t which = 0; which < postings; which++)
+						count[bin(score[which])]++;
+					}
+				}
+
+			/*
+				QUANTIZE::BIN()
+				---------------
+			*/
+			/*!
+				@brief Return the equi-depth histogram bin of a score.
+				@details The bits of a float are made order preserving (flip all the bits of negatives, and the sign bit of positives) and the top bits are the bin.
+				@param score [in] The score.
+				@return The bin the score falls into.
+			*/
+			static size_t bin(double score)
+				{
+				float as_float = static_cast<float>(score);
+				uint32_t bits;
+				memcpy(&bits, &as_float, sizeof(bits));
+				bits = (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+				return bits >> HISTOGRAM_SHIFT;
+				}
+
+			/*
+				QUANTIZE::UNIFORM()
+				-------------------
+			*/
+			/*!
+				@brief Uniformly quantize a score between the smallest and largest score in the collection.
+				@details This uses Uniform Quantiization as defined by Anh et al. in:
+				Vo Ngoc Anh, Owen de Kretser, and Alistair Moffat. 2001. Vector-space ranking with effective early termination. In Proceedings of the 24th annual international ACM SIGIR conference on Research and development in information retrieval (SIGIR '01). ACM, New York, NY, USA, 35-42. DOI: https://doi.org/10.1145/383952.383957
+				@param score [in] The score.
+				@return The impact.
+			*/
+			index_postings_impact::impact_type uniform(double score) const
+				{
+				return static_cast<index_postings_impact::impact_type>(((score - smallest_rsv) / (largest_rsv - smallest_rsv)) * impact_range) + index_postings_impact::smallest_impact;
+				}
+
+			/*
+				QUANTIZE::BUILD_EQUI_DEPTH_TABLE()
+				----------------------------------
+			*/
+			/*!
+				@brief Once all the scores have been counted, compute the impact of each histogram bin so that each impact holds about the same number of postings.
+				@details A bin's impact is that of the middle of its postings, so a bin holding many postings may skip impacts, but the mapping never decreases.
+			*/
+			void build_equi_depth_table(void)
+				{
+				std::vector<uint64_t> &count = histogram[0];
+				for (size_t thread = 1; thread < threads; thread++)
+					for (size_t which = 0; which < HISTOGRAM_BINS; which++)
+						count[which] += histogram[thread][which];
+
+				uint64_t total = 0;
+				for (auto frequency : count)
+					total += frequency;
+
+				bin_impact.resize(HISTOGRAM_BINS);
+				double levels = impact_range + 1;
+				uint64_t before = 0;
+				for (size_t which = 0; which < HISTOGRAM_BINS; which++)
+					{
+					double level = total == 0 ? 0 : floor((before + count[which] / 2.0) * levels / total);
+					bin_impact[which] = static_cast<index_postings_impact::impact_type>((std::min)(level, impact_range)) + index_postings_impact::smallest_impact;
+					before += count[which];
+					}
+
+				histogram.clear();
+				histogram.shrink_to_fit();
+				}
+
+			/*
+				QUANTIZE::QUANTIZE_POSTINGS()
+				-----------------------------
+			*/
+			/*!
+				@brief Score (part of) a postings list and replace each term frequency with the quantized score (the impact).
+				@param thread_number [in] The thread doing the scoring.
+				@param document_frequency [in] The document frequency of the term.
+				@param collection_frequency [in] The number of times the term occurs in the collection.
+				@param document_ids [in] The document ids to score.
+				@param term_frequencies [in / out] The term frequencies (corresponding to document_ids), which become the impacts.
+				@param postings [in] The number of postings to score.
+			*/
+			void quantize_postings(size_t thread_number, compress_integer::integer document_frequency, uint64_t collection_frequency, const compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies, size_t postings)
+				{
+				auto &score = scores[thread_number];
+				if (score.size() < postings)
+					score.resize(postings);
+				ranker->compute_scores(&score[0], document_frequency, collection_frequency, documents_in_collection, document_ids, term_frequencies, postings);
+
+				/*
+					Scores from the collection_statistics might fall outside their bounds (which are those of the whole collection), so clip them.
+				*/
+				if (statistics != nullptr)
+					for (size_t which = 0; which < postings; which++)
+						score[which] = (std::min)((std::max)(score[which], smallest_rsv), largest_rsv);
+
+				/*
+					Quantize and write back as the new term frequency (which is now an impact score).
+				*/
+				switch (method)
+					{
+					case quantization_method::uniform:
+						for (size_t which = 0; which < postings; which++)
+							term_frequencies[which] = uniform(score[which]);
+						break;
+					case quantization_method::logarithmic:
+						{
+						/*
+							impact = log(1 + r * x) / log(1 + r) where x is the uniform position in [0, 1] and r is the impact range.
+						*/
+						double log_range = log1p(impact_range);
+						double range = largest_rsv - smallest_rsv;
+						for (size_t which = 0; which < postings; which++)
+							term_frequencies[which] = static_cast<index_postings_impact::impact_type>((log1p(impact_range * ((score[which] - smallest_rsv) / range)) / log_range) * impact_range) + index_postings_impact::smallest_impact;
+						break;
+						}
+					case quantization_method::equi_depth:
+						for (size_t which = 0; which < postings; which++)
+							term_frequencies[which] = bin_impact[bin(score[which])];
+						break;
+					case quantization_method::per_term:
+						{
+						/*
+							The term's smallest score gets the impact uniform quantization gives it, as does the largest, and the rest go by how many
+							of the term's scores are smaller.  The list is never split between threads (see start()) so this is the whole list.
+						*/
+						auto &order = sorted[thread_number];
+						order.assign(score.begin(), score.begin() + postings);
+						std::sort(order.begin(), order.end());
+						auto low = uniform(order.front());
+						auto high = uniform(order.back());
+						double below_largest = static_cast<double>(std::lower_bound(order.begin(), order.end(), order.back()) - order.begin());
+						for (size_t which = 0; which < postings; which++)
+							{
+							if (below_largest == 0)
+								term_frequencies[which] = low;
+							else
+								{
+								double below = static_cast<double>(std::lower_bound(order.begin(), order.end(), score[which]) - order.begin());
+								term_frequencies[which] = static_cast<index_postings_impact::impact_type>(low + static_cast<index_postings_impact::impact_type>((below / below_largest) * (high - low)));
+								}
+							}
+						break;
+						}
+					}
+				}
+
+			/*
+				QUANTIZE::WORK()
+				----------------
+			*/
+			/*!
+				@brief Score the postings from first to last (counting from the start of the batch) of processing.  Lists are split between threads so that each thread scores about the same number of postings.
+				@param thread_number [in] The thread doing the scoring.
+				@param first [in] The first posting to score.
+				@param last [in] One past the last posting to score.
+			*/
+			void work(size_t thread_number, size_t first, size_t last)
+				{
+				double smallest = (std::numeric_limits<double>::max)();
+				double largest = (std::numeric_limits<double>::lowest)();
+
+				/*
+					Find the list that holds the first posting then score from there to last
+				*/
+				auto current = std::upper_bound(processing.items.begin(), processing.items.end(), first, [](size_t posting, const item &list) { return posting < list.postings_start; }) - 1;
+				for (size_t from = first; from < last; ++current)
+					{
+					size_t to = (std::min)(last, current->postings_start + current->document_frequency);
+					if (processing.writer == nullptr)
+						bound(thread_number, current->scoring_frequency, current->collection_frequency, &processing.document_ids[from], &processing.term_frequencies[from], to - from, smallest, largest);
+					else
+						quantize_postings(thread_number, current->scoring_frequency, current->collection_frequency, &processing.document_ids[from], &processing.term_frequencies[from], to - from);
+					from = to;
+					}
+
+				thread_smallest_rsv[thread_number] = smallest;
+				thread_largest_rsv[thread_number] = largest;
+				}
+
+			/*
+				QUANTIZE::START()
+				-----------------
+			*/
+			/*!
+				@brief Start the threads scoring the batch in processing.
+			*/
+			void start(void)
+				{
+				size_t postings = processing.document_ids.size();
+				if (method == quantization_method::per_term && processing.writer != nullptr)
+					{
+					/*
+						Per-term quantization needs all of a postings list, so move the split points to the start of the next list
+					*/
+					auto split = [this, postings](size_t posting)
+						{
+						auto next = std::lower_bound(processing.items.begin(), processing.items.end(), posting, [](const item &list, size_t at) { return list.postings_start < at; });
+						return next == processing.items.end() ? postings : next->postings_start;
+						};
+					for (size_t which = 0; which < threads; which++)
+						workers.push_back(std::thread(&quantize::work, this, which, split(postings * which / threads), split(postings * (which + 1) / threads)));
+					}
+				else
+					for (size_t which = 0; which < threads; which++)
+						workers.push_back(std::thread(&quantize::work, this, which, postings * which / threads, postings * (which + 1) / threads));
+				}
+
+			/*
+				QUANTIZE::COMPLETE()
+				--------------------
+			*/
+			/*!
+				@brief Wait for the threads to finish the batch in processing, then either merge their bounds or pass the quantized lists to the writer (in order).
+			*/
+			void complete(void)
+				{
+				if (workers.size() == 0)
+					return;
+
+				for (auto &worker : workers)
+					worker.join();
+				workers.clear();
+
+				if (processing.writer == nullptr)
+					for (size_t which = 0; which < threads; which++)
+						{
+						smallest_rsv = (std::min)(smallest_rsv, thread_smallest_rsv[which]);
+						largest_rsv = (std::max)(largest_rsv, thread_largest_rsv[which]);
+						}
+				else
+					for (const auto &list : processing.items)
+						(*processing.writer)(list.term, *list.postings, list.document_frequency, &processing.document_ids[list.postings_start], &processing.term_frequencies[list.postings_start]);
+
+				processing.items.clear();
+				processing.document_ids.clear();
+				processing.term_frequencies.clear();
+				}
+
+			/*
+				QUANTIZE::ADD()
+				---------------
+			*/
+			/*!
+				@brief Add a postings list to the batch being filled, and once full score it while the next batch is filled.
+				@param writer [in] The writer to pass the quantized list to (or nullptr if computing the bounds).
+				@param term [in] The term name.
+				@param postings [in] The postings list.
+				@param document_frequency [in] The document frequency of the term
+				@param document_ids [in] An array (of length document_frequency) of document ids.
+				@param term_frequencies [in] An array (of length document_frequency) of term frequencies (corresponding to document_ids).
+			*/
+			void add(index_manager::delegate *writer, const slice &term, const index_postings &postings, compress_integer::integer document_frequency, const compress_integer::integer *document_ids, const index_postings_impact::impact_type *term_frequencies)
+				{
+				compress_integer::integer scoring_frequency = document_frequency;
+				uint64_t occurrences = collection_frequency(term_frequencies, document_frequency);
+				scoring_frequencies(term, scoring_frequency, occurrences);
+
+				filling.writer = writer;
+				filling.items.push_back(item{term, &postings, filling.document_ids.size(), document_frequency, scoring_frequency, occurrences});
+				filling.document_ids.insert(filling.document_ids.end(), document_ids, document_ids + document_frequency);
+				filling.term_frequencies.insert(filling.term_frequencies.end(), term_frequencies, term_frequencies + document_frequency);
+
+				if (filling.document_ids.size() >= BATCH_POSTINGS || filling.items.size() >= BATCH_ITEMS)
+					{
+					complete();
+					std::swap(filling, processing);
+					start();
+					}
+				}
+
+			/*
+				QUANTIZE::FLUSH()
+				-----------------
+			*/
+			/*!
+				@brief Score everything that has been added, and wait until it is done.
+			*/
+			void flush(void)
+				{
+				complete();
+				if (filling.items.size() != 0)
+					{
+					std::swap(filling, processing);
+					start();
+					complete();
+					}
+				}
+
 		public:
 			/*
 				QUANTIZE::QUANTIZE()
@@ -57,15 +529,25 @@ namespace JASS
 				@brief Constructor
 				@param documents [in] The number of documents in the collection.
 				@param ranker [in] The ranking function used for quantization.
+				@param threads [in] The number of threads to score with (default 1).
+				@param method [in] How to map scores to impacts (default uniform).
 			*/
-			quantize(size_t documents, std::shared_ptr<RANKER> ranker) :
+			quantize(size_t documents, std::shared_ptr<RANKER> ranker, size_t threads = 1, quantization_method method = quantization_method::uniform) :
 				index_manager::delegate(documents),
 				largest_rsv((std::numeric_limits<decltype(largest_rsv)>::min)()),
 				smallest_rsv((std::numeric_limits<decltype(smallest_rsv)>::max)()),
 				ranker(ranker),
-				documents_in_collection(static_cast<compress_integer::integer>(documents))
+				documents_in_collection(static_cast<compress_integer::integer>(documents)),
+				threads((std::max)(threads, static_cast<size_t>(1))),
+				scores(this->threads),
+				thread_largest_rsv(this->threads),
+				thread_smallest_rsv(this->threads),
+				method(method),
+				sorted(this->threads),
+				statistics(nullptr)
 				{
-				/* Nothing. */
+				if (method == quantization_method::equi_depth)
+					histogram.assign(this->threads, std::vector<uint64_t>(HISTOGRAM_BINS));
 				}
 
 			/*
@@ -77,6 +559,7 @@ namespace JASS
 			*/
 			virtual ~quantize()
 				{
+				complete();
 //				std::cout << "RSVmin:" << smallest_rsv << '\n';
 //				std::cout << "RSVmax:" << largest_rsv << '\n';
 				}
@@ -90,7 +573,7 @@ namespace JASS
 			*/
 			virtual void finish(void)
 				{
-				/* Nothing */
+				flush();
 				}
 
 			/*
@@ -99,6 +582,8 @@ namespace JASS
 			*/
 			/*!
 				@brief The callback function for each postings list is operator().
+				@details With more than one thread the postings are copied into a batch which is scored (in parallel) once full, and the bounds
+				of each thread are merged once it is done.  The bounds are complete once the last primary key has been seen (or finish() is called).
 				@param term [in] The term name.
 				@param postings [in] The postings list.
 				@param document_frequency [in] The document frequency of the term
@@ -107,32 +592,13 @@ namespace JASS
 			*/
 			virtual void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
 				{
-				/*
-					Compute the IDF component
-				*/
-				ranker->compute_idf_component(document_frequency, documents_in_collection);
-
-				/*
-					Compute the document / term score and keep a tally of the smallest and largest (for quantization)
-				*/
-				auto end = document_ids + document_frequency;
-				auto current_tf = term_frequencies;
-				for (compress_integer::integer *current_id = document_ids; current_id < end; current_id++, current_tf++)
-					{
-					/*
-						Compute the term / document score
-					*/
-					ranker->compute_tf_component(*current_tf);
-					auto score = ranker->compute_score(*current_id, *current_tf);
+				if (statistics != nullptr)
+					return;			// the bounds are those of the collection_statistics
 
-					/*
-						Keep a running tally of the largest and smallest rsv we've seen so far
-					*/
-					if (score < smallest_rsv)
-						smallest_rsv = score;
-					if (score > largest_rsv)
-						largest_rsv = score;
-					}
+				if (threads == 1)
+					bound(0, document_frequency, collection_frequency(term_frequencies, document_frequency), document_ids, term_frequencies, document_frequency, smallest_rsv, largest_rsv);
+				else
+					add(nullptr, term, postings, document_frequency, document_ids, term_frequencies);
 				}
 
 			/*
@@ -141,12 +607,13 @@ namespace JASS
 			*/
 			/*!
 				@brief The callback function for primary keys (external document ids) is operator(). Not needed for quantization
+				@details The primary keys come after the postings lists so any postings still waiting to be scored are scored.
 				@param document_id [in] The internal document identfier.
 				@param primary_key [in] This document's primary key (external document identifier).
 			*/
 			virtual void operator()(size_t document_id, const slice &primary_key)
 				{
-				/* Nothing. */
+				flush();
 				}
 
 			/*
@@ -155,6 +622,8 @@ namespace JASS
 			*/
 			/*!
 				@brief The callback function for each postings list is operator().
+				@details With more than one thread the postings are copied into a batch which is quantized (in parallel) once full, and then each
+				list is passed to the writer (in the order they were given to this object) while the next batch is filled.
 				@param writer [in] The delegate that writes the quantized result to the output media.
 				@param term [in] The term name.
 				@param postings [in] The postings list.
@@ -164,37 +633,22 @@ namespace JASS
 			*/
 			virtual void operator()(index_manager::delegate &writer, const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
 				{
-				/*
-					Compute the IDF component
-				*/
-				ranker->compute_idf_component(document_frequency, documents_in_collection);
+				if (method == quantization_method::equi_depth && bin_impact.size() == 0)
+					build_equi_depth_table();
 
-				/*
-					Compute the document / term score and quantize it.
-				*/
-				auto end = document_ids + document_frequency;
-				auto current_tf = term_frequencies;
-				for (compress_integer::integer *current_id = document_ids; current_id < end; current_id++, current_tf++)
+				if (threads == 1)
 					{
 					/*
-						Compute the term / document score
+						Compute the document / term score and quantize it, then pass the quantized list to the writer.
 					*/
-					ranker->compute_tf_component(*current_tf);
-					double score = ranker->compute_score(*current_id, *current_tf);
-
-					/*
-						Quantize using uniform quantization, and write back as the new term frequency (which is now an impact score).
-						This uses Uniform Quantiization as defined by Anh et al. in:
-						Vo Ngoc Anh, Owen de Kretser, and Alistair Moffat. 2001. Vector-space ranking with effective early termination. In Proceedings of the 24th annual international ACM SIGIR conference on Research and development in information retrieval (SIGIR '01). ACM, New York, NY, USA, 35-42. DOI: https://doi.org/10.1145/383952.383957
-					*/
-					index_postings_impact::impact_type impact = static_cast<index_postings_impact::impact_type>(((score - smallest_rsv) / (largest_rsv - smallest_rsv)) * impact_range) + index_postings_impact::smallest_impact;
-					*current_tf = impact;
+					compress_integer::integer scoring_frequency = document_frequency;
+					uint64_t occurrences = collection_frequency(term_frequencies, document_frequency);
+					scoring_frequencies(term, scoring_frequency, occurrences);
+					quantize_postings(0, scoring_frequency, occurrences, document_ids, term_frequencies, document_frequency);
+					writer(term, postings, document_frequency, document_ids, term_frequencies);
 					}
-
-				/*
-					Pass the quantized list to the writer.
-				*/
-				writer(term, postings, document_frequency, document_ids, term_frequencies);
+				else
+					add(&writer, term, postings, document_frequency, document_ids, term_frequencies);
 				}
 
 			/*
@@ -203,15 +657,41 @@ namespace JASS
 			*/
 			/*!
 				@brief The callback function for primary keys (external document ids) is operator(). Not needed for quantization
+				@details The primary keys come after the postings lists so any postings lists still waiting are quantized and written first.
 				@param writer [in] A deligate object to manage the data once quantized.
 				@param document_id [in] The internal document identfier.
 				@param primary_key [in] This document's primary key (external document identifier).
 			*/
 			virtual void operator()(index_manager::delegate &writer, size_t document_id, const slice &primary_key)
 				{
+				flush();
 				writer(document_id, primary_key);
 				}
 
+			/*
+				QUANTIZE::USE_STATISTICS()
+				--------------------------
+			*/
+			/*!
+				@brief Score with the given collection statistics (rather than those of this collection) and quantize between their bounds.
+				@details The ranker must have been constructed with the mean document length (or collection length) of the statistics.  Terms
+				that are not in the statistics are scored with their own document and collection frequency.  Only uniform and logarithmic
+				quantization map a score to the same impact in every collection, so this fails for the others.
+				@param statistics [in] The statistics, which must outlive this object.
+				@return true on success, false if the quantization method can't use collection statistics.
+			*/
+			bool use_statistics(const collection_statistics &statistics)
+				{
+				if (method != quantization_method::uniform && method != quantization_method::logarithmic)
+					return false;
+
+				this->statistics = &statistics;
+				documents_in_collection = static_cast<compress_integer::integer>(statistics.documents);
+				smallest_rsv = statistics.smallest_rsv;
+				largest_rsv = statistics.largest_rsv;
+				return true;
+				}
+
 			/*
 				QUANTIZE::GET_BOUNDS()
 				----------------------
@@ -223,6 +703,7 @@ namespace JASS
 			*/
 			void get_bounds(double &smallest, double &largest)
 				{
+				flush();
 				smallest = smallest_rsv;
 				largest = largest_rsv;
 				}
@@ -232,16 +713,26 @@ namespace JASS
 				---------------------------
 			*/
 			/*!
-				@brief Given the index and a serialiser, serialise the index to disk.
+				@brief Given the index and a set of serialisers, serialise the index to disk.
+				@details The index is iterated (and each postings list quantized) once, no matter how many serialisers there are.  If there is more than
+				one then each runs in its own thread (see serialise_fan_out).
 				@param index [in] The index to serialise.
-				@param serialisers [in] The serialiser that writes out in the desired format.
+				@param serialisers [in] The serialisers that write out in the desired formats.
 			*/
 			void serialise_index(index_manager &index, std::vector<std::unique_ptr<index_manager::delegate>> &serialisers)
 				{
-				for (auto &outputter : serialisers)
+				if (serialisers.size() == 1)
+					{
+					index.iterate(*this, *serialisers[0]);
+					flush();
+					serialisers[0]->finish();
+					}
+				else if (serialisers.size() > 1)
 					{
-					index.iterate(*this, *outputter);
-					outputter->finish();
+					serialise_fan_out outputter(documents_in_collection, serialisers);
+					index.iterate(*this, outputter);
+					flush();
+					outputter.finish();
 					}
 				}
 
@@ -274,6 +765,136 @@ namespace JASS
 				JASS_assert(static_cast<int>(smallest) == 0);
 				JASS_assert(static_cast<int>(largest) == 2);
 
+				/*
+					Write out the quantized postings lists
+				*/
+				class unittest_delegate : public index_manager::delegate
+					{
+					public:
+						std::ostringstream result;
+						std::vector<std::vector<index_postings_impact::impact_type>> impacts;
+						std::map<std::string, std::map<compress_integer::integer, index_postings_impact::impact_type>> postings;
+
+					public:
+						unittest_delegate() : delegate(0) {}
+						virtual void operator()(const slice &term, const index_postings &, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+							{
+							result << term << "->";
+							for (compress_integer::integer which = 0; which < document_frequency; which++)
+								result << "<" << document_ids[which] << "," << term_frequencies[which] << ">";
+							result << '\n';
+							impacts.push_back(std::vector<index_postings_impact::impact_type>(term_frequencies, term_frequencies + document_frequency));
+							for (compress_integer::integer which = 0; which < document_frequency; which++)
+								postings[std::string(reinterpret_cast<const char *>(term.address()), term.size())][document_ids[which]] = term_frequencies[which];
+							}
+						virtual void operator()(size_t document_id, const slice &primary_key)
+							{
+							result << document_id << "->" << primary_key << '\n';
+							}
+						virtual void finish(void)
+							{
+							/* Nothing */
+							}
+					};
+
+				unittest_delegate expected;
+				index.iterate(quantizer, expected);
+
+				/*
+					Several threads (each scoring part of the lists) must give the same bounds and the same quantized index
+				*/
+				quantize<ranking_function_atire_bm25> parallel_quantizer(index.get_highest_document_id(), ranker, 3);
+				index.iterate(parallel_quantizer);
+				double parallel_smallest;
+				double parallel_largest;
+				parallel_quantizer.get_bounds(parallel_smallest, parallel_largest);
+				JASS_assert(parallel_smallest == smallest);
+				JASS_assert(parallel_largest == largest);
+
+				unittest_delegate got;
+				index.iterate(parallel_quantizer, got);
+				JASS_assert(got.result.str() == expected.result.str());
+
+				/*
+					The other quantization methods must also be the same with several threads, must stay within the impact range, and must
+					keep the order of the scores (across the collection, or within each term for per-term quantization).
+				*/
+				for (auto method : {quantization_method::logarithmic, quantization_method::equi_depth, quantization_method::per_term})
+					{
+					unittest_delegate serial;
+					quantize<ranking_function_atire_bm25> serial_quantizer(index.get_highest_document_id(), ranker, 1, method);
+					index.iterate(serial_quantizer);
+					index.iterate(serial_quantizer, serial);
+
+					unittest_delegate parallel;
+					quantize<ranking_function_atire_bm25> method_quantizer(index.get_highest_document_id(), ranker, 3, method);
+					index.iterate(method_quantizer);
+					index.iterate(method_quantizer, parallel);
+					JASS_assert(parallel.result.str() == serial.result.str());
+
+					for (size_t term = 0; term < expected.impacts.size(); term++)
+						for (size_t posting = 0; posting < expected.impacts[term].size(); posting++)
+							{
+							auto impact = serial.impacts[term][posting];
+							JASS_assert(impact >= index_postings_impact::smallest_impact && impact <= index_postings_impact::largest_impact);
+
+							for (size_t other_term = 0; other_term < expected.impacts.size(); other_term++)
+								{
+								if (method == quantization_method::per_term && other_term != term)
+									continue;
+								for (size_t other = 0; other < expected.impacts[other_term].size(); other++)
+									if (expected.impacts[term][posting] < expected.impacts[other_term][other])
+										JASS_assert(impact <= serial.impacts[other_term][other]);
+								}
+							}
+					}
+
+				/*
+					Log-scale quantization gives low scores higher impacts than uniform quantization does (and the same to the extremes).
+				*/
+				unittest_delegate logarithmic;
+				quantize<ranking_function_atire_bm25> log_quantizer(index.get_highest_document_id(), ranker, 1, quantization_method::logarithmic);
+				index.iterate(log_quantizer);
+				index.iterate(log_quantizer, logarithmic);
+				for (size_t term = 0; term < expected.impacts.size(); term++)
+					for (size_t posting = 0; posting < expected.impacts[term].size(); posting++)
+						JASS_assert(logarithmic.impacts[term][posting] >= expected.impacts[term][posting]);
+
+				/*
+					A shard (the last 5 documents) quantized against the statistics of the whole collection must get the same impacts as
+					those documents do in the whole collection (with one thread or several).
+				*/
+				uint64_t length = 0;
+				for (auto document_length : index.get_document_length_vector())
+					length += document_length;
+				collection_statistics whole(index.get_highest_document_id(), length);
+				index.iterate(whole);
+				whole.smallest_rsv = smallest;
+				whole.largest_rsv = largest;
+
+				index_manager_sequential shard;
+				index_manager_sequential::unittest_build_index(shard, unittest_data::ten_document_6 + unittest_data::ten_document_7 + unittest_data::ten_document_8 + unittest_data::ten_document_9 + unittest_data::ten_document_10);
+				std::shared_ptr<ranking_function_atire_bm25> shard_ranker(new ranking_function_atire_bm25(0.9, 0.4, shard.get_document_length_vector(), static_cast<double>(whole.length) / static_cast<double>(whole.documents)));
+				for (size_t shard_threads : {1, 3})
+					{
+					quantize<ranking_function_atire_bm25> shard_quantizer(shard.get_highest_document_id(), shard_ranker, shard_threads);
+					JASS_assert(shard_quantizer.use_statistics(whole));
+					shard.iterate(shard_quantizer);
+					unittest_delegate shard_impacts;
+					shard.iterate(shard_quantizer, shard_impacts);
+
+					JASS_assert(shard_impacts.postings.size() == 15);
+					for (const auto &[term, impacts] : shard_impacts.postings)
+						for (const auto &[document_id, impact] : impacts)
+							JASS_assert(impact == expected.postings[term][document_id + 5]);
+					}
+
+				/*
+					Equi-depth and per-term quantization depend on the collection, so they can't use the statistics of another collection
+				*/
+				quantize<ranking_function_atire_bm25> equi_depth_quantizer(shard.get_highest_document_id(), shard_ranker, 1, quantization_method::equi_depth);
+				JASS_assert(!equi_depth_quantizer.use_statistics(whole));
+
 				puts("quantize::PASSED");
 				}
 		};
@@ -170,6 +170,19 @@ namespace JASS
 				return *parsed_query;
 				}
 
+			/*
+				QUERY::NORMALISED_QUERY()
+				-------------------------
+			*/
+			/*!
+				@brief Return the normalised form of the parsed query, suitable for use as the key of a results cache (see parser_query::get_normalised_query()).
+				@return The normalised query.
+			*/
+			const std::string &normalised_query(void) const
+				{
+				return parser.get_normalised_query();
+				}
+
 			/*
 				QUERY::GET_FIRST()
 				------------------
@@ -202,8 +215,10 @@ namespace JASS
 			*/
 			virtual void rewind(ACCUMULATOR_TYPE smallest_possible_rsv = 0, ACCUMULATOR_TYPE top_k_lower_bound = 0, ACCUMULATOR_TYPE largest_possible_rsv = 0)
 				{
-				delete parsed_query;
-				parsed_query = new query_term_list;
+				if (parsed_query == nullptr)
+					parsed_query = new query_term_list;
+				else
+					parsed_query->clear();
 				impact = 0;
 				}
 
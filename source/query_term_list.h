@@ -12,10 +12,15 @@
 */
 #pragma once
 
+#include <string.h>
+
 #include <array>
+#include <string>
+#include <vector>
 #include <algorithm>
 
 #include "query_term.h"
+#include "hash_pearson.h"
 #include "dynamic_array.h"
 
 namespace JASS
@@ -34,9 +39,12 @@ namespace JASS
 
 		private:
 			static const size_t max_query_terms = 0xFFFF;			///< We allow up-to this numnber of (not necessarily unique) terms in a query.
+			static const size_t unique_table_size = 256;			///< The number of slots in the table push_back_unique() uses to find duplicates (a power of 2).
+			static const size_t max_unique_terms = unique_table_size / 2;	///< Beyond this many terms push_back_unique() stops looking for duplicates (keeping the table at most half full).
 
 		private:
 			size_t terms_in_query;								///< The numner of terms in this query.
+			uint16_t unique_table[unique_table_size];		///< Open-addressed table of (1 + the index of) the terms added by push_back_unique(), 0 is empty.
 			query_term terms[max_query_terms];				///< The quey terms themselves.
 
 		public:
@@ -131,6 +139,56 @@ namespace JASS
 					}
 				}
 
+			/*
+				QUERY_TERM_LIST::PUSH_BACK_UNIQUE()
+				-----------------------------------
+			*/
+			/*!
+				@brief Add a query term to the list, or if it is already in the list then increment its query frequency.
+				@details Duplicates are found using a small open-addressed (linear probing) hash table so that short queries
+				are deduplicated as they are parsed.  Once there are more than max_unique_terms terms in the list this
+				degrades to push_back() and sort_unique() is needed to merge duplicates (which it does correctly either way).  A list should be
+				built either with push_back() or with push_back_unique(), not both.
+				@param term [in] The term to add.
+			*/
+			void push_back_unique(const slice &term)
+				{
+				if (terms_in_query == 0)
+					memset(unique_table, 0, sizeof(unique_table));
+				else if (terms_in_query >= max_unique_terms)
+					{
+					push_back(term);
+					return;
+					}
+
+				size_t slot = hash_pearson::hash<8>(term) & (unique_table_size - 1);
+				while (unique_table[slot] != 0)
+					{
+					query_term &existing = terms[unique_table[slot] - 1];
+					if (existing.term == term)
+						{
+						existing.query_frequency++;
+						return;
+						}
+					slot = (slot + 1) & (unique_table_size - 1);
+					}
+
+				unique_table[slot] = static_cast<uint16_t>(terms_in_query + 1);
+				push_back(term);
+				}
+
+			/*
+				QUERY_TERM_LIST::CLEAR()
+				------------------------
+			*/
+			/*!
+				@brief Empty the list so that it can be used for another query.
+			*/
+			void clear(void)
+				{
+				terms_in_query = 0;
+				}
+
 			/*
 				QUERY_TERM_LIST::SORT_UNIQUE()
 				------------------------------
@@ -138,7 +196,7 @@ namespace JASS
 			/*!
 				@brief Sort the query terms then unique the list, incrementing the term count if duplicates are seen.  At the end
 				the list has each term represented once and all the term counts represent the numbner of times the term has been
-				seen in the original query.
+				seen in the original query.  Terms already counted by push_back_unique() keep their counts.
 			*/
 			void sort_unique(void)
 				{
@@ -153,7 +211,7 @@ namespace JASS
 				while (from < terms_in_query)
 					{
 					if (terms[from].term == terms[to].term)
-						terms[to].query_frequency++;
+						terms[to].query_frequency += terms[from].query_frequency;
 					else
 						{
 						to++;
@@ -273,6 +331,57 @@ namespace JASS
 				delete terms;
 				}
 				
+				/*
+					Deduplicate while adding, then sort
+				*/
+				{
+				query_term_list *terms = new query_term_list;
+
+				terms->push_back_unique("b");
+				terms->push_back_unique("a");
+				terms->push_back_unique("b");
+				terms->push_back_unique("ab");
+				terms->push_back_unique("b");
+				JASS_assert(terms->size() == 3);
+
+				terms->sort_unique();
+				std::ostringstream into;
+				into << *terms;
+				JASS_assert(into.str() == "(a,1)(b,3)(ab,1)");
+
+				/*
+					Reuse the list after clear()
+				*/
+				terms->clear();
+				terms->push_back_unique("c");
+				terms->push_back_unique("c");
+				terms->sort_unique();
+				into.str("");
+				into << *terms;
+				JASS_assert(into.str() == "(c,2)");
+				delete terms;
+				}
+
+				/*
+					More terms than the table holds, each twice so that the duplicates past max_unique_terms are merged by sort_unique()
+				*/
+				{
+				query_term_list *terms = new query_term_list;
+				std::vector<std::string> words;
+				for (size_t word = 0; word < 2 * max_unique_terms; word++)
+					words.push_back(std::to_string(word));
+
+				for (size_t pass = 0; pass < 2; pass++)
+					for (const auto &word : words)
+						terms->push_back_unique(slice((void *)word.c_str(), word.size()));
+
+				terms->sort_unique();
+				JASS_assert(terms->size() == words.size());
+				for (const auto &term : *terms)
+					JASS_assert(term.query_frequency == 2);
+				delete terms;
+				}
+
 				puts("query_term_list::PASSED");
 				}
 		};
@@ -0,0 +1,293 @@
+/*
+	QUEUE_SPSC.H
+	------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Bounded lock-free single-producer single-consumer queue.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "asserts.h"
+#include "threads.h"
+
+namespace JASS
+	{
+	/*
+		CLASS QUEUE_SPSC
+		----------------
+	*/
+	/*!
+		@brief Bounded lock-free queue between exactly one producer thread and exactly one consumer thread (such as two stages of a pipeline).
+		@details The queue is a ring buffer of a power of 2 slots.  The producer is the only writer of tail and the consumer the only writer of
+		head, and each counts up forever (the slot is the count modulo the size), so the queue is full when tail - head is the size and empty when
+		they are equal.  They are on different cache lines so the producer and consumer do not fight over the same line.  push() and pop() block
+		by spinning, then yielding, then sleeping, so a stage that waits for a long time does not steal a core from the other stages.
+		@tparam TYPE The type of the elements in the queue.
+	*/
+	template <typename TYPE>
+	class queue_spsc
+		{
+		private:
+			static constexpr size_t cache_line_size = 64;				///< The size of a cache line (head and tail are on their own)
+
+		private:
+			std::vector<TYPE> slot;												///< The elements of the ring buffer
+			size_t mask;															///< slot.size() - 1 (as the size is a power of 2)
+			alignas(cache_line_size) std::atomic<size_t> head;			///< The number of elements ever popped (written only by the consumer)
+			alignas(cache_line_size) std::atomic<size_t> tail;			///< The number of elements ever pushed (written only by the producer)
+
+		private:
+			/*
+				QUEUE_SPSC::WAIT()
+				------------------
+			*/
+			/*!
+				@brief Back off while waiting for the other thread (spin, then yield, then sleep), the longer the wait the longer the back off.
+				@param attempts [in/out] The number of times we've waited so far.
+			*/
+			static void wait(size_t &attempts)
+				{
+				attempts++;
+				if (attempts < 16)
+					return;					// spin, the other thread is probably about to get there
+				else if (attempts < 64)
+					std::this_thread::yield();
+				else
+					std::this_thread::sleep_for(std::chrono::microseconds(50));
+				}
+
+		public:
+			/*
+				QUEUE_SPSC::QUEUE_SPSC()
+				------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param capacity [in] The maximum number of elements in the queue (rounded up to the next power of 2).
+			*/
+			explicit queue_spsc(size_t capacity) :
+				head(0),
+				tail(0)
+				{
+				size_t size = 1;
+				while (size < capacity)
+					size <<= 1;
+				slot.resize(size);
+				mask = size - 1;
+				}
+
+			/*
+				QUEUE_SPSC::CAPACITY()
+				----------------------
+			*/
+			/*!
+				@brief Return the maximum number of elements in the queue.
+				@return The capacity of the queue.
+			*/
+			size_t capacity(void) const
+				{
+				return slot.size();
+				}
+
+			/*
+				QUEUE_SPSC::TRY_PUSH()
+				----------------------
+			*/
+			/*!
+				@brief Add an element to the end of the queue, if there is room.  Only the producer can call this method.
+				@param value [in] The element to add (moved from on success).
+				@return true on success, false if the queue is full.
+			*/
+			bool try_push(TYPE &value)
+				{
+				size_t at = tail.load(std::memory_order_relaxed);
+				if (at - head.load(std::memory_order_acquire) >= slot.size())
+					return false;
+
+				slot[at & mask] = std::move(value);
+				tail.store(at + 1, std::memory_order_release);
+				return true;
+				}
+
+			/*
+				QUEUE_SPSC::TRY_POP()
+				---------------------
+			*/
+			/*!
+				@brief Remove the element from the front of the queue, if there is one.  Only the consumer can call this method.
+				@param value [out] The element.
+				@return true on success, false if the queue is empty.
+			*/
+			bool try_pop(TYPE &value)
+				{
+				size_t at = head.load(std::memory_order_relaxed);
+				if (at == tail.load(std::memory_order_acquire))
+					return false;
+
+				value = std::move(slot[at & mask]);
+				head.store(at + 1, std::memory_order_release);
+				return true;
+				}
+
+			/*
+				QUEUE_SPSC::PUSH()
+				------------------
+			*/
+			/*!
+				@brief Add an element to the end of the queue, waiting until there is room.  Only the producer can call this method.
+				@param value [in] The element to add (moved from).
+			*/
+			void push(TYPE value)
+				{
+				size_t attempts = 0;
+				while (!try_push(value))
+					wait(attempts);
+				}
+
+			/*
+				QUEUE_SPSC::PUSH()
+				------------------
+			*/
+			/*!
+				@brief Add an element to the end of the queue, waiting until there is room or until give_up is set (by another thread).  Only the producer can call this method.
+				@param value [in] The element to add (moved from on success).
+				@param give_up [in] Stop waiting once this is true.
+				@return true on success, false if give_up was set while the queue was full.
+			*/
+			bool push(TYPE &value, const std::atomic<bool> &give_up)
+				{
+				size_t attempts = 0;
+				while (!try_push(value))
+					{
+					if (give_up.load(std::memory_order_acquire))
+						return false;
+					wait(attempts);
+					}
+				return true;
+				}
+
+			/*
+				QUEUE_SPSC::POP()
+				-----------------
+			*/
+			/*!
+				@brief Remove the element from the front of the queue, waiting until there is one.  Only the consumer can call this method.
+				@return The element.
+			*/
+			TYPE pop(void)
+				{
+				TYPE value;
+				size_t attempts = 0;
+				while (!try_pop(value))
+					wait(attempts);
+				return value;
+				}
+
+			/*
+				QUEUE_SPSC::POP()
+				-----------------
+			*/
+			/*!
+				@brief Remove the element from the front of the queue, waiting until there is one or until give_up is set (by another thread).  Only the consumer can call this method.
+				@param value [out] The element.
+				@param give_up [in] Stop waiting once this is true.
+				@return true on success, false if give_up was set while the queue was empty.
+			*/
+			bool pop(TYPE &value, const std::atomic<bool> &give_up)
+				{
+				size_t attempts = 0;
+				while (!try_pop(value))
+					{
+					if (give_up.load(std::memory_order_acquire))
+						return false;
+					wait(attempts);
+					}
+				return true;
+				}
+
+			/*
+				QUEUE_SPSC::UNITTEST()
+				----------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				/*
+					Single threaded: the capacity is rounded up, and the queue is first in first out
+				*/
+				queue_spsc<size_t> queue(5);
+				JASS_assert(queue.capacity() == 8);
+
+				size_t value;
+				JASS_assert(!queue.try_pop(value));
+				for (size_t which = 0; which < 8; which++)
+					{
+					value = which;
+					JASS_assert(queue.try_push(value));
+					}
+				value = 8;
+				JASS_assert(!queue.try_push(value));
+
+				for (size_t which = 0; which < 3; which++)
+					JASS_assert(queue.try_pop(value) && value == which);
+				for (size_t which = 8; which < 11; which++)
+					{
+					value = which;
+					JASS_assert(queue.try_push(value));				// wraps around the end of the buffer
+					}
+				for (size_t which = 3; which < 11; which++)
+					JASS_assert(queue.pop() == which);
+				JASS_assert(!queue.try_pop(value));
+
+				std::atomic<bool> give_up(true);
+				JASS_assert(!queue.pop(value, give_up));
+				value = 11;
+				JASS_assert(queue.push(value, give_up));
+				for (size_t which = 12; which < 19; which++)
+					queue.push(which);
+				JASS_assert(!queue.push(value, give_up));				// full
+				JASS_assert(queue.pop(value, give_up) && value == 11);
+
+				/*
+					Two threads: everything the producer pushes through a small queue arrives, in order
+				*/
+				const size_t count = 100'000;
+				queue_spsc<size_t> pipe(16);
+				size_t received = 0;
+				bool in_order = true;
+				thread consumer([&pipe, &received, &in_order, count]()
+					{
+					for (size_t which = 0; which < count; which++)
+						{
+						if (pipe.pop() != which)
+							in_order = false;
+						received++;
+						}
+					});
+
+				for (size_t which = 0; which < count; which++)
+					pipe.push(which);
+				consumer.join();
+
+				JASS_assert(received == count);
+				JASS_assert(in_order);
+
+				puts("queue_spsc::PASSED");
+				}
+		};
+	}
@@ -19,6 +19,7 @@
 
 #include <vector>
 
+#include "simd.h"
 #include "forceinline.h"
 #include "compress_integer.h"
 #include "index_postings_impact.h"
@@ -52,8 +53,9 @@ namespace JASS
 				@param k1 [in] the BM25 k1 parameter, 0.9 is a good value.
 				@param b [in] the BM25 b parameter, 0.4 is a good value.
 				@param document_lengths [in] a vector holding the length of each document in the collection.
+				@param mean_length [in] If not 0 then use this as the mean document length rather than that of document_lengths (to score against the statistics of a larger collection, see collection_statistics).
 			*/
-			ranking_function_atire_bm25(double k1, double b, std::vector<compress_integer::integer> &document_lengths):
+			ranking_function_atire_bm25(double k1, double b, std::vector<compress_integer::integer> &document_lengths, double mean_length = 0):
 				idf(0),
 				top_row(0),
 				k1_plus_1(k1 + 1.0),
@@ -66,7 +68,7 @@ namespace JASS
 				for (auto length : document_lengths)
 					sum += length;
 
-				mean_document_length = static_cast<double>(sum) / static_cast<double>(document_lengths.size() - 1);			// -1 because ID 0 is not used (and should be 0)
+				mean_document_length = mean_length != 0 ? mean_length : static_cast<double>(sum) / static_cast<double>(document_lengths.size() - 1);			// -1 because ID 0 is not used (and should be 0)
 
 				auto correction = &length_correction[0];			// recall that we count from 1, not from 0
 				for (auto length : document_lengths)
@@ -144,6 +146,46 @@ namespace JASS
 				return idf * (top_row / (tf + length_correction[document_id]));
 				}
 
+			/*
+				RANKING_FUNCTION_ATIRE_BM25::COMPUTE_SCORES()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Compute BM25 for each posting of a postings list.
+				@details This gives the same scores as compute_idf_component(), compute_tf_component(), and compute_score() for each posting, but it
+				keeps no state (so several threads can use the one ranker at once).  With AVX2 four postings are scored at once (gathering from
+				length_correction), the scores are identical to those computed one at a time.
+				@param scores [out] The score of each posting (of length postings).
+				@param document_frequency [in] The number of documents that contain this term.
+				@param collection_frequency [in] The number of times the term occurs in the collection (not used).
+				@param documents_in_collection [in] The number of documents in the collection.
+				@param document_ids [in] The document ids.
+				@param term_frequencies [in] The term frequencies (corresponding to document_ids).
+				@param postings [in] The number of postings to score (a part of a postings list can be scored by passing a pointer into it and its length).
+			*/
+			void compute_scores(double *scores, compress_integer::integer document_frequency, uint64_t collection_frequency, compress_integer::integer documents_in_collection, const compress_integer::integer *document_ids, const index_postings_impact::impact_type *term_frequencies, size_t postings) const
+				{
+				double term_idf = log((double)documents_in_collection / (double)document_frequency);
+				const float *correction = &length_correction[0];
+				size_t which = 0;
+
+#ifdef __AVX2__
+				__m256d idf_4 = _mm256_set1_pd(term_idf);
+				__m256d k1_plus_1_4 = _mm256_set1_pd(k1_plus_1);
+				for (; which + 4 <= postings; which += 4)
+					{
+					__m256d tf = _mm256_cvtepi32_pd(simd::widen(term_frequencies + which));
+					__m256d bottom_row = _mm256_add_pd(tf, _mm256_cvtps_pd(_mm_i32gather_ps(correction, _mm_loadu_si128((const __m128i *)(document_ids + which)), sizeof(float))));
+					_mm256_storeu_pd(scores + which, _mm256_mul_pd(idf_4, _mm256_div_pd(_mm256_mul_pd(tf, k1_plus_1_4), bottom_row)));
+					}
+#endif
+				for (; which < postings; which++)
+					{
+					double tf = term_frequencies[which];
+					scores[which] = term_idf * ((tf * k1_plus_1) / (tf + correction[document_ids[which]]));
+					}
+				}
+
 			/*
 				RANKING_FUNCTION_ATIRE_BM25::UNITTEST()
 				---------------------------------------
@@ -162,6 +204,20 @@ namespace JASS
 				rsv = ranker.compute_score(1, 12);								// it occurs in document 1 a total of 12 times;
 
 				JASS_assert(static_cast<uint32_t>(rsv * 1000) == 1635);
+
+				/*
+					The scores of a whole postings list must be the same as those computed one at a time
+				*/
+				compress_integer::integer document_ids[] = {1, 3, 4, 0, 2, 1, 3};
+				index_postings_impact::impact_type term_frequencies[] = {12, 1, 7, 2, 3, 1, 200};
+				double scores[7];
+				ranker.compute_idf_component(3, static_cast<uint32_t>(lengths.size()));
+				ranker.compute_scores(scores, 3, 226, static_cast<uint32_t>(lengths.size()), document_ids, term_frequencies, 7);
+				for (size_t which = 0; which < 7; which++)
+					{
+					ranker.compute_tf_component(term_frequencies[which]);
+					JASS_assert(scores[which] == ranker.compute_score(document_ids[which], term_frequencies[which]));
+					}
 				puts("ranking_function_atire_bm25::PASSED");
 				}
 		};
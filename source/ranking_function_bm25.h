@@ -0,0 +1,170 @@
+/*
+	RANKING_FUNCTION_BM25.H
+	-----------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief The Robertson / Sparck Jones BM25 ranking function (and BM25+)
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "simd.h"
+#include "asserts.h"
+#include "compress_integer.h"
+#include "index_postings_impact.h"
+
+namespace JASS
+	{
+	/*
+		CLASS RANKING_FUNCTION_BM25
+		---------------------------
+	*/
+	/*!
+		@brief The BM25 ranking function with the (always positive) IDF used by Lucene, and optionally the BM25+ lower bound on the term frequency component.
+		@details See:
+		S. Robertson, H. Zaragoza (2009) The Probabilistic Relevance Framework: BM25 and Beyond, Foundations and Trends in Information Retrieval 3(4):333-389.
+		Y. Lv, C. Zhai (2011) Lower-bounding term frequency normalization, CIKM 2011, pp. 7-16.
+	*/
+	class ranking_function_bm25
+		{
+		private:
+			double k1_plus_1;										///< k1 + 1
+			double delta;											///< The BM25+ lower bound on the term frequency component (0 for BM25)
+			double mean_document_length;						///< the mean of the document lengths
+			std::vector<float> length_correction;			///< most of the bottom row of BM25 (k1 * ((1 - b) + b * length / mean_document_length)) for each document
+
+		public:
+			/*
+				RANKING_FUNCTION_BM25::RANKING_FUNCTION_BM25()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param k1 [in] the BM25 k1 parameter, 0.9 is a good value.
+				@param b [in] the BM25 b parameter, 0.4 is a good value.
+				@param document_lengths [in] a vector holding the length of each document in the collection.
+				@param delta [in] The BM25+ delta parameter, 1.0 is a good value (default 0, which is BM25).
+				@param mean_length [in] If not 0 then use this as the mean document length rather than that of document_lengths (to score against the statistics of a larger collection, see collection_statistics).
+			*/
+			ranking_function_bm25(double k1, double b, std::vector<compress_integer::integer> &document_lengths, double delta = 0.0, double mean_length = 0) :
+				k1_plus_1(k1 + 1.0),
+				delta(delta),
+				mean_document_length(0),
+				length_correction(document_lengths.size())
+				{
+				double one_minus_b = 1.0 - b;
+				uint64_t sum = 0;
+				for (auto length : document_lengths)
+					sum += length;
+				mean_document_length = mean_length != 0 ? mean_length : static_cast<double>(sum) / static_cast<double>(document_lengths.size() - 1);			// -1 because ID 0 is not used (and should be 0)
+				auto correction = &length_correction[0];			// recall that we count from 1, not from 0
+				for (auto length : document_lengths)
+					*correction++ =  k1 * (one_minus_b + b * static_cast<double>(length) / mean_document_length);
+				}
+
+			/*
+				RANKING_FUNCTION_BM25::COMPUTE_SCORES()
+				---------------------------------------
+			*/
+			/*!
+				@brief Compute BM25 for each posting of a postings list.
+				@details With AVX2 four postings are scored at once, the scores are identical to those computed one at a time.
+				@param scores [out] The score of each posting (of length postings).
+				@param document_frequency [in] The number of documents that contain this term.
+				@param collection_frequency [in] The number of times the term occurs in the collection (not used).
+				@param documents_in_collection [in] The number of documents in the collection.
+				@param document_ids [in] The document ids.
+				@param term_frequencies [in] The term frequencies (corresponding to document_ids).
+				@param postings [in] The number of postings to score (a part of a postings list can be scored by passing a pointer into it and its length).
+			*/
+			void compute_scores(double *scores, compress_integer::integer document_frequency, uint64_t collection_frequency, compress_integer::integer documents_in_collection, const compress_integer::integer *document_ids, const index_postings_impact::impact_type *term_frequencies, size_t postings) const
+				{
+				/*
+								  N - n + 0.5
+					IDF = log(1 + -----------)
+									 n + 0.5
+
+									 tf(td) * (k1 + 1)
+					rsv = IDF * (----------------------------------- + delta)
+																		len(d)
+									tf(td) + k1 * (1 - b + b * --------)
+																	  av_len_d
+				*/
+				double idf = log(1.0 + ((double)documents_in_collection - (double)document_frequency + 0.5) / ((double)document_frequency + 0.5));
+				const float *correction = &length_correction[0];
+				size_t which = 0;
+
+#ifdef __AVX2__
+				__m256d idf_4 = _mm256_set1_pd(idf);
+				__m256d delta_4 = _mm256_set1_pd(delta);
+				__m256d k1_plus_1_4 = _mm256_set1_pd(k1_plus_1);
+				for (; which + 4 <= postings; which += 4)
+					{
+					__m256d tf = _mm256_cvtepi32_pd(simd::widen(term_frequencies + which));
+					__m256d bottom_row = _mm256_add_pd(tf, _mm256_cvtps_pd(_mm_i32gather_ps(correction, _mm_loadu_si128((const __m128i *)(document_ids + which)), sizeof(float))));
+					_mm256_storeu_pd(scores + which, _mm256_mul_pd(idf_4, _mm256_add_pd(_mm256_div_pd(_mm256_mul_pd(tf, k1_plus_1_4), bottom_row), delta_4)));
+					}
+#endif
+				for (; which < postings; which++)
+					{
+					double tf = term_frequencies[which];
+					scores[which] = idf * ((tf * k1_plus_1) / (tf + correction[document_ids[which]]) + delta);
+					}
+				}
+
+			/*
+				RANKING_FUNCTION_BM25::UNITTEST()
+				---------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				std::vector<compress_integer::integer> lengths{0, 30, 40, 50, 60, 70};			// the lengths of the documents in this pseudo-index (document 0 is not used)
+				compress_integer::integer document_ids[] = {1, 3, 4, 5, 2, 1, 3};
+				index_postings_impact::impact_type term_frequencies[] = {12, 1, 7, 2, 3, 1, 200};
+				double scores[7];
+
+				/*
+					BM25 (k1=0.9, b=0.4), the term occurs in 2 of 5 documents, and 12 times in document 1
+				*/
+				ranking_function_bm25 bm25(0.9, 0.4, lengths);
+				bm25.compute_scores(scores, 2, 14, 5, document_ids, term_frequencies, 7);
+				JASS_assert(static_cast<uint32_t>(scores[0] * 1000) == 1564);
+
+				/*
+					The vectorised scores must be the same as those computed one at a time
+				*/
+				double mean = 250.0 / 5.0;
+				double idf = log(1.0 + (5.0 - 2.0 + 0.5) / (2.0 + 0.5));
+				for (size_t which = 0; which < 7; which++)
+					{
+					double tf = term_frequencies[which];
+					float correction = static_cast<float>(0.9 * ((1.0 - 0.4) + 0.4 * static_cast<double>(lengths[document_ids[which]]) / mean));
+					JASS_assert(scores[which] == idf * ((tf * (0.9 + 1.0)) / (tf + correction)));
+					}
+
+				/*
+					BM25+ adds delta * IDF to each score
+				*/
+				ranking_function_bm25 bm25_plus(0.9, 0.4, lengths, 1.0);
+				double plus_scores[7];
+				bm25_plus.compute_scores(plus_scores, 2, 14, 5, document_ids, term_frequencies, 7);
+				for (size_t which = 0; which < 7; which++)
+					JASS_assert(fabs(plus_scores[which] - (scores[which] + idf)) < 0.000001);
+
+				puts("ranking_function_bm25::PASSED");
+				}
+		};
+	}
@@ -0,0 +1,132 @@
+/*
+	RANKING_FUNCTION_DPH.H
+	----------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief The DPH (divergence from randomness) ranking function
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "asserts.h"
+#include "compress_integer.h"
+#include "index_postings_impact.h"
+
+namespace JASS
+	{
+	/*
+		CLASS RANKING_FUNCTION_DPH
+		--------------------------
+	*/
+	/*!
+		@brief The DPH hypergeometric divergence from randomness model (which has no parameters).
+		@details As implemented in Terrier, see:
+		G. Amati, E. Ambrosi, M. Bianchi, C. Gaibisso, G. Gambosi (2007) FUB, IASI-CNR and University of Tor Vergata at TREC 2007 Blog Track, TREC 2007.
+		Each posting needs a log() which AVX2 does not have, so this loop is left to the compiler.  DPH scores can be negative, which uniform
+		quantization handles as it quantizes between the smallest and largest scores.
+	*/
+	class ranking_function_dph
+		{
+		private:
+			static constexpr double pi = 3.14159265358979323846;			///< pi
+
+		private:
+			double mean_document_length;						///< the mean of the document lengths
+			std::vector<compress_integer::integer> document_length;		///< The length of each document
+
+		public:
+			/*
+				RANKING_FUNCTION_DPH::RANKING_FUNCTION_DPH()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param document_lengths [in] a vector holding the length of each document in the collection.
+				@param mean_length [in] If not 0 then use this as the mean document length rather than that of document_lengths (to score against the statistics of a larger collection, see collection_statistics).
+			*/
+			ranking_function_dph(std::vector<compress_integer::integer> &document_lengths, double mean_length = 0) :
+				mean_document_length(0),
+				document_length(document_lengths)
+				{
+				uint64_t sum = 0;
+				for (auto length : document_lengths)
+					sum += length;
+				mean_document_length = mean_length != 0 ? mean_length : static_cast<double>(sum) / static_cast<double>(document_lengths.size() - 1);			// -1 because ID 0 is not used (and should be 0)
+				}
+
+			/*
+				RANKING_FUNCTION_DPH::COMPUTE_SCORES()
+				--------------------------------------
+			*/
+			/*!
+				@brief Compute DPH for each posting of a postings list.
+				@param scores [out] The score of each posting (of length postings).
+				@param document_frequency [in] The number of documents that contain this term (not used).
+				@param collection_frequency [in] The number of times the term occurs in the collection.
+				@param documents_in_collection [in] The number of documents in the collection.
+				@param document_ids [in] The document ids.
+				@param term_frequencies [in] The term frequencies (corresponding to document_ids).
+				@param postings [in] The number of postings to score (a part of a postings list can be scored by passing a pointer into it and its length).
+			*/
+			void compute_scores(double *scores, compress_integer::integer document_frequency, uint64_t collection_frequency, compress_integer::integer documents_in_collection, const compress_integer::integer *document_ids, const index_postings_impact::impact_type *term_frequencies, size_t postings) const
+				{
+				/*
+					rsv = (1 - f)^2 / (tf + 1) * (tf * log2((tf * avg_len / len(d)) * (N / F)) + 0.5 * log2(2 * pi * tf * (1 - f)))
+					where f = tf / len(d), N is the number of documents in the collection, and F is the collection frequency of the term.
+				*/
+				double n_over_f = static_cast<double>(documents_in_collection) / static_cast<double>(collection_frequency);
+				const compress_integer::integer *lengths = &document_length[0];
+
+				for (size_t which = 0; which < postings; which++)
+					{
+					double tf = term_frequencies[which];
+					double length = lengths[document_ids[which]];
+					double f = tf / length;
+
+					if (f >= 1.0)
+						scores[which] = 0;				// the document is only this term (and (1 - f)^2 is 0)
+					else
+						{
+						double norm = (1.0 - f) * (1.0 - f) / (tf + 1.0);
+						scores[which] = norm * (tf * log2((tf * mean_document_length / length) * n_over_f) + 0.5 * log2(2.0 * pi * tf * (1.0 - f)));
+						}
+					}
+				}
+
+			/*
+				RANKING_FUNCTION_DPH::UNITTEST()
+				--------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				std::vector<compress_integer::integer> lengths{0, 30, 40, 50, 60, 70};			// the lengths of the documents in this pseudo-index (document 0 is not used)
+				compress_integer::integer document_ids[] = {1, 3, 2};
+				index_postings_impact::impact_type term_frequencies[] = {12, 1, 40};
+				double scores[3];
+
+				/*
+					The term occurs 20 times in the collection (of 5 documents), 12 of which are in document 1.
+				*/
+				ranking_function_dph ranker(lengths);
+				ranker.compute_scores(scores, 3, 20, 5, document_ids, term_frequencies, 3);
+				JASS_assert(static_cast<uint32_t>(scores[0] * 1000) == 847);
+				JASS_assert(static_cast<int32_t>(scores[1] * 1000) == -330);
+				JASS_assert(scores[2] == 0);					// the document is only this term
+
+				puts("ranking_function_dph::PASSED");
+				}
+		};
+	}
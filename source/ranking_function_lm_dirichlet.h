@@ -0,0 +1,124 @@
+/*
+	RANKING_FUNCTION_LM_DIRICHLET.H
+	-------------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief The language model ranking function with Dirichlet smoothing
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "asserts.h"
+#include "compress_integer.h"
+#include "index_postings_impact.h"
+
+namespace JASS
+	{
+	/*
+		CLASS RANKING_FUNCTION_LM_DIRICHLET
+		-----------------------------------
+	*/
+	/*!
+		@brief The query likelihood language model with Dirichlet smoothing.
+		@details The score of a term in a document is log(1 + tf / (mu * p(t|C))) + log(mu / (len(d) + mu)), clipped at 0 (as Lucene does) so
+		that a document that contains the term never scores less than one that does not.  See:
+		C. Zhai, J. Lafferty (2004) A study of smoothing methods for language models applied to information retrieval, ACM TOIS 22(2):179-214.
+		The document component (log(mu / (len(d) + mu))) is computed once for each document in the constructor, but the term frequency
+		component needs a log() for each posting which AVX2 does not have, so this loop is left to the compiler.
+	*/
+	class ranking_function_lm_dirichlet
+		{
+		private:
+			double mu;												///< The Dirichlet smoothing parameter
+			double collection_length;							///< The number of term occurrences in the collection
+			std::vector<float> document_component;			///< log(mu / (len(d) + mu)) for each document
+
+		public:
+			/*
+				RANKING_FUNCTION_LM_DIRICHLET::RANKING_FUNCTION_LM_DIRICHLET()
+				--------------------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param mu [in] The Dirichlet smoothing parameter, 1000 is a good value.
+				@param document_lengths [in] a vector holding the length of each document in the collection.
+				@param total_length [in] If not 0 then use this as the collection length rather than the sum of document_lengths (to score against the statistics of a larger collection, see collection_statistics).
+			*/
+			ranking_function_lm_dirichlet(double mu, std::vector<compress_integer::integer> &document_lengths, double total_length = 0) :
+				mu(mu),
+				collection_length(0),
+				document_component(document_lengths.size())
+				{
+				uint64_t sum = 0;
+				for (auto length : document_lengths)
+					sum += length;
+				collection_length = total_length != 0 ? total_length : static_cast<double>(sum);
+
+				auto component = &document_component[0];
+				for (auto length : document_lengths)
+					*component++ = log(mu / (static_cast<double>(length) + mu));
+				}
+
+			/*
+				RANKING_FUNCTION_LM_DIRICHLET::COMPUTE_SCORES()
+				-----------------------------------------------
+			*/
+			/*!
+				@brief Compute the language model score for each posting of a postings list.
+				@param scores [out] The score of each posting (of length postings).
+				@param document_frequency [in] The number of documents that contain this term (not used).
+				@param collection_frequency [in] The number of times the term occurs in the collection.
+				@param documents_in_collection [in] The number of documents in the collection (not used).
+				@param document_ids [in] The document ids.
+				@param term_frequencies [in] The term frequencies (corresponding to document_ids).
+				@param postings [in] The number of postings to score (a part of a postings list can be scored by passing a pointer into it and its length).
+			*/
+			void compute_scores(double *scores, compress_integer::integer document_frequency, uint64_t collection_frequency, compress_integer::integer documents_in_collection, const compress_integer::integer *document_ids, const index_postings_impact::impact_type *term_frequencies, size_t postings) const
+				{
+				double mu_times_probability = mu * static_cast<double>(collection_frequency) / collection_length;
+				const float *component = &document_component[0];
+
+				for (size_t which = 0; which < postings; which++)
+					{
+					double score = log(1.0 + term_frequencies[which] / mu_times_probability) + component[document_ids[which]];
+					scores[which] = score < 0 ? 0 : score;
+					}
+				}
+
+			/*
+				RANKING_FUNCTION_LM_DIRICHLET::UNITTEST()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				std::vector<compress_integer::integer> lengths{0, 30, 40, 50, 60, 70};			// the lengths of the documents in this pseudo-index (document 0 is not used)
+				compress_integer::integer document_ids[] = {1, 3, 5};
+				index_postings_impact::impact_type term_frequencies[] = {12, 1, 7};
+				double scores[3];
+
+				/*
+					mu = 100, the term occurs 20 times in the collection (of 250 terms), 12 of which are in document 1.
+				*/
+				ranking_function_lm_dirichlet ranker(100, lengths);
+				ranker.compute_scores(scores, 3, 20, 5, document_ids, term_frequencies, 3);
+				JASS_assert(static_cast<uint32_t>(scores[0] * 1000) == 653);
+				JASS_assert(scores[1] == 0);					// clipped
+				JASS_assert(scores[2] > 0);
+
+				puts("ranking_function_lm_dirichlet::PASSED");
+				}
+		};
+	}
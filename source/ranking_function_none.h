@@ -100,5 +100,25 @@ namespace JASS
 				{
 				return term_frequency;
 				}
+
+			/*
+				RANKING_FUNCTION_NONE::COMPUTE_SCORES()
+				---------------------------------------
+			*/
+			/*!
+				@brief Return the term frequency of each posting of a postings list.
+				@param scores [out] The score of each posting (of length postings).
+				@param document_frequency [in] The number of documents that contain this term.
+				@param collection_frequency [in] The number of times the term occurs in the collection.
+				@param documents_in_collection [in] The number of documents in the collection.
+				@param document_ids [in] The document ids.
+				@param term_frequencies [in] The term frequencies (corresponding to document_ids).
+				@param postings [in] The number of postings to score (a part of a postings list can be scored by passing a pointer into it and its length).
+			*/
+			void compute_scores(double *scores, compress_integer::integer document_frequency, uint64_t collection_frequency, compress_integer::integer documents_in_collection, const compress_integer::integer *document_ids, const index_postings_impact::impact_type *term_frequencies, size_t postings) const
+				{
+				for (size_t which = 0; which < postings; which++)
+					scores[which] = term_frequencies[which];
+				}
 		};
 	}
@@ -0,0 +1,117 @@
+/*
+	RANKING_FUNCTION_TFIDF.H
+	------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief The TF.IDF ranking function (with logarithmic term frequency)
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "simd.h"
+#include "asserts.h"
+#include "compress_integer.h"
+#include "index_postings_impact.h"
+
+namespace JASS
+	{
+	/*
+		CLASS RANKING_FUNCTION_TFIDF
+		----------------------------
+	*/
+	/*!
+		@brief The TF.IDF ranking function, rsv = (1 + log(tf)) * log(N / n).
+		@details The term frequency component is looked up in a table (of every possible term frequency) so there is no log() for each posting.
+	*/
+	class ranking_function_tfidf
+		{
+		private:
+			std::vector<double> tf_component;				///< 1 + log(tf) for each possible term frequency (0 for 0)
+
+		public:
+			/*
+				RANKING_FUNCTION_TFIDF::RANKING_FUNCTION_TFIDF()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+			*/
+			ranking_function_tfidf() :
+				tf_component(index_postings_impact::largest_impact + 1)
+				{
+				for (size_t tf = 1; tf <= index_postings_impact::largest_impact; tf++)
+					tf_component[tf] = 1.0 + log(static_cast<double>(tf));
+				}
+
+			/*
+				RANKING_FUNCTION_TFIDF::COMPUTE_SCORES()
+				----------------------------------------
+			*/
+			/*!
+				@brief Compute TF.IDF for each posting of a postings list.
+				@details With AVX2 four postings are scored at once, the scores are identical to those computed one at a time.
+				@param scores [out] The score of each posting (of length postings).
+				@param document_frequency [in] The number of documents that contain this term.
+				@param collection_frequency [in] The number of times the term occurs in the collection (not used).
+				@param documents_in_collection [in] The number of documents in the collection.
+				@param document_ids [in] The document ids (not used).
+				@param term_frequencies [in] The term frequencies (corresponding to document_ids).
+				@param postings [in] The number of postings to score (a part of a postings list can be scored by passing a pointer into it and its length).
+			*/
+			void compute_scores(double *scores, compress_integer::integer document_frequency, uint64_t collection_frequency, compress_integer::integer documents_in_collection, const compress_integer::integer *document_ids, const index_postings_impact::impact_type *term_frequencies, size_t postings) const
+				{
+				double idf = log((double)documents_in_collection / (double)document_frequency);
+				const double *component = &tf_component[0];
+				size_t which = 0;
+
+#ifdef __AVX2__
+				__m256d idf_4 = _mm256_set1_pd(idf);
+				__m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));		// the masked gather (with every lane on) because the unmasked one leaves its source uninitialised (and so warns)
+				for (; which + 4 <= postings; which += 4)
+					_mm256_storeu_pd(scores + which, _mm256_mul_pd(_mm256_mask_i32gather_pd(_mm256_setzero_pd(), component, simd::widen(term_frequencies + which), all, sizeof(double)), idf_4));
+#endif
+				for (; which < postings; which++)
+					scores[which] = component[term_frequencies[which]] * idf;
+				}
+
+			/*
+				RANKING_FUNCTION_TFIDF::UNITTEST()
+				----------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				compress_integer::integer document_ids[] = {1, 3, 4, 5, 2, 1, 3};
+				index_postings_impact::impact_type term_frequencies[] = {12, 1, 7, 2, 3, 1, 200};
+				double scores[7];
+
+				/*
+					The term occurs in 2 of 5 documents, and 12 times in document 1
+				*/
+				ranking_function_tfidf ranker;
+				ranker.compute_scores(scores, 2, 226, 5, document_ids, term_frequencies, 7);
+				JASS_assert(static_cast<uint32_t>(scores[0] * 1000) == 3193);
+
+				/*
+					The vectorised scores must be the same as those computed one at a time
+				*/
+				double idf = log(5.0 / 2.0);
+				for (size_t which = 0; which < 7; which++)
+					JASS_assert(scores[which] == (1.0 + log(static_cast<double>(term_frequencies[which]))) * idf);
+
+				puts("ranking_function_tfidf::PASSED");
+				}
+		};
+	}
@@ -0,0 +1,362 @@
+/*
+	SEGMENT_CACHE.CPP
+	-----------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+	#include <io.h>
+	#include <malloc.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "file.h"
+#include "asserts.h"
+#include "segment_cache.h"
+
+namespace JASS
+	{
+	/*
+		ALIGNED_ALLOC()
+		---------------
+		Allocate memory aligned to a segment_cache::ALIGNMENT boundary (free with aligned_free())
+	*/
+	static uint8_t *aligned_alloc(size_t bytes)
+		{
+		#ifdef _MSC_VER
+			return (uint8_t *)_aligned_malloc(bytes, segment_cache::ALIGNMENT);
+		#else
+			return (uint8_t *)::aligned_alloc(segment_cache::ALIGNMENT, bytes);
+		#endif
+		}
+
+	/*
+		ALIGNED_FREE()
+		--------------
+		Free memory allocated with aligned_alloc()
+	*/
+	static void aligned_free(void *memory)
+		{
+		#ifdef _MSC_VER
+			_aligned_free(memory);
+		#else
+			::free(memory);
+		#endif
+		}
+
+	/*
+		READ_AT()
+		---------
+		Read bytes bytes from offset in the given file into buffer, returning the number of bytes read (short at end of file), or -1 on error
+	*/
+	static int64_t read_at(int file_handle, uint8_t *buffer, size_t bytes, uint64_t offset)
+		{
+		#ifdef _MSC_VER
+			/*
+				Windows doesn't have pread(), so seek and read under a lock
+			*/
+			static std::mutex seek_and_read;
+			std::lock_guard<std::mutex> lock(seek_and_read);
+			if (_lseeki64(file_handle, offset, SEEK_SET) < 0)
+				return -1;
+			return _read(file_handle, buffer, (unsigned int)bytes);
+		#else
+			size_t total = 0;
+			while (total < bytes)
+				{
+				ssize_t got = ::pread(file_handle, buffer + total, bytes - total, offset + total);
+				if (got < 0)
+					{
+					if (errno == EINTR)
+						continue;
+					return -1;
+					}
+				if (got == 0)
+					break;			// end of file
+				total += got;
+				}
+			return total;
+		#endif
+		}
+
+	/*
+		SEGMENT_CACHE::SEGMENT_CACHE()
+		------------------------------
+	*/
+	segment_cache::segment_cache(size_t capacity, size_t reader_threads) :
+		file_handle(-1),
+		direct(false),
+		capacity(capacity),
+		cached_bytes(0),
+		shutting_down(false),
+		hits(0),
+		misses(0)
+		{
+		reader_threads = reader_threads == 0 ? 1 : reader_threads;
+		for (size_t which = 0; which < reader_threads; which++)
+			readers.push_back(thread(reader, this));
+		}
+
+	/*
+		SEGMENT_CACHE::~SEGMENT_CACHE()
+		-------------------------------
+	*/
+	segment_cache::~segment_cache()
+		{
+		/*
+			Tell the readers to stop (once the read queue is empty) and wait for them
+		*/
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+			shutting_down = true;
+			}
+		work_available.notify_all();
+
+		for (auto &which : readers)
+			which.join();
+
+		if (file_handle >= 0)
+			#ifdef _MSC_VER
+				_close(file_handle);
+			#else
+				::close(file_handle);
+			#endif
+		}
+
+	/*
+		SEGMENT_CACHE::OPEN()
+		---------------------
+	*/
+	bool segment_cache::open(const std::string &filename)
+		{
+		#ifdef _MSC_VER
+			file_handle = _open(filename.c_str(), _O_RDONLY | _O_BINARY);
+			direct = false;
+		#else
+			/*
+				Try for direct I/O, but not all file systems support it (tmpfs, for example) so fall back to buffered I/O if need be.
+			*/
+			#ifdef O_DIRECT
+				file_handle = ::open(filename.c_str(), O_RDONLY | O_DIRECT);
+				direct = file_handle >= 0;
+				if (direct)
+					{
+					std::unique_ptr<uint8_t, void (*)(void *)> test(aligned_alloc(ALIGNMENT), aligned_free);
+					if (read_at(file_handle, test.get(), ALIGNMENT, 0) < 0)
+						{
+						::close(file_handle);
+						direct = false;
+						}
+					}
+				if (!direct)
+			#endif
+				file_handle = ::open(filename.c_str(), O_RDONLY);
+		#endif
+
+		return file_handle >= 0;
+		}
+
+	/*
+		SEGMENT_CACHE::READ()
+		---------------------
+	*/
+	void segment_cache::read(segment &into)
+		{
+		/*
+			Direct I/O must be block aligned so read the blocks that contain the segment
+		*/
+		uint64_t aligned_start = into.offset & ~(uint64_t)(ALIGNMENT - 1);
+		size_t allocated = allocation_size(into.offset, into.end);
+		size_t length = allocated - ALIGNMENT;
+
+		into.buffer = std::unique_ptr<uint8_t, void (*)(void *)>(aligned_alloc(allocated), aligned_free);
+		int64_t got = into.buffer == nullptr ? -1 : read_at(file_handle, into.buffer.get(), length, aligned_start);
+
+		/*
+			The read might be short at the end of the file, which is fine as long as we got the whole segment
+		*/
+		std::lock_guard<std::mutex> lock(into.mutex);
+		if (got >= 0 && (uint64_t)got >= into.end - aligned_start)
+			into.data = into.buffer.get() + (into.offset - aligned_start);
+		into.ready = true;
+		into.signal.notify_all();
+		}
+
+	/*
+		SEGMENT_CACHE::READER()
+		-----------------------
+	*/
+	void segment_cache::reader(segment_cache *cache)
+		{
+		for (;;)
+			{
+			std::shared_ptr<segment> next;
+
+				{
+				std::unique_lock<std::mutex> lock(cache->mutex);
+				cache->work_available.wait(lock, [cache](){ return cache->shutting_down || !cache->read_queue.empty(); });
+
+				if (cache->read_queue.empty())
+					return;				// shutting down and nothing left to do
+
+				next = cache->read_queue.front();
+				cache->read_queue.pop_front();
+				}
+
+			cache->read(*next);
+			}
+		}
+
+	/*
+		SEGMENT_CACHE::FETCH()
+		----------------------
+	*/
+	std::shared_ptr<segment_cache::segment> segment_cache::fetch(uint64_t offset, uint64_t end)
+		{
+		std::shared_ptr<segment> answer;
+
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			/*
+				If its in the cache then move it to the most-recently-used end of the list and return it
+			*/
+			auto found = cache.find(offset);
+			if (found != cache.end() && found->second.data->end == end)
+				{
+				hits++;
+				least_recently_used.splice(least_recently_used.end(), least_recently_used, found->second.age);
+				return found->second.data;
+				}
+
+			/*
+				Its not in the cache so add it and queue it to be read
+			*/
+			misses++;
+			if (found != cache.end())
+				{
+				cached_bytes -= found->second.data->charged;
+				least_recently_used.erase(found->second.age);
+				cache.erase(found);
+				}
+
+			answer = std::make_shared<segment>(offset, end);
+			answer->charged = allocation_size(offset, end);
+			least_recently_used.push_back(offset);
+			cache[offset] = cache_entry{answer, std::prev(least_recently_used.end())};
+			cached_bytes += answer->charged;
+			read_queue.push_back(answer);
+
+			/*
+				Evict the least recently used segments until we fit (those in use are deleted when they are no longer in use)
+			*/
+			while (cached_bytes > capacity && least_recently_used.size() > 1)
+				{
+				auto victim = cache.find(least_recently_used.front());
+				cached_bytes -= victim->second.data->charged;
+				cache.erase(victim);
+				least_recently_used.pop_front();
+				}
+			}
+
+		work_available.notify_one();
+
+		return answer;
+		}
+
+	/*
+		SEGMENT_CACHE::GET_STATISTICS()
+		-------------------------------
+	*/
+	void segment_cache::get_statistics(size_t &hits, size_t &misses, size_t &bytes)
+		{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		hits = this->hits;
+		misses = this->misses;
+		bytes = cached_bytes;
+		}
+
+	/*
+		SEGMENT_CACHE::UNITTEST()
+		-------------------------
+	*/
+	void segment_cache::unittest(void)
+		{
+		/*
+			Make a file that spans several blocks and isn't a whole number of blocks long
+		*/
+		std::string contents;
+		for (size_t byte = 0; byte < 3 * ALIGNMENT + 123; byte++)
+			contents.push_back((char)(byte * 7 % 251));
+		std::string filename = file::mkstemp("jass");
+		file::write_entire_file(filename, contents);
+
+		/*
+			Can't open a file that doesn't exist
+		*/
+		{
+		segment_cache missing(ALIGNMENT);
+		JASS_assert(!missing.open(filename + ".does.not.exist"));
+		}
+
+		segment_cache cache(4 * ALIGNMENT, 2);
+		JASS_assert(cache.open(filename));
+
+		/*
+			Fetch segments in one block, across blocks, at the end of the file, and at the start of the file
+		*/
+		std::pair<uint64_t, uint64_t> tests[] = {{10, 20}, {ALIGNMENT - 5, 2 * ALIGNMENT + 7}, {contents.size() - 10, contents.size()}, {0, 1}};
+		std::vector<std::shared_ptr<segment>> fetched;
+		for (const auto &[start, end] : tests)
+			fetched.push_back(cache.fetch(start, end));		// all in flight at once
+
+		for (size_t which = 0; which < fetched.size(); which++)
+			{
+			const uint8_t *data = fetched[which]->wait();
+			JASS_assert(data != nullptr);
+			JASS_assert(memcmp(data, contents.data() + tests[which].first, tests[which].second - tests[which].first) == 0);
+			}
+
+		/*
+			The last one fetched is still in the cache, but the cache is not larger than its capacity.  A segment counts as the aligned
+			blocks that hold it plus a block of slack, so the four segments above take 2 + 4 + 2 + 2 blocks and don't all fit.
+		*/
+		size_t hits;
+		size_t misses;
+		size_t bytes;
+		JASS_assert(cache.fetch(0, 1)->wait()[0] == contents[0]);
+		cache.get_statistics(hits, misses, bytes);
+		JASS_assert(hits == 1);
+		JASS_assert(misses == 4);
+		JASS_assert(bytes == 4 * ALIGNMENT);
+
+		/*
+			A segment larger than the cache evicts everything else, but is itself kept (as it is in use)
+		*/
+		JASS_assert(cache.fetch(0, 3 * ALIGNMENT + 1)->wait() != nullptr);
+		cache.get_statistics(hits, misses, bytes);
+		JASS_assert(bytes == 5 * ALIGNMENT);
+		JASS_assert(memcmp(cache.fetch(10, 20)->wait(), contents.data() + 10, 10) == 0);
+		cache.get_statistics(hits, misses, bytes);
+		JASS_assert(hits == 1);
+		JASS_assert(misses == 6);
+		JASS_assert(bytes == 2 * ALIGNMENT);
+
+		/*
+			A segment past the end of the file fails
+		*/
+		JASS_assert(cache.fetch(contents.size() + ALIGNMENT, contents.size() + ALIGNMENT + 10)->wait() == nullptr);
+
+		::remove(filename.c_str());
+
+		puts("segment_cache::PASSED");
+		}
+	}
@@ -0,0 +1,239 @@
+/*
+	SEGMENT_CACHE.H
+	---------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A user-space cache of impact segments read on demand (and asynchronously) from the postings file using direct I/O.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <list>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+
+#include "threads.h"
+
+namespace JASS
+	{
+	/*
+		CLASS SEGMENT_CACHE
+		-------------------
+	*/
+	/*!
+		@brief A user-space cache of impact segments read on demand from the postings file (for indexes too large to keep in memory).
+		@details The postings file is opened with O_DIRECT (where supported) so that reads bypass the page cache and the cache size
+		is under our control.  fetch() returns immediately with a segment that is either already in the cache or queued to be read
+		by one of a pool of reader threads, so all the segments of a query can be requested at once (as soon as their offsets are
+		known) and the disk can service them in parallel.  The caller then wait()s for each segment as it is needed.  Segments are
+		evicted in least-recently-used order once the cache exceeds its capacity, but a segment is not deleted while anyone holds it.
+	*/
+	class segment_cache
+		{
+		public:
+			static constexpr size_t ALIGNMENT = 4096;				///< O_DIRECT reads must be aligned to (and a multiple of) the device block size
+
+			/*
+				CLASS SEGMENT_CACHE::SEGMENT
+				----------------------------
+			*/
+			/*!
+				@brief A segment read (or being read) from disk
+			*/
+			class segment
+				{
+				friend class segment_cache;
+
+				private:
+					uint64_t offset;											///< Where the segment starts in the postings file
+					uint64_t end;												///< Where the segment ends in the postings file
+					size_t charged;											///< The number of bytes this segment counts against the cache capacity (see allocation_size())
+					std::unique_ptr<uint8_t, void (*)(void *)> buffer;	///< Aligned buffer holding the (aligned) blocks containing the segment
+					const uint8_t *data;										///< The start of the segment in buffer (nullptr if the read failed)
+					bool ready;													///< Has the read completed?
+					std::mutex mutex;											///< Protects ready
+					std::condition_variable signal;						///< Signalled when the read completes
+
+				public:
+					/*
+						SEGMENT_CACHE::SEGMENT::SEGMENT()
+						---------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param offset [in] Where the segment starts in the postings file
+						@param end [in] Where the segment ends in the postings file
+					*/
+					segment(uint64_t offset, uint64_t end) :
+						offset(offset),
+						end(end),
+						charged(0),
+						buffer(nullptr, free),
+						data(nullptr),
+						ready(false)
+						{
+						/* Nothing */
+						}
+
+					/*
+						SEGMENT_CACHE::SEGMENT::WAIT()
+						------------------------------
+					*/
+					/*!
+						@brief Block until the segment has been read from disk
+						@return A pointer to the segment (of length end - offset), or nullptr if the read failed
+					*/
+					const uint8_t *wait(void)
+						{
+						std::unique_lock<std::mutex> lock(mutex);
+						signal.wait(lock, [this](){ return ready; });
+						return data;
+						}
+				};
+
+		private:
+			/*
+				CLASS SEGMENT_CACHE::CACHE_ENTRY
+				--------------------------------
+			*/
+			/*!
+				@brief A segment in the cache and its place in the least-recently-used list
+			*/
+			class cache_entry
+				{
+				public:
+					std::shared_ptr<segment> data;							///< The segment
+					std::list<uint64_t>::iterator age;						///< Where it is in the least-recently-used list
+				};
+
+		private:
+			int file_handle;													///< The postings file (-1 if not open)
+			bool direct;														///< Was the file opened with O_DIRECT?
+			size_t capacity;													///< The maximum number of bytes to keep in the cache
+			size_t cached_bytes;												///< The number of bytes allocated to the segments in the cache
+			std::map<uint64_t, cache_entry> cache;						///< The segments, keyed on their offset in the postings file
+			std::list<uint64_t> least_recently_used;					///< Offsets of the segments in the cache, least recently used at the front
+			std::deque<std::shared_ptr<segment>> read_queue;			///< Segments waiting to be read
+			std::mutex mutex;													///< Protects everything above
+			std::condition_variable work_available;					///< Signalled when a segment is added to read_queue (or on shutdown)
+			bool shutting_down;												///< Set when the reader threads should exit
+			std::vector<thread> readers;									///< The threads that read from disk
+			size_t hits;														///< The number of fetch()es found in the cache
+			size_t misses;														///< The number of fetch()es that had to go to disk
+
+		private:
+			/*
+				SEGMENT_CACHE::ALLOCATION_SIZE()
+				--------------------------------
+			*/
+			/*!
+				@brief Return the number of bytes read() allocates to hold a segment (the aligned blocks containing it, plus slack)
+				@param offset [in] Where the segment starts in the postings file
+				@param end [in] Where the segment ends in the postings file
+				@return The size of the buffer
+			*/
+			static size_t allocation_size(uint64_t offset, uint64_t end)
+				{
+				uint64_t aligned_start = offset & ~(uint64_t)(ALIGNMENT - 1);
+				uint64_t aligned_end = (end + ALIGNMENT - 1) & ~(uint64_t)(ALIGNMENT - 1);
+
+				return aligned_end - aligned_start + ALIGNMENT;		// some decoders read past the end of the segment so add some slack
+				}
+
+			/*
+				SEGMENT_CACHE::READER()
+				-----------------------
+			*/
+			/*!
+				@brief The reader thread, read segments from the read queue until shutdown.
+				@param cache [in] The cache this thread is reading for
+			*/
+			static void reader(segment_cache *cache);
+
+			/*
+				SEGMENT_CACHE::READ()
+				---------------------
+			*/
+			/*!
+				@brief Read a segment from disk (and signal anyone waiting on it)
+				@param into [in/out] The segment to read
+			*/
+			void read(segment &into);
+
+		public:
+			/*
+				SEGMENT_CACHE::SEGMENT_CACHE()
+				------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param capacity [in] The maximum number of bytes to keep in the cache
+				@param reader_threads [in] The number of threads reading from disk (the number of reads in flight at once)
+			*/
+			segment_cache(size_t capacity, size_t reader_threads = 8);
+
+			/*
+				SEGMENT_CACHE::~SEGMENT_CACHE()
+				-------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			~segment_cache();
+
+			/*
+				SEGMENT_CACHE::OPEN()
+				---------------------
+			*/
+			/*!
+				@brief Open the postings file
+				@param filename [in] The name of the postings file
+				@return true on success, else false
+			*/
+			bool open(const std::string &filename);
+
+			/*
+				SEGMENT_CACHE::FETCH()
+				----------------------
+			*/
+			/*!
+				@brief Return the segment, from the cache if it is there, else queued to be read from disk.  This method does not block on I/O.
+				@param offset [in] Where the segment starts in the postings file
+				@param end [in] Where the segment ends in the postings file
+				@return The segment, call wait() on it to get its contents
+			*/
+			std::shared_ptr<segment> fetch(uint64_t offset, uint64_t end);
+
+			/*
+				SEGMENT_CACHE::GET_STATISTICS()
+				-------------------------------
+			*/
+			/*!
+				@brief Return the cache usage statistics
+				@param hits [out] The number of fetches found in the cache
+				@param misses [out] The number of fetches read from disk
+				@param bytes [out] The number of bytes allocated to the segments in the cache
+			*/
+			void get_statistics(size_t &hits, size_t &misses, size_t &bytes);
+
+			/*
+				SEGMENT_CACHE::UNITTEST()
+				-------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
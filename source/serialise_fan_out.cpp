@@ -0,0 +1,219 @@
+/*
+	SERIALISE_FAN_OUT.CPP
+	---------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <sstream>
+
+#include "asserts.h"
+#include "unittest_data.h"
+#include "serialise_fan_out.h"
+#include "index_manager_sequential.h"
+
+namespace JASS
+	{
+	/*
+		SERIALISE_FAN_OUT::SERIALISE_FAN_OUT()
+		--------------------------------------
+	*/
+	serialise_fan_out::serialise_fan_out(size_t documents, std::vector<std::unique_ptr<index_manager::delegate>> &serialisers) :
+		index_manager::delegate(documents),
+		serialisers(serialisers),
+		current(std::make_unique<batch>()),
+		queues(serialisers.size()),
+		shutting_down(false)
+		{
+		for (size_t which = 0; which < serialisers.size(); which++)
+			threads.push_back(thread(work, this, which));
+		}
+
+	/*
+		SERIALISE_FAN_OUT::~SERIALISE_FAN_OUT()
+		---------------------------------------
+	*/
+	serialise_fan_out::~serialise_fan_out()
+		{
+		finish();
+		}
+
+	/*
+		SERIALISE_FAN_OUT::WORK()
+		-------------------------
+	*/
+	void serialise_fan_out::work(serialise_fan_out *fan_out, size_t which)
+		{
+		auto &serialiser = *fan_out->serialisers[which];
+		auto &queue = fan_out->queues[which];
+
+		for (;;)
+			{
+			std::shared_ptr<const batch> next;
+
+				{
+				std::unique_lock<std::mutex> lock(fan_out->mutex);
+				fan_out->not_empty.wait(lock, [fan_out, &queue](){ return fan_out->shutting_down || !queue.empty(); });
+
+				if (queue.empty())
+					break;				// shutting down and nothing left to do
+
+				next = queue.front();
+				queue.pop_front();
+				}
+			fan_out->not_full.notify_all();
+
+			/*
+				The batch is shared with the other serialisers so it is read only, but the serialiser interface takes non-const pointers
+			*/
+			auto document_ids = const_cast<compress_integer::integer *>(next->document_ids.data());
+			auto term_frequencies = const_cast<index_postings_impact::impact_type *>(next->term_frequencies.data());
+			for (const auto &current : next->items)
+				{
+				if (current.postings == nullptr)
+					serialiser(current.document_frequency_or_id, current.string);
+				else
+					serialiser(current.string, *current.postings, (compress_integer::integer)current.document_frequency_or_id, document_ids + current.postings_start, term_frequencies + current.postings_start);
+				}
+			}
+
+		serialiser.finish();
+		}
+
+	/*
+		SERIALISE_FAN_OUT::DISPATCH()
+		-----------------------------
+	*/
+	void serialise_fan_out::dispatch(void)
+		{
+		std::shared_ptr<const batch> sending(current.release());
+
+			{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (auto &queue : queues)
+				{
+				not_full.wait(lock, [&queue](){ return queue.size() < QUEUE_LENGTH; });
+				queue.push_back(sending);
+				}
+			}
+		not_empty.notify_all();
+
+		current = std::make_unique<batch>();
+		}
+
+	/*
+		SERIALISE_FAN_OUT::OPERATOR()()
+		-------------------------------
+	*/
+	void serialise_fan_out::operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+		{
+		current->items.push_back(item{term, &postings, current->document_ids.size(), document_frequency});
+
+		current->document_ids.insert(current->document_ids.end(), document_ids, document_ids + document_frequency);
+		current->term_frequencies.insert(current->term_frequencies.end(), term_frequencies, term_frequencies + document_frequency);
+
+		if (current->document_ids.size() >= BATCH_POSTINGS || current->items.size() >= BATCH_ITEMS)
+			dispatch();
+		}
+
+	/*
+		SERIALISE_FAN_OUT::OPERATOR()()
+		-------------------------------
+	*/
+	void serialise_fan_out::operator()(size_t document_id, const slice &primary_key)
+		{
+		current->items.push_back(item{primary_key, nullptr, 0, document_id});
+
+		if (current->items.size() >= BATCH_ITEMS)
+			dispatch();
+		}
+
+	/*
+		SERIALISE_FAN_OUT::FINISH()
+		---------------------------
+	*/
+	void serialise_fan_out::finish(void)
+		{
+		if (shutting_down)
+			return;
+
+		if (current->items.size() != 0)
+			dispatch();
+
+		/*
+			Tell the threads to stop (once their queue is empty) and wait for them to finish()
+		*/
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+			shutting_down = true;
+			}
+		not_empty.notify_all();
+
+		for (auto &which : threads)
+			which.join();
+		}
+
+	/*
+		SERIALISE_FAN_OUT::UNITTEST()
+		-----------------------------
+	*/
+	void serialise_fan_out::unittest(void)
+		{
+		/*
+			Write everything into a string (and count the calls to finish())
+		*/
+		class unittest_delegate : public index_manager::delegate
+			{
+			public:
+				std::ostringstream output;
+				size_t finished;
+
+			public:
+				unittest_delegate() : delegate(10), finished(0) {}
+				virtual void operator()(const slice &term, const index_postings &, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+					{
+					output << term << "->";
+					for (compress_integer::integer which = 0; which < document_frequency; which++)
+						output << "<" << document_ids[which] << "," << term_frequencies[which] << ">";
+					output << '\n';
+					}
+				virtual void operator()(size_t document_id, const slice &primary_key)
+					{
+					output << document_id << "->" << primary_key << '\n';
+					}
+				virtual void finish(void)
+					{
+					finished++;
+					}
+			};
+
+		index_manager_sequential index;
+		index_manager_sequential::unittest_build_index(index, unittest_data::ten_documents);
+
+		/*
+			The answer is what we get by iterating directly
+		*/
+		unittest_delegate expected;
+		index.iterate(expected);
+
+		/*
+			Fan out to three serialisers at once, each should see the same thing
+		*/
+		std::vector<std::unique_ptr<index_manager::delegate>> serialisers;
+		for (size_t which = 0; which < 3; which++)
+			serialisers.push_back(std::make_unique<unittest_delegate>());
+
+		serialise_fan_out fan_out(10, serialisers);
+		index.iterate(fan_out);
+		fan_out.finish();
+		fan_out.finish();			// a second call does nothing
+
+		for (const auto &serialiser : serialisers)
+			{
+			auto &got = *static_cast<unittest_delegate *>(serialiser.get());
+			JASS_assert(got.output.str() == expected.output.str());
+			JASS_assert(got.finished == 1);
+			}
+
+		puts("serialise_fan_out::PASSED");
+		}
+	}
@@ -0,0 +1,172 @@
+/*
+	SERIALISE_FAN_OUT.H
+	-------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Pass each (quantized) postings list to several serialisers, each running in its own thread.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <condition_variable>
+
+#include "threads.h"
+#include "index_manager.h"
+
+namespace JASS
+	{
+	/*
+		CLASS SERIALISE_FAN_OUT
+		-----------------------
+	*/
+	/*!
+		@brief Pass each (quantized) postings list to several serialisers, each running in its own thread.
+		@details This allows an index to be iterated (and so linearized and quantized) once no matter how many formats it is being written
+		in.  The postings lists are copied into batches which are shared (read only) between one thread per serialiser, so
+		the serialisers run concurrently with each other and with the iteration.  Each serialiser sees exactly the same sequence of calls it
+		would have seen had it been passed to iterate() directly, and finish() is called on each once everything has been written.  The
+		serialisers must not modify the document_ids or term_frequencies arrays they are passed (none of the JASS serialisers do).  The terms
+		and primary keys are not copied (the serialisers keep the terms until finish() so they must already outlive the serialisers).
+	*/
+	class serialise_fan_out : public index_manager::delegate
+		{
+		private:
+			static constexpr size_t BATCH_POSTINGS = 1 << 20;		///< Send a batch once it holds this many postings
+			static constexpr size_t BATCH_ITEMS = 16 * 1024;		///< Send a batch once it holds this many postings lists (or primary keys)
+			static constexpr size_t QUEUE_LENGTH = 4;					///< The maximum number of batches waiting for a serialiser (operator() blocks when full)
+
+			/*
+				CLASS SERIALISE_FAN_OUT::ITEM
+				-----------------------------
+			*/
+			/*!
+				@brief A postings list or a primary key
+			*/
+			class item
+				{
+				public:
+					slice string;											///< The term or primary key
+					const index_postings *postings;					///< The postings list (or nullptr if this is a primary key)
+					size_t postings_start;								///< Where the postings start in the batch's document_ids and term_frequencies
+					size_t document_frequency_or_id;					///< The document frequency of a postings list, or the document id of a primary key
+				};
+
+			/*
+				CLASS SERIALISE_FAN_OUT::BATCH
+				------------------------------
+			*/
+			/*!
+				@brief A sequence of postings lists and primary keys to be serialised
+			*/
+			class batch
+				{
+				public:
+					std::vector<item> items;													///< The postings lists and primary keys in order
+					std::vector<compress_integer::integer> document_ids;				///< The document ids of all the postings lists
+					std::vector<index_postings_impact::impact_type> term_frequencies;	///< The term frequencies (impacts) of all the postings lists
+				};
+
+		private:
+			std::vector<std::unique_ptr<index_manager::delegate>> &serialisers;	///< The serialisers to pass everything on to
+			std::unique_ptr<batch> current;												///< The batch being filled
+			std::vector<std::deque<std::shared_ptr<const batch>>> queues;		///< The batches waiting for each serialiser
+			std::vector<thread> threads;													///< One thread for each serialiser
+			std::mutex mutex;																	///< Protects queues and shutting_down
+			std::condition_variable not_empty;											///< Signalled when a batch is added to the queues (or on shutdown)
+			std::condition_variable not_full;											///< Signalled when a batch is taken from a queue
+			bool shutting_down;																///< Set when the threads should exit (once their queue is empty)
+
+		private:
+			/*
+				SERIALISE_FAN_OUT::WORK()
+				-------------------------
+			*/
+			/*!
+				@brief The serialiser thread, serialise batches until shutdown, then call finish().
+				@param fan_out [in] The object this thread is working for.
+				@param which [in] The serialiser this thread is responsible for.
+			*/
+			static void work(serialise_fan_out *fan_out, size_t which);
+
+			/*
+				SERIALISE_FAN_OUT::DISPATCH()
+				-----------------------------
+			*/
+			/*!
+				@brief Send the current batch to all the serialisers (blocking if any queue is full).
+			*/
+			void dispatch(void);
+
+		public:
+			/*
+				SERIALISE_FAN_OUT::SERIALISE_FAN_OUT()
+				--------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param documents [in] The number of documents in the collection.
+				@param serialisers [in] The serialisers to pass everything on to (they must exist for the life of this object).
+			*/
+			serialise_fan_out(size_t documents, std::vector<std::unique_ptr<index_manager::delegate>> &serialisers);
+
+			/*
+				SERIALISE_FAN_OUT::~SERIALISE_FAN_OUT()
+				---------------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~serialise_fan_out();
+
+			/*
+				SERIALISE_FAN_OUT::OPERATOR()()
+				-------------------------------
+			*/
+			/*!
+				@brief Pass a postings list on to each serialiser.
+				@param term [in] The term name.
+				@param postings [in] The postings lists (which must exist until finish() returns).
+				@param document_frequency [in] The document frequency of the term
+				@param document_ids [in] An array (of length document_frequency) of document ids.
+				@param term_frequencies [in] An array (of length document_frequency) of term frequencies (corresponding to document_ids).
+			*/
+			virtual void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies);
+
+			/*
+				SERIALISE_FAN_OUT::OPERATOR()()
+				-------------------------------
+			*/
+			/*!
+				@brief Pass a primary key on to each serialiser.
+				@param document_id [in] The internal document identfier.
+				@param primary_key [in] This document's primary key (external document identifier).
+			*/
+			virtual void operator()(size_t document_id, const slice &primary_key);
+
+			/*
+				SERIALISE_FAN_OUT::FINISH()
+				---------------------------
+			*/
+			/*!
+				@brief Wait for each serialiser to serialise everything it has been given, and to finish().
+			*/
+			virtual void finish(void);
+
+			/*
+				SERIALISE_FAN_OUT::UNITTEST()
+				-----------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
@@ -4,6 +4,9 @@
 	Copyright (c) 2016 Andrew Trotman
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
+#include <stdio.h>
+#include <string.h>
+
 #include <algorithm>
 
 #include "reverse.h"
@@ -11,6 +14,7 @@
 #include "allocator.h"
 #include "serialise_jass_v1.h"
 #include "compress_integer_all.h"
+#include "deserialised_jass_v1.h"
 #include "index_manager_sequential.h"
 
 namespace JASS
@@ -30,6 +34,51 @@ namespace JASS
 			Serialise the primary key offsets and the number of documents in the collection.
 		*/
 		serialise_primary_keys();
+
+		/*
+			Checksum the index files
+		*/
+		serialise_checksums();
+		}
+
+	/*
+		SERIALISE_JASS_V1::SERIALISE_CHECKSUMS()
+		----------------------------------------
+	*/
+	void serialise_jass_v1::serialise_checksums(void)
+		{
+		std::vector<uint8_t> buffer(1024 * 1024);
+		std::string manifest;
+		std::pair<const char *, file *> index_files[] =
+			{
+			{"CIdoclist.bin", &primary_keys},
+			{"CIvocab.bin", &vocabulary},
+			{"CIvocab_terms.bin", &vocabulary_strings},
+			{"CIpostings.bin", &postings}
+			};
+
+		/*
+			Read each file back from the start (this also flushes the write buffer) and compute the CRC-32C of it.
+		*/
+		for (auto &[filename, index_file] : index_files)
+			{
+			uint32_t crc = 0;
+			uint64_t length = 0;
+			size_t bytes_read;
+
+			index_file->seek(0);
+			while ((bytes_read = index_file->read(&buffer[0], buffer.size())) != 0)
+				{
+				crc = checksum::crc32c(&buffer[0], bytes_read, crc);
+				length += bytes_read;
+				}
+
+			char line[1024];
+			snprintf(line, sizeof(line), "%08X %llu %s\n", (unsigned)crc, (unsigned long long)length, filename);
+			manifest += line;
+			}
+
+		file::write_entire_file((directory / "CIchecksums.txt").string(), manifest);
 		}
 
 	/*
@@ -306,6 +355,21 @@ namespace JASS
 //std::cout << "CIdoclist.bin checksum:" << checksum << "\n";
 		JASS_assert(checksum == 3045);
 
+		/*
+			The checksum manifest must match the files and the files must verify
+		*/
+		std::string manifest;
+		file::read_entire_file("CIchecksums.txt", manifest);
+		std::string doclist;
+		file::read_entire_file("CIdoclist.bin", doclist);
+		char expected[64];
+		snprintf(expected, sizeof(expected), "%08X %llu CIdoclist.bin\n", (unsigned)checksum::crc32c(doclist.data(), doclist.size()), (unsigned long long)doclist.size());
+		JASS_assert(manifest.compare(0, strlen(expected), expected) == 0);
+
+		deserialised_jass_v1 loaded;
+		loaded.read_index();
+		JASS_assert(loaded.verify_checksums());
+
 		puts("serialise_jass_v1::PASSED");
 		}
 	}
@@ -12,6 +12,9 @@
 */
 #pragma once
 
+#include <string>
+#include <filesystem>
+
 #include "file.h"
 #include "slice.h"
 #include "allocator_cpp.h"
@@ -66,6 +69,10 @@ namespace JASS
 		seperately. These lists do not have the impact score stored at the start and do not have 0 terminators on them. This 
 		means score-at-a-time processing is the only paradigm, even if term-at-a-time processing is done score-at-a-time for 
 		each term. ATIRE could do either (but it was a compile time flag).
+
+		CIchecksums.txt: Not part of JASS version 1.  One line for each of the other 4 files, each line being the CRC-32C (8 hex digits),
+		the length (in bytes), and the name of the file (seperated by spaces).  It is used to check the index has not been corrupted (see
+		deserialised_jass_v1::verify_checksums()).
 	*/
 	class serialise_jass_v1 : public index_manager::delegate
 		{
@@ -158,6 +165,7 @@ namespace JASS
 			std::vector<uint8_t, allocator_cpp<uint8_t>> compressed_buffer;		///< The buffer used to compress postings into.
 			std::vector<slice, allocator_cpp<slice>> compressed_segments;			///< vector of pointers (and lengths) to the compressed postings.
 			uint8_t alignment;									///< Postings lists are padded to this alignment (used for codexes that require word alignment).
+			std::filesystem::path directory;					///< The index files are written into this directory.
 
 		protected:
 			/*
@@ -185,20 +193,22 @@ namespace JASS
 				@param documents [in] The number of documents in the collection (used to allocate re-usable buffers).
 				@param encoder [in] An shared pointer to a codex responsible for performing the compression of postings lists (default = compress_integer_QMX_jass_v1()).
 				@param alignment [in] The start address of a postings list is padded to start on these boundaries (needed for compress_integer_QMX_jass_v1 (use 16), and others).  Default = 0.
+				@param directory [in] The directory to write the index into (which must exist).  Default = "" (the current directory).
 			*/
-			serialise_jass_v1(size_t documents, jass_v1_codex codex = jass_v1_codex::elias_gamma_simd, int8_t alignment = 1) :
+			serialise_jass_v1(size_t documents, jass_v1_codex codex = jass_v1_codex::elias_gamma_simd, int8_t alignment = 1, const std::string &directory = "") :
 				index_manager::delegate(documents),
-				vocabulary_strings("CIvocab_terms.bin", "w+b"),
-				vocabulary("CIvocab.bin", "w+b"),
-				postings("CIpostings.bin", "w+b"),
-				primary_keys("CIdoclist.bin", "w+b"),
+				vocabulary_strings((std::filesystem::path(directory) / "CIvocab_terms.bin").string(), "w+b"),
+				vocabulary((std::filesystem::path(directory) / "CIvocab.bin").string(), "w+b"),
+				postings((std::filesystem::path(directory) / "CIpostings.bin").string(), "w+b"),
+				primary_keys((std::filesystem::path(directory) / "CIdoclist.bin").string(), "w+b"),
 				memory(1024 * 1024),								///< The allocation block size is currently 1MB, big enough for most postings lists (but it'll grow for larger ones).
 				impact_ordered(documents, memory),
 				encoder(get_compressor(codex, compressor_name, compressor_d_ness)),
 				allocator(memory),
 				compressed_buffer(allocator),
 				compressed_segments(allocator),
-				alignment(alignment)
+				alignment(alignment),
+				directory(directory)
 				{
 				/*
 					Allocate space for storing the compressed postings.  But, allocate too much space as some
@@ -268,6 +278,15 @@ namespace JASS
 			*/
 			virtual void serialise_primary_keys(void);
 
+			/*
+				 SERIALISE_JASS_V1::SERIALISE_CHECKSUMS()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Compute the CRC-32C of each of the index files and write them to CIchecksums.txt (this must be the last thing written).
+			*/
+			virtual void serialise_checksums(void);
+
 			/*
 				SERIALISE_JASS_V1::DELEGATE::OPERATOR()()
 				-----------------------------------------
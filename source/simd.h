@@ -442,6 +442,36 @@ namespace JASS
 				}
 #endif
 
+			/*
+				SIMD::WIDEN()
+				-------------
+			*/
+			/*!
+				@brief Load 4 x 8-bit integers into an SSE register of 4 x 32-bit integers.
+				@param array [in] The 4 integers to load.
+				@return The 4 integers.
+			*/
+			forceinline static __m128i widen(const uint8_t *array)
+				{
+				int32_t four;
+				::memcpy(&four, array, sizeof(four));
+				return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(four));
+				}
+
+			/*
+				SIMD::WIDEN()
+				-------------
+			*/
+			/*!
+				@brief Load 4 x 16-bit integers into an SSE register of 4 x 32-bit integers.
+				@param array [in] The 4 integers to load.
+				@return The 4 integers.
+			*/
+			forceinline static __m128i widen(const uint16_t *array)
+				{
+				return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)array));
+				}
+
 			/*
 				SIMD::CUMULATIVE_SUM()
 				----------------------
@@ -824,6 +854,17 @@ namespace JASS
 				uint32_t sum_answer[8] = {0, 1, 3, 6, 10, 15, 21, 28};
 				JASS_assert(::memcmp(destination_32, sum_answer, sizeof(sum_answer)) == 0);
 
+				/*
+					Check widening
+				*/
+				uint32_t widened[4];
+				_mm_storeu_si128((__m128i *)widened, simd::widen(source_8));
+				for (size_t pos = 0; pos < 4; pos++)
+					JASS_assert(widened[pos] == pos);
+				_mm_storeu_si128((__m128i *)widened, simd::widen(source_16));
+				for (size_t pos = 0; pos < 4; pos++)
+					JASS_assert(widened[pos] == pos);
+
 #ifdef __AVX512F__
 				uint32_t numbers[] = {0, 1, 3, 7, 15, 31, 63, 127, 255, 511, 1023, 2047, 4095, 8191, 16383, 32767};
 				__m512i bit_vector = _mm512_loadu_si512(numbers);
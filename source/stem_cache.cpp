@@ -0,0 +1,83 @@
+/*
+	STEM_CACHE.CPP
+	--------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "asserts.h"
+#include "stem_cache.h"
+#include "stem_porter.h"
+
+namespace JASS
+	{
+	/*
+		STEM_CACHE::UNITTEST()
+		----------------------
+	*/
+	void stem_cache::unittest(void)
+		{
+		std::vector<std::string> words = {"caresses", "ponies", "hopping", "relational", "hopping", "vietnamization", "sky", "caresses", "relational", "internationalisationalisations", "supercalifragilisticexpialidociously"};
+
+		/*
+			A large cache and a one-slot cache (where every word replaces the last) both give the same answers as the stemmer
+		*/
+		for (size_t slots : {size_t(1024), size_t(1)})
+			{
+			stem_porter stemmer;
+			stem_cache cached(std::make_unique<stem_porter>(), slots);
+			JASS_assert(cached.name() == "Porter");
+
+			for (size_t pass = 0; pass < 2; pass++)
+				for (const auto &word : words)
+					{
+					char expected[1024];
+					char got[1024];
+					size_t expected_length = stemmer.tostem(expected, word.c_str(), word.size());
+					size_t got_length = cached.tostem(got, word.c_str(), word.size());
+					JASS_assert(got_length == expected_length);
+					JASS_assert(strcmp(got, expected) == 0);
+
+					/*
+						In place (source and destination the same)
+					*/
+					strcpy(got, word.c_str());
+					got_length = cached.tostem(got, got, word.size());
+					JASS_assert(got_length == expected_length);
+					JASS_assert(strcmp(got, expected) == 0);
+					}
+
+			/*
+				The words longer than longest_word are never cached, the others are found from the second time (in the large cache)
+			*/
+			JASS_assert(cached.get_hits() + cached.get_misses() == 4 * (words.size() - 1));
+			if (slots != 1)
+				JASS_assert(cached.get_misses() == 7);
+			}
+
+		/*
+			Words of every length (which are keyed and copied differently), each twice so the second comes from the cache
+		*/
+		stem_porter stemmer;
+		stem_cache cached(std::make_unique<stem_porter>());
+		std::string sentence = "the generalisations of relational hopping motors";
+		for (size_t length = 1; length <= sentence.size(); length++)
+			for (size_t pass = 0; pass < 2; pass++)
+				{
+				char expected[1024];
+				char got[1024];
+				size_t expected_length = stemmer.tostem(expected, sentence.c_str() + sentence.size() - length, length);
+				size_t got_length = cached.tostem(got, sentence.c_str() + sentence.size() - length, length);
+				JASS_assert(got_length == expected_length);
+				JASS_assert(strcmp(got, expected) == 0);
+				}
+		JASS_assert(cached.get_hits() == longest_word);
+
+		puts("stem_cache::PASSED");
+		}
+	}
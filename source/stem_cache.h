@@ -0,0 +1,336 @@
+/*
+	STEM_CACHE.H
+	------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Remember the stems of recently seen words so that they are not stemmed again.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "stem.h"
+#include "forceinline.h"
+
+namespace JASS
+	{
+	/*
+		CLASS STEM_CACHE
+		----------------
+	*/
+	/*!
+		@brief Remember the stems of recently seen words so that they are not stemmed again.
+		@details Word frequencies are Zipfian so most of the tokens of a collection are a few thousand different words, and a small cache
+		in front of the stemmer answers most of them.  The cache is direct mapped (each word has one slot, chosen by hash, and a new word
+		replaces the old one) so its size is fixed.  Each slot is one cache line holding the word and its stem, so words (and stems) longer
+		than longest_word are not cached.  A stem_cache is not thread safe, so each thread should have its own (as each JASS_index
+		indexing thread has its own stemmer).
+	*/
+	class stem_cache : public stem
+		{
+		public:
+			static constexpr size_t longest_word = 30;		///< Words (and stems) longer than this are not cached
+
+		private:
+			/*
+				CLASS STEM_CACHE::SLOT
+				----------------------
+			*/
+			/*!
+				@brief A word and its stem.
+				@details The word is kept as the (up to) four overlapping 8-byte loads that cover it (see get_key()), so a lookup is a few
+				integer compares rather than a call to memcmp().
+			*/
+			class alignas(64) slot
+				{
+				public:
+					uint64_t key[4];						///< The word (see get_key())
+					uint8_t word_length;					///< The length of the word (0 if the slot is empty)
+					uint8_t stem_length;					///< The length of stem
+					char stem[longest_word];			///< The stem of the word
+				};
+
+		private:
+			std::unique_ptr<stem> stemmer;			///< The stemmer to use on a cache miss
+			std::vector<slot> cache;					///< The slots
+			size_t mask;									///< cache.size() - 1 (as the size is a power of 2)
+			size_t hits;									///< The number of words found in the cache
+			size_t misses;									///< The number of words stemmed
+
+		private:
+			/*
+				STEM_CACHE::LOAD()
+				------------------
+			*/
+			/*!
+				@brief Read an integer from memory that might not be aligned.
+				@param from [in] Where to read from.
+				@return The integer.
+			*/
+			template <typename TYPE>
+			forceinline static TYPE load(const char *from)
+				{
+				TYPE value;
+				memcpy(&value, from, sizeof(value));
+				return value;
+				}
+
+			/*
+				STEM_CACHE::STORE()
+				-------------------
+			*/
+			/*!
+				@brief Write an integer to memory that might not be aligned.
+				@param to [out] Where to write to.
+				@param value [in] The integer.
+			*/
+			template <typename TYPE>
+			forceinline static void store(char *to, TYPE value)
+				{
+				memcpy(to, &value, sizeof(value));
+				}
+
+			/*
+				STEM_CACHE::GET_KEY()
+				---------------------
+			*/
+			/*!
+				@brief Turn a word into 4 integers using loads that overlap rather than a loop (or a call to memcpy()).
+				@details Between them the loads cover every byte of the word, so two words of the same length are the same if their keys are.
+				@param key [out] The key.
+				@param word [in] The word.
+				@param length [in] The length of the word (no more than 32).
+			*/
+			forceinline static void get_key(uint64_t key[4], const char *word, size_t length)
+				{
+				if (length >= 16)
+					{
+					key[0] = load<uint64_t>(word);
+					key[1] = load<uint64_t>(word + 8);
+					key[2] = load<uint64_t>(word + length - 16);
+					key[3] = load<uint64_t>(word + length - 8);
+					}
+				else if (length >= 8)
+					{
+					key[0] = load<uint64_t>(word);
+					key[1] = load<uint64_t>(word + length - 8);
+					key[2] = key[3] = 0;
+					}
+				else if (length >= 4)
+					{
+					key[0] = load<uint32_t>(word);
+					key[1] = load<uint32_t>(word + length - 4);
+					key[2] = key[3] = 0;
+					}
+				else
+					{
+					key[0] = static_cast<uint8_t>(word[0]) | static_cast<uint8_t>(word[length / 2]) << 8 | static_cast<uint8_t>(word[length - 1]) << 16;
+					key[1] = key[2] = key[3] = 0;
+					}
+				}
+
+			/*
+				STEM_CACHE::COPY()
+				------------------
+			*/
+			/*!
+				@brief Copy a short string (no more than 32 bytes) using stores that overlap (rather than a loop or a call to memcpy()).
+				@param to [out] Where to copy to (exactly length bytes are written).
+				@param from [in] Where to copy from.
+				@param length [in] The number of bytes to copy.
+			*/
+			forceinline static void copy(char *to, const char *from, size_t length)
+				{
+				if (length >= 16)
+					{
+					uint64_t first = load<uint64_t>(from);
+					uint64_t second = load<uint64_t>(from + 8);
+					uint64_t third = load<uint64_t>(from + length - 16);
+					uint64_t fourth = load<uint64_t>(from + length - 8);
+					store(to, first);
+					store(to + 8, second);
+					store(to + length - 16, third);
+					store(to + length - 8, fourth);
+					}
+				else if (length >= 8)
+					{
+					uint64_t first = load<uint64_t>(from);
+					uint64_t last = load<uint64_t>(from + length - 8);
+					store(to, first);
+					store(to + length - 8, last);
+					}
+				else if (length >= 4)
+					{
+					uint32_t first = load<uint32_t>(from);
+					uint32_t last = load<uint32_t>(from + length - 4);
+					store(to, first);
+					store(to + length - 4, last);
+					}
+				else if (length != 0)
+					{
+					char first = from[0];
+					char middle = from[length / 2];
+					char last = from[length - 1];
+					to[0] = first;
+					to[length / 2] = middle;
+					to[length - 1] = last;
+					}
+				}
+
+			/*
+				STEM_CACHE::HASH()
+				------------------
+			*/
+			/*!
+				@brief Hash a key (multiply and fold).
+				@param key [in] The key.
+				@param length [in] The length of the word.
+				@return The hash value.
+			*/
+			forceinline static uint64_t hash(const uint64_t key[4], size_t length)
+				{
+				uint64_t result = (key[0] * 0xFF51AFD7ED558CCDULL) ^ (key[1] * 0xC4CEB9FE1A85EC53ULL) ^ (key[2] * 0x9E3779B97F4A7C15ULL) ^ key[3] ^ length;
+				result *= 0xFF51AFD7ED558CCDULL;
+				return result ^ (result >> 32);
+				}
+
+		public:
+			/*
+				STEM_CACHE::STEM_CACHE()
+				------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param stemmer [in] The stemmer to put the cache in front of.
+				@param slots [in] The number of words to remember (rounded up to the next power of 2), each uses 64 bytes.
+			*/
+			stem_cache(std::unique_ptr<stem> stemmer, size_t slots = 4096) :
+				stemmer(std::move(stemmer)),
+				hits(0),
+				misses(0)
+				{
+				size_t size = 1;
+				while (size < slots)
+					size <<= 1;
+				cache.resize(size);
+				for (auto &current : cache)
+					current.word_length = 0;
+				mask = size - 1;
+				}
+
+			/*
+				STEM_CACHE::~STEM_CACHE()
+				-------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~stem_cache()
+				{
+				/* Nothing */
+				}
+
+			/*
+				STEM_CACHE::NAME()
+				------------------
+			*/
+			/*!
+				@brief Return the name of the stemming algorithm
+				@return The name of the stemmer
+			*/
+			virtual std::string name(void)
+				{
+				return stemmer->name();
+				}
+
+			/*
+				STEM_CACHE::GET_HITS()
+				----------------------
+			*/
+			/*!
+				@brief Return the number of words found in the cache.
+				@return The number of cache hits.
+			*/
+			size_t get_hits(void) const
+				{
+				return hits;
+				}
+
+			/*
+				STEM_CACHE::GET_MISSES()
+				------------------------
+			*/
+			/*!
+				@brief Return the number of words that were not in the cache (and so were stemmed).
+				@return The number of cache misses.
+			*/
+			size_t get_misses(void) const
+				{
+				return misses;
+				}
+
+			/*
+				STEM_CACHE::TOSTEM()
+				--------------------
+			*/
+			/*!
+				@brief Stem from source into destination, from the cache if possible.
+				@param destination [out] the result of the steming process (the stem)
+				@param source [in] the term to stem
+				@param source_length [in] the length of the string to stem
+				@details source and destination can be the same.
+				@return the length of the stem
+			*/
+			using stem::tostem;
+			virtual size_t tostem(char *destination, const char *source, size_t source_length)
+				{
+				if (source_length == 0 || source_length > longest_word)
+					return stemmer->tostem(destination, source, source_length);
+
+				uint64_t key[4];
+				get_key(key, source, source_length);
+				slot &current = cache[hash(key, source_length) & mask];
+				if (current.word_length == source_length && current.key[0] == key[0] && current.key[1] == key[1] && current.key[2] == key[2] && current.key[3] == key[3])
+					{
+					hits++;
+					copy(destination, current.stem, current.stem_length);
+					destination[current.stem_length] = '\0';
+					return current.stem_length;
+					}
+
+				/*
+					Not in the cache so stem it and remember it
+				*/
+				misses++;
+				size_t length = stemmer->tostem(destination, source, source_length);
+				if (length <= longest_word)
+					{
+					memcpy(current.key, key, sizeof(key));
+					current.word_length = static_cast<uint8_t>(source_length);
+					current.stem_length = static_cast<uint8_t>(length);
+					copy(current.stem, destination, length);
+					}
+				else
+					current.word_length = 0;
+
+				return length;
+				}
+
+			/*
+				STEM_CACHE::UNITTEST()
+				----------------------
+			*/
+			/*!
+				@brief Unit test this class.
+			*/
+			static void unittest(void);
+		};
+	}
@@ -2,6 +2,8 @@
 	STEM_PORTER.CPP
 	---------------
 */
+#include <string.h>
+
 #include <vector>
 #include <iostream>
 #include <algorithm>
@@ -12,40 +14,134 @@
 
 namespace JASS
 	{
+	/*
+		STEM_PORTER::STEP_2
+		-------------------
+	*/
+	const stem_porter::suffix_table stem_porter::step_2 = stem_porter::make_table
+		({
+		{"lanoita", "eta", 0},
+		{"lanoit", "noit", 0},
+		{"icne", "ecne", 0},
+		{"icna", "ecna", 0},
+		{"rezi", "ezi", 0},
+		{"ilba", "elba", 0},
+		{"illa", "la", 0},
+		{"iltne", "tne", 0},
+		{"ile", "e", 0},
+		{"ilsuo", "suo", 0},
+		{"noitazi", "ezi", 0, true},
+		{"noita", "eta", 0},
+		{"rota", "eta", 0},
+		{"msila", "la", 0},
+		{"ssenevi", "evi", 0},
+		{"ssenluf", "luf", 0},
+		{"ssensuo", "suo", 0},
+		{"itila", "la", 0},
+		{"itivi", "evi", 0},
+		{"itilib", "elb", 0}
+		});
+
+	/*
+		STEM_PORTER::STEP_3
+		-------------------
+	*/
+	const stem_porter::suffix_table stem_porter::step_3 = stem_porter::make_table
+		({
+		{"etaci", "ci", 0},
+		{"evita", "", 0},
+		{"ezila", "la", 0},
+		{"itici", "ci", 0},
+		{"laci", "ci", 0},
+		{"luf", "", 0},
+		{"ssen", "", 0}
+		});
+
+	/*
+		STEM_PORTER::STEP_4
+		-------------------
+	*/
+	const stem_porter::suffix_table stem_porter::step_4 = stem_porter::make_table
+		({
+		{"la", "", 1},
+		{"ecna", "", 1},
+		{"ecne", "", 1},
+		{"re", "", 1},
+		{"ci", "", 1},
+		{"elba", "", 1},
+		{"elbi", "", 1},
+		{"tna", "", 1},
+		{"tneme", "", 1, true},
+		{"tnem", "", 1, true},
+		{"tne", "", 1, true},
+		{"uo", "", 1},
+		{"msi", "", 1},
+		{"eta", "", 1},
+		{"iti", "", 1},
+		{"suo", "", 1},
+		{"evi", "", 1},
+		{"ezi", "", 1},
+		{"nois", "s", 1, false, 3},				// special case, (s)ion and (t)ion keep the s or t
+		{"noit", "t", 1, false, 3}
+		});
+
+	/*
+		STEM_PORTER::MAKE_TABLE()
+		-------------------------
+	*/
+	stem_porter::suffix_table stem_porter::make_table(const std::vector<suffix_rule> &rules)
+		{
+		suffix_table table;
+
+		for (const auto &rule : rules)
+			table[rule.suffix[0] - 'a'].push_back(rule);
+
+		return table;
+		}
+
+	/*
+		STEM_PORTER::REPLACE_SUFFIX()
+		-----------------------------
+	*/
+	void stem_porter::replace_suffix(char *&at, const suffix_table &table)
+		{
+		if (*at < 'a' || *at > 'z')
+			return;
+
+		for (const auto &rule : table[*at - 'a'])
+			if (memcmp(at, rule.suffix, rule.suffix_length) == 0)
+				{
+				if (length(at + rule.measure_from) > rule.more_than)
+					{
+					at += rule.suffix_length - rule.replacement_length;
+					memcpy(at, rule.replacement, rule.replacement_length);
+					return;
+					}
+				else if (rule.final)
+					return;
+				}
+		}
+
 	/*
 		STEM_PORTER::LENGTH()
 		---------------------
 	*/
 	size_t stem_porter::length(const char *reversed)
 		{
-		const char *end;
-		char was;
-		long size;
+		size_t size = 0;
 
 		if (*reversed == '\0')
 			return 0;
 
-		size = 0;
-		while (isvowely(reversed))
-			reversed++;
-		end = reversed + strlen(reversed) - 1;
-		while (end >= reversed && !isvowely(end))
-			end--;
-		was = 'v';
-		while (end >= reversed)
+		bool was_vowely = isvowely(reversed);
+		for (const char *current = reversed + 1; *current != '\0'; current++)
 			{
-			if (was == 'c' && isvowely(end))
-				{
-				was = 'v';
-				size++;
-				}
-			else if (was == 'v' && !isvowely(end))
-				{
-				was = 'c';
+			bool is_vowely = isvowely(current);
+			if (is_vowely && !was_vowely)
 				size++;
-				}
-			end--;
+			was_vowely = is_vowely;
 			}
+
 		return size;
 		}
 
@@ -55,12 +151,9 @@ namespace JASS
 	*/
 	bool stem_porter::has_vowel(const char *what)
 		{
-		if (strpbrk("aeiou", what) != NULL)
-			return true;
-		else
-			for (const char *pos = strchr(what, 'y'); pos != NULL; pos = strchr(pos + 1, 'y'))
-				if (!ascii::isvowel(*(pos + 1)))
-					return true;
+		for (; *what != '\0'; what++)
+			if (ascii::isvowel(*what) || (*what == 'y' && !ascii::isvowel(*(what + 1))))
+				return true;
 
 		return false;
 		}
@@ -71,13 +164,21 @@ namespace JASS
 	*/
 	size_t stem_porter::tostem(char *destination, const char *source, size_t source_length)
 		{
+		/*
+			Words too long for the workspace are left as they are
+		*/
+		if (source_length > MAX_TERM_LENGTH)
+			{
+			memmove(destination, source, source_length);
+			destination[source_length] = '\0';
+			return source_length;
+			}
+
 		/*
 			Reverse the string.
 		*/
-		workspace.resize(source_length + 1);
-		char *at = const_cast<char *>(workspace.c_str());
+		char *at = workspace;
 		std::reverse_copy(source, source + source_length, at);
-//		workspace[source_length] = '\0';
 		at[source_length] = '\0';
 
 		/*
@@ -152,148 +253,17 @@ namespace JASS
 		/*
 			Step 2.
 		*/
-		if (strchr("lirnms", *at) != NULL)
-			{
-			if (strncmp(at, "lanoita", 7) == 0 && length(at + 7) > 0)
-				{
-				at += 4;
-				*at = 'e';
-				}
-			else if (strncmp(at, "lanoit", 6) == 0 && length(at + 6) > 0)
-				at += 2;
-			else if (strncmp(at, "icne", 4) == 0 && length(at + 4) > 0)
-				*at = 'e';
-			else if (strncmp(at, "icna", 4) == 0 && length(at + 4) > 0)
-				*at = 'e';
-			else if (strncmp(at, "rezi", 4) == 0 && length(at + 4) > 0)
-				at++;
-			else if (strncmp(at, "ilba", 4) == 0 && length(at + 4) > 0)
-				*at = 'e';
-			else if (strncmp(at, "illa", 4) == 0 && length(at + 4) > 0)
-				at += 2;
-			else if (strncmp(at, "iltne", 5) == 0 && length(at + 5) > 0)
-				at += 2;
-			else if (strncmp(at, "ile", 3) == 0 && length(at + 3) > 0)
-				at += 2;
-			else if (strncmp(at, "ilsuo", 5) == 0 && length(at + 5) > 0)
-				at += 2;
-			else if (strncmp(at, "noitazi", 7) == 0)
-				{
-				if (length(at + 7) > 0)
-					{
-					at += 4;
-					*at = 'e';
-					}
-				}
-			else if (strncmp(at, "noita", 5) == 0 && length(at + 5) > 0)
-				{
-				at += 2;
-				*at = 'e';
-				}
-			else if (strncmp(at, "rota", 4) == 0 && length(at + 4) > 0)
-				{
-				at++;
-				*at = 'e';
-				}
-			else if (strncmp(at, "msila", 5) == 0 && length(at + 5) > 0)
-				at += 3;
-			else if (strncmp(at, "ssenevi", 7) == 0 && length(at + 7) > 0)
-				at += 4;
-			else if (strncmp(at, "ssenluf", 7) == 0 && length(at + 7) > 0)
-				at += 4;
-			else if (strncmp(at, "ssensuo", 7) == 0 && length(at + 7) > 0)
-				at += 4;
-			else if (strncmp(at, "itila", 5) == 0 && length(at + 5) > 0)
-				at += 3;
-			else if (strncmp(at, "itivi", 5) == 0 && length(at + 5) > 0)
-				{
-				at += 2;
-				*at = 'e';
-				}
-			else if (strncmp(at, "itilib", 6) == 0 && length(at + 6) > 0)
-				{
-				at += 4;
-				*at-- = 'l';
-				*at = 'e';
-				}
-			}
+		replace_suffix(at, step_2);
 
 		/*
 			Step 3.
 		*/
-		if (strchr("eils", *at) != NULL)
-			{
-			if (strncmp(at, "etaci", 5) == 0  && length(at + 5) > 0)
-				at += 3;
-			else if (strncmp(at, "evita", 5) == 0 && length(at + 5) > 0)
-				at += 5;
-			else if (strncmp(at, "ezila", 5) == 0 && length(at + 5) > 0)
-				at += 3;
-			else if (strncmp(at, "itici", 5) == 0 && length(at + 5) > 0)
-				at += 3;
-			else if (strncmp(at, "laci", 4) == 0 && length(at + 4) > 0)
-				at += 2;
-			else if (strncmp(at, "luf", 3) == 0 && length(at + 3) > 0)
-				at += 3;
-			else if (strncmp(at, "ssen", 4) == 0 && length(at + 4) > 0)
-				at += 4;
-			}
+		replace_suffix(at, step_3);
 
 		/*
 			Step 4.
 		*/
-		if (strchr("lerctumisn", *at) != NULL)
-			{
-			if (strncmp(at, "la", 2) == 0 && length(at + 2) > 1)
-				at += 2;
-			else if (strncmp(at, "ecna", 4) == 0 && length(at + 4) > 1)
-				at += 4;
-			else if (strncmp(at, "ecne", 4) == 0 && length(at + 4) > 1)
-				at += 4;
-			else if (strncmp(at, "re", 2) == 0 && length(at + 2) > 1)
-				at += 2;
-			else if (strncmp(at, "ci", 2) == 0 && length(at + 2) > 1)
-				at += 2;
-			else if (strncmp(at, "elba", 4) == 0 && length(at + 4) > 1)
-				at += 4;
-			else if (strncmp(at, "elbi", 4) == 0 && length(at + 4) > 1)
-				at += 4;
-			else if (strncmp(at, "tna", 3) == 0 && length(at + 3) > 1)
-				at += 3;
-			else if (strncmp(at, "tneme", 5) == 0)
-				{
-				if (length(at + 5) > 1)
-					at += 5;
-				}
-			else if (strncmp(at, "tnem", 4) == 0)
-				{
-				if (length(at + 4) > 1)
-					at += 4;
-				}
-			else if (strncmp(at, "tne", 3) == 0)
-				{
-				if (length(at + 3) > 1)
-					at += 3;
-				}
-			else if (strncmp(at, "uo", 2) == 0 && length(at + 2) > 1)
-				at += 2;
-			else if (strncmp(at, "msi", 3) == 0 && length(at + 3) > 1)
-				at += 3;
-			else if (strncmp(at, "eta", 3) == 0 && length(at + 3) > 1)
-				at += 3;
-			else if (strncmp(at, "iti", 3) == 0 && length(at + 3) > 1)
-				at += 3;
-			else if (strncmp(at, "suo", 3) == 0 && length(at + 3) > 1)
-				at += 3;
-			else if (strncmp(at, "evi", 3) == 0 && length(at + 3) > 1)
-				at += 3;
-			else if (strncmp(at, "ezi", 3) == 0 && length(at + 3) > 1)
-				at += 3;
-			else if (strncmp(at, "nois", 4) == 0 && length(at + 3) > 1) // special case
-				at += 3;
-			else if (strncmp(at, "noit", 4) == 0 && length(at + 3) > 1) // special case
-				at += 3;
-			}
+		replace_suffix(at, step_4);
 
 		/*
 			Step 5a.
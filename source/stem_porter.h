@@ -11,6 +11,10 @@
 #pragma once
 
 #include <stdio.h>
+#include <string.h>
+
+#include <array>
+#include <vector>
 
 #include "stem.h"
 #include "ascii.h"
@@ -32,9 +36,87 @@ namespace JASS
 	class stem_porter : public stem
 		{
 		private:
-			std::string workspace;		// temporary workspace used to reverse the string.
-			
+			/*
+				CLASS STEM_PORTER::SUFFIX_RULE
+				------------------------------
+			*/
+			/*!
+				@brief A rule of steps 2, 3, and 4 of the algorithm, replace the (reversed) suffix if the measure of the stem is large enough.
+			*/
+			class suffix_rule
+				{
+				public:
+					const char *suffix;				///< The suffix (reversed)
+					size_t suffix_length;			///< The length of suffix
+					const char *replacement;		///< What to replace the suffix with (reversed)
+					size_t replacement_length;		///< The length of replacement
+					size_t measure_from;				///< The measure is of the stem from here (normally suffix_length)
+					size_t more_than;					///< The rule applies if the measure is larger than this
+					bool final;							///< If the suffix matches but the measure is too small then don't try any later rules
+
+				public:
+					/*
+						STEM_PORTER::SUFFIX_RULE::SUFFIX_RULE()
+						---------------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param suffix [in] The suffix (reversed).
+						@param replacement [in] What to replace the suffix with (reversed).
+						@param more_than [in] The rule applies if the measure is larger than this.
+						@param final [in] If the suffix matches but the measure is too small then don't try any later rules.
+						@param measure_from [in] The measure is of the stem from here (default, or 0, is from the end of the suffix).
+					*/
+					suffix_rule(const char *suffix, const char *replacement, size_t more_than, bool final = false, size_t measure_from = 0) :
+						suffix(suffix),
+						suffix_length(strlen(suffix)),
+						replacement(replacement),
+						replacement_length(strlen(replacement)),
+						measure_from(measure_from == 0 ? suffix_length : measure_from),
+						more_than(more_than),
+						final(final)
+						{
+						/* Nothing */
+						}
+				};
+
+			/*!
+				@typedef suffix_table
+				@brief The rules of a step, by the last letter of the suffix (the first of the reversed suffix) so that only those that might match are checked.
+			*/
+			typedef std::array<std::vector<suffix_rule>, 26> suffix_table;
+
+		private:
+			static const suffix_table step_2;					///< The rules of step 2 (ational -> ate, etc)
+			static const suffix_table step_3;					///< The rules of step 3 (icate -> ic, etc)
+			static const suffix_table step_4;					///< The rules of step 4 (al -> , etc)
+
 		private:
+			char workspace[MAX_TERM_LENGTH + 16];		///< Temporary workspace used to reverse the string (+16 so that rules can compare past the '\0').
+
+		private:
+			/*
+				STEM_PORTER::MAKE_TABLE()
+				-------------------------
+			*/
+			/*!
+				@brief Sort the rules of a step by the first letter of their (reversed) suffix, keeping them in order.
+				@param rules [in] The rules, in the order they are tried.
+				@return The table.
+			*/
+			static suffix_table make_table(const std::vector<suffix_rule> &rules);
+
+			/*
+				STEM_PORTER::REPLACE_SUFFIX()
+				-----------------------------
+			*/
+			/*!
+				@brief Apply the first rule of a step whose suffix matches (and whose measure is large enough).
+				@param at [in/out] The (reversed) word, which is moved forward if the suffix is replaced.
+				@param table [in] The rules of the step.
+			*/
+			void replace_suffix(char *&at, const suffix_table &table);
+
 			/*
 				STEM_PORTER::ISVOWELY()
 				-----------------------
@@ -76,6 +158,7 @@ namespace JASS
 			*/
 			/*!
 				@brief Return Porter's m in [C](VC)m[V], the length of the stem
+				@details The string is reversed so it is V*(C+V+)mC*, and m is the number of consonants followed by a vowel (counted in one pass).
 				@param reversed [in] The string to count m on.
 				@return The length of the stem in units of m
 			*/
@@ -12,6 +12,9 @@
 	replaced with a tocasefold() method because uppercase and lowercase are meaningless for many languages.
 	
 	See unicode_database_to_c.cpp (in the tools directory) for how to generate the matching unicode.cpp file.
+
+	The properties needed by the tokenizer, and the JASS normalisation, are looked up in two-level tables (a first level that maps
+	each block of 256 codepoints to a de-duplicated second level block) so the parts used by a given language stay in cache.
 	
 	@author Andrew Trotman
 	@copyright 2016 Andrew Trotman
@@ -24,6 +27,10 @@
 
 #include <vector>
 
+#ifdef __AVX2__
+	#include <immintrin.h>
+#endif
+
 #include "asserts.h"
 
 extern unsigned char JASS_unicode_isalpha_data[];	///< is the given codepoint alphabetic
@@ -42,7 +49,11 @@ extern unsigned char JASS_unicode_issymbol_data[];	///< is the given codepoint a
 extern unsigned char JASS_unicode_isxmlnamestartchar_data[]; ///< is the given character a XML NameStartChar (see XML production 4)
 extern unsigned char JASS_unicode_isxmlnamechar_data[]; ///< is the given character a XML NameStartChar (see XML production 4a)
 
-extern const uint32_t *JASS_normalisation[];		///< an array of pointers to JASS normalised codepoints for the given codepoint
+extern const uint16_t JASS_unicode_properties_stage1[];	///< for each block of codepoints, the block of JASS_unicode_properties_stage2 that holds its properties
+extern const uint8_t JASS_unicode_properties_stage2[];	///< the properties (see unicode::property) of each codepoint, in de-duplicated blocks
+extern const uint16_t JASS_unicode_casefold_stage1[];		///< for each block of codepoints, the block of JASS_unicode_casefold_stage2 that holds its normalisations
+extern const uint32_t JASS_unicode_casefold_stage2[];		///< the offset (in JASS_unicode_casefold_pool) of the normalisation of each codepoint, in de-duplicated blocks
+extern const uint32_t JASS_unicode_casefold_pool[];		///< the ('\0' terminated) JASS normalisations
 
 namespace JASS
 	{
@@ -60,6 +71,24 @@ namespace JASS
 			static constexpr size_t max_casefold_expansion_factor = 18;		///< The maximum number of codepoints a case-folded codepoint can take.
 			static constexpr size_t max_utf8_bytes = 4;							///< The maximum number of bytes that a UTF8 codepoint can take.
 			static constexpr size_t max_codepoint = 0x10FFFF;					///< The highest valid Unicode codepoint
+			static constexpr size_t block_bits = 8;								///< The two-level tables are in blocks of 2^block_bits codepoints
+			static constexpr size_t max_batch = 16;								///< The most codepoints utf8_to_codepoints() will decode at once
+
+			/*!
+				@enum property
+				@brief The bits of the property byte (see properties())
+			*/
+			enum property
+				{
+				ALPHA = 0x01,							///< isalpha()
+				ALNUM = 0x02,							///< isalnum()
+				DIGIT = 0x04,							///< isdigit()
+				PUNCT = 0x08,							///< ispunct()
+				SPACE = 0x10,							///< isspace()
+				USPACE = 0x20,							///< isuspace()
+				XML_NAME_START_CHAR = 0x40,		///< isxmlnamestartchar()
+				XML_NAME_CHAR = 0x80					///< isxmlnamechar()
+				};
 			
 		public:
 			/*
@@ -166,27 +195,140 @@ namespace JASS
 			static uint32_t utf8_to_codepoint(const void *utf8_start, const void *end_of_buffer, size_t &bytes_consumed)
 				{
 				const uint8_t *bytes = (const uint8_t *)utf8_start;
+				const uint8_t *end = (const uint8_t *)end_of_buffer;
 
-				bytes_consumed = isutf8(bytes, end_of_buffer);
-
-				switch (bytes_consumed)
+				/*
+					Check the length and continuation bytes as each length is decoded (the same as isutf8() does)
+				*/
+				if (*bytes < 0x80)
+					{
+					bytes_consumed = 1;
+					return *bytes;
+					}
+				else if ((*bytes & 0xE0) == 0xC0)
 					{
-					case 0:
-						return replacement_character;						// invaid UTF-8 sequence
-					case 1:
-						return *bytes;
-					case 2:
-						return ((*bytes & 0x1F) << 6) | (*(bytes + 1) & 0x3F);
-					case 3:
-						return ((*bytes & 0x0F) << 12) | ((*(bytes + 1) & 0x3F) << 6) | (*(bytes + 2) & 0x3F);
-					case 4:
+					if (bytes + 2 <= end && (bytes[1] & 0xC0) == 0x80)
 						{
-						uint32_t got = ((*bytes & 0x07) << 18) | ((*(bytes + 1) & 0x3F) << 12) | ((*(bytes + 2) & 0x3F) << 6) | (*(bytes + 3) & 0x3F);
+						bytes_consumed = 2;
+						return ((*bytes & 0x1F) << 6) | (bytes[1] & 0x3F);
+						}
+					}
+				else if ((*bytes & 0xF0) == 0xE0)
+					{
+					if (bytes + 3 <= end && ((bytes[1] & 0xC0) == 0x80) & ((bytes[2] & 0xC0) == 0x80))
+						{
+						bytes_consumed = 3;
+						return ((*bytes & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F);
+						}
+					}
+				else if ((*bytes & 0xF8) == 0xF0)
+					{
+					if (bytes + 4 <= end && ((bytes[1] & 0xC0) == 0x80) & ((bytes[2] & 0xC0) == 0x80) & ((bytes[3] & 0xC0) == 0x80))
+						{
+						bytes_consumed = 4;
+						uint32_t got = ((*bytes & 0x07) << 18) | ((bytes[1] & 0x3F) << 12) | ((bytes[2] & 0x3F) << 6) | (bytes[3] & 0x3F);
 						return got <= max_codepoint ? got : replacement_character;
 						}
-					default:
-						return replacement_character;		// LCOV_EXCL_LINE	// Cannot happen, but Xcode gives a warning if this line is missing.
 					}
+
+				bytes_consumed = 0;
+				return replacement_character;						// invaid UTF-8 sequence
+				}
+
+			/*
+				UNICODE::UTF8_TO_CODEPOINTS()
+				-----------------------------
+			*/
+			/*!
+				@brief Decode the UTF-8 sequences that start in the next 16 bytes, the same as calling utf8_to_codepoint() on each.
+				@details Decoding stops early at an invalid sequence (or, with AVX2, a 4-byte sequence), which the caller should pass to
+				utf8_to_codepoint().  With AVX2, when 18 bytes can be read, the lead and continuation bytes are found and checked against each other,
+				and each of the 16 bytes is decoded as if it were the start of a 1, 2, and 3 byte sequence, all at once.  Then the sequences are
+				picked out of the bitmap of lead bytes.
+				@param utf8_start [in] The start of the UTF-8 sequences.
+				@param end_of_buffer [in] The end of the buffer containing the UTF-8.
+				@param codepoints [out] The codepoints (at most max_batch of them).
+				@param bytes_consumed [out] The length of the UTF-8 sequence of each codepoint.
+				@return The number of codepoints decoded.
+			*/
+			static size_t utf8_to_codepoints(const void *utf8_start, const void *end_of_buffer, uint32_t *codepoints, uint8_t *bytes_consumed)
+				{
+				const uint8_t *bytes = (const uint8_t *)utf8_start;
+				size_t decoded = 0;
+
+#ifdef __AVX2__
+				if (bytes + max_batch + 2 <= end_of_buffer)
+					{
+					/*
+						Classify each byte as a continuation byte or the lead byte of a 1, 2, or 3 byte sequence
+					*/
+					__m128i raw = _mm_loadu_si128((__m128i *)bytes);
+					uint32_t continues = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(raw, _mm_set1_epi8((char)0xC0)), _mm_set1_epi8((char)0x80)));
+					continues |= (((bytes[16] & 0xC0) == 0x80) << 16) | (((bytes[17] & 0xC0) == 0x80) << 17);
+					uint32_t one_byte = ~_mm_movemask_epi8(raw) & 0xFFFF;
+					uint32_t two_bytes = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(raw, _mm_set1_epi8((char)0xE0)), _mm_set1_epi8((char)0xC0)));
+					uint32_t three_bytes = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(raw, _mm_set1_epi8((char)0xF0)), _mm_set1_epi8((char)0xE0)));
+					uint32_t starts = one_byte | two_bytes | three_bytes;
+
+					/*
+						The UTF-8 is valid if the continuation bytes are exactly those the lead bytes say there should be (and every byte is one or the other).
+						If not, keep only the sequences that end before the first problem.
+					*/
+					uint32_t expected = (two_bytes << 1) | (three_bytes << 1) | (three_bytes << 2);
+					uint32_t invalid = ((continues ^ expected) & 0xFFFF) | (expected & ~continues) | (~(starts | continues) & 0xFFFF);
+					if (invalid != 0)
+						{
+						uint32_t first_invalid = _tzcnt_u32(invalid);
+						starts &= (1U << first_invalid) - 1;
+						if (starts != 0)
+							{
+							uint32_t last = 31 - __builtin_clz(starts);
+							if (last + 1 + ((two_bytes >> last) & 1) + 2 * ((three_bytes >> last) & 1) > first_invalid)
+								starts &= ~(1U << last);
+							}
+						}
+
+					/*
+						Decode the sequence starting at each byte as if it were a 1, 2, or 3 byte sequence (a 3-byte sequence is at most 0xFFFF, so they fit in 16 bits)
+					*/
+					__m256i first = _mm256_cvtepu8_epi16(raw);
+					__m256i second = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)(bytes + 1)));
+					__m256i third = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)(bytes + 2)));
+					__m256i low_six = _mm256_set1_epi16(0x3F);
+					__m256i two_byte_lead = _mm256_cmpeq_epi16(_mm256_and_si256(first, _mm256_set1_epi16(0xE0)), _mm256_set1_epi16(0xC0));
+					__m256i three_byte_lead = _mm256_cmpeq_epi16(_mm256_and_si256(first, _mm256_set1_epi16(0xF0)), _mm256_set1_epi16(0xE0));
+					__m256i two_byte_codepoint = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(first, _mm256_set1_epi16(0x1F)), 6), _mm256_and_si256(second, low_six));
+					__m256i three_byte_codepoint = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(first, 12), _mm256_slli_epi16(_mm256_and_si256(second, low_six), 6)), _mm256_and_si256(third, low_six));
+					__m256i codepoint = _mm256_blendv_epi8(_mm256_blendv_epi8(first, two_byte_codepoint, two_byte_lead), three_byte_codepoint, three_byte_lead);
+
+					uint16_t codepoint_at[max_batch];
+					_mm256_storeu_si256((__m256i *)codepoint_at, codepoint);
+
+					/*
+						Pick out the sequences
+					*/
+					for (; starts != 0; starts &= starts - 1)
+						{
+						uint32_t at = _tzcnt_u32(starts);
+						codepoints[decoded] = codepoint_at[at];
+						bytes_consumed[decoded] = static_cast<uint8_t>(1 + ((two_bytes >> at) & 1) + 2 * ((three_bytes >> at) & 1));
+						decoded++;
+						}
+
+					return decoded;
+					}
+#endif
+				for (const uint8_t *end = bytes + max_batch; bytes < end && bytes < end_of_buffer; decoded++)
+					{
+					size_t length;
+					codepoints[decoded] = utf8_to_codepoint(bytes, end_of_buffer, length);
+					if (length == 0)
+						break;
+					bytes_consumed[decoded] = static_cast<uint8_t>(length);
+					bytes += length;
+					}
+
+				return decoded;
 				}
 
 			/*
@@ -259,7 +401,7 @@ namespace JASS
 			*/
 			static inline void tocasefold(std::vector<uint32_t> &casefolded, uint32_t codepoint)
 				{
-				const uint32_t *got = JASS_normalisation[codepoint];
+				const uint32_t *got = tocasefold(codepoint);
 				while (*got != 0)
 					casefolded.push_back(*got++);
 				}
@@ -278,7 +420,21 @@ namespace JASS
 			*/
 			static inline const uint32_t *tocasefold(uint32_t codepoint)
 				{
-				return JASS_normalisation[codepoint];
+				return JASS_unicode_casefold_pool + JASS_unicode_casefold_stage2[(JASS_unicode_casefold_stage1[codepoint >> block_bits] << block_bits) | (codepoint & ((1 << block_bits) - 1))];
+				}
+
+			/*
+				UNICODE::PROPERTIES()
+				---------------------
+			*/
+			/*!
+				@brief Return the properties the tokenizer needs (see unicode::property) of the codepoint, all at once.
+				@param codepoint [in] The Unicode codepoint to check.
+				@return The properties of codepoint.
+			*/
+			static inline uint8_t properties(uint32_t codepoint)
+				{
+				return JASS_unicode_properties_stage2[(JASS_unicode_properties_stage1[codepoint >> block_bits] << block_bits) | (codepoint & ((1 << block_bits) - 1))];
 				}
 			
 			/*
@@ -293,10 +449,7 @@ namespace JASS
 			*/
 			static inline int isalpha(uint32_t codepoint)
 				{
-				uint32_t byte = codepoint >> 3;
-				uint32_t bit = 1 << (codepoint & 0x07);
-
-				return JASS_unicode_isalpha_data[byte] & bit;
+				return properties(codepoint) & ALPHA;
 				}
 
 
@@ -313,10 +466,7 @@ namespace JASS
 			*/
 			static inline int isalnum(uint32_t codepoint)
 				{
-				uint32_t byte = codepoint >> 3;
-				uint32_t bit = 1 << (codepoint & 0x07);
-
-				return JASS_unicode_isalnum_data[byte] & bit;
+				return properties(codepoint) & ALNUM;
 				}
 			
 			/*
@@ -387,10 +537,7 @@ namespace JASS
 			*/
 			static inline int isdigit(uint32_t codepoint)
 				{
-				uint32_t byte = codepoint >> 3;
-				uint32_t bit = 1 << (codepoint & 0x07);
-
-				return JASS_unicode_isdigit_data[byte] & bit;
+				return properties(codepoint) & DIGIT;
 				}
 			
 			/*
@@ -423,10 +570,7 @@ namespace JASS
 			*/
 			static inline int ispunct(uint32_t codepoint)
 				{
-				uint32_t byte = codepoint >> 3;
-				uint32_t bit = 1 << (codepoint & 0x07);
-
-				return JASS_unicode_ispunct_data[byte] & bit;
+				return properties(codepoint) & PUNCT;
 				}
 
 			/*
@@ -441,10 +585,7 @@ namespace JASS
 			*/
 			static inline int isspace(uint32_t codepoint)
 				{
-				uint32_t byte = codepoint >> 3;
-				uint32_t bit = 1 << (codepoint & 0x07);
-
-				return JASS_unicode_isspace_data[byte] & bit;
+				return properties(codepoint) & SPACE;
 				}
 
 			/*
@@ -459,10 +600,7 @@ namespace JASS
 			*/
 			static inline int isuspace(uint32_t codepoint)
 				{
-				uint32_t byte = codepoint >> 3;
-				uint32_t bit = 1 << (codepoint & 0x07);
-
-				return JASS_unicode_isuspace_data[byte] & bit;
+				return properties(codepoint) & USPACE;
 				}
 
 			/*
@@ -532,10 +670,7 @@ namespace JASS
 			*/
 			static inline int isxmlnamestartchar(uint32_t codepoint)
 				{
-				uint32_t byte = codepoint >> 3;
-				uint32_t bit = 1 << (codepoint & 0x07);
-
-				return JASS_unicode_isxmlnamestartchar_data[byte] & bit;
+				return properties(codepoint) & XML_NAME_START_CHAR;
 				}
 
 			/*
@@ -551,10 +686,7 @@ namespace JASS
 			*/
 			static inline int isxmlnamechar(uint32_t codepoint)
 				{
-				uint32_t byte = codepoint >> 3;
-				uint32_t bit = 1 << (codepoint & 0x07);
-
-				return JASS_unicode_isxmlnamechar_data[byte] & bit;
+				return properties(codepoint) & XML_NAME_CHAR;
 				}
 
 			/*
@@ -664,6 +796,59 @@ namespace JASS
 				JASS_assert(unicode::ismark(0x300));
 				JASS_assert(unicode::issymbol(0x2600));
 
+				/*
+					The two-level property table must match the bitmaps for every codepoint
+				*/
+				for (uint32_t codepoint = 0; codepoint <= max_codepoint; codepoint++)
+					{
+					uint32_t byte = codepoint >> 3;
+					uint32_t bit = 1 << (codepoint & 0x07);
+
+					JASS_assert(!(JASS_unicode_isalpha_data[byte] & bit) == !isalpha(codepoint));
+					JASS_assert(!(JASS_unicode_isalnum_data[byte] & bit) == !isalnum(codepoint));
+					JASS_assert(!(JASS_unicode_isdigit_data[byte] & bit) == !isdigit(codepoint));
+					JASS_assert(!(JASS_unicode_ispunct_data[byte] & bit) == !ispunct(codepoint));
+					JASS_assert(!(JASS_unicode_isspace_data[byte] & bit) == !isspace(codepoint));
+					JASS_assert(!(JASS_unicode_isuspace_data[byte] & bit) == !isuspace(codepoint));
+					JASS_assert(!(JASS_unicode_isxmlnamestartchar_data[byte] & bit) == !isxmlnamestartchar(codepoint));
+					JASS_assert(!(JASS_unicode_isxmlnamechar_data[byte] & bit) == !isxmlnamechar(codepoint));
+					}
+
+				/*
+					Check normalisations that expand (sharp s becomes "ss", and U+FDFA becomes 18 codepoints)
+				*/
+				const uint32_t *folded = tocasefold(0xDF);
+				JASS_assert(folded[0] == 's' && folded[1] == 's' && folded[2] == 0);
+				size_t expansion = 0;
+				for (folded = tocasefold(0xFDFA); *folded != 0; folded++)
+					expansion++;
+				JASS_assert(expansion == max_casefold_expansion_factor);
+				JASS_assert(*tocasefold(0x300) == 0);
+
+				/*
+					Decoding 16 bytes at a time must give the same answer as decoding one codepoint at a time, from every starting point
+					(ASCII, 2, 3, and 4-byte sequences, a continuation byte with no start, a truncated sequence, and a bad start byte).
+				*/
+				const uint8_t mixed[] = "Zoë слово 漢字 \xF0\x90\x8D\x88 end \x80 ab\xE2\x82 cd \xF8 Ελληνικά κείμενο and some more ASCII to pad it out";
+				const uint8_t *end_of_mixed = mixed + sizeof(mixed) - 1;
+				for (const uint8_t *start = mixed; start < end_of_mixed; start++)
+					{
+					uint32_t codepoints[max_batch];
+					uint8_t lengths[max_batch];
+					size_t decoded = utf8_to_codepoints(start, end_of_mixed, codepoints, lengths);
+					JASS_assert(decoded <= max_batch);
+
+					const uint8_t *at = start;
+					for (size_t which = 0; which < decoded; which++)
+						{
+						size_t length;
+						JASS_assert(at < start + max_batch);				// each sequence starts in the 16 bytes (but might end after them)
+						JASS_assert(codepoints[which] == utf8_to_codepoint(at, end_of_mixed, length));
+						JASS_assert(lengths[which] == length && length != 0);
+						at += length;
+						}
+					}
+
 				puts("unicode::PASSED");
 				}
 		};
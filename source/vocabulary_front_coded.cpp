@@ -0,0 +1,245 @@
+/*
+	VOCABULARY_FRONT_CODED.CPP
+	--------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+
+#include <iterator>
+#include <algorithm>
+
+#include "asserts.h"
+#include "vocabulary_front_coded.h"
+#include "compress_integer_variable_byte.h"
+
+namespace JASS
+	{
+	/*
+		COMMON_PREFIX_LENGTH()
+		----------------------
+		Return the number of bytes at the start of first and second that are the same
+	*/
+	static inline size_t common_prefix_length(const uint8_t *first, size_t first_length, const uint8_t *second, size_t second_length)
+		{
+		size_t length = first_length < second_length ? first_length : second_length;
+		size_t same = 0;
+
+		while (same < length && first[same] == second[same])
+			same++;
+
+		return same;
+		}
+
+	/*
+		VOCABULARY_FRONT_CODED::PUSH_BACK()
+		-----------------------------------
+	*/
+	void vocabulary_front_coded::push_back(const slice &term, uint64_t postings, uint64_t impacts)
+		{
+		const uint8_t *string = reinterpret_cast<const uint8_t *>(term.address());
+		auto into = std::back_inserter(blocks);
+
+		if (terms % BLOCK_SIZE == 0)
+			{
+			/*
+				The first term in the block is stored in full (and is in the top-level array)
+			*/
+			block_start.push_back(blocks.size());
+			compress_integer_variable_byte::compress_into(into, (uint64_t)term.size());
+			blocks.insert(blocks.end(), string, string + term.size());
+			compress_integer_variable_byte::compress_into(into, postings);
+			}
+		else
+			{
+			/*
+				Subsequent terms are stored as the length of the prefix shared with the previous term and the suffix that differs
+			*/
+			size_t shared = common_prefix_length(reinterpret_cast<const uint8_t *>(previous_term.data()), previous_term.size(), string, term.size());
+			compress_integer_variable_byte::compress_into(into, (uint64_t)shared);
+			compress_integer_variable_byte::compress_into(into, (uint64_t)(term.size() - shared));
+			blocks.insert(blocks.end(), string + shared, string + term.size());
+
+			/*
+				The postings offset is stored as the (zig-zag encoded) difference from the previous term
+			*/
+			int64_t difference = (int64_t)(postings - previous_postings);
+			compress_integer_variable_byte::compress_into(into, (uint64_t)((difference << 1) ^ (difference >> 63)));
+			}
+
+		compress_integer_variable_byte::compress_into(into, impacts);
+
+		previous_term.assign(reinterpret_cast<const char *>(string), term.size());
+		previous_postings = postings;
+		terms++;
+		}
+
+	/*
+		VOCABULARY_FRONT_CODED::SHRINK_TO_FIT()
+		---------------------------------------
+	*/
+	void vocabulary_front_coded::shrink_to_fit(void)
+		{
+		blocks.shrink_to_fit();
+		block_start.shrink_to_fit();
+		previous_term.clear();
+		previous_term.shrink_to_fit();
+		}
+
+	/*
+		VOCABULARY_FRONT_CODED::FIND()
+		------------------------------
+	*/
+	bool vocabulary_front_coded::find(const slice &term, uint64_t &postings, uint64_t &impacts) const
+		{
+		const uint8_t *query = reinterpret_cast<const uint8_t *>(term.address());
+		size_t query_length = term.size();
+
+		/*
+			Binary search for the first block whose first term is larger than the query, the term (if present) is in the block before it
+		*/
+		size_t low = 0;
+		size_t high = block_start.size();
+		while (low < high)
+			{
+			size_t middle = (low + high) / 2;
+			const uint8_t *first_term = &blocks[block_start[middle]];
+			uint64_t first_term_length;
+			compress_integer_variable_byte::decompress_into(&first_term_length, first_term);
+
+			int cmp = memcmp(query, first_term, query_length < first_term_length ? query_length : first_term_length);
+			if (cmp < 0 || (cmp == 0 && query_length < first_term_length))
+				high = middle;
+			else
+				low = middle + 1;
+			}
+
+		if (low == 0)
+			return false;			// before the first term in the vocabulary
+
+		const uint8_t *current = &blocks[block_start[low - 1]];
+		const uint8_t *block_end = low < block_start.size() ? &blocks[block_start[low]] : blocks.data() + blocks.size();
+
+		/*
+			Compare to the first term in the block, which is stored in full.  From here on, matched is the length of the prefix the current term
+			shares with the query and the current term is always less than the query (until we find it or pass it).
+		*/
+		uint64_t current_length;
+		uint64_t current_postings;
+		uint64_t current_impacts;
+		compress_integer_variable_byte::decompress_into(&current_length, current);
+		size_t matched = common_prefix_length(query, query_length, current, current_length);
+		current += current_length;
+		compress_integer_variable_byte::decompress_into(&current_postings, current);
+
+		for (;;)
+			{
+			compress_integer_variable_byte::decompress_into(&current_impacts, current);
+			if (matched == current_length && matched == query_length)
+				{
+				postings = current_postings;
+				impacts = current_impacts;
+				return true;
+				}
+
+			if (current >= block_end)
+				return false;			// past the end of the block so not in the vocabulary
+
+			uint64_t shared;
+			uint64_t suffix_length;
+			compress_integer_variable_byte::decompress_into(&shared, current);
+			compress_integer_variable_byte::decompress_into(&suffix_length, current);
+
+			/*
+				If this term shares less with the previous term than the previous term did with the query then we've gone past the query.  If it
+				shares more then it differs from the query in the same place the previous term did (and so is still less).  Only if it shares the
+				same do we need to look at the suffix.
+			*/
+			if (shared < matched)
+				return false;
+
+			current_length = shared + suffix_length;
+			if (shared == matched)
+				{
+				size_t extra = common_prefix_length(query + matched, query_length - matched, current, suffix_length);
+				matched += extra;
+				if (matched != current_length && (matched == query_length || current[extra] > query[matched]))
+					return false;
+				}
+
+			current += suffix_length;
+
+			uint64_t difference;
+			compress_integer_variable_byte::decompress_into(&difference, current);
+			current_postings += (uint64_t)((int64_t)(difference >> 1) ^ -(int64_t)(difference & 1));
+			}
+		}
+
+	/*
+		VOCABULARY_FRONT_CODED::UNITTEST()
+		----------------------------------
+	*/
+	void vocabulary_front_coded::unittest(void)
+		{
+		uint64_t postings;
+		uint64_t impacts;
+
+		/*
+			An empty vocabulary contains nothing
+		*/
+		vocabulary_front_coded empty;
+		JASS_assert(!empty.find(slice("a"), postings, impacts));
+
+		/*
+			Every string of 1-4 characters from {a, b, c}, so there are lots of shared prefixes and terms that are prefixes of other terms
+		*/
+		std::vector<std::string> terms;
+		for (size_t length = 1; length <= 4; length++)
+			{
+			size_t count = 1;
+			for (size_t character = 0; character < length; character++)
+				count *= 3;
+			for (size_t which = 0; which < count; which++)
+				{
+				std::string term;
+				for (size_t remainder = which, character = 0; character < length; character++, remainder /= 3)
+					term.push_back((char)('a' + remainder % 3));
+				terms.push_back(term);
+				}
+			}
+		std::sort(terms.begin(), terms.end());
+
+		/*
+			The postings offsets go both up and down
+		*/
+		vocabulary_front_coded vocabulary;
+		for (size_t which = 0; which < terms.size(); which++)
+			vocabulary.push_back(slice((void *)terms[which].data(), terms[which].size()), (which * 7919) % 1000, which + 1);
+		vocabulary.shrink_to_fit();
+		JASS_assert(vocabulary.size() == terms.size());
+
+		for (size_t which = 0; which < terms.size(); which++)
+			{
+			JASS_assert(vocabulary.find(slice((void *)terms[which].data(), terms[which].size()), postings, impacts));
+			JASS_assert(postings == (which * 7919) % 1000);
+			JASS_assert(impacts == which + 1);
+			}
+
+		/*
+			Terms that are not there: before the first, after the last, longer than any, and between terms
+		*/
+		const char *missing[] = {"", "0", "d", "aaaaa", "abcd", "ca0", "cccc0", "ccccc", "ba!"};
+		for (const auto term : missing)
+			JASS_assert(!vocabulary.find(slice(term), postings, impacts));
+
+		/*
+			It should be smaller than the strings on their own (with a '\0' terminator)
+		*/
+		size_t string_bytes = 0;
+		for (const auto &term : terms)
+			string_bytes += term.size() + 1;
+		JASS_assert(vocabulary.memory_usage() < string_bytes + terms.size() * sizeof(uint64_t) * 2);
+
+		puts("vocabulary_front_coded::PASSED");
+		}
+	}
@@ -0,0 +1,133 @@
+/*
+	VOCABULARY_FRONT_CODED.H
+	------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A compressed (front coded and blocked) in-memory vocabulary.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "slice.h"
+
+namespace JASS
+	{
+	/*
+		CLASS VOCABULARY_FRONT_CODED
+		----------------------------
+	*/
+	/*!
+		@brief A compressed (front coded and blocked) in-memory vocabulary mapping each term to its postings offset and number of impacts.
+		@details The terms are stored in sorted order in blocks of BLOCK_SIZE terms.  The first term of each block is stored in full, each
+		subsequent term is stored as the length of the prefix it shares with the term before it followed by the remaining suffix (front coding).
+		The postings offset and impact count of each term follow the term and are variable byte encoded (the postings offset as the difference
+		from the previous term).  Lookup is a binary search on the (sampled) first term of each block followed by a linear scan of one block,
+		which compares the query to each term without having to re-construct it.  This is typically 4-8 times smaller than an array of
+		pointers to strings (and metadata), and the strings themselves.
+	*/
+	class vocabulary_front_coded
+		{
+		public:
+			static constexpr size_t BLOCK_SIZE = 16;				///< The number of terms in a block (one in BLOCK_SIZE terms is in the top-level array)
+
+		private:
+			std::vector<uint8_t> blocks;								///< The front coded terms and their metadata
+			std::vector<uint64_t> block_start;						///< The offset (within blocks) of the start of each block (the top-level array)
+			size_t terms;													///< The number of terms in the vocabulary
+			std::string previous_term;									///< The previous term added with push_back() (used during construction)
+			uint64_t previous_postings;								///< The postings offset of the previous term added with push_back() (used during construction)
+
+		public:
+			/*
+				VOCABULARY_FRONT_CODED::VOCABULARY_FRONT_CODED()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+			*/
+			vocabulary_front_coded() :
+				terms(0),
+				previous_postings(0)
+				{
+				/* Nothing */
+				}
+
+			/*
+				VOCABULARY_FRONT_CODED::PUSH_BACK()
+				-----------------------------------
+			*/
+			/*!
+				@brief Add a term to the end of the vocabulary (the terms must be added in slice::strict_weak_order_less_than() order)
+				@param term [in] The term
+				@param postings [in] The offset of the term's postings list
+				@param impacts [in] The number of impacts (segments) in the term's postings list
+			*/
+			void push_back(const slice &term, uint64_t postings, uint64_t impacts);
+
+			/*
+				VOCABULARY_FRONT_CODED::SHRINK_TO_FIT()
+				---------------------------------------
+			*/
+			/*!
+				@brief Release any memory not being used to store the vocabulary (call after the last push_back())
+			*/
+			void shrink_to_fit(void);
+
+			/*
+				VOCABULARY_FRONT_CODED::FIND()
+				------------------------------
+			*/
+			/*!
+				@brief Look up a term in the vocabulary
+				@param term [in] The term to look for
+				@param postings [out] If found, the offset of the term's postings list
+				@param impacts [out] If found, the number of impacts in the term's postings list
+				@return true if the term is in the vocabulary, else false
+			*/
+			bool find(const slice &term, uint64_t &postings, uint64_t &impacts) const;
+
+			/*
+				VOCABULARY_FRONT_CODED::SIZE()
+				------------------------------
+			*/
+			/*!
+				@brief Return the number of terms in the vocabulary
+				@return The number of terms in the vocabulary
+			*/
+			size_t size(void) const
+				{
+				return terms;
+				}
+
+			/*
+				VOCABULARY_FRONT_CODED::MEMORY_USAGE()
+				--------------------------------------
+			*/
+			/*!
+				@brief Return the number of bytes of memory used to store the vocabulary
+				@return The number of bytes used
+			*/
+			size_t memory_usage(void) const
+				{
+				return blocks.capacity() + block_start.capacity() * sizeof(block_start[0]);
+				}
+
+			/*
+				VOCABULARY_FRONT_CODED::UNITTEST()
+				----------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
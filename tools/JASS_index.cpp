@@ -19,14 +19,18 @@
 #include "parser.h"
 #include "version.h"
 #include "quantize.h"
+#include "stem_cache.h"
 #include "commandline.h"
 #include "stem_porter.h"
 #include "parser_fasta.h"
 #include "serialise_ci.h"
 #include "quantize_none.h"
+#include "collection_statistics.h"
 #include "instream_file.h"
+#include "instream_mmap.h"
 #include "instream_memory.h"
 #include "instream_deflate.h"
+#include "instream_prefetch.h"
 #include "compress_integer.h"
 #include "serialise_jass_v1.h"
 #include "serialise_jass_v2.h"
@@ -35,10 +39,17 @@
 #include "instream_document_trec.h"
 #include "instream_document_fasta.h"
 #include "serialise_forward_index.h"
+#include "index_manager_parallel.h"
+#include "index_manager_spilling.h"
 #include "index_manager_sequential.h"
+#include "ranking_function_dph.h"
+#include "ranking_function_bm25.h"
+#include "ranking_function_tfidf.h"
 #include "ranking_function_atire_bm25.h"
+#include "ranking_function_lm_dirichlet.h"
 #include "instream_directory_iterator.h"
 #include "instream_document_unicoil_json.h"
+#include "instream_document_warc_parallel.h"
 
 /*
 	Declare the command line parameters
@@ -54,11 +65,24 @@ bool parameter_help = false;
 size_t parameter_report_every_n = (std::numeric_limits<size_t>::max)();
 bool parameter_atire_similar = false;
 size_t parameter_fasta_kmer_length = 0;
+size_t parameter_threads = 1;
+bool parameter_shared_dictionary = false;
+size_t parameter_memory_mb = 0;
+
+std::string parameter_ranker = "atire_bm25";
+double parameter_k1 = 0.9;
+double parameter_b = 0.4;
+double parameter_delta = 1.0;
+double parameter_mu = 1000.0;
+std::string parameter_quantization = "uniform";
+std::string parameter_statistics_write = "";
+std::string parameter_statistics_read = "";
 
 bool parameter_stem_porter = false;
 
 bool parameter_document_format_trec = true;
 bool parameter_document_format_JSON_uniCOIL = false;
+bool parameter_document_format_warc = false;
 
 auto command_line_parameters = std::make_tuple
 	(
@@ -71,11 +95,17 @@ auto command_line_parameters = std::make_tuple
 	JASS::commandline::note("\nREPORTING\n---------"),
 	JASS::commandline::parameter("-N", "--report-every", "<n> Report time and memory every <n> documents.", parameter_report_every_n),
 
+	JASS::commandline::note("\nPERFORMANCE\n-----------"),
+	JASS::commandline::parameter("-T", "--threads", "<n> Index using <n> threads (default 1), reading (and decompressing) in another (or, for a directory, decompressing <n> files at once).", parameter_threads),
+	JASS::commandline::parameter("-D", "--shared-dictionary", "With -T, index all threads into one shared (lock-free) dictionary rather than merging per-thread indexes.", parameter_shared_dictionary),
+	JASS::commandline::parameter("-M", "--memory", "<megabytes> Spill the index to disk (and merge at the end) whenever it uses more than <megabytes> of memory.", parameter_memory_mb),
+
 	JASS::commandline::note("\nFILE HANDLING\n-------------"),
 	JASS::commandline::parameter("-f", "--filename", "<filename> Filename to index.", parameter_filename),
 
 	JASS::commandline::note("\nDOCUMENT FORMATS\n-------------"),
 	JASS::commandline::parameter("-dt",  "--document_TREC", "TREC format: <DOC><DOCNO></DOCNO></DOC> formatted documents (default)", parameter_document_format_trec),
+	JASS::commandline::parameter("-dw",  "--document_WARC", "WARC format (a .warc or .warc.gz file or a directory of them, decompressed and parsed with -T threads): records with a WARC-TREC-ID, HTTP header and HTML removed", parameter_document_format_warc),
 	JASS::commandline::parameter("-djc", "--document_JSON_uniCOIL", "JSON uniCOIL forward index format: {\"id\": \"0\", \"vector\": {\"term\": 94 }}", parameter_document_format_JSON_uniCOIL),
 
 	JASS::commandline::note("\nCOMPATIBILITY\n-------------"),
@@ -84,6 +114,16 @@ auto command_line_parameters = std::make_tuple
 	JASS::commandline::note("\nTERM PROCESSING\n---------------"),
 	JASS::commandline::parameter("-tp", "--term_steming_porter", "Term stemming with Porter v1 (JASS implementation)", parameter_stem_porter),
 
+	JASS::commandline::note("\nRANKING FUNCTION (FOR QUANTIZATION)\n-----------------------------------"),
+	JASS::commandline::parameter("-R", "--ranker", "<function> Quantize with atire_bm25 (default), bm25, bm25+, lm_dirichlet, dph, or tfidf.", parameter_ranker),
+	JASS::commandline::parameter("-k1", "--bm25_k1", "<k1> The BM25 k1 parameter (default 0.9).", parameter_k1),
+	JASS::commandline::parameter("-b", "--bm25_b", "<b> The BM25 b parameter (default 0.4).", parameter_b),
+	JASS::commandline::parameter("-delta", "--bm25_delta", "<delta> The BM25+ delta parameter (default 1.0).", parameter_delta),
+	JASS::commandline::parameter("-mu", "--lm_mu", "<mu> The language model Dirichlet smoothing parameter (default 1000).", parameter_mu),
+	JASS::commandline::parameter("-Q", "--quantization", "<method> Map scores to impacts with uniform (default), log, equi_depth, or per_term quantization.", parameter_quantization),
+	JASS::commandline::parameter("-Sw", "--statistics_write", "<filename> Write the collection statistics and quantization bounds to <filename> (for use with -Sr).", parameter_statistics_write),
+	JASS::commandline::parameter("-Sr", "--statistics_read", "<filename> Quantize with the collection statistics and bounds in <filename> (from -Sw on the whole collection) so a shard or delta gets the same impacts as in the whole collection (uniform or log only).", parameter_statistics_read),
+
 	JASS::commandline::note("\nINDEX GENERATION\n----------------"),
 	JASS::commandline::parameter("-I1", "--index_jass_v1", "Generate a JASS version 1 index.", parameter_jass_v1_index),
 	JASS::commandline::parameter("-I2", "--index_jass_v2", "Generate a JASS version 2 index.", parameter_jass_v2_index),
@@ -103,7 +143,112 @@ enum document_format
 	NONE,
 	TREC,
 	K_MER,
-	JSON_uniCOIL
+	JSON_uniCOIL,
+	WARC
+	};
+
+/*
+	CLASS INDEXER
+	-------------
+*/
+/*!
+	@brief Parse a document and add it to the index (one of these is used by each indexing thread).
+*/
+class indexer : public JASS::index_manager_parallel::document_indexer
+	{
+	private:
+		std::unique_ptr<JASS::parser> parser;			///< The parser for the document format
+		std::unique_ptr<JASS::stem> stem;				///< The stemmer (or nullptr for no stemming)
+
+	public:
+		/*
+			INDEXER::INDEXER()
+			------------------
+		*/
+		/*!
+			@brief Constructor
+			@param format [in] The format of the documents.
+		*/
+		indexer(document_format format)
+			{
+			switch (format)
+				{
+				case TREC:
+				case WARC:
+					parser = std::make_unique<JASS::parser>();
+					break;
+				case K_MER:
+					parser = std::make_unique<JASS::parser_fasta>(parameter_fasta_kmer_length);
+					break;
+				case JSON_uniCOIL:
+					parser = std::make_unique<JASS::parser_unicoil_json>();
+					break;
+				default:
+					std::cout << "Unknown parser type";
+					exit(1);
+					break;
+				}
+
+			if (parameter_stem_porter)
+				stem = std::make_unique<JASS::stem_cache>(std::make_unique<JASS::stem_porter>());		// each indexer (so each thread) has its own cache
+			}
+
+		/*
+			INDEXER::INDEX()
+			----------------
+		*/
+		/*!
+			@brief Parse the document and add it to the index.
+			@param index [in] The index to add the document to.
+			@param document [in] The document to parse.
+		*/
+		virtual void index(JASS::index_manager &index, JASS::document &document)
+			{
+			/*
+				parse the current document
+			*/
+			parser->set_document(document);
+			index.begin_document(document.primary_key);
+
+			/*
+				Process each token
+			*/
+			bool finished = false;
+			JASS::compress_integer::integer document_length = 0;				// measured in terms
+			do
+				{
+				auto &token = const_cast<JASS::parser::token &>(parser->get_next_token());
+//std::cout << "[" << token.lexeme << "," << token.count << "]\n";
+				switch (token.type)
+					{
+					case JASS::parser::token::eof:
+						finished = true;
+						break;
+					case JASS::parser::token::alpha:
+						document_length++;
+						if (stem != nullptr && token.lexeme.size() > 2)
+							stem->tostem(token, token);
+						index.term(token);
+						break;
+					case JASS::parser::token::numeric:
+						document_length++;
+						index.term(token);
+						break;
+					case JASS::parser::token::xml_start_tag:
+						break;
+					case JASS::parser::token::xml_end_tag:
+						break;
+					default:
+						break;
+					}
+				}
+			while (!finished);
+
+			/*
+				ATIRE has a bug that results in the document length calculation being off by one (one too large in ATIRE)
+			*/
+			index.end_document(document_length + (parameter_atire_similar ? 1 : 0));
+			}
 	};
 
 /*
@@ -124,8 +269,9 @@ document_format get_document_format()
 	{
 	if
 		(
-		parameter_fasta_kmer_length != 0 &&
-		parameter_document_format_JSON_uniCOIL
+		(parameter_fasta_kmer_length != 0) +
+		parameter_document_format_JSON_uniCOIL +
+		parameter_document_format_warc > 1
 		)
 		return document_format::NONE;
 
@@ -134,10 +280,94 @@ document_format get_document_format()
 		return document_format::K_MER;
 	else if (parameter_document_format_JSON_uniCOIL)
 		return document_format::JSON_uniCOIL;
+	else if (parameter_document_format_warc)
+		return document_format::WARC;
 	else
 		return document_format::TREC;
 	}
 
+/*
+	READ_AHEAD()
+	------------
+*/
+/*!
+	@brief With more than one thread, read (and decompress) the input in a thread of its own, so that it overlaps splitting it into documents and parsing them.
+	@param source [in] The input.
+	@return The input to split into documents.
+*/
+std::shared_ptr<JASS::instream> read_ahead(std::shared_ptr<JASS::instream> &source)
+	{
+	if (parameter_threads <= 1)
+		return source;
+
+	return std::shared_ptr<JASS::instream>(new JASS::instream_prefetch(source));
+	}
+
+/*
+	OPEN_INPUT()
+	------------
+*/
+/*!
+	@brief Open the input, a file (decompressing it if it ends in .gz or .zst) or a directory of files (decompressing parameter_threads of them at once).
+	@param filename [in] The name of the file or directory.
+	@param map [in] Should a file that is not compressed be memory mapped (for a document splitter that can read from the mapping)?
+	@return The input to split into documents.
+*/
+std::shared_ptr<JASS::instream> open_input(const std::string &filename, bool map = false)
+	{
+	if (std::filesystem::is_directory(std::filesystem::path(filename)))
+		return std::shared_ptr<JASS::instream>(new JASS::instream_directory_iterator(filename, parameter_threads));
+
+	std::shared_ptr<JASS::instream> file = JASS::instream_directory_iterator::open(filename, map);
+	if (dynamic_cast<JASS::instream_mmap *>(file.get()) != nullptr)
+		return file;							// the operating system reads ahead
+	return read_ahead(file);
+	}
+
+/*
+	QUANTIZE_AND_SERIALISE()
+	------------------------
+*/
+/*!
+	@brief Quantize the index with the given ranking function then write it out in each of the export formats.
+	@param index [in] The index.
+	@param documents [in] The number of documents in the index.
+	@param ranker [in] The ranking function to quantize with.
+	@param exporters [in] The export formats.
+	@param method [in] How to map scores to impacts.
+	@param statistics_in [in] Score with these collection statistics and quantize between their bounds (nullptr to use those of this collection).
+	@param statistics_out [in/out] If not nullptr then the bounds are added to these statistics which are then written to parameter_statistics_write.
+	@return The time (in nanoseconds) taken to compute the bounds of the quantizer.
+*/
+template <typename RANKER>
+uint64_t quantize_and_serialise(JASS::index_manager &index, size_t documents, std::shared_ptr<RANKER> ranker, std::vector<std::unique_ptr<JASS::index_manager::delegate>> &exporters, JASS::quantization_method method, const JASS::collection_statistics *statistics_in, JASS::collection_statistics *statistics_out)
+	{
+	auto timer = JASS::timer::start();
+	JASS::quantize<RANKER> quantizer(documents, ranker, parameter_threads, method);
+	if (statistics_in != nullptr && !quantizer.use_statistics(*statistics_in))
+		{
+		std::cout << "Only uniform and log quantization can use the collection statistics of another collection (-Sr)\n";
+		exit(1);
+		}
+	index.iterate(quantizer);
+	auto quantization_time = JASS::timer::stop(timer).nanoseconds();
+
+	if (statistics_out != nullptr)
+		{
+		quantizer.get_bounds(statistics_out->smallest_rsv, statistics_out->largest_rsv);
+		if (!statistics_out->write(parameter_statistics_write))
+			{
+			std::cout << "Cannot write the collection statistics to " << parameter_statistics_write << "\n";
+			exit(1);
+			}
+		}
+
+	if (exporters.size() != 0)
+		quantizer.serialise_index(index, exporters);
+
+	return quantization_time;
+	}
+
 /*
 	MAIN()
 	------
@@ -177,6 +407,61 @@ int main(int argc, const char *argv[])
 		std::cout << JASS::version::build() << "\n";
 
 
+	/*
+		Check the ranking function before we start
+	*/
+	if (parameter_ranker != "atire_bm25" && parameter_ranker != "bm25" && parameter_ranker != "bm25+" && parameter_ranker != "lm_dirichlet" && parameter_ranker != "dph" && parameter_ranker != "tfidf")
+		{
+		std::cout << "Unknown ranking function:" << parameter_ranker << "\n";
+		return 1;
+		}
+
+	JASS::quantization_method method;
+	if (parameter_quantization == "uniform")
+		method = JASS::quantization_method::uniform;
+	else if (parameter_quantization == "log")
+		method = JASS::quantization_method::logarithmic;
+	else if (parameter_quantization == "equi_depth")
+		method = JASS::quantization_method::equi_depth;
+	else if (parameter_quantization == "per_term")
+		method = JASS::quantization_method::per_term;
+	else
+		{
+		std::cout << "Unknown quantization method:" << parameter_quantization << "\n";
+		return 1;
+		}
+
+	/*
+		Load the collection statistics to quantize against (if any).  The ranker and quantization must be the same as they were
+		for the collection the statistics are of, or else the scores (and bounds) mean something different.
+	*/
+	std::string quantizer_name = parameter_ranker + " k1=" + std::to_string(parameter_k1) + " b=" + std::to_string(parameter_b) + " delta=" + std::to_string(parameter_delta) + " mu=" + std::to_string(parameter_mu) + " " + parameter_quantization;
+	std::unique_ptr<JASS::collection_statistics> statistics_in;
+	if (parameter_statistics_read != "")
+		{
+		if (parameter_statistics_write != "")
+			{
+			std::cout << "Statistics can be read (-Sr) or written (-Sw), but not both\n";
+			return 1;
+			}
+		if (format == JSON_uniCOIL)
+			{
+			std::cout << "uniCOIL impacts are already quantized so they can't be quantized with collection statistics (-Sr)\n";
+			return 1;
+			}
+		statistics_in = std::make_unique<JASS::collection_statistics>();
+		if (!statistics_in->read(parameter_statistics_read))
+			{
+			std::cout << "Cannot read the collection statistics from " << parameter_statistics_read << "\n";
+			return 1;
+			}
+		if (statistics_in->quantizer != quantizer_name)
+			{
+			std::cout << "The collection statistics are for a different ranker or quantization (" << statistics_in->quantizer << ")\n";
+			return 1;
+			}
+		}
+
 	/*
 		Check to make sure we'll actually be exporting the index
 	*/
@@ -192,54 +477,52 @@ int main(int argc, const char *argv[])
 	if (parameter_filename == "")
 		std::cout << "filename needed";
 
-	/*
-		Set up the parser
-	*/
-	JASS::parser *parser;
-	switch (format)
-		{
-		case TREC:
-			parser = new JASS::parser();
-			break;
-		case K_MER:
-			parser = new JASS::parser_fasta(parameter_fasta_kmer_length);
-			break;
-		case JSON_uniCOIL:
-			parser = new JASS::parser_unicoil_json();
-			break;
-		default:
-			std::cout << "Unknown parser type";
-			exit(1);
-			break;
-		}
-
 	/*
 		Set up the input pipeline
 	*/
-	std::shared_ptr<JASS::instream> file(new JASS::instream_file(parameter_filename));
 	JASS::instream *data_source;
 	switch (format)
 		{
 		case TREC:
-			data_source = new JASS::instream_document_trec(file);
+			{
+			std::shared_ptr<JASS::instream> reader = open_input(parameter_filename, true);
+			JASS::instream_document_trec *slicer = new JASS::instream_document_trec(reader);
+			slicer->set_zero_copy(true);				// each document is indexed (or copied into a batch) before the next is read
+			data_source = slicer;
 			break;
+			}
 		case K_MER:
-			data_source = new JASS::instream_document_fasta(file);
+			{
+			std::shared_ptr<JASS::instream> reader = open_input(parameter_filename);
+			data_source = new JASS::instream_document_fasta(reader);
 			break;
+			}
 		case JSON_uniCOIL:
 			{
 			if (std::filesystem::is_directory(std::filesystem::path(parameter_filename)))
 				{
-				std::shared_ptr<JASS::instream> source(new JASS::instream_directory_iterator(parameter_filename));
-				data_source = new JASS::instream_document_unicoil_json(source);
+				std::shared_ptr<JASS::instream> reader = open_input(parameter_filename);
+				data_source = new JASS::instream_document_unicoil_json(reader);
 				}
 			else
 				{
+				std::shared_ptr<JASS::instream> file(new JASS::instream_file(parameter_filename));
 				std::shared_ptr<JASS::instream> deflater(new JASS::instream_deflate(file));
-				data_source = new JASS::instream_document_unicoil_json(deflater);
+				std::shared_ptr<JASS::instream> reader = read_ahead(deflater);
+				data_source = new JASS::instream_document_unicoil_json(reader);
 				}
 			break;
 			}
+		case WARC:
+			{
+			/*
+				A file or a directory of files, either way the HTTP headers and HTML are removed the same way
+			*/
+			JASS::instream_document_warc_parallel *reader = new JASS::instream_document_warc_parallel(parameter_filename, parameter_threads);
+			reader->set_zero_copy(true);				// each document is indexed (or copied into a batch) before the next is read
+			data_source = reader;
+			break;
+			}
 		default:
 			std::cout << "Unknown parser type";
 			exit(1);
@@ -249,16 +532,27 @@ int main(int argc, const char *argv[])
 	std::shared_ptr<JASS::instream> source(data_source);
 
 	/*
-		Set up the stemmer
+		Now call JASS, with more than one thread the documents are indexed in parallel
 	*/
-	JASS::stem *stem = nullptr;
-	if (parameter_stem_porter)
-		stem = new JASS::stem_porter;
-
-	/*
-		Now call JASS
-	*/
-	JASS::index_manager_sequential index;
+	std::unique_ptr<JASS::index_manager> index_memory;
+	std::unique_ptr<indexer> sequential_indexer;
+	JASS::index_manager_parallel *parallel_index = nullptr;
+	if (parameter_threads > 1 && parameter_memory_mb != 0)
+		{
+		std::cout << "Spilling to disk (-M) is single threaded (-T 1) only\n";
+		return 1;
+		}
+	if (parameter_threads > 1)
+		index_memory.reset(parallel_index = new JASS::index_manager_parallel(parameter_threads, [format](){ return std::make_unique<indexer>(format); }, 1024, parameter_shared_dictionary));
+	else
+		{
+		if (parameter_memory_mb != 0)
+			index_memory = std::make_unique<JASS::index_manager_spilling>(parameter_memory_mb * 1024 * 1024);
+		else
+			index_memory = std::make_unique<JASS::index_manager_sequential>();
+		sequential_indexer = std::make_unique<indexer>(format);
+		}
+	JASS::index_manager &index = *index_memory;
 	JASS::document document;
 	size_t total_documents = 0;
 
@@ -267,7 +561,6 @@ int main(int argc, const char *argv[])
 	/*
 		Parse the instream to get document (which are then indexed)
 	*/
-	uint64_t collection_length = 0;		// measured in terms
 	do
 		{
 		/*
@@ -289,74 +582,31 @@ int main(int argc, const char *argv[])
 			std::cout << "Documents:" << total_documents << " in:" << took << " ns" << "\n";
 			}
 
-		/*
-			parse the current document
-		*/
-		parser->set_document(document);
-		index.begin_document(document.primary_key);
-
-		/*
-			Process each token
-		*/
-		bool finished = false;
-		JASS::compress_integer::integer document_length = 0;				// measured in terms
-		do
-			{
-			auto &token = const_cast<JASS::parser::token &>(parser->get_next_token());
-//std::cout << "[" << token.lexeme << "," << token.count << "]\n";
-			switch (token.type)
-				{
-				case JASS::parser::token::eof:
-					finished = true;
-					break;
-				case JASS::parser::token::alpha:
-					document_length++;
-					if (stem != nullptr && token.lexeme.size() > 2)
-						stem->tostem(token, token);
-					index.term(token);
-					break;
-				case JASS::parser::token::numeric:
-					document_length++;
-					index.term(token);
-					break;
-				case JASS::parser::token::xml_start_tag:
-					break;
-				case JASS::parser::token::xml_end_tag:
-					break;
-				default:
-					break;
-				}
-			}
-		while (!finished);
-		collection_length += document_length;
-
-		/*
-			ATIRE has a bug that results in the document length calculation being off by one (one too large in ATIRE)
-		*/
-		index.end_document(document_length + (parameter_atire_similar ? 1 : 0));
+		if (parallel_index != nullptr)
+			parallel_index->add_document(document);
+		else
+			sequential_indexer->index(index, document);
 		}
 	while (!document.isempty());
 
-	auto time_to_end_parse = JASS::timer::stop(timer).nanoseconds();
-
-	std::cout << "Documents:" << total_documents << '\n';
-	std::cout << "Terms    :" << collection_length << '\n';
+	if (parallel_index != nullptr)
+		parallel_index->finish();
 
 	/*
-		quantize the index
+		The collection length is measured in terms (without the ATIRE off-by-one)
 	*/
-	std::shared_ptr<JASS::ranking_function_atire_bm25> ranker(new JASS::ranking_function_atire_bm25(0.9, 0.4, index.get_document_length_vector()));
+	uint64_t collection_length = 0;
+	for (const auto length : index.get_document_length_vector())
+		collection_length += length;
+	if (parameter_atire_similar)
+		collection_length -= total_documents;
 
-	JASS::quantize<JASS::ranking_function_atire_bm25> *quantizer;
-	if (format == JSON_uniCOIL)
-		quantizer = new JASS::quantize_none<JASS::ranking_function_atire_bm25>(total_documents, ranker);
-	else
-		{
-		quantizer = new JASS::quantize<JASS::ranking_function_atire_bm25>(total_documents, ranker);
-		index.iterate(*quantizer);
-		}
+	auto time_to_end_parse = JASS::timer::stop(timer).nanoseconds();
 
-	auto time_to_end_quantization = JASS::timer::stop(timer).nanoseconds();
+	std::cout << "Documents:" << total_documents << '\n';
+	std::cout << "Terms    :" << collection_length << '\n';
+	std::cout << "Threads  :" << parameter_threads << '\n';
+	std::cout << "Docs/sec :" << (uint64_t)(total_documents / ((time_to_end_parse - preamble_time) / 1000000000.0 + 1e-9)) << '\n';
 
 	/*
 		Decode the export formats and encode into a vector
@@ -374,10 +624,58 @@ int main(int argc, const char *argv[])
 		exporters.push_back(std::make_unique<JASS::serialise_forward_index>(index.get_highest_document_id()));
 
 	/*
-		Write out the index in the desired formats.
+		Quantize the index with the chosen ranking function and write it out in the desired formats.
 	*/
-	if (exporters.size() != 0)
-		quantizer->serialise_index(index, exporters);
+	auto &lengths = index.get_document_length_vector();
+	uint64_t time_to_quantize = 0;
+
+	/*
+		If quantizing against the statistics of another collection then score with its mean document length (and collection length).
+		If writing the statistics of this collection then collect them before quantization replaces the term frequencies with impacts.
+	*/
+	double mean_document_length = 0;
+	double total_length = 0;
+	if (statistics_in != nullptr)
+		{
+		mean_document_length = static_cast<double>(statistics_in->length) / static_cast<double>(statistics_in->documents);
+		total_length = static_cast<double>(statistics_in->length);
+		}
+
+	std::unique_ptr<JASS::collection_statistics> statistics_out;
+	if (parameter_statistics_write != "" && format != JSON_uniCOIL)
+		{
+		uint64_t length = 0;
+		for (const auto document_length : lengths)
+			length += document_length;
+		statistics_out = std::make_unique<JASS::collection_statistics>(total_documents, length);
+		statistics_out->quantizer = quantizer_name;
+		index.iterate(*statistics_out);
+		}
+
+	if (format == JSON_uniCOIL)
+		{
+		/*
+			uniCOIL impacts are already quantized so they are written as they are
+		*/
+		std::shared_ptr<JASS::ranking_function_atire_bm25> ranker(new JASS::ranking_function_atire_bm25(parameter_k1, parameter_b, lengths));
+		JASS::quantize_none<JASS::ranking_function_atire_bm25> quantizer(total_documents, ranker);
+		if (exporters.size() != 0)
+			quantizer.serialise_index(index, exporters);
+		}
+	else if (parameter_ranker == "bm25")
+		time_to_quantize = quantize_and_serialise(index, total_documents, std::make_shared<JASS::ranking_function_bm25>(parameter_k1, parameter_b, lengths, 0.0, mean_document_length), exporters, method, statistics_in.get(), statistics_out.get());
+	else if (parameter_ranker == "bm25+")
+		time_to_quantize = quantize_and_serialise(index, total_documents, std::make_shared<JASS::ranking_function_bm25>(parameter_k1, parameter_b, lengths, parameter_delta, mean_document_length), exporters, method, statistics_in.get(), statistics_out.get());
+	else if (parameter_ranker == "lm_dirichlet")
+		time_to_quantize = quantize_and_serialise(index, total_documents, std::make_shared<JASS::ranking_function_lm_dirichlet>(parameter_mu, lengths, total_length), exporters, method, statistics_in.get(), statistics_out.get());
+	else if (parameter_ranker == "dph")
+		time_to_quantize = quantize_and_serialise(index, total_documents, std::make_shared<JASS::ranking_function_dph>(lengths, mean_document_length), exporters, method, statistics_in.get(), statistics_out.get());
+	else if (parameter_ranker == "tfidf")
+		time_to_quantize = quantize_and_serialise(index, total_documents, std::make_shared<JASS::ranking_function_tfidf>(), exporters, method, statistics_in.get(), statistics_out.get());
+	else
+		time_to_quantize = quantize_and_serialise(index, total_documents, std::make_shared<JASS::ranking_function_atire_bm25>(parameter_k1, parameter_b, lengths, mean_document_length), exporters, method, statistics_in.get(), statistics_out.get());
+
+	auto time_to_end_quantization = time_to_end_parse + time_to_quantize;
 
 	/*
 		Dump the statistics to the console.
@@ -394,8 +692,6 @@ int main(int argc, const char *argv[])
 	std::cout << "=================\n";
 	std::cout << "Total time       :" << time_to_end << "ns (" << time_to_end / 1000000000 << " seconds)\n";
 
-	delete parser;
-	delete quantizer;
 
 	/*
 		Done.
@@ -0,0 +1,159 @@
+/*
+	JASS_SEGMENT_DISTRIBUTION.CPP
+	-----------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@brief Report the distribution of postings (and segments) over the impacts of a JASS index.
+	@details An anytime search processes segments from the highest impact down, so the cumulative postings (from the highest impact)
+	show how much of the index can be processed within a postings_to_process budget, which is how quantization methods are compared.
+*/
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "commandline.h"
+#include "deserialised_jass_v1.h"
+#include "deserialised_jass_v2.h"
+#include "index_postings_impact.h"
+
+/*
+	PARAMETERS
+	----------
+*/
+bool parameter_help = false;
+bool parameter_v2 = false;
+std::string parameter_directory = "";
+
+std::string parameters_errors;						///< Any errors as a result of command line parsing
+auto parameters = std::make_tuple					///< The  command line parameter block
+	(
+	JASS::commandline::parameter("-?", "--help", "Print this help.", parameter_help),
+	JASS::commandline::parameter("-2", "--index_v2", "The index is a V2 index, not a V1 index", parameter_v2),
+	JASS::commandline::parameter("-d", "--directory", "<directory> The directory holding the index (default is the current directory)", parameter_directory)
+	);
+
+/*
+	USAGE()
+	-------
+*/
+/*!
+	@brief Print the usage line
+*/
+uint8_t usage(std::string exename)
+	{
+	std::cout << JASS::commandline::usage(exename, parameters) << "\n";
+
+	return 1;
+	}
+
+/*
+	MAIN()
+	------
+*/
+/*!
+	@brief Report the distribution of postings (and segments) over the impacts of a JASS index.
+*/
+int main(int argc, const char *argv[])
+	{
+	try
+		{
+		/*
+			Parse the commane line parameters
+		*/
+		auto success = JASS::commandline::parse(argc, argv, parameters, parameters_errors);
+		if (!success)
+			{
+			std::cout << parameters_errors;
+			exit(1);
+			}
+		if (parameter_help)
+			exit(usage(argv[0]));
+
+		/*
+			Open and read the index
+		*/
+		JASS::deserialised_jass_v1 *index;
+		if (parameter_v2)
+			index = new JASS::deserialised_jass_v2(false);
+		else
+			index = new JASS::deserialised_jass_v1(false);
+
+		index->read_index(parameter_directory);
+
+		/*
+			Walk the segment headers of every term, counting the segments and postings at each impact (there is no need to decode the postings)
+		*/
+		std::vector<uint64_t> segments_at(JASS::index_postings_impact::largest_impact + 1);
+		std::vector<uint64_t> postings_at(JASS::index_postings_impact::largest_impact + 1);
+		std::vector<JASS::query::DOCID_TYPE> segment_length;
+		std::vector<JASS::deserialised_jass_v1::segment_header> segments(JASS::index_postings_impact::largest_impact + 1);
+		uint64_t terms = 0;
+
+		for (auto term : *index)
+			{
+			uint32_t smallest;
+			uint32_t largest;
+			JASS::query::DOCID_TYPE document_frequency;
+			size_t segment_count = index->get_segment_list(&segments[0], term, 1, smallest, largest, document_frequency);
+
+			terms++;
+			for (size_t which = 0; which < segment_count; which++)
+				{
+				segments_at[segments[which].impact]++;
+				postings_at[segments[which].impact] += segments[which].segment_frequency;
+				segment_length.push_back(segments[which].segment_frequency);
+				}
+			}
+
+		uint64_t total_postings = 0;
+		for (auto postings : postings_at)
+			total_postings += postings;
+
+		/*
+			Print the distribution, from the highest impact down (the order an anytime search processes them)
+		*/
+		std::cout << "Impact Segments Postings %Postings Cumulative %Cumulative\n";
+		uint64_t cumulative = 0;
+		size_t impacts_used = 0;
+		for (size_t impact = JASS::index_postings_impact::largest_impact + 1; impact-- > 0;)
+			{
+			if (segments_at[impact] == 0)
+				continue;
+
+			impacts_used++;
+			cumulative += postings_at[impact];
+			std::cout << impact << ' ' << segments_at[impact] << ' ' << postings_at[impact] << ' ';
+			std::cout << std::fixed << std::setprecision(4) << 100.0 * postings_at[impact] / total_postings << ' ';
+			std::cout << cumulative << ' ' << 100.0 * cumulative / total_postings << '\n';
+			}
+
+		/*
+			Print the summary statistics
+		*/
+		std::sort(segment_length.begin(), segment_length.end());
+		std::cout << "\nTerms          :" << terms << '\n';
+		std::cout << "Impacts used   :" << impacts_used << '\n';
+		std::cout << "Segments       :" << segment_length.size() << '\n';
+		std::cout << "Postings       :" << total_postings << '\n';
+		if (segment_length.size() != 0)
+			{
+			std::cout << "Mean segment   :" << static_cast<double>(total_postings) / segment_length.size() << '\n';
+			std::cout << "Median segment :" << segment_length[segment_length.size() / 2] << '\n';
+			std::cout << "Largest segment:" << segment_length.back() << '\n';
+			}
+
+		delete index;
+		}
+	catch (...)
+		{
+		std::cout << "Unknown exception\n";
+		return 1;
+		}
+	return 0;
+	}
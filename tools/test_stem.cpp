@@ -0,0 +1,169 @@
+/*
+	TEST_STEM.CPP
+	-------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*
+	Compare the time it takes to stem the tokens of a TREC collection with the Porter stemmer and with the Porter stemmer behind a
+	stem_cache.  The collection is parsed first, then the tokens are stemmed the way JASS_index does it (alphabetic tokens longer than
+	two characters, in place in the token), so the times are just those of the stemmers.  The time to copy the tokens without stemming
+	them is also given so the cost of stemming can be seen.
+*/
+/*!
+	@file
+	@brief Benchmark the Porter stemmer with and without a stem_cache on a TREC collection.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <limits>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+
+#include "timer.h"
+#include "parser.h"
+#include "document.h"
+#include "stem_cache.h"
+#include "commandline.h"
+#include "stem_porter.h"
+#include "instream_file.h"
+#include "allocator_pool.h"
+#include "instream_document_trec.h"
+
+/*
+	USAGE()
+	-------
+	Write out the useage statistics.
+*/
+template <typename TYPE>
+void usage(const char *exename, TYPE &command_line_parameters)
+	{
+	std::cout << JASS::commandline::usage(exename, command_line_parameters);
+	exit(0);
+	}
+
+/*
+	STEM_ALL()
+	----------
+*/
+/*!
+	@brief Stem each token (or just copy it if stemmer is nullptr) and return the time it took, in milliseconds.
+	@param stemmer [in] The stemmer to use (or nullptr to not stem).
+	@param tokens [in] The tokens.
+	@param checksum [out] The sum of the lengths of the stems (so that the work can't be optimised away).
+	@return The time taken.
+*/
+size_t stem_all(JASS::stem *stemmer, const std::vector<JASS::slice> &tokens, size_t &checksum)
+	{
+	JASS::parser::token token;
+	token.type = JASS::parser::token::alpha;
+	checksum = 0;
+
+	auto timer = JASS::timer::start();
+
+	for (const auto &term : tokens)
+		{
+		memcpy(token.buffer, term.address(), term.size());
+		token.lexeme = JASS::slice(token.buffer, term.size());
+		if (stemmer != nullptr)
+			stemmer->tostem(token, token);
+		checksum += token.lexeme.size();
+		}
+
+	return JASS::timer::stop(timer).milliseconds();
+	}
+
+/*
+	MAIN()
+	------
+*/
+/*!
+	@brief Benchmark the stemmers
+	@param argc [in] The number of parameters
+	@param argv [in] The parameters
+	@return 0 on success, else failure
+*/
+int main(int argc, const char *argv[])
+	{
+	std::string filename = "";
+	size_t repeats = 1;
+	size_t slots = 4096;
+	auto all_parameters = std::make_tuple
+		(
+		JASS::commandline::parameter("-f", "--filename", "<filename> TREC formatted collection to stem.", filename),
+		JASS::commandline::parameter("-r", "--repeats", "<n> Stem the collection <n> times with each stemmer and report the fastest (default 1).", repeats),
+		JASS::commandline::parameter("-s", "--slots", "<n> The number of words in the stem cache (default 4096).", slots)
+		);
+
+	std::string error;
+	if (!JASS::commandline::parse(argc, argv, all_parameters, error) || filename == "" || repeats == 0)
+		usage(argv[0], all_parameters);
+
+	/*
+		Parse the collection into a list of tokens (copied into memory) so that parsing is not measured
+	*/
+	JASS::allocator_pool memory;
+	std::vector<JASS::slice> tokens;
+
+	std::shared_ptr<JASS::instream> file(new JASS::instream_file(filename));
+	JASS::instream_document_trec source(file);
+	JASS::document document;
+	JASS::parser parser;
+	for (;;)
+		{
+		document.rewind();
+		source.read(document);
+		if (document.isempty())
+			break;
+
+		parser.set_document(document);
+		for (;;)
+			{
+			const auto &token = parser.get_next_token();
+			if (token.type == JASS::parser::token::eof)
+				break;
+			if (token.type == JASS::parser::token::alpha && token.lexeme.size() > 2)
+				tokens.push_back(JASS::slice(memory, token.lexeme));
+			}
+		}
+
+	std::cout << "Tokens    : " << tokens.size() << '\n';
+
+	/*
+		Stem with each stemmer, keeping the fastest time of each
+	*/
+	size_t copy_time = (std::numeric_limits<size_t>::max)();
+	size_t porter_time = (std::numeric_limits<size_t>::max)();
+	size_t cached_time = (std::numeric_limits<size_t>::max)();
+	size_t unstemmed_checksum;
+	size_t porter_checksum;
+	size_t cached_checksum;
+	size_t hits = 0;
+	for (size_t repeat = 0; repeat < repeats; repeat++)
+		{
+		copy_time = (std::min)(copy_time, stem_all(nullptr, tokens, unstemmed_checksum));
+
+		JASS::stem_porter porter;
+		porter_time = (std::min)(porter_time, stem_all(&porter, tokens, porter_checksum));
+
+		JASS::stem_cache cached(std::make_unique<JASS::stem_porter>(), slots);
+		cached_time = (std::min)(cached_time, stem_all(&cached, tokens, cached_checksum));
+		hits = cached.get_hits();
+		}
+
+	if (porter_checksum != cached_checksum)
+		std::cout << "FAIL: The cached stemmer and the stemmer give different stems\n";
+
+	std::cout << "Cache hits: " << (tokens.size() == 0 ? 0.0 : 100.0 * hits / tokens.size()) << "%\n";
+	std::cout << "No stemming            : " << copy_time << " ms\n";
+	std::cout << "Porter                 : " << porter_time << " ms\n";
+	std::cout << "Porter with stem_cache : " << cached_time << " ms\n";
+
+	return 0;
+	}
@@ -0,0 +1,161 @@
+/*
+	TEST_TERM_DICTIONARY.CPP
+	------------------------
+	Copyright (c) 2025 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*
+	Compare the time it takes to build the in-memory index of a TREC collection using the chained hash table (an array of binary trees) and
+	the open addressing hash table.  The collection is parsed first, then the tokens are added to each dictionary in turn (the way
+	index_manager_sequential does), so the times are just those of the dictionaries and postings lists.
+*/
+/*!
+	@file
+	@brief Benchmark the term dictionaries (hash_table and hash_table_open) on a TREC collection.
+	@author Andrew Trotman
+	@copyright 2025 Andrew Trotman
+*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <limits>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+
+#include "timer.h"
+#include "parser.h"
+#include "document.h"
+#include "hash_table.h"
+#include "commandline.h"
+#include "instream_file.h"
+#include "allocator_pool.h"
+#include "index_postings.h"
+#include "hash_table_open.h"
+#include "instream_document_trec.h"
+
+/*
+	USAGE()
+	-------
+	Write out the useage statistics.
+*/
+template <typename TYPE>
+void usage(const char *exename, TYPE &command_line_parameters)
+	{
+	std::cout << JASS::commandline::usage(exename, command_line_parameters);
+	exit(0);
+	}
+
+/*
+	INDEX()
+	-------
+*/
+/*!
+	@brief Add each token to the dictionary (and its postings list) and return the time it took, in milliseconds.
+	@param dictionary [in] The dictionary to add to.
+	@param tokens [in] The tokens of each document, in order.
+	@param document_ends [in] The end of each document in tokens.
+	@return The time taken.
+*/
+template <typename DICTIONARY>
+size_t index(DICTIONARY &dictionary, const std::vector<JASS::slice> &tokens, const std::vector<size_t> &document_ends)
+	{
+	auto timer = JASS::timer::start();
+
+	size_t token = 0;
+	JASS::compress_integer::integer document_id = 0;
+	for (size_t end : document_ends)
+		{
+		document_id++;
+		for (; token < end; token++)
+			dictionary[tokens[token]].push_back(document_id);
+		}
+
+	return JASS::timer::stop(timer).milliseconds();
+	}
+
+/*
+	MAIN()
+	------
+*/
+/*!
+	@brief Benchmark the term dictionaries
+	@param argc [in] The number of parameters
+	@param argv [in] The parameters
+	@return 0 on success, else failure
+*/
+int main(int argc, const char *argv[])
+	{
+	std::string filename = "";
+	size_t repeats = 1;
+	auto all_parameters = std::make_tuple
+		(
+		JASS::commandline::parameter("-f", "--filename", "<filename> TREC formatted collection to index.", filename),
+		JASS::commandline::parameter("-r", "--repeats", "<n> Index the collection <n> times with each dictionary and report the fastest (default 1).", repeats)
+		);
+
+	std::string error;
+	if (!JASS::commandline::parse(argc, argv, all_parameters, error) || filename == "" || repeats == 0)
+		usage(argv[0], all_parameters);
+
+	/*
+		Parse the collection into a list of tokens (copied into memory) so that parsing is not measured
+	*/
+	JASS::allocator_pool memory;
+	std::vector<JASS::slice> tokens;
+	std::vector<size_t> document_ends;
+
+	std::shared_ptr<JASS::instream> file(new JASS::instream_file(filename));
+	JASS::instream_document_trec source(file);
+	JASS::document document;
+	JASS::parser parser;
+	for (;;)
+		{
+		document.rewind();
+		source.read(document);
+		if (document.isempty())
+			break;
+
+		parser.set_document(document);
+		for (;;)
+			{
+			const auto &token = parser.get_next_token();
+			if (token.type == JASS::parser::token::eof)
+				break;
+			if (token.type == JASS::parser::token::alpha || token.type == JASS::parser::token::numeric)
+				tokens.push_back(JASS::slice(memory, token.lexeme));
+			}
+		document_ends.push_back(tokens.size());
+		}
+
+	std::cout << "Documents : " << document_ends.size() << '\n';
+	std::cout << "Tokens    : " << tokens.size() << '\n';
+
+	/*
+		Index with each dictionary, keeping the fastest time of each
+	*/
+	size_t chained_time = (std::numeric_limits<size_t>::max)();
+	size_t open_time = (std::numeric_limits<size_t>::max)();
+	size_t terms = 0;
+	for (size_t repeat = 0; repeat < repeats; repeat++)
+		{
+			{
+			JASS::allocator_pool pool;
+			JASS::hash_table<JASS::slice, JASS::index_postings, 24> chained(pool);
+			chained_time = (std::min)(chained_time, index(chained, tokens, document_ends));
+			}
+			{
+			JASS::allocator_pool pool;
+			JASS::hash_table_open<JASS::slice, JASS::index_postings> open(pool);
+			open_time = (std::min)(open_time, index(open, tokens, document_ends));
+			terms = open.size();
+			}
+		}
+
+	std::cout << "Terms     : " << terms << '\n';
+	std::cout << "hash_table (chained into binary trees) : " << chained_time << " ms\n";
+	std::cout << "hash_table_open (open addressing)      : " << open_time << " ms\n";
+
+	return 0;
+	}
@@ -41,6 +41,11 @@
 		isxmlnamechar                                NameStartChar | "-" | "." | [0-9] | #xB7 | [#x0300-#x036F] | [#x203F-#x2040]
 
 	These are then dumped out as C routines.
+
+	The properties the tokenizer needs (alpha, alnum, digit, punct, whitespace, space, and the XML name characters) and the JASS normalisation
+	are also written as two-level tables.  The codepoints are split into blocks of 256 and the first level gives, for each block, which
+	(de-duplicated) second level block holds its data.  Most blocks are unassigned (or are all the same) so the tables are small and the
+	parts used by any one language are few and stay in cache.
 */
 /*!
 	@file
@@ -57,6 +62,7 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <functional>
 
 #include "file.h"
 #include "bitstring.h"
@@ -66,6 +72,11 @@
 */
 static const size_t MAX_CODEPOINT = 0x10FFFF;
 
+/*
+	The number of codepoints in each block of the two-level tables (must match unicode.h).
+*/
+static const size_t BLOCK_SIZE = 256;
+
 /*
 	alphabetic characters.  Note that alpha != lowercase + uppercase because there are many
 	characters that are caseless (such as the phonetic characters).
@@ -242,6 +253,84 @@ void serialise(const std::string &operation, const std::vector<size_t> &list)
 	puts("}\n");
 	}
 
+/*
+	SERIALISE_TWO_LEVEL()
+	---------------------
+*/
+/*!
+	@brief Write out a two-level table, JASS_unicode_<name>_stage1[] (the first level) and JASS_unicode_<name>_stage2[] (the second level).
+	@details The value for codepoint c is JASS_unicode_<name>_stage2[JASS_unicode_<name>_stage1[c / BLOCK_SIZE] * BLOCK_SIZE + c % BLOCK_SIZE].
+	@param name [in] The name of the table.
+	@param type [in] The C type of the second level.
+	@param value [in] The value of each codepoint.
+*/
+void serialise_two_level(const std::string &name, const std::string &type, const std::function<uint32_t(size_t)> &value)
+	{
+	std::map<std::vector<uint32_t>, size_t> block_number;
+	std::vector<std::vector<uint32_t>> blocks;
+	std::vector<size_t> first_level;
+
+	/*
+		De-duplicate the blocks
+	*/
+	for (size_t start = 0; start <= MAX_CODEPOINT; start += BLOCK_SIZE)
+		{
+		std::vector<uint32_t> block(BLOCK_SIZE);
+		for (size_t codepoint = start; codepoint < start + BLOCK_SIZE; codepoint++)
+			block[codepoint - start] = value(codepoint);
+
+		auto found = block_number.find(block);
+		if (found == block_number.end())
+			{
+			found = block_number.insert(std::make_pair(block, blocks.size())).first;
+			blocks.push_back(block);
+			}
+		first_level.push_back(found->second);
+		}
+
+	/*
+		Write out the first level then the second level
+	*/
+	printf("extern const uint16_t JASS_unicode_%s_stage1[] = {", name.c_str());
+	for (size_t which = 0; which < first_level.size(); which++)
+		printf("%s%u,", which % 16 == 0 ? "\n" : "", static_cast<unsigned>(first_level[which]));
+	puts("\n};\n");
+
+	printf("extern const %s JASS_unicode_%s_stage2[] = {", type.c_str(), name.c_str());
+	for (const auto &block : blocks)
+		for (size_t which = 0; which < BLOCK_SIZE; which++)
+			printf("%s0x%X,", which % 16 == 0 ? "\n" : "", block[which]);
+	puts("\n};\n");
+	}
+
+/*
+	SERIALISE_PROPERTIES()
+	----------------------
+*/
+/*!
+	@brief Write out the properties the tokenizer needs as a two-level table of bytes, one bit for each property (the bits must match unicode.h).
+*/
+void serialise_properties(void)
+	{
+	std::vector<uint8_t> properties(MAX_CODEPOINT + 1);
+	auto set = [&properties](const std::vector<size_t> &list, uint8_t bit)
+		{
+		for (const auto &codepoint : list)
+			properties[codepoint] |= bit;
+		};
+
+	set(alpha, 0x01);
+	set(alphanumeric, 0x02);
+	set(digit, 0x04);
+	set(punc, 0x08);
+	set(whitespace, 0x10);
+	set(space, 0x20);
+	set(xmlnamestartchar, 0x40);
+	set(xmlnamechar, 0x80);
+
+	serialise_two_level("properties", "uint8_t", [&properties](size_t codepoint) { return properties[codepoint]; });
+	}
+
 /*
 	PROCESS_UNICODEDATA()
 	---------------------
@@ -670,35 +759,35 @@ void normalize(void)
 		while (answer.size() >= 1 && answer[answer.size() - 1] == 0x20)			// LCOV_EXCL_LINE
 			answer.pop_back();													// LCOV_EXCL_LINE
 
-		/*
-			Only write it out if it isn't an empty string (as most are empty and we only need to store that once).
-		*/
-		if (answer.size() != 0)
-			{
-			printf("static const uint32_t JASS_normalisation_%x[] = {", codepoint);
-
-			for (const auto &cp : answer)
-				printf("0x%X, ", cp);
-			puts("0x00};");
-			}
-			
 		table_of_normalisations[codepoint] = answer;
 		}
-	/*
-		Write out the empty string
-	*/
-	printf("static const uint32_t JASS_normalisation_0[] = {0};\n");
 
 	/*
-		Write out the global lookup table
+		Each distinct normalisation is stored (0 terminated) once in a pool of codepoints, with the empty string first.
 	*/
-	printf("const uint32_t *JASS_normalisation[] = {\n");
-	for (int codepoint = 0; codepoint <= 0x10FFFF; codepoint++)
-		if (table_of_normalisations[codepoint].size() == 0)
-			printf("JASS_normalisation_0,\n");
-		else
-			printf("JASS_normalisation_%x,\n", codepoint);
-	puts("};");
+	std::vector<uint32_t> pool = {0};
+	std::map<std::vector<int>, uint32_t> pool_offset;
+	pool_offset[std::vector<int>()] = 0;
+	std::vector<uint32_t> offset(MAX_CODEPOINT + 1);
+	for (size_t codepoint = 0; codepoint <= MAX_CODEPOINT; codepoint++)
+		{
+		const auto &answer = table_of_normalisations[static_cast<int>(codepoint)];
+		auto found = pool_offset.find(answer);
+		if (found == pool_offset.end())
+			{
+			found = pool_offset.insert(std::make_pair(answer, static_cast<uint32_t>(pool.size()))).first;
+			pool.insert(pool.end(), answer.begin(), answer.end());
+			pool.push_back(0);
+			}
+		offset[codepoint] = found->second;
+		}
+
+	printf("extern const uint32_t JASS_unicode_casefold_pool[] = {");
+	for (size_t which = 0; which < pool.size(); which++)
+		printf("%s0x%X,", which % 16 == 0 ? "\n" : "", pool[which]);
+	puts("\n};\n");
+
+	serialise_two_level("casefold", "uint32_t", [&offset](size_t codepoint) { return offset[codepoint]; });
 	}
 
 /*
@@ -832,6 +921,11 @@ int main_event(int argc, char *argv[])
 	serialise("isxmlnamechar", xmlnamechar);
 	serialise("isxmlnamestartchar", xmlnamestartchar);
 
+	/*
+		And the two-level table of the properties the tokenizer needs
+	*/
+	serialise_properties();
+
 	/*
 		Now for case folded normalisation.
 	*/
@@ -19,15 +19,19 @@
 #include "threads.h"
 #include "evaluate.h"
 #include "checksum.h"
+#include "collection_statistics.h"
 #include "quantize.h"
 #include "bitstream.h"
 #include "bitstring.h"
 #include "query_heap.h"
 #include "statistics.h"
+#include "segment_cache.h"
 #include "evaluate_f.h"
 #include "hash_table.h"
+#include "hash_table_open.h"
 #include "run_export.h"
 #include "top_k_heap.h"
+#include "stem_cache.h"
 #include "stem_porter.h"
 #include "top_k_qsort.h"
 #include "binary_tree.h"
@@ -50,6 +54,10 @@
 #include "accumulator_2d.h"
 #include "channel_buffer.h"
 #include "instream_memory.h"
+#include "instream_mmap.h"
+#include "instream_prefetch.h"
+#include "instream_zstd.h"
+#include "queue_spsc.h"
 #include "run_export_trec.h"
 #include "evaluate_recall.h"
 #include "query_block_max.h"
@@ -58,22 +66,35 @@
 #include "ranking_function.h"
 #include "serialise_jass_v1.h"
 #include "accumulator_simple.h"
+#include "merge_jass_v2.h"
+#include "serialise_fan_out.h"
 #include "serialise_integers.h"
 #include "evaluate_precision.h"
 #include "instream_file_star.h"
+#include "json_scanner.h"
 #include "parser_unicoil_json.h"
 #include "compress_integer_all.h"
+#include "ranking_function_dph.h"
 #include "evaluate_buying_power.h"
 #include "compress_integer_none.h"
 #include "index_postings_impact.h"
 #include "compress_general_zlib.h"
+#include "compress_general_zstd.h"
 #include "accumulator_block_max.h"
+#include "ranking_function_bm25.h"
+#include "vocabulary_front_coded.h"
+#include "JASS_anytime_api.h"
 #include "instream_document_trec.h"
 #include "instream_document_warc.h"
+#include "instream_document_warc_parallel.h"
 #include "evaluate_selling_power.h"
+#include "ranking_function_tfidf.h"
 #include "evaluate_buying_power4k.h"
 #include "instream_document_fasta.h"
 #include "serialise_forward_index.h"
+#include "index_manager_parallel.h"
+#include "index_manager_spilling.h"
+#include "index_manager_concurrent.h"
 #include "index_manager_sequential.h"
 #include "compress_integer_carry_8b.h"
 #include "compress_integer_simple_9.h"
@@ -95,6 +116,7 @@
 #include "compress_integer_qmx_original.h"
 #include "compress_integer_qmx_improved.h"
 #include "compress_integer_carryover_12.h"
+#include "ranking_function_lm_dirichlet.h"
 #include "evaluate_rank_biased_precision.h"
 #include "compress_integer_variable_byte.h"
 #include "instream_document_unicoil_json.h"
@@ -146,6 +168,9 @@ int main(void)
 		puts("instream_directory_iterator");
 		JASS::instream_directory_iterator::unittest();
 
+		puts("json_scanner");
+		JASS::json_scanner::unittest();
+
 		puts("parser_unicoil_json::unittest");
 		JASS::parser_unicoil_json::unittest();
 
@@ -208,6 +233,9 @@ int main(void)
 		puts("stem_porter");
 		JASS::stem_porter::unittest();
 
+		puts("stem_cache");
+		JASS::stem_cache::unittest();
+
 		puts("statistics");
 		JASS::statistics::unittest();
 		
@@ -217,6 +245,18 @@ int main(void)
 		puts("ranking_function_atire_bm25");
 		JASS::ranking_function_atire_bm25::unittest();
 
+		puts("ranking_function_bm25");
+		JASS::ranking_function_bm25::unittest();
+
+		puts("ranking_function_lm_dirichlet");
+		JASS::ranking_function_lm_dirichlet::unittest();
+
+		puts("ranking_function_dph");
+		JASS::ranking_function_dph::unittest();
+
+		puts("ranking_function_tfidf");
+		JASS::ranking_function_tfidf::unittest();
+
 		puts("ranking_function");
 		JASS::ranking_function<JASS::ranking_function_atire_bm25>::unittest();
 
@@ -225,6 +265,9 @@ int main(void)
 
 		puts("threads");
 		JASS::thread::unittest();
+
+		puts("queue_spsc");
+		JASS::queue_spsc<size_t>::unittest();
 		
 		puts("top_k_sort");
 		JASS::top_k_qsort::unittest();
@@ -249,6 +292,12 @@ int main(void)
 		puts("file");
 		JASS::file::unittest();
 
+		puts("segment_cache");
+		JASS::segment_cache::unittest();
+
+		puts("vocabulary_front_coded");
+		JASS::vocabulary_front_coded::unittest();
+
 		puts("evaluate");
 		JASS::evaluate::unittest();
 
@@ -337,12 +386,24 @@ int main(void)
 		puts("instream_memory");
 		JASS::instream_memory::unittest();
 
+		puts("instream_mmap");
+		JASS::instream_mmap::unittest();
+
+		puts("instream_prefetch");
+		JASS::instream_prefetch::unittest();
+
+		puts("instream_zstd");
+		JASS::instream_zstd::unittest();
+
 		puts("instream_document_trec");
 		JASS::instream_document_trec::unittest();
 
 		puts("instream_document_warc");
 		JASS::instream_document_warc::unittest();
 
+		puts("instream_document_warc_parallel");
+		JASS::instream_document_warc_parallel::unittest();
+
 		puts("instream_document_fasta");
 		JASS::instream_document_fasta::unittest();
 
@@ -378,6 +439,9 @@ int main(void)
 		puts("hash_table");
 		JASS::hash_table<JASS::slice, JASS::slice>::unittest();
 
+		puts("hash_table_open");
+		JASS::hash_table_open<JASS::slice, JASS::slice>::unittest();
+
 		puts("dynamic_array");
 		JASS::dynamic_array<JASS::slice>::unittest();
 
@@ -393,6 +457,15 @@ int main(void)
 		puts("index_manager_sequential");
 		JASS::index_manager_sequential::unittest();
 
+		puts("index_manager_parallel");
+		JASS::index_manager_parallel::unittest();
+
+		puts("index_manager_spilling");
+		JASS::index_manager_spilling::unittest();
+
+		puts("index_manager_concurrent");
+		JASS::index_manager_concurrent::unittest();
+
 		puts("serialise_ci");
 		JASS::serialise_ci::unittest();
 
@@ -405,6 +478,15 @@ int main(void)
 		puts("serialise_forward_index");
 		JASS::serialise_forward_index::unittest();
 
+		puts("serialise_fan_out");
+		JASS::serialise_fan_out::unittest();
+
+		puts("merge_jass_v2");
+		JASS::merge_jass_v2::unittest();
+
+		puts("JASS_anytime_api");
+		JASS_anytime_api::unittest();
+
 		puts("compress_integer_elias_gamma_bitwise");
 		JASS::compress_integer_elias_gamma_bitwise::unittest();
 
@@ -495,12 +577,18 @@ int main(void)
 		puts("run_export");
 		JASS::run_export::unittest();
 
+		puts("collection_statistics");
+		JASS::collection_statistics::unittest();
+
 		puts("quantize");
 		JASS::quantize<JASS::ranking_function_atire_bm25>::unittest();
 
 		puts("compress_general_zlib");
 		JASS::compress_general_zlib::unittest();
 
+		puts("compress_general_zstd");
+		JASS::compress_general_zstd::unittest();
+
 		puts("ALL UNIT TESTS HAVE PASSED");
 		failed = false;
 		}